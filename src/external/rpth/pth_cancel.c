@@ -69,6 +69,11 @@ int pth_cancel(pth_t thread)
     /* now mark the thread as cancelled */
     thread->cancelreq = TRUE;
 
+    /* the event manager only checks waiting threads whose events epoll can't
+       report when it has to, so make sure it looks at this one */
+    if (thread->state == PTH_STATE_WAITING)
+        pth_gctx_get()->pth_WQ_nscan++;
+
     /* when cancellation is enabled in async mode we cancel the thread immediately */
     if (   thread->cancelstate & PTH_CANCEL_ENABLE
         && thread->cancelstate & PTH_CANCEL_ASYNCHRONOUS) {
@@ -86,6 +91,10 @@ int pth_cancel(pth_t thread)
             return pth_error(FALSE, ESRCH);
         pth_pqueue_delete(q, thread);
 
+        /* the thread never returns from pth_wait(), so stop watching its events */
+        if (thread->state == PTH_STATE_WAITING)
+            pth_event_unwatch(thread->events);
+
         /* execute cleanups */
         pth_thread_cleanup(thread);
 
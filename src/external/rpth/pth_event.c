@@ -40,6 +40,7 @@ struct pth_event_st {
     struct pth_event_st *ev_prev;
     pth_status_t ev_status;
     int ev_type;
+    pth_t ev_owner; /* the thread waiting for the event, set by pth_wait() */
     int ev_goal;
     union {
         struct { int fd; }                                          FD;
@@ -465,6 +466,22 @@ static void _pth_event_deregister(pth_event_t pth_ev) {
     }
 }
 
+/* stop watching all events of a ring that are still registered in the epoll
+   instance, e.g., when a waiting thread gets cancelled before pth_wait() returns */
+intern void pth_event_unwatch(pth_event_t ev_ring)
+{
+    pth_event_t ev;
+
+    if (ev_ring == NULL)
+        return;
+    ev = ev_ring;
+    do {
+        _pth_event_deregister(ev);
+        ev->ev_owner = NULL;
+        ev = ev->ev_next;
+    } while (ev != ev_ring);
+}
+
 /* wait for one or more events */
 int pth_wait(pth_event_t ev_ring)
 {
@@ -481,6 +498,7 @@ int pth_wait(pth_event_t ev_ring)
     do {
     	/* we are waiting for this event */
         ev->ev_status = PTH_STATUS_PENDING;
+        ev->ev_owner = pth_gctx_get()->pth_current;
 
         /* make sure we track events for this fd */
         _pth_event_register(ev);
@@ -513,6 +531,7 @@ int pth_wait(pth_event_t ev_ring)
 
         /* we no longer watch this fd until the next wait */
         _pth_event_deregister(ev);
+        ev->ev_owner = NULL;
 
         ev = ev->ev_next;
     } while (ev != ev_ring);
@@ -61,6 +61,7 @@ struct pth_gctx_st {
     pth_time_t   pth_loadtickgap;
 
     int main_efd; // epoll fd
+    int pth_WQ_nscan; // upper bound of waiting threads with events epoll can't report
 
     struct pth_keytab_st pth_keytab[PTH_KEY_MAX];
     pth_key_t ev_key_join;
@@ -77,6 +78,9 @@ struct pth_gctx_st {
 
     struct pth_atfork_st pth_atfork_list[PTH_ATFORK_MAX];
     int pth_atfork_idx;
+
+    struct pth_stackpool_entry_st *pth_stackpool_head; /* stacks of dead threads */
+    int          pth_stackpool_count;
 };
 
 #endif /* cpp */
@@ -233,9 +237,6 @@ static int pth_init_helper(void)
     }
     pth_attr_destroy(t_attr);
 
-    /* create our epoll instance, used for scheduling */
-    pth_gctx_get()->main_efd = epoll_create(1);
-
     /*
      * The first time we've to manually switch into the scheduler to start
      * threading. Because at this time the only non-scheduler thread is the
@@ -277,6 +278,7 @@ static int pth_kill_helper(void)
     pth_gctx_get()->pth_initialized = FALSE;
     pth_tcb_free(pth_gctx_get()->pth_sched);
     pth_tcb_free(pth_gctx_get()->pth_main);
+    pth_stackpool_drain();
     pth_syscall_kill();
 #ifdef PTH_EX
     __ex_ctx       = __ex_ctx_default;
@@ -706,6 +708,8 @@ int pth_resume(pth_t t)
     if (!pth_pqueue_contains(&pth_gctx_get()->pth_SQ, t))
         return pth_error(FALSE, EPERM);
     pth_pqueue_delete(&pth_gctx_get()->pth_SQ, t);
+    if (t->state == PTH_STATE_WAITING)
+        pth_gctx_get()->pth_WQ_nscan++;
     switch (t->state) {
         case PTH_STATE_NEW:     q = &pth_gctx_get()->pth_NQ; break;
         case PTH_STATE_READY:   q = &pth_gctx_get()->pth_RQ; break;
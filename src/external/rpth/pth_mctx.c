@@ -48,6 +48,8 @@ struct pth_mctx_st {
 #if PTH_MCTX_MTH(mcsc)
     ucontext_t uc;
     int restored;
+#elif PTH_MCTX_MTH(asm)
+    void *sp;
 #elif PTH_MCTX_MTH(sjlj)
     pth_sigjmpbuf jb;
 #else
@@ -64,6 +66,17 @@ struct pth_mctx_st {
 ** ____ MACHINE STATE SWITCHING ______________________________________
 */
 
+#if PTH_MCTX_MTH(asm)
+/*
+ * The asm method keeps the callee-saved registers and the FPU control
+ * words on the stack of the thread and only stores its stack pointer in
+ * `sp'. Switching therefore is a plain function call that neither
+ * saves nor restores the signal mask, so it never enters the kernel.
+ */
+#define pth_mctx_asm_switch __pth_mctx_asm_switch
+extern void pth_mctx_asm_switch(void **sp_old, void *sp_new);
+#endif
+
 /*
  * save the current machine context
  */
@@ -73,6 +86,8 @@ struct pth_mctx_st {
           (mctx)->restored = 0, \
           getcontext(&(mctx)->uc), \
           (mctx)->restored )
+#elif PTH_MCTX_MTH(asm)
+/* the asm method can only save a context while switching away from it */
 #elif PTH_MCTX_MTH(sjlj) && PTH_MCTX_DSP(sjlje)
 #define pth_mctx_save(mctx) \
         ( (mctx)->error = errno, \
@@ -95,6 +110,10 @@ struct pth_mctx_st {
         ( errno = (mctx)->error, \
           (mctx)->restored = 1, \
           (void)setcontext(&(mctx)->uc) )
+#elif PTH_MCTX_MTH(asm)
+#define pth_mctx_restore(mctx) \
+        ( errno = (mctx)->error, \
+          pth_mctx_asm_switch(NULL, (mctx)->sp) )
 #elif PTH_MCTX_MTH(sjlj)
 #define pth_mctx_restore(mctx) \
         ( errno = (mctx)->error, \
@@ -129,6 +148,12 @@ struct pth_mctx_st {
 #define pth_mctx_switch(old,new) \
     _pth_mctx_switch_debug \
     swapcontext(&((old)->uc), &((new)->uc));
+#elif PTH_MCTX_MTH(asm)
+#define pth_mctx_switch(old,new) \
+    _pth_mctx_switch_debug \
+    (old)->error = errno; \
+    pth_mctx_asm_switch(&((old)->sp), (new)->sp); \
+    errno = (old)->error;
 #elif PTH_MCTX_MTH(sjlj)
 #define pth_mctx_switch(old,new) \
     _pth_mctx_switch_debug \
@@ -180,6 +205,82 @@ intern int pth_mctx_set(
     return TRUE;
 }
 
+#elif PTH_MCTX_MTH(asm)
+
+/*
+ * VARIANT 6: HAND-WRITTEN X86_64 CONTEXT SWITCH
+ *
+ * This avoids swapcontext(3), which saves and restores the signal mask
+ * with a system call on every switch. The switch pushes the registers
+ * that the System V ABI requires a function to preserve, exchanges the
+ * stack pointers and pops the registers of the other context. A new
+ * context is a stack that looks as if it had been switched away from
+ * right before calling the start function.
+ */
+
+__asm__(
+    ".text\n"
+    ".globl __pth_mctx_asm_switch\n"
+    ".type __pth_mctx_asm_switch,@function\n"
+    ".p2align 4\n"
+    "__pth_mctx_asm_switch:\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    subq $8, %rsp\n"
+    "    stmxcsr (%rsp)\n"
+    "    fnstcw 4(%rsp)\n"
+    "    testq %rdi, %rdi\n"
+    "    jz 1f\n"
+    "    movq %rsp, (%rdi)\n"
+    "1:  movq %rsi, %rsp\n"
+    "    ldmxcsr (%rsp)\n"
+    "    fldcw 4(%rsp)\n"
+    "    addq $8, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".size __pth_mctx_asm_switch,.-__pth_mctx_asm_switch\n"
+);
+
+intern int pth_mctx_set(
+    pth_mctx_t *mctx, void (*func)(void), char *sk_addr_lo, char *sk_addr_hi)
+{
+    void **sp;
+    int i;
+
+    /* we need room for the initial frame below */
+    if (sk_addr_hi - sk_addr_lo < 16 * (int)sizeof(void *))
+        return pth_error(FALSE, EINVAL);
+
+    /* the start function is entered with a 16 byte aligned
+       stack plus a (never used) return address on top of it */
+    sp = (void **)((unsigned long)sk_addr_hi & ~((unsigned long)15));
+    *--sp = NULL;
+    *--sp = (void *)func;
+
+    /* rbp, rbx, r12, r13, r14, r15 */
+    for (i = 0; i < 6; i++)
+        *--sp = NULL;
+
+    /* the new context inherits the current FPU control words */
+    *--sp = NULL;
+    __asm__ __volatile__ ("stmxcsr %0" : "=m" (*(unsigned int *)sp));
+    __asm__ __volatile__ ("fnstcw %0" : "=m" (*((unsigned short *)sp + 2)));
+
+    mctx->sp = sp;
+    sigemptyset(&mctx->sigs);
+    mctx->error = 0;
+    return TRUE;
+}
+
 #elif PTH_MCTX_MTH(sjlj)     &&\
       !PTH_MCTX_DSP(sjljlx)  &&\
       !PTH_MCTX_DSP(sjljisc) &&\
@@ -27,6 +27,11 @@
                                      -- Unknown   */
 #include "pth_p.h"
 
+/* the most epoll events the event manager collects in one pass */
+#define PTH_SCHED_MAXEVENTS 100
+
+static int rpth_epoll_ctl_helper(int epollfd, int op, int fd, void* data, uint32_t evset);
+
 /* initialize the scheduler ingredients */
 intern int pth_scheduler_init(void)
 {
@@ -38,6 +43,21 @@ intern int pth_scheduler_init(void)
     if (pth_fdmode(pth_gctx_get()->pth_sigpipe[1], PTH_FDMODE_NONBLOCK) == PTH_FDMODE_ERROR)
         return pth_error(FALSE, errno);
 
+    /* create our epoll instance, used for scheduling. pth_wait() adds the fds
+       of the events a thread waits for and removes them again when it returns,
+       so the event manager never has to rebuild the interest set. */
+    pth_gctx_get()->main_efd = epoll_create(1);
+    if (pth_gctx_get()->main_efd < 0)
+        return pth_error(FALSE, errno);
+    pth_gctx_get()->pth_WQ_nscan = 0;
+
+    /* only the blocking event manager waits for signals through the pipe */
+    if (!pth_gctx_get()->pth_is_async) {
+        if (rpth_epoll_ctl_helper(pth_gctx_get()->main_efd, (int)EPOLL_CTL_ADD,
+                                  pth_gctx_get()->pth_sigpipe[0], NULL, (uint32_t)EPOLLIN) < 0)
+            return pth_error(FALSE, errno);
+    }
+
     /* initialize the essential threads */
     pth_gctx_get()->pth_sched   = NULL;
     pth_gctx_get()->pth_current = NULL;
@@ -100,9 +120,49 @@ intern void pth_scheduler_kill(void)
     /* remove the internal signal pipe */
     close(pth_gctx_get()->pth_sigpipe[0]);
     close(pth_gctx_get()->pth_sigpipe[1]);
+
+    /* remove the epoll instance */
+    close(pth_gctx_get()->main_efd);
     return;
 }
 
+/* returns TRUE if the thread waits for an event that epoll does not report,
+   so that the event manager has to check on it in every pass */
+static int pth_sched_needs_scan(pth_t t)
+{
+    pth_event_t ev;
+
+    if (t->cancelreq == TRUE)
+        return TRUE;
+    if (t->events == NULL)
+        return FALSE;
+    ev = t->events;
+    do {
+        if (ev->ev_type != PTH_EVENT_FD
+            && ev->ev_type != PTH_EVENT_TIME
+            && ev->ev_type != PTH_EVENT_FUNC)
+            return TRUE;
+    } while ((ev = ev->ev_next) != t->events);
+    return FALSE;
+}
+
+/* move a waiting thread whose events occurred to the ready queue */
+static void pth_sched_wakeup(pth_t t)
+{
+    pth_pqueue_delete(&pth_gctx_get()->pth_WQ, t);
+    t->state = PTH_STATE_READY;
+    /*
+     * we insert it with a slightly increased queue priority to it a
+     * better chance to immediately get scheduled, else the last running
+     * thread might immediately get again the CPU which is usually not
+     * what we want, because we oven use pth_yield() calls to give others
+     * a chance.
+     */
+    pth_pqueue_insert(&pth_gctx_get()->pth_RQ, t->prio+1, t);
+    pth_debug2("pth_sched_eventmanager: thread \"%s\" moved from waiting "
+               "to ready queue", t->name);
+}
+
 
 static int pth_sched_check_pth_events(pth_t t) {
     if(!t || !t->events) {
@@ -221,8 +281,8 @@ static void pth_sched_eventmanager_async(pth_time_t *now) {
     }
 
     /* check for events without blocking!! */
-    struct epoll_event* events_ready = calloc(100, sizeof(struct epoll_event));
-    int n_events_ready = pth_sc(epoll_wait)(pth_gctx_get()->main_efd, events_ready, 100, 0);
+    struct epoll_event events_ready[PTH_SCHED_MAXEVENTS];
+    int n_events_ready = pth_sc(epoll_wait)(pth_gctx_get()->main_efd, events_ready, PTH_SCHED_MAXEVENTS, 0);
 
     /* mark events based on the status we got from epoll */
     int i;
@@ -258,13 +318,39 @@ static void pth_sched_eventmanager_async(pth_time_t *now) {
         }
     }
 
-    /* cleanup */
-    free(events_ready);
-    events_ready = NULL;
+    /*
+     * if every waiting thread only waits for events that epoll reports, then
+     * only the owners of the events epoll just returned can have become ready.
+     * suspended threads are not in the waiting queue, so we don't take the
+     * shortcut while there are any.
+     */
+    if (pth_gctx_get()->pth_WQ_nscan == 0
+        && pth_pqueue_elements(&pth_gctx_get()->pth_SQ) == 0) {
+        for(i = 0; i < n_events_ready; i++) {
+            pth_event_t ev = (pth_event_t) events_ready[i].data.ptr;
+            if(!ev || !ev->ev_owner) {
+                continue;
+            }
+
+            /* the owner may have several ready events, but it only moves once */
+            pth_t t = ev->ev_owner;
+            if (t->state != PTH_STATE_WAITING) {
+                continue;
+            }
+            if (pth_sched_check_pth_events(t) > 0) {
+                pth_sched_wakeup(t);
+            }
+        }
+
+        pth_debug1("pth_sched_eventmanager: leaving");
+        return;
+    }
 
     /* now comes the final cleanup loop where we've to do two jobs:
      * 1 handle all pth event types for all threads
-     * 2 move threads with occurred events from the waiting queue to the ready queue */
+     * 2 move threads with occurred events from the waiting queue to the ready queue
+     * while we are at it, count the threads that still need this on the next pass */
+    int n_scan = 0;
     pth_t t = pth_pqueue_head(&pth_gctx_get()->pth_WQ);
     pth_t tlast = NULL;
     while (t != NULL) {
@@ -282,22 +368,14 @@ static void pth_sched_eventmanager_async(pth_time_t *now) {
         tlast = t;
         t = pth_pqueue_walk(&pth_gctx_get()->pth_WQ, t, PTH_WALK_NEXT);
 
-        /*
-         * move last thread to ready queue if any events occurred for it.
-         * we insert it with a slightly increased queue priority to it a
-         * better chance to immediately get scheduled, else the last running
-         * thread might immediately get again the CPU which is usually not
-         * what we want, because we oven use pth_yield() calls to give others
-         * a chance.
-         */
+        /* move last thread to ready queue if any events occurred for it */
         if (n_events_occurred > 0) {
-            pth_pqueue_delete(&pth_gctx_get()->pth_WQ, tlast);
-            tlast->state = PTH_STATE_READY;
-            pth_pqueue_insert(&pth_gctx_get()->pth_RQ, tlast->prio+1, tlast);
-            pth_debug2("pth_sched_eventmanager: thread \"%s\" moved from waiting "
-                       "to ready queue", tlast->name);
+            pth_sched_wakeup(tlast);
+        } else if (pth_sched_needs_scan(tlast)) {
+            n_scan++;
         }
     }
+    pth_gctx_get()->pth_WQ_nscan = n_scan;
 
     pth_debug1("pth_sched_eventmanager: leaving");
     return;
@@ -527,6 +605,8 @@ intern void *pth_scheduler(void *dummy)
             pth_debug2("pth_scheduler: moving thread \"%s\" to waiting queue",
                     pth_gctx_get()->pth_current->name);
             pth_pqueue_insert(&pth_gctx_get()->pth_WQ, pth_gctx_get()->pth_current->prio, pth_gctx_get()->pth_current);
+            if (pth_sched_needs_scan(pth_gctx_get()->pth_current))
+                pth_gctx_get()->pth_WQ_nscan++;
             pth_gctx_get()->pth_current = NULL;
         }
 
@@ -571,11 +651,11 @@ intern void *pth_scheduler(void *dummy)
 }
 
 static int rpth_epoll_ctl_helper(int epollfd, int op, int fd, void* data, uint32_t evset) {
-    struct epoll_event* epollev = calloc(1, sizeof(struct epoll_event));
-    epollev->events = evset;
-    epollev->data.ptr = data;
-    int ret = epoll_ctl(epollfd, op, fd, epollev);
-    free(epollev);
+    struct epoll_event epollev;
+    memset(&epollev, 0, sizeof(epollev));
+    epollev.events = evset;
+    epollev.data.ptr = data;
+    int ret = epoll_ctl(epollfd, op, fd, &epollev);
     if(ret == 0) {
         /* all good, 1 fd got added */
         return 1;
@@ -611,8 +691,7 @@ intern void pth_sched_eventmanager(pth_time_t *now, int dopoll)
     int loop_repeat;
     int n_events_ready;
     int sig;
-    int epollfd;
-    int nepollevs;
+    struct epoll_event readyevs[PTH_SCHED_MAXEVENTS];
 
     pth_debug2("pth_sched_eventmanager: enter in %s mode",
                dopoll ? "polling" : "waiting");
@@ -621,14 +700,6 @@ intern void pth_sched_eventmanager(pth_time_t *now, int dopoll)
     loop_entry:
     loop_repeat = FALSE;
 
-    /* initialize epoll */
-    nepollevs = 0;
-    epollfd = epoll_create(1);
-    if(epollfd < 0) {
-        pth_debug2("pth_sched_eventmanager: epoll_create failed: error %d", errno);
-        abort(); // FIXME how to handle error here?
-    }
-
     /* initialize signal status */
     sigpending(&pth_gctx_get()->pth_sigpending);
     sigfillset(&pth_gctx_get()->pth_sigblock);
@@ -666,24 +737,7 @@ intern void pth_sched_eventmanager(pth_time_t *now, int dopoll)
                 /* Filedescriptor I/O */
                 if (ev->ev_type == PTH_EVENT_FD) {
                     /* filedescriptors are checked later all at once.
-                       Here we only track them in the epoll instance. */
-                    uint32_t evset = 0;
-                    if (ev->ev_goal & PTH_UNTIL_FD_READABLE)
-                        evset |= EPOLLIN;
-                    if (ev->ev_goal & PTH_UNTIL_FD_WRITEABLE)
-                        evset |= EPOLLOUT;
-                    if (ev->ev_goal & PTH_UNTIL_FD_EXCEPTION)
-                        evset |= EPOLLERR;
-                    if(evset != 0) {
-                        int retval = rpth_epoll_ctl_helper(epollfd, (int)EPOLL_CTL_ADD, ev->ev_args.FD.fd, ev, evset);
-                        if(retval < 0) {
-                            ev->ev_status = PTH_STATUS_FAILED;
-                            pth_debug3("pth_sched_eventmanager: "
-                                       "[I/O] event failed for thread \"%s\" fd %d", t->name, ev->ev_args.FD.fd);
-                        } else {
-                            nepollevs++;
-                        }
-                    }
+                       pth_wait() already tracks them in the epoll instance. */
                 }
                 /* Signal Set */
                 else if (ev->ev_type == PTH_EVENT_SIGS) {
@@ -786,11 +840,10 @@ intern void pth_sched_eventmanager(pth_time_t *now, int dopoll)
     if (any_occurred)
         dopoll = TRUE;
 
-    /* clear pipe and let select() wait for the read-part of the pipe */
+    /* clear pipe and let epoll wait for the read-part of the pipe,
+       which was added to the epoll instance in pth_scheduler_init() */
     while (pth_sc(read)(pth_gctx_get()->pth_sigpipe[0], minibuf, sizeof(minibuf)) > 0) ;
-    nepollevs += rpth_epoll_ctl_helper(epollfd, (int)EPOLL_CTL_ADD, pth_gctx_get()->pth_sigpipe[0], NULL, (uint32_t)EPOLLIN);
 
-    struct epoll_event* readyevs = calloc(nepollevs, sizeof(struct epoll_event));
     int epoll_timeout;
 
     if (dopoll) {
@@ -828,10 +881,9 @@ intern void pth_sched_eventmanager(pth_time_t *now, int dopoll)
 
     /* now decide how and do the polling for fd I/O and timers
        WHEN THE SCHEDULER SLEEPS AT ALL, THEN HERE!! */
-    n_events_ready = -1;
-    if (!(dopoll && nepollevs == 0))
-        while ((n_events_ready = pth_sc(epoll_wait)(epollfd, readyevs, nepollevs, epoll_timeout)) < 0
-               && errno == EINTR) ;
+    while ((n_events_ready = pth_sc(epoll_wait)(pth_gctx_get()->main_efd, readyevs,
+                                                PTH_SCHED_MAXEVENTS, epoll_timeout)) < 0
+           && errno == EINTR) ;
 
     /* restore signal mask and actions and handle signals */
     pth_sc(sigprocmask)(SIG_SETMASK, &oss, NULL);
@@ -855,8 +907,8 @@ intern void pth_sched_eventmanager(pth_time_t *now, int dopoll)
     }
 
     /* if an error occurred, avoid confusion in the cleanup loop */
-    if (n_events_ready <= 0) {
-        memset(readyevs, 0, nepollevs * sizeof(struct epoll_event));
+    if (n_events_ready < 0) {
+        n_events_ready = 0;
     }
 
     /* now comes the final cleanup loop where we've to
@@ -893,6 +945,20 @@ intern void pth_sched_eventmanager(pth_time_t *now, int dopoll)
                     ev->ev_status = PTH_STATUS_OCCURRED;
                 }
             }
+            /* Timer */
+            else if (ev->ev_type == PTH_EVENT_TIME) {
+                /* the timerfd that pth_wait() armed for the event expired */
+                uint64_t n_expirations = 0;
+                if (pth_sc(read)(ev->ev_args.TIME.fd, &n_expirations, 8) > 0 && n_expirations > 0)
+                    ev->ev_status = PTH_STATUS_OCCURRED;
+            }
+            /* Custom Event Function */
+            else if (ev->ev_type == PTH_EVENT_FUNC) {
+                /* drain the timerfd and check the function again */
+                uint64_t n_expirations = 0;
+                if (pth_sc(read)(ev->ev_args.FUNC.fd, &n_expirations, 8) > 0 && n_expirations > 0)
+                    loop_repeat = TRUE;
+            }
             /* Signal Set */
             else if (ev->ev_type == PTH_EVENT_SIGS) {
                 for (sig = 1; sig < PTH_NSIG; sig++) {
@@ -967,11 +1033,6 @@ intern void pth_sched_eventmanager(pth_time_t *now, int dopoll)
         }
     }
 
-    if(epollfd > -1)
-        close(epollfd);
-    if(readyevs)
-        free(readyevs);
-
     /* perhaps we have to internally loop... */
     if (loop_repeat) {
         pth_time_set(now, PTH_TIME_NOW);
@@ -108,6 +108,122 @@ intern const char *pth_state_names[] = {
 #endif
 #endif
 
+/*
+ * Stacks are mapped with an inaccessible guard page at their end, so
+ * that an overflow faults instead of silently corrupting the heap. The
+ * kernel only backs the pages a thread actually touches. The stacks of
+ * dead threads are kept on a free list in the global context and handed
+ * to the next thread it spawns with the same stack size, which saves the
+ * mapping system calls when virtual threads come and go at high rates.
+ * The list is unmapped when the context is killed.
+ */
+#define PTH_TCB_STACKPOOL_MAX 64
+
+typedef struct pth_stackpool_entry_st pth_stackpool_entry_t;
+struct pth_stackpool_entry_st {
+    pth_stackpool_entry_t *next;
+    size_t                 size;
+};
+
+static size_t pth_stack_pagesize(void)
+{
+    static size_t pagesize = 0;
+    if (pagesize == 0)
+        pagesize = (size_t)sysconf(_SC_PAGESIZE);
+    return pagesize;
+}
+
+/* the stack size rounded up to whole pages */
+static size_t pth_stack_mapsize(unsigned int stacksize)
+{
+    size_t pagesize = pth_stack_pagesize();
+    return ((size_t)stacksize + pagesize - 1) & ~(pagesize - 1);
+}
+
+static char *pth_stack_alloc(unsigned int stacksize)
+{
+    size_t size = pth_stack_mapsize(stacksize);
+    size_t pagesize = pth_stack_pagesize();
+    pth_stackpool_entry_t *entry;
+    pth_stackpool_entry_t **prev;
+    pth_gctx_t gctx = pth_gctx_get();
+    char *map;
+
+    /* reuse a stack of a dead thread if we have one of the right size */
+    for (prev = &gctx->pth_stackpool_head; *prev != NULL; prev = &(*prev)->next) {
+        entry = *prev;
+        if (entry->size == size) {
+            *prev = entry->next;
+            gctx->pth_stackpool_count--;
+            /* new stacks are zeroed, so drop the old contents; the kernel
+             * gives us zero pages again when the new thread touches them */
+            madvise((void *)entry, size, MADV_DONTNEED);
+            return (char *)entry;
+        }
+    }
+
+    map = (char *)mmap(NULL, size + pagesize, PROT_READ|PROT_WRITE,
+                       MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    if (map == MAP_FAILED)
+        return NULL;
+#if PTH_STACKGROWTH < 0
+    if (mprotect(map, pagesize, PROT_NONE) != 0) {
+        pth_shield { munmap(map, size + pagesize); }
+        return NULL;
+    }
+    return map + pagesize;
+#else
+    if (mprotect(map + size, pagesize, PROT_NONE) != 0) {
+        pth_shield { munmap(map, size + pagesize); }
+        return NULL;
+    }
+    return map;
+#endif
+}
+
+static void pth_stack_unmap(char *stack, size_t size)
+{
+    size_t pagesize = pth_stack_pagesize();
+#if PTH_STACKGROWTH < 0
+    munmap(stack - pagesize, size + pagesize);
+#else
+    munmap(stack, size + pagesize);
+#endif
+}
+
+static void pth_stack_free(char *stack, unsigned int stacksize)
+{
+    size_t size = pth_stack_mapsize(stacksize);
+    pth_gctx_t gctx = pth_gctx_get();
+    pth_stackpool_entry_t *entry;
+
+    if (gctx != NULL && gctx->pth_stackpool_count < PTH_TCB_STACKPOOL_MAX) {
+        entry = (pth_stackpool_entry_t *)stack;
+        entry->size = size;
+        entry->next = gctx->pth_stackpool_head;
+        gctx->pth_stackpool_head = entry;
+        gctx->pth_stackpool_count++;
+        return;
+    }
+
+    pth_stack_unmap(stack, size);
+}
+
+/* unmap the stacks of dead threads that the global context keeps for reuse */
+intern void pth_stackpool_drain(void)
+{
+    pth_gctx_t gctx = pth_gctx_get();
+    pth_stackpool_entry_t *entry;
+
+    if (gctx == NULL)
+        return;
+    while ((entry = gctx->pth_stackpool_head) != NULL) {
+        gctx->pth_stackpool_head = entry->next;
+        pth_stack_unmap((char *)entry, entry->size);
+    }
+    gctx->pth_stackpool_count = 0;
+}
+
 /* allocate a thread control block */
 intern pth_t pth_tcb_alloc(unsigned int stacksize, void *stackaddr)
 {
@@ -128,7 +244,7 @@ intern pth_t pth_tcb_alloc(unsigned int stacksize, void *stackaddr)
         if (stackaddr != NULL)
             t->stack = (char *)(stackaddr);
         else {
-            if ((t->stack = (char *)calloc(1, stacksize)) == NULL) {
+            if ((t->stack = pth_stack_alloc(stacksize)) == NULL) {
                 pth_shield { free(t); }
                 return NULL;
             }
@@ -168,9 +284,10 @@ intern void pth_tcb_free(pth_t t)
               t->stacksize, t->stack, &t->stack[t->stacksize], t->valgrind_id);
 #endif
 #endif
-            memset(t->stack, 0, (size_t)t->stacksize);
+            pth_stack_free(t->stack, t->stacksize);
         }
-        free(t->stack);
+        else
+            free(t->stack);
     }
     if (t->data_value != NULL)
         free(t->data_value);
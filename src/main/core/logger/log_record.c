@@ -6,192 +6,711 @@
 #include "main/core/logger/log_record.h"
 
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 
 #include "main/utility/utility.h"
 
-struct _LogRecord {
-    /* required */
-    LogLevel level;
-    gchar* callInfo;
+/* the longest conversion specification we copy to format an argument */
+#define LOG_FORMAT_SPEC_MAX_LENGTH 64
+
+/* the length we store for a NULL string */
+#define LOG_STRING_NULL G_MAXUINT32
+
+typedef enum _LogArgType LogArgType;
+enum _LogArgType {
+    /* a conversion that takes no argument (%%) */
+    LOG_ARG_NONE,
+    LOG_ARG_INT, LOG_ARG_LONG, LOG_ARG_LONGLONG, LOG_ARG_SIZE, LOG_ARG_INTMAX, LOG_ARG_PTRDIFF,
+    LOG_ARG_DOUBLE, LOG_ARG_LONGDOUBLE,
+    LOG_ARG_STRING, LOG_ARG_POINTER,
+    /* a conversion we can't defer, the message is formatted when it is logged */
+    LOG_ARG_UNSUPPORTED,
+};
 
-    /* optional */
-    SimulationTime simElapsedNanos;
-    gdouble wallElapsedSeconds;
-    gchar* threadName;
-    gchar* hostName;
-    gchar* message;
+typedef enum _LogLengthModifier LogLengthModifier;
+enum _LogLengthModifier {
+    LOG_LENGTH_NONE, LOG_LENGTH_CHAR, LOG_LENGTH_SHORT, LOG_LENGTH_LONG, LOG_LENGTH_LONGLONG,
+    LOG_LENGTH_LONGDOUBLE, LOG_LENGTH_INTMAX, LOG_LENGTH_SIZE, LOG_LENGTH_PTRDIFF,
+};
+
+/* a conversion specification in a format, from the '%' to the conversion character */
+typedef struct _LogFormatSpec LogFormatSpec;
+struct _LogFormatSpec {
+    gsize length;
+    /* the number of '*' for the width and precision, each takes an int argument */
+    guint numStars;
+    LogArgType type;
+};
+
+struct _LogCallsite {
+    guint32 id;
+    gint lineNumber;
+    gchar* baseName;
+    gchar* functionName;
+    gchar* format;
+
+    /* the arguments the format takes, in order, including widths and
+     * precisions given with '*' */
+    guint8* argTypes;
+    guint numArgs;
+    /* records hold the formatted message instead of the arguments */
+    gboolean isPreformatted;
 
-    /* for memory management */
-    gint referenceCount;
     MAGIC_DECLARE;
 };
 
-LogRecord* logrecord_new(LogLevel level, gdouble timespan, const gchar* fileName, const gchar* functionName, const gint lineNumber) {
-    LogRecord* record = g_new0(LogRecord, 1);
-    MAGIC_INIT(record);
+typedef struct _LogCallsiteEntry LogCallsiteEntry;
+struct _LogCallsiteEntry {
+    guint32 type;
+    guint32 id;
+    gint32 lineNumber;
+    guint32 isPreformatted;
+    /* followed by the base name, function name, and format, each terminated by a NUL */
+};
 
-    record->level = level;
-    record->simElapsedNanos = SIMTIME_INVALID;
-    record->wallElapsedSeconds = timespan;
+typedef struct _LogRecordEntry LogRecordEntry;
+struct _LogRecordEntry {
+    guint32 type;
+    guint32 callsiteID;
+    gint32 level;
+    gint32 threadID;
+    gdouble wallElapsedSeconds;
+    SimulationTime simElapsedNanos;
+    /* followed by the host name, the host IP, and the arguments (or the
+     * formatted message). numbers take 8 bytes (long doubles 16), and strings
+     * take a 4 byte length (including the NUL) and their bytes, padded to 8. */
+};
+
+typedef struct _LogIndirectEntry LogIndirectEntry;
+struct _LogIndirectEntry {
+    guint32 type;
+    guint32 padding;
+    gpointer record;
+};
+
+/* reads the arguments of a record */
+typedef struct _LogRecordReader LogRecordReader;
+struct _LogRecordReader {
+    const guchar* data;
+    gsize offset;
+};
 
-    gchar* baseName = (fileName != NULL) ? g_path_get_basename(fileName) : NULL;
+static inline gsize _logrecord_align(gsize offset) {
+    return (offset + 7) & ~((gsize)7);
+}
+
+static void _logrecord_parseSpec(const gchar* spec, LogFormatSpec* result) {
+    utility_assert(spec[0] == '%');
+    const gchar* position = &spec[1];
 
-    record->callInfo = g_strdup_printf("[%s:%i] [%s]",
-            (baseName != NULL) ? baseName : "n/a", lineNumber, functionName ? functionName : "n/a");
+    result->numStars = 0;
 
-    if(baseName != NULL) {
-        g_free(baseName);
+    if(*position == '%') {
+        result->length = 2;
+        result->type = LOG_ARG_NONE;
+        return;
     }
 
-    return record;
-}
+    result->type = LOG_ARG_UNSUPPORTED;
 
-static void _logrecord_free(LogRecord* record) {
-    MAGIC_ASSERT(record);
+    /* flags */
+    while(*position && strchr("-+ #0'I", *position)) {
+        position++;
+    }
 
-    if(record->callInfo != NULL) {
-        g_free(record->callInfo);
+    /* width */
+    if(*position == '*') {
+        result->numStars++;
+        position++;
+    } else {
+        while(g_ascii_isdigit(*position)) {
+            position++;
+        }
     }
-    if(record->hostName != NULL) {
-        g_free(record->hostName);
+
+    /* positional arguments (%1$d) would need all arguments at once */
+    if(*position == '$') {
+        result->length = (gsize)(position - spec) + 1;
+        return;
     }
-    if(record->threadName != NULL) {
-        g_free(record->threadName);
+
+    /* precision */
+    gboolean hasPrecision = FALSE;
+    if(*position == '.') {
+        hasPrecision = TRUE;
+        position++;
+        if(*position == '*') {
+            result->numStars++;
+            position++;
+        } else {
+            while(g_ascii_isdigit(*position)) {
+                position++;
+            }
+        }
     }
-    if(record->message != NULL) {
-        g_free(record->message);
+
+    /* length modifier */
+    LogLengthModifier modifier = LOG_LENGTH_NONE;
+    switch(*position) {
+        case 'h':
+            position++;
+            modifier = LOG_LENGTH_SHORT;
+            if(*position == 'h') {
+                position++;
+                modifier = LOG_LENGTH_CHAR;
+            }
+            break;
+        case 'l':
+            position++;
+            modifier = LOG_LENGTH_LONG;
+            if(*position == 'l') {
+                position++;
+                modifier = LOG_LENGTH_LONGLONG;
+            }
+            break;
+        case 'q':
+            position++;
+            modifier = LOG_LENGTH_LONGLONG;
+            break;
+        case 'L':
+            position++;
+            modifier = LOG_LENGTH_LONGDOUBLE;
+            break;
+        case 'j':
+            position++;
+            modifier = LOG_LENGTH_INTMAX;
+            break;
+        case 'z':
+        case 'Z':
+            position++;
+            modifier = LOG_LENGTH_SIZE;
+            break;
+        case 't':
+            position++;
+            modifier = LOG_LENGTH_PTRDIFF;
+            break;
+        default:
+            break;
     }
 
-    MAGIC_CLEAR(record);
-    g_free(record);
-}
+    if(*position == '\0') {
+        /* the format ends in the middle of the specification */
+        result->length = (gsize)(position - spec);
+        return;
+    }
+    result->length = (gsize)(position - spec) + 1;
+
+    switch(*position) {
+        case 'd':
+        case 'i':
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X': {
+            switch(modifier) {
+                case LOG_LENGTH_NONE:
+                case LOG_LENGTH_CHAR:
+                case LOG_LENGTH_SHORT:
+                    result->type = LOG_ARG_INT;
+                    break;
+                case LOG_LENGTH_LONG:
+                    result->type = LOG_ARG_LONG;
+                    break;
+                case LOG_LENGTH_LONGLONG:
+                case LOG_LENGTH_LONGDOUBLE:
+                    result->type = LOG_ARG_LONGLONG;
+                    break;
+                case LOG_LENGTH_INTMAX:
+                    result->type = LOG_ARG_INTMAX;
+                    break;
+                case LOG_LENGTH_SIZE:
+                    result->type = LOG_ARG_SIZE;
+                    break;
+                case LOG_LENGTH_PTRDIFF:
+                    result->type = LOG_ARG_PTRDIFF;
+                    break;
+            }
+            break;
+        }
+
+        case 'c': {
+            /* wide characters depend on the locale of the logging thread */
+            result->type = (modifier == LOG_LENGTH_NONE) ? LOG_ARG_INT : LOG_ARG_UNSUPPORTED;
+            break;
+        }
+
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A': {
+            result->type = (modifier == LOG_LENGTH_LONGDOUBLE) ? LOG_ARG_LONGDOUBLE : LOG_ARG_DOUBLE;
+            break;
+        }
+
+        case 's': {
+            /* with a precision, the string need not be terminated, so we can't copy it */
+            result->type = (modifier == LOG_LENGTH_NONE && !hasPrecision) ?
+                    LOG_ARG_STRING : LOG_ARG_UNSUPPORTED;
+            break;
+        }
+
+        case 'p': {
+            result->type = LOG_ARG_POINTER;
+            break;
+        }
+
+        default: {
+            /* %n, %m (which reads errno), wide strings, or garbage */
+            result->type = LOG_ARG_UNSUPPORTED;
+            break;
+        }
+    }
 
-void logrecord_ref(LogRecord* record) {
-    MAGIC_ASSERT(record);
-    record->referenceCount++;
+    if(result->length > LOG_FORMAT_SPEC_MAX_LENGTH) {
+        result->type = LOG_ARG_UNSUPPORTED;
+    }
 }
 
-void logrecord_unref(LogRecord* record) {
-    MAGIC_ASSERT(record);
-    record->referenceCount--;
-    if(record->referenceCount <= 0) {
-        _logrecord_free(record);
+static void _logcallsite_parseFormat(LogCallsite* callsite) {
+    GByteArray* argTypes = g_byte_array_new();
+
+    const gchar* position = callsite->format;
+    while((position = strchr(position, '%')) != NULL) {
+        LogFormatSpec spec;
+        _logrecord_parseSpec(position, &spec);
+
+        if(spec.type == LOG_ARG_UNSUPPORTED) {
+            callsite->isPreformatted = TRUE;
+            break;
+        }
+
+        for(guint i = 0; i < spec.numStars; i++) {
+            guint8 type = LOG_ARG_INT;
+            g_byte_array_append(argTypes, &type, 1);
+        }
+        if(spec.type != LOG_ARG_NONE) {
+            guint8 type = (guint8)spec.type;
+            g_byte_array_append(argTypes, &type, 1);
+        }
+
+        position += spec.length;
+    }
+
+    if(callsite->isPreformatted) {
+        g_byte_array_free(argTypes, TRUE);
+    } else {
+        callsite->numArgs = argTypes->len;
+        callsite->argTypes = g_byte_array_free(argTypes, FALSE);
     }
 }
 
-gint logrecord_compare(const LogRecord* a, const LogRecord* b, gpointer userData) {
-    MAGIC_ASSERT(a);
-    MAGIC_ASSERT(b);
-    return a->wallElapsedSeconds < b->wallElapsedSeconds ? -1 : a->wallElapsedSeconds > b->wallElapsedSeconds ? 1 : 0;
+LogCallsite* logcallsite_new(guint32 id, const gchar* fileName, const gchar* functionName,
+        gint lineNumber, const gchar* format) {
+    LogCallsite* callsite = g_new0(LogCallsite, 1);
+    MAGIC_INIT(callsite);
+
+    callsite->id = id;
+    callsite->lineNumber = lineNumber;
+    callsite->baseName = g_path_get_basename((fileName != NULL) ? fileName : "n/a");
+    callsite->functionName = g_strdup((functionName != NULL) ? functionName : "n/a");
+
+    if(format != NULL) {
+        callsite->format = g_strdup(format);
+        _logcallsite_parseFormat(callsite);
+    } else {
+        callsite->format = g_strdup("NOMESSAGE");
+    }
+
+    return callsite;
 }
 
-void logrecord_setTime(LogRecord* record, SimulationTime simElapsedNanos) {
-    MAGIC_ASSERT(record);
-    record->simElapsedNanos = simElapsedNanos;
+LogCallsite* logcallsite_decode(gconstpointer entry, gsize length) {
+    const LogCallsiteEntry* header = entry;
+    utility_assert(length > sizeof(LogCallsiteEntry));
+    utility_assert(header->type == LOG_ENTRY_CALLSITE);
+
+    LogCallsite* callsite = g_new0(LogCallsite, 1);
+    MAGIC_INIT(callsite);
+
+    callsite->id = header->id;
+    callsite->lineNumber = header->lineNumber;
+    callsite->isPreformatted = header->isPreformatted ? TRUE : FALSE;
+
+    const gchar* strings = (const gchar*)&header[1];
+    callsite->baseName = g_strdup(strings);
+    strings += strlen(strings) + 1;
+    callsite->functionName = g_strdup(strings);
+    strings += strlen(strings) + 1;
+    callsite->format = g_strdup(strings);
+
+    /* the helper walks the format again when formatting a record, so it
+     * does not need the argument types */
+    return callsite;
 }
 
-void logrecord_setNames(LogRecord* record, const gchar* threadName, const gchar* hostName) {
-    MAGIC_ASSERT(record);
+void logcallsite_free(LogCallsite* callsite) {
+    MAGIC_ASSERT(callsite);
 
-    /* free the old ones if they exist */
-    if(record->hostName != NULL) {
-        g_free(record->hostName);
-        record->hostName = NULL;
+    g_free(callsite->baseName);
+    g_free(callsite->functionName);
+    g_free(callsite->format);
+    if(callsite->argTypes) {
+        g_free(callsite->argTypes);
     }
-    if(record->threadName != NULL) {
-        g_free(record->threadName);
-        record->threadName = NULL;
+
+    MAGIC_CLEAR(callsite);
+    g_free(callsite);
+}
+
+guint32 logcallsite_getID(LogCallsite* callsite) {
+    MAGIC_ASSERT(callsite);
+    return callsite->id;
+}
+
+/* grows the buffer by size bytes and returns the new space */
+static inline gpointer _logrecord_reserve(GByteArray* buffer, gsize size) {
+    guint offset = buffer->len;
+    g_byte_array_set_size(buffer, offset + (guint)size);
+    return &buffer->data[offset];
+}
+
+void logrecord_encodeCallsite(GByteArray* buffer, LogCallsite* callsite) {
+    MAGIC_ASSERT(callsite);
+
+    gsize baseNameLength = strlen(callsite->baseName) + 1;
+    gsize functionNameLength = strlen(callsite->functionName) + 1;
+    gsize formatLength = strlen(callsite->format) + 1;
+
+    g_byte_array_set_size(buffer, 0);
+
+    LogCallsiteEntry* header = _logrecord_reserve(buffer, sizeof(LogCallsiteEntry));
+    header->type = LOG_ENTRY_CALLSITE;
+    header->id = callsite->id;
+    header->lineNumber = callsite->lineNumber;
+    header->isPreformatted = callsite->isPreformatted ? 1 : 0;
+
+    g_byte_array_append(buffer, (const guint8*)callsite->baseName, (guint)baseNameLength);
+    g_byte_array_append(buffer, (const guint8*)callsite->functionName, (guint)functionNameLength);
+    g_byte_array_append(buffer, (const guint8*)callsite->format, (guint)formatLength);
+}
+
+static inline void _logrecord_encodeNumber(GByteArray* buffer, guint64 value) {
+    guint64* slot = _logrecord_reserve(buffer, sizeof(guint64));
+    *slot = value;
+}
+
+static void _logrecord_encodeString(GByteArray* buffer, const gchar* string) {
+    guint32 length = (string != NULL) ? (guint32)strlen(string) + 1 : LOG_STRING_NULL;
+    gsize stringSize = (string != NULL) ? length : 0;
+
+    guchar* slot = _logrecord_reserve(buffer, _logrecord_align(sizeof(guint32) + stringSize));
+    memcpy(slot, &length, sizeof(guint32));
+    if(string != NULL) {
+        memcpy(&slot[sizeof(guint32)], string, stringSize);
     }
+}
 
-    /* save the new ones */
-    if(hostName != NULL) {
-        record->hostName = g_strdup(hostName);
+static void _logrecord_encodeFormatted(GByteArray* buffer, const gchar* format, va_list vargs) {
+    va_list vargsCopy;
+    va_copy(vargsCopy, vargs);
+    gint messageLength = g_vsnprintf(NULL, 0, format, vargsCopy);
+    va_end(vargsCopy);
+
+    guint32 length = (guint32)MAX(messageLength, 0) + 1;
+    guchar* slot = _logrecord_reserve(buffer, _logrecord_align(sizeof(guint32) + length));
+    memcpy(slot, &length, sizeof(guint32));
+    g_vsnprintf((gchar*)&slot[sizeof(guint32)], length, format, vargs);
+}
+
+void logrecord_encode(GByteArray* buffer, LogCallsite* callsite, LogLevel level,
+        gdouble wallElapsedSeconds, SimulationTime simElapsedNanos, gint threadID,
+        const gchar* hostName, const gchar* hostIP, va_list vargs) {
+    MAGIC_ASSERT(callsite);
+
+    g_byte_array_set_size(buffer, 0);
+
+    LogRecordEntry* header = _logrecord_reserve(buffer, sizeof(LogRecordEntry));
+    header->type = LOG_ENTRY_RECORD;
+    header->callsiteID = callsite->id;
+    header->level = (gint32)level;
+    header->threadID = (gint32)threadID;
+    header->wallElapsedSeconds = wallElapsedSeconds;
+    header->simElapsedNanos = simElapsedNanos;
+
+    _logrecord_encodeString(buffer, hostName);
+    _logrecord_encodeString(buffer, hostIP);
+
+    if(callsite->isPreformatted) {
+        _logrecord_encodeFormatted(buffer, callsite->format, vargs);
+        return;
     }
-    if(threadName != NULL) {
-        record->threadName = g_strdup(threadName);
+
+    for(guint i = 0; i < callsite->numArgs; i++) {
+        switch((LogArgType)callsite->argTypes[i]) {
+            case LOG_ARG_INT:
+                _logrecord_encodeNumber(buffer, (guint64)va_arg(vargs, int));
+                break;
+            case LOG_ARG_LONG:
+                _logrecord_encodeNumber(buffer, (guint64)va_arg(vargs, long));
+                break;
+            case LOG_ARG_LONGLONG:
+                _logrecord_encodeNumber(buffer, (guint64)va_arg(vargs, long long));
+                break;
+            case LOG_ARG_SIZE:
+                _logrecord_encodeNumber(buffer, (guint64)va_arg(vargs, size_t));
+                break;
+            case LOG_ARG_INTMAX:
+                _logrecord_encodeNumber(buffer, (guint64)va_arg(vargs, intmax_t));
+                break;
+            case LOG_ARG_PTRDIFF:
+                _logrecord_encodeNumber(buffer, (guint64)va_arg(vargs, ptrdiff_t));
+                break;
+            case LOG_ARG_POINTER:
+                _logrecord_encodeNumber(buffer, (guint64)(uintptr_t)va_arg(vargs, void*));
+                break;
+            case LOG_ARG_DOUBLE: {
+                gdouble value = va_arg(vargs, double);
+                gdouble* slot = _logrecord_reserve(buffer, sizeof(guint64));
+                *slot = value;
+                break;
+            }
+            case LOG_ARG_LONGDOUBLE: {
+                long double value = va_arg(vargs, long double);
+                guchar* slot = _logrecord_reserve(buffer, _logrecord_align(sizeof(long double)));
+                memcpy(slot, &value, sizeof(long double));
+                break;
+            }
+            case LOG_ARG_STRING:
+                _logrecord_encodeString(buffer, va_arg(vargs, const char*));
+                break;
+            default:
+                utility_assert(FALSE && "unexpected log argument type");
+                break;
+        }
     }
 }
 
-void logrecord_formatMessageVA(LogRecord* record, const gchar *messageFormat, va_list vargs) {
-    MAGIC_ASSERT(record);
+void logrecord_encodeIndirect(GByteArray* buffer, gpointer record) {
+    utility_assert(logrecord_getEntryType(record) == LOG_ENTRY_RECORD);
 
-    /* free the old one if it exists */
-    if(record->message != NULL) {
-        g_free(record->message);
-        record->message = NULL;
+    g_byte_array_set_size(buffer, 0);
+
+    LogIndirectEntry* header = _logrecord_reserve(buffer, sizeof(LogIndirectEntry));
+    header->type = LOG_ENTRY_RECORD_INDIRECT;
+    header->record = record;
+}
+
+LogEntryType logrecord_getEntryType(gconstpointer entry) {
+    return (LogEntryType)(*(const guint32*)entry);
+}
+
+gconstpointer logrecord_getRecord(gconstpointer entry) {
+    if(logrecord_getEntryType(entry) == LOG_ENTRY_RECORD_INDIRECT) {
+        return ((const LogIndirectEntry*)entry)->record;
     }
+    return entry;
+}
 
-    if(messageFormat != NULL) {
-        record->message = g_strdup_vprintf(messageFormat, vargs);
+void logrecord_freeIndirect(gconstpointer entry) {
+    if(logrecord_getEntryType(entry) == LOG_ENTRY_RECORD_INDIRECT) {
+        g_free(((const LogIndirectEntry*)entry)->record);
     }
 }
 
-void logrecord_formatMessage(LogRecord* record, const gchar *messageFormat, ...) {
-    MAGIC_ASSERT(record);
-    va_list vargs;
-    va_start(vargs, messageFormat);
-    logrecord_formatMessageVA(record, messageFormat, vargs);
-    va_end(vargs);
+guint32 logrecord_getCallsiteID(gconstpointer record) {
+    return ((const LogRecordEntry*)record)->callsiteID;
+}
+
+gdouble logrecord_getWallTime(gconstpointer record) {
+    return ((const LogRecordEntry*)record)->wallElapsedSeconds;
 }
 
-static gchar* _logrecord_getNewSimTimeStr(LogRecord* record) {
-    MAGIC_ASSERT(record);
+static inline guint64 _logrecord_readNumber(LogRecordReader* reader) {
+    guint64 value;
+    memcpy(&value, &reader->data[reader->offset], sizeof(guint64));
+    reader->offset += sizeof(guint64);
+    return value;
+}
 
-    SimulationTime remainder = record->simElapsedNanos;
+static const gchar* _logrecord_readString(LogRecordReader* reader) {
+    guint32 length;
+    memcpy(&length, &reader->data[reader->offset], sizeof(guint32));
 
-    SimulationTime hours = remainder / SIMTIME_ONE_HOUR;
-    remainder %= SIMTIME_ONE_HOUR;
-    SimulationTime minutes = remainder / SIMTIME_ONE_MINUTE;
-    remainder %= SIMTIME_ONE_MINUTE;
-    SimulationTime seconds = remainder / SIMTIME_ONE_SECOND;
-    remainder %= SIMTIME_ONE_SECOND;
-    SimulationTime nanoseconds = remainder;
+    const gchar* string = NULL;
+    gsize stringSize = 0;
+    if(length != LOG_STRING_NULL) {
+        string = (const gchar*)&reader->data[reader->offset + sizeof(guint32)];
+        stringSize = length;
+    }
 
-    return g_strdup_printf("%02"G_GUINT64_FORMAT":%02"G_GUINT64_FORMAT":%02"G_GUINT64_FORMAT".%09"G_GUINT64_FORMAT,
-            hours, minutes, seconds, nanoseconds);
+    reader->offset += _logrecord_align(sizeof(guint32) + stringSize);
+    return string;
 }
 
-static gchar* _logrecord_getNewWallTimeStr(LogRecord* record) {
-    MAGIC_ASSERT(record);
+/* formats one argument with its conversion specification */
+static void _logrecord_formatArgument(LogRecordReader* reader, const gchar* spec,
+        LogFormatSpec* formatSpec, GString* output) {
+    gint stars[2] = {0, 0};
+    for(guint i = 0; i < formatSpec->numStars; i++) {
+        stars[i] = (gint)_logrecord_readNumber(reader);
+    }
 
-    guint64 remainder = (guint64)record->wallElapsedSeconds;
-    gdouble fraction = record->wallElapsedSeconds - ((gdouble)remainder);
+#define _LOGRECORD_APPEND(value) \
+    if(formatSpec->numStars == 0) { \
+        g_string_append_printf(output, spec, value); \
+    } else if(formatSpec->numStars == 1) { \
+        g_string_append_printf(output, spec, stars[0], value); \
+    } else { \
+        g_string_append_printf(output, spec, stars[0], stars[1], value); \
+    }
 
-    guint64 hours = remainder/3600;
-    remainder %= 3600;
-    guint64 minutes = remainder/60;
-    remainder %= 60;
-    guint64 seconds = remainder;
-    guint64 microseconds = (guint64)(fraction * ((gdouble)1000000));
+    switch(formatSpec->type) {
+        case LOG_ARG_INT: {
+            _LOGRECORD_APPEND((int)_logrecord_readNumber(reader));
+            break;
+        }
+        case LOG_ARG_LONG: {
+            _LOGRECORD_APPEND((long)_logrecord_readNumber(reader));
+            break;
+        }
+        case LOG_ARG_LONGLONG: {
+            _LOGRECORD_APPEND((long long)_logrecord_readNumber(reader));
+            break;
+        }
+        case LOG_ARG_SIZE: {
+            _LOGRECORD_APPEND((size_t)_logrecord_readNumber(reader));
+            break;
+        }
+        case LOG_ARG_INTMAX: {
+            _LOGRECORD_APPEND((intmax_t)_logrecord_readNumber(reader));
+            break;
+        }
+        case LOG_ARG_PTRDIFF: {
+            _LOGRECORD_APPEND((ptrdiff_t)_logrecord_readNumber(reader));
+            break;
+        }
+        case LOG_ARG_POINTER: {
+            _LOGRECORD_APPEND((void*)(uintptr_t)_logrecord_readNumber(reader));
+            break;
+        }
+        case LOG_ARG_DOUBLE: {
+            gdouble value;
+            memcpy(&value, &reader->data[reader->offset], sizeof(gdouble));
+            reader->offset += sizeof(guint64);
+            _LOGRECORD_APPEND(value);
+            break;
+        }
+        case LOG_ARG_LONGDOUBLE: {
+            long double value;
+            memcpy(&value, &reader->data[reader->offset], sizeof(long double));
+            reader->offset += _logrecord_align(sizeof(long double));
+            _LOGRECORD_APPEND(value);
+            break;
+        }
+        case LOG_ARG_STRING: {
+            _LOGRECORD_APPEND(_logrecord_readString(reader));
+            break;
+        }
+        default: {
+            utility_assert(FALSE && "unexpected log argument type");
+            break;
+        }
+    }
 
-    return g_strdup_printf("%02"G_GUINT64_FORMAT":%02"G_GUINT64_FORMAT":%02"G_GUINT64_FORMAT".%06"G_GUINT64_FORMAT,
-            hours, minutes, seconds, microseconds);
+#undef _LOGRECORD_APPEND
 }
 
+static void _logrecord_formatMessage(LogRecordReader* reader, LogCallsite* callsite, GString* output) {
+    if(callsite->isPreformatted) {
+        const gchar* message = _logrecord_readString(reader);
+        g_string_append(output, (message != NULL) ? message : "NOMESSAGE");
+        return;
+    }
+
+    gchar spec[LOG_FORMAT_SPEC_MAX_LENGTH + 1];
+    const gchar* position = callsite->format;
+    const gchar* next = NULL;
 
-gchar* logrecord_toString(LogRecord* record) {
-    MAGIC_ASSERT(record);
-    utility_assert(record->callInfo);
+    while((next = strchr(position, '%')) != NULL) {
+        g_string_append_len(output, position, (gssize)(next - position));
 
-    gchar* wallTimeStr = _logrecord_getNewWallTimeStr(record);
-    gchar* simTimeStr = (record->simElapsedNanos != SIMTIME_INVALID) ? _logrecord_getNewSimTimeStr(record) : NULL;
+        LogFormatSpec formatSpec;
+        _logrecord_parseSpec(next, &formatSpec);
+        /* the logging thread found the same specifications */
+        utility_assert(formatSpec.type != LOG_ARG_UNSUPPORTED);
 
-    gchar* recordStr = g_strdup_printf("%s [%s] %s [%s] [%s] %s %s\n",
-            (wallTimeStr != NULL) ? wallTimeStr : "n/a",
-            (record->threadName != NULL) ? record->threadName : "thread-0",
-            (simTimeStr != NULL) ? simTimeStr : "n/a",
-            loglevel_toStr(record->level),
-            (record->hostName != NULL) ? record->hostName : "n/a",
-            record->callInfo,
-            (record->message != NULL) ? record->message : "NOMESSAGE");
+        if(formatSpec.type == LOG_ARG_NONE) {
+            g_string_append_c(output, '%');
+        } else {
+            memcpy(spec, next, formatSpec.length);
+            spec[formatSpec.length] = '\0';
+            _logrecord_formatArgument(reader, spec, &formatSpec, output);
+        }
+
+        position = next + formatSpec.length;
+    }
 
+    g_string_append(output, position);
+}
 
-    if(wallTimeStr != NULL) {
-        g_free(wallTimeStr);
+void logrecord_format(gconstpointer record, LogCallsite* callsite, GString* output) {
+    MAGIC_ASSERT(callsite);
+
+    const LogRecordEntry* header = record;
+    utility_assert(header->type == LOG_ENTRY_RECORD);
+    utility_assert(header->callsiteID == callsite->id);
+
+    LogRecordReader reader = {.data = record, .offset = sizeof(LogRecordEntry)};
+    const gchar* hostName = _logrecord_readString(&reader);
+    const gchar* hostIP = _logrecord_readString(&reader);
+
+    /* the wall time since logging started */
+    guint64 wallRemainder = (guint64)header->wallElapsedSeconds;
+    gdouble wallFraction = header->wallElapsedSeconds - ((gdouble)wallRemainder);
+    guint64 wallHours = wallRemainder / 3600;
+    wallRemainder %= 3600;
+    guint64 wallMinutes = wallRemainder / 60;
+    wallRemainder %= 60;
+
+    g_string_append_printf(output,
+            "%02"G_GUINT64_FORMAT":%02"G_GUINT64_FORMAT":%02"G_GUINT64_FORMAT".%06"G_GUINT64_FORMAT" [thread-%i] ",
+            wallHours, wallMinutes, wallRemainder, (guint64)(wallFraction * ((gdouble)1000000)),
+            header->threadID);
+
+    /* the simulation time, if it was logged by a worker */
+    if(header->simElapsedNanos != SIMTIME_INVALID) {
+        SimulationTime simRemainder = header->simElapsedNanos;
+        SimulationTime simHours = simRemainder / SIMTIME_ONE_HOUR;
+        simRemainder %= SIMTIME_ONE_HOUR;
+        SimulationTime simMinutes = simRemainder / SIMTIME_ONE_MINUTE;
+        simRemainder %= SIMTIME_ONE_MINUTE;
+        SimulationTime simSeconds = simRemainder / SIMTIME_ONE_SECOND;
+        simRemainder %= SIMTIME_ONE_SECOND;
+
+        g_string_append_printf(output,
+                "%02"G_GUINT64_FORMAT":%02"G_GUINT64_FORMAT":%02"G_GUINT64_FORMAT".%09"G_GUINT64_FORMAT,
+                simHours, simMinutes, simSeconds, simRemainder);
+    } else {
+        g_string_append(output, "n/a");
     }
-    if(simTimeStr != NULL) {
-        g_free(simTimeStr);
+
+    g_string_append_printf(output, " [%s] ", loglevel_toStr((LogLevel)header->level));
+
+    if(hostName != NULL && hostIP != NULL) {
+        g_string_append_printf(output, "[%s~%s] ", hostName, hostIP);
+    } else {
+        g_string_append(output, "[n/a] ");
     }
 
-    return recordStr;
+    g_string_append_printf(output, "[%s:%i] [%s] ",
+            callsite->baseName, callsite->lineNumber, callsite->functionName);
+
+    _logrecord_formatMessage(&reader, callsite, output);
+
+    g_string_append_c(output, '\n');
 }
@@ -7,23 +7,68 @@
 #define SHD_LOG_RECORD_H_
 
 #include <glib.h>
+#include <stdarg.h>
 
 #include "main/core/support/definitions.h"
 #include "support/logger/log_level.h"
 
-typedef struct _LogRecord LogRecord;
+/**
+ * The binary encoding of log messages. The logging thread does not format a
+ * message; it copies the format's arguments into a record, along with the
+ * times and the names of the thread and host it was logged from. The record
+ * refers to its call site (source location and format) by an id, and the
+ * call site is encoded once, in an entry before the first record that uses
+ * it. The logger helper thread decodes the records and formats them.
+ *
+ * Call sites are identified by the address of their format, so formats must
+ * not change once they were logged (as is the case for string literals).
+ * Formats that can't be encoded (e.g., with %m or %n) are formatted by the
+ * logging thread.
+ */
+
+typedef struct _LogCallsite LogCallsite;
+
+typedef enum _LogEntryType LogEntryType;
+enum _LogEntryType {
+    /* the definition of a call site */
+    LOG_ENTRY_CALLSITE,
+    /* a record */
+    LOG_ENTRY_RECORD,
+    /* a record that was too large to store inline, stored on the heap */
+    LOG_ENTRY_RECORD_INDIRECT,
+};
+
+/* called by the logging thread when it logs from a call site for the first time */
+LogCallsite* logcallsite_new(guint32 id, const gchar* fileName, const gchar* functionName,
+        gint lineNumber, const gchar* format);
+/* called by the helper thread for a LOG_ENTRY_CALLSITE entry */
+LogCallsite* logcallsite_decode(gconstpointer entry, gsize length);
+void logcallsite_free(LogCallsite* callsite);
 
-LogRecord* logrecord_new(LogLevel level, gdouble timespan, const gchar* fileName, const gchar* functionName, const gint lineNumber);
+guint32 logcallsite_getID(LogCallsite* callsite);
 
-void logrecord_ref(LogRecord* record);
-void logrecord_unref(LogRecord* record);
+/* replaces the contents of buffer with the LOG_ENTRY_CALLSITE entry for the call site */
+void logrecord_encodeCallsite(GByteArray* buffer, LogCallsite* callsite);
+/* replaces the contents of buffer with a LOG_ENTRY_RECORD entry. simElapsedNanos may be
+ * SIMTIME_INVALID, hostName and hostIP may be NULL. */
+void logrecord_encode(GByteArray* buffer, LogCallsite* callsite, LogLevel level,
+        gdouble wallElapsedSeconds, SimulationTime simElapsedNanos, gint threadID,
+        const gchar* hostName, const gchar* hostIP, va_list vargs);
+/* replaces the contents of buffer with a LOG_ENTRY_RECORD_INDIRECT entry that
+ * takes ownership of a heap copy of the given LOG_ENTRY_RECORD entry */
+void logrecord_encodeIndirect(GByteArray* buffer, gpointer record);
 
-gint logrecord_compare(const LogRecord* a, const LogRecord* b, gpointer userData);
-void logrecord_setTime(LogRecord* record, SimulationTime simElapsedNanos);
-void logrecord_setNames(LogRecord* record, const gchar* threadName, const gchar* hostName);
-void logrecord_formatMessageVA(LogRecord* record, const gchar *messageFormat, va_list vargs);
-void logrecord_formatMessage(LogRecord* record, const gchar *messageFormat, ...);
+LogEntryType logrecord_getEntryType(gconstpointer entry);
+/* returns the LOG_ENTRY_RECORD entry that the given record entry holds, which
+ * is the entry itself unless it is LOG_ENTRY_RECORD_INDIRECT */
+gconstpointer logrecord_getRecord(gconstpointer entry);
+/* frees the heap copy of a LOG_ENTRY_RECORD_INDIRECT entry, if it is one */
+void logrecord_freeIndirect(gconstpointer entry);
 
-gchar* logrecord_toString(LogRecord* record);
+/* the following take a LOG_ENTRY_RECORD entry */
+guint32 logrecord_getCallsiteID(gconstpointer record);
+gdouble logrecord_getWallTime(gconstpointer record);
+/* appends the formatted log line for the record that was logged from callsite */
+void logrecord_format(gconstpointer record, LogCallsite* callsite, GString* output);
 
 #endif /* SHD_LOG_RECORD_H_ */
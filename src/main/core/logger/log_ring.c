@@ -0,0 +1,149 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/core/logger/log_ring.h"
+
+#include <string.h>
+
+#include "main/core/support/definitions.h"
+#include "main/utility/utility.h"
+
+/* the length of an entry header that tells the consumer to continue at the
+ * start of the buffer, because the next entry did not fit before the end */
+#define LOG_RING_WRAP G_MAXUINT32
+
+typedef struct _LogRingEntryHeader LogRingEntryHeader;
+struct _LogRingEntryHeader {
+    guint32 length;
+    /* keeps the entry data 8-byte aligned */
+    guint32 padding;
+};
+
+struct _LogRing {
+    guchar* buffer;
+    /* always a power of 2 */
+    gsize capacity;
+
+    /* positions only grow; the offset into the buffer is the position modulo
+     * the capacity */
+
+    /* only used by the producer */
+    guint64 writePosition;
+    /* written by the producer, read by the consumer */
+    guint64 publishedPosition;
+
+    /* only used by the consumer */
+    guint64 knownPublishedPosition;
+    guint64 peekedEndPosition;
+    /* written by the consumer, read by the producer */
+    guint64 readPosition;
+
+    MAGIC_DECLARE;
+};
+
+static inline gsize _logring_getEntrySize(gsize length) {
+    /* the header plus the data, rounded up to keep the next header aligned */
+    return (sizeof(LogRingEntryHeader) + length + 7) & ~((gsize)7);
+}
+
+LogRing* logring_new(gsize capacity) {
+    LogRing* ring = g_new0(LogRing, 1);
+    MAGIC_INIT(ring);
+
+    ring->capacity = 64;
+    while(ring->capacity < capacity) {
+        ring->capacity *= 2;
+    }
+    ring->buffer = g_malloc(ring->capacity);
+
+    return ring;
+}
+
+void logring_free(LogRing* ring) {
+    MAGIC_ASSERT(ring);
+    g_free(ring->buffer);
+    MAGIC_CLEAR(ring);
+    g_free(ring);
+}
+
+gsize logring_getMaxEntryLength(LogRing* ring) {
+    MAGIC_ASSERT(ring);
+    /* with at most half of the capacity, an entry that does not fit before the
+     * end of the buffer always fits at its start once the ring is empty */
+    return ring->capacity / 2 - sizeof(LogRingEntryHeader);
+}
+
+gboolean logring_write(LogRing* ring, gconstpointer data, gsize length) {
+    MAGIC_ASSERT(ring);
+    utility_assert(length <= logring_getMaxEntryLength(ring));
+
+    gsize entrySize = _logring_getEntrySize(length);
+    gsize offset = (gsize)(ring->writePosition & (ring->capacity - 1));
+    gsize spaceBeforeEnd = ring->capacity - offset;
+
+    /* if the entry does not fit before the end, the rest of the buffer is skipped */
+    gsize neededSpace = (entrySize <= spaceBeforeEnd) ? entrySize : spaceBeforeEnd + entrySize;
+
+    guint64 readPosition = __atomic_load_n(&ring->readPosition, __ATOMIC_ACQUIRE);
+    if(ring->writePosition + neededSpace - readPosition > ring->capacity) {
+        return FALSE;
+    }
+
+    if(entrySize > spaceBeforeEnd) {
+        LogRingEntryHeader* wrap = (LogRingEntryHeader*)&ring->buffer[offset];
+        wrap->length = LOG_RING_WRAP;
+        ring->writePosition += spaceBeforeEnd;
+        offset = 0;
+    }
+
+    LogRingEntryHeader* header = (LogRingEntryHeader*)&ring->buffer[offset];
+    header->length = (guint32)length;
+    memcpy(&ring->buffer[offset + sizeof(LogRingEntryHeader)], data, length);
+    ring->writePosition += entrySize;
+
+    return TRUE;
+}
+
+void logring_publish(LogRing* ring) {
+    MAGIC_ASSERT(ring);
+    /* the entries must be visible before the consumer learns about them */
+    __atomic_store_n(&ring->publishedPosition, ring->writePosition, __ATOMIC_RELEASE);
+}
+
+gconstpointer logring_peek(LogRing* ring, gsize* length) {
+    MAGIC_ASSERT(ring);
+
+    guint64 position = ring->readPosition;
+    if(position == ring->knownPublishedPosition) {
+        ring->knownPublishedPosition = __atomic_load_n(&ring->publishedPosition, __ATOMIC_ACQUIRE);
+        if(position == ring->knownPublishedPosition) {
+            return NULL;
+        }
+    }
+
+    gsize offset = (gsize)(position & (ring->capacity - 1));
+    LogRingEntryHeader* header = (LogRingEntryHeader*)&ring->buffer[offset];
+
+    if(header->length == LOG_RING_WRAP) {
+        /* the producer never publishes a wrap without the entry after it */
+        position += ring->capacity - offset;
+        offset = 0;
+        header = (LogRingEntryHeader*)&ring->buffer[offset];
+    }
+
+    ring->peekedEndPosition = position + _logring_getEntrySize(header->length);
+
+    if(length) {
+        *length = header->length;
+    }
+    return &ring->buffer[offset + sizeof(LogRingEntryHeader)];
+}
+
+void logring_consume(LogRing* ring) {
+    MAGIC_ASSERT(ring);
+    utility_assert(ring->peekedEndPosition > ring->readPosition);
+    /* we must be done reading the entry before the producer may overwrite it */
+    __atomic_store_n(&ring->readPosition, ring->peekedEndPosition, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,44 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_LOG_RING_H_
+#define SHD_LOG_RING_H_
+
+#include <glib.h>
+
+/**
+ * A preallocated ring buffer of variable-length entries that one producer
+ * thread and one consumer thread share without a lock. The producer appends
+ * entries and makes them visible to the consumer in batches with
+ * logring_publish. The consumer reads the published entries in order, and
+ * consuming an entry gives its space back to the producer.
+ *
+ * Entries never wrap around the end of the buffer, so the consumer can read
+ * them in place. Entries start at 8-byte aligned addresses.
+ */
+
+typedef struct _LogRing LogRing;
+
+/* the capacity is rounded up to a power of 2 */
+LogRing* logring_new(gsize capacity);
+void logring_free(LogRing* ring);
+
+/* the longest entry that always fits into the ring once it is empty */
+gsize logring_getMaxEntryLength(LogRing* ring);
+
+/* called by the producer. appends a copy of the data as a new entry, or
+ * returns FALSE if the ring does not have enough free space for it. */
+gboolean logring_write(LogRing* ring, gconstpointer data, gsize length);
+/* called by the producer. makes the entries written so far visible to the consumer. */
+void logring_publish(LogRing* ring);
+
+/* called by the consumer. returns the oldest published entry that was not
+ * consumed yet and stores its length, or returns NULL if there is none. the
+ * entry stays valid until it is consumed. */
+gconstpointer logring_peek(LogRing* ring, gsize* length);
+/* called by the consumer. drops the entry that logring_peek returned. */
+void logring_consume(LogRing* ring);
+
+#endif /* SHD_LOG_RING_H_ */
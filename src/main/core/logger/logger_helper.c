@@ -5,13 +5,42 @@
 
 #include "main/core/logger/logger_helper.h"
 
+#include <errno.h>
 #include <stddef.h>
+#include <stdio.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 #include "main/core/logger/log_record.h"
+#include "main/core/logger/log_ring.h"
 #include "main/core/support/definitions.h"
 #include "main/utility/priority_queue.h"
 #include "main/utility/utility.h"
 
+/* we format log lines into chunks of about this size */
+#define LOGGER_HELPER_CHUNK_SIZE (64*1024)
+/* and write the chunks out once we filled this many of them */
+#define LOGGER_HELPER_MAX_CHUNKS 32
+
+/* a thread whose records we read */
+typedef struct _LoggerHelperSource LoggerHelperSource;
+struct _LoggerHelperSource {
+    LogRing* ring;
+    /* the call sites that were defined in the ring, indexed by id */
+    GPtrArray* callsites;
+    /* breaks ties between records with the same time */
+    guint index;
+    /* the time of the record at the head of the ring */
+    gdouble nextWallTime;
+};
+
+typedef struct _LoggerHelperOutput LoggerHelperOutput;
+struct _LoggerHelperOutput {
+    GString* chunks[LOGGER_HELPER_MAX_CHUNKS];
+    /* the chunks that hold data, the last one is the one we append to */
+    guint numChunks;
+};
+
 struct _LoggerHelperCommand {
     LoggerHelperCommmandType type;
     gpointer argument;
@@ -47,21 +76,155 @@ void loggerhelpercommand_unref(LoggerHelperCommand* command) {
     }
 }
 
-static void _loggerhelper_sort(GAsyncQueue* incomingRecords, PriorityQueue* sortedRecords) {
-    if(incomingRecords == NULL || sortedRecords == NULL) {
-        return;
+static LoggerHelperSource* _loggerhelpersource_new(LogRing* ring, guint index) {
+    LoggerHelperSource* source = g_new0(LoggerHelperSource, 1);
+    source->ring = ring;
+    source->callsites = g_ptr_array_new_with_free_func((GDestroyNotify)logcallsite_free);
+    source->index = index;
+    return source;
+}
+
+static void _loggerhelpersource_free(LoggerHelperSource* source) {
+    g_ptr_array_free(source->callsites, TRUE);
+    g_free(source);
+}
+
+static gint _loggerhelpersource_compare(const LoggerHelperSource* a, const LoggerHelperSource* b,
+        gpointer userData) {
+    if(a->nextWallTime != b->nextWallTime) {
+        return a->nextWallTime < b->nextWallTime ? -1 : 1;
+    }
+    return a->index < b->index ? -1 : a->index > b->index ? 1 : 0;
+}
+
+/* reads the call site definitions at the head of the ring, and returns TRUE
+ * if a record follows them */
+static gboolean _loggerhelpersource_advance(LoggerHelperSource* source) {
+    gconstpointer entry = NULL;
+    gsize length = 0;
+
+    while((entry = logring_peek(source->ring, &length)) != NULL) {
+        if(logrecord_getEntryType(entry) != LOG_ENTRY_CALLSITE) {
+            source->nextWallTime = logrecord_getWallTime(logrecord_getRecord(entry));
+            return TRUE;
+        }
+
+        LogCallsite* callsite = logcallsite_decode(entry, length);
+        guint32 id = logcallsite_getID(callsite);
+        if(id >= source->callsites->len) {
+            g_ptr_array_set_size(source->callsites, (gint)id + 1);
+        }
+        utility_assert(g_ptr_array_index(source->callsites, id) == NULL);
+        g_ptr_array_index(source->callsites, id) = callsite;
+
+        logring_consume(source->ring);
+    }
+
+    return FALSE;
+}
+
+static void _loggerhelperoutput_init(LoggerHelperOutput* output) {
+    for(guint i = 0; i < LOGGER_HELPER_MAX_CHUNKS; i++) {
+        output->chunks[i] = g_string_sized_new(LOGGER_HELPER_CHUNK_SIZE + 1024);
+    }
+    output->numChunks = 1;
+}
+
+static void _loggerhelperoutput_clear(LoggerHelperOutput* output) {
+    for(guint i = 0; i < LOGGER_HELPER_MAX_CHUNKS; i++) {
+        g_string_free(output->chunks[i], TRUE);
+    }
+}
+
+static void _loggerhelperoutput_write(LoggerHelperOutput* output) {
+    struct iovec iov[LOGGER_HELPER_MAX_CHUNKS];
+    guint numIOV = 0;
+
+    for(guint i = 0; i < output->numChunks; i++) {
+        if(output->chunks[i]->len > 0) {
+            iov[numIOV].iov_base = output->chunks[i]->str;
+            iov[numIOV].iov_len = output->chunks[i]->len;
+            numIOV++;
+        }
     }
 
-    GQueue* records = NULL;
-    while((records = g_async_queue_try_pop(incomingRecords)) != NULL) {
-        while(!g_queue_is_empty(records)) {
-            LogRecord* record = g_queue_pop_head(records);
-            if(record != NULL) {
-                priorityqueue_push(sortedRecords, record);
+    /* anything else that was printed to stdout goes first */
+    fflush(stdout);
+
+    struct iovec* next = iov;
+    while(numIOV > 0) {
+        ssize_t written = writev(STDOUT_FILENO, next, (gint)numIOV);
+        if(written < 0) {
+            if(errno == EINTR) {
+                continue;
             }
+            /* there is nowhere to report the error */
+            break;
+        }
+
+        /* skip what was written, which may end in the middle of a chunk */
+        gsize remaining = (gsize)written;
+        while(numIOV > 0 && remaining >= next->iov_len) {
+            remaining -= next->iov_len;
+            next++;
+            numIOV--;
+        }
+        if(numIOV > 0) {
+            next->iov_base = (gchar*)next->iov_base + remaining;
+            next->iov_len -= remaining;
+        }
+    }
+
+    for(guint i = 0; i < output->numChunks; i++) {
+        g_string_truncate(output->chunks[i], 0);
+    }
+    output->numChunks = 1;
+}
+
+static GString* _loggerhelperoutput_getChunk(LoggerHelperOutput* output) {
+    GString* chunk = output->chunks[output->numChunks - 1];
+    if(chunk->len >= LOGGER_HELPER_CHUNK_SIZE) {
+        if(output->numChunks == LOGGER_HELPER_MAX_CHUNKS) {
+            _loggerhelperoutput_write(output);
+        } else {
+            output->numChunks++;
         }
-        g_queue_free(records);
+        chunk = output->chunks[output->numChunks - 1];
     }
+    return chunk;
+}
+
+/* formats all published records of all sources in time order, and writes them out */
+static void _loggerhelper_flush(GQueue* sources, PriorityQueue* sortedSources, LoggerHelperOutput* output) {
+    for(GList* item = g_queue_peek_head_link(sources); item != NULL; item = item->next) {
+        LoggerHelperSource* source = item->data;
+        if(_loggerhelpersource_advance(source)) {
+            priorityqueue_push(sortedSources, source);
+        }
+    }
+
+    while(!priorityqueue_isEmpty(sortedSources)) {
+        LoggerHelperSource* source = priorityqueue_pop(sortedSources);
+
+        gconstpointer entry = logring_peek(source->ring, NULL);
+        utility_assert(entry);
+        gconstpointer record = logrecord_getRecord(entry);
+
+        guint32 id = logrecord_getCallsiteID(record);
+        utility_assert(id < source->callsites->len);
+        LogCallsite* callsite = g_ptr_array_index(source->callsites, id);
+
+        logrecord_format(record, callsite, _loggerhelperoutput_getChunk(output));
+
+        logrecord_freeIndirect(entry);
+        logring_consume(source->ring);
+
+        if(_loggerhelpersource_advance(source)) {
+            priorityqueue_push(sortedSources, source);
+        }
+    }
+
+    _loggerhelperoutput_write(output);
 }
 
 gpointer loggerhelper_runHelperThread(LoggerHelperRunData* data) {
@@ -70,8 +233,10 @@ gpointer loggerhelper_runHelperThread(LoggerHelperRunData* data) {
     g_free(data);
     data = NULL;
 
-    GQueue* queues = g_queue_new();
-    PriorityQueue* sortedRecords = priorityqueue_new((GCompareDataFunc)logrecord_compare, NULL, NULL);
+    GQueue* sources = g_queue_new();
+    PriorityQueue* sortedSources = priorityqueue_new((GCompareDataFunc)_loggerhelpersource_compare, NULL, NULL);
+    LoggerHelperOutput output;
+    _loggerhelperoutput_init(&output);
 
     LoggerHelperCommand* command = NULL;
     gboolean stop = FALSE;
@@ -80,22 +245,13 @@ gpointer loggerhelper_runHelperThread(LoggerHelperRunData* data) {
         MAGIC_ASSERT(command);
         switch(command->type) {
             case LHC_REGISTER: {
-                GAsyncQueue* incomingRecords = command->argument;
-                g_queue_push_tail(queues, incomingRecords);
+                LogRing* ring = command->argument;
+                g_queue_push_tail(sources, _loggerhelpersource_new(ring, g_queue_get_length(sources)));
                 break;
             }
 
             case LHC_FLUSH: {
-                g_queue_foreach(queues, (GFunc)_loggerhelper_sort, sortedRecords);
-                while(!priorityqueue_isEmpty(sortedRecords)) {
-                    LogRecord* record = priorityqueue_pop(sortedRecords);
-                    gchar* logRecordStr = logrecord_toString(record);
-                    utility_assert(logRecordStr);
-                    g_print("%s", logRecordStr);
-                    g_free(logRecordStr);
-                    logrecord_unref(record);
-                }
-                utility_assert(priorityqueue_isEmpty(sortedRecords));
+                _loggerhelper_flush(sources, sortedSources, &output);
                 break;
             }
 
@@ -111,11 +267,12 @@ gpointer loggerhelper_runHelperThread(LoggerHelperRunData* data) {
         loggerhelpercommand_unref(command);
     }
 
-    while(!g_queue_is_empty(queues)) {
-        g_async_queue_unref(g_queue_pop_head(queues));
+    while(!g_queue_is_empty(sources)) {
+        _loggerhelpersource_free(g_queue_pop_head(sources));
     }
-    g_queue_free(queues);
-    priorityqueue_free(sortedRecords);
+    g_queue_free(sources);
+    priorityqueue_free(sortedSources);
+    _loggerhelperoutput_clear(&output);
 
     countdownlatch_countDown(notifyDoneRunning);
     return NULL;
@@ -10,6 +10,9 @@
 
 #include "main/utility/count_down_latch.h"
 
+/* LHC_REGISTER takes the LogRing of a thread that logs. the helper reads the
+ * ring until it stops, so the ring must outlive the helper.
+ * LHC_FLUSH formats and writes out the published records of all rings. */
 typedef enum _LoggerHelperCommmandType LoggerHelperCommmandType;
 enum _LoggerHelperCommmandType {
     LHC_STOP, LHC_REGISTER, LHC_FLUSH,
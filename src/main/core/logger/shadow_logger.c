@@ -11,6 +11,7 @@
 #include <string.h>
 
 #include "main/core/logger/log_record.h"
+#include "main/core/logger/log_ring.h"
 #include "main/core/logger/logger_helper.h"
 #include "main/core/support/definitions.h"
 #include "main/core/worker.h"
@@ -20,15 +21,43 @@
 #include "main/utility/utility.h"
 #include "support/logger/logger.h"
 
+/* the size of the ring of log records of each thread */
+#define LOGGER_RING_CAPACITY (1024*1024)
+/* the number of call sites each thread finds without a hash table lookup,
+ * must be a power of 2 */
+#define LOGGER_CALLSITE_CACHE_SIZE 256
+
+/* where a message was logged from */
+typedef struct _LoggerCallsiteKey LoggerCallsiteKey;
+struct _LoggerCallsiteKey {
+    const gchar* fileName;
+    const gchar* functionName;
+    const gchar* format;
+    gint lineNumber;
+};
+
+typedef struct _LoggerCallsite LoggerCallsite;
+struct _LoggerCallsite {
+    LoggerCallsiteKey key;
+    LogCallsite* callsite;
+};
+
 /* this stores thread-specific data for each "worker" thread (the threads that
  * are running the virtual nodes) */
 typedef struct _LoggerThreadData LoggerThreadData;
 struct _LoggerThreadData {
-    /* local temporary store for this threads log records */
-    GQueue* localRecordBundle;
-
-    /* remote queue over which to send helper thread messages */
-    GAsyncQueue* remoteLogHelperMailbox;
+    /* this threads log records, which the helper thread reads and formats */
+    LogRing* ring;
+
+    /* the call sites this thread logged from, and the ones it used recently */
+    GHashTable* callsites;
+    /* the same call sites, indexed by id */
+    GPtrArray* callsitesByID;
+    LoggerCallsite* callsiteCache[LOGGER_CALLSITE_CACHE_SIZE];
+    guint32 nextCallsiteID;
+
+    /* where we encode entries before copying them into the ring */
+    GByteArray* encodeBuffer;
     MAGIC_DECLARE;
 };
 
@@ -47,22 +76,56 @@ struct _ShadowLogger {
     pthread_t helper;
     GAsyncQueue* helperCommands;
     CountDownLatch* helperLatch;
+    /* set once the helper exited, after which threads write their own records */
+    gboolean helperStopped;
 
     /* store map of other threads that will call logging functions to
      * thread-specific data */
     GHashTable* threadToDataMap;
+    /* tells this logger apart from earlier ones at the same address */
+    guint generation;
 
     /* for memory management */
     gint referenceCount;
     MAGIC_DECLARE;
 };
 
+/* counts the loggers that were created */
+static guint loggerGeneration = 0;
+
+/* the data of the calling thread for the logger it logged to last, so that
+ * we don't need to look it up for every message */
+static __thread ShadowLogger* cachedThreadDataLogger = NULL;
+static __thread guint cachedThreadDataGeneration = 0;
+static __thread LoggerThreadData* cachedThreadData = NULL;
+
+static guint _logger_hashCallsiteKey(const LoggerCallsiteKey* key) {
+    /* the format alone tells apart nearly all call sites */
+    guint hash = (guint)(GPOINTER_TO_SIZE(key->format) >> 3);
+    hash ^= (guint)key->lineNumber * 2654435761U;
+    hash ^= (guint)(GPOINTER_TO_SIZE(key->fileName) >> 3);
+    return hash;
+}
+
+static gboolean _logger_isEqualCallsiteKey(const LoggerCallsiteKey* a, const LoggerCallsiteKey* b) {
+    return (a->format == b->format && a->lineNumber == b->lineNumber &&
+            a->fileName == b->fileName && a->functionName == b->functionName) ? TRUE : FALSE;
+}
+
+static void _loggercallsite_free(LoggerCallsite* loggerCallsite) {
+    logcallsite_free(loggerCallsite->callsite);
+    g_free(loggerCallsite);
+}
+
 static LoggerThreadData* _loggerthreaddata_new() {
     LoggerThreadData* threadData = g_new0(LoggerThreadData, 1);
     MAGIC_INIT(threadData);
 
-    threadData->localRecordBundle = g_queue_new();
-    threadData->remoteLogHelperMailbox = g_async_queue_new();
+    threadData->ring = logring_new(LOGGER_RING_CAPACITY);
+    threadData->callsites = g_hash_table_new_full((GHashFunc)_logger_hashCallsiteKey,
+            (GEqualFunc)_logger_isEqualCallsiteKey, NULL, (GDestroyNotify)_loggercallsite_free);
+    threadData->callsitesByID = g_ptr_array_new();
+    threadData->encodeBuffer = g_byte_array_sized_new(4096);
 
     return threadData;
 }
@@ -70,13 +133,18 @@ static LoggerThreadData* _loggerthreaddata_new() {
 static void _loggerthreaddata_free(LoggerThreadData* threadData) {
     MAGIC_ASSERT(threadData);
 
-    /* free any remaining log records and the record queue */
-    LogRecord* record = NULL;
-    while ((record = g_queue_pop_head(threadData->localRecordBundle)) != NULL) {
-        logrecord_unref(record);
+    /* free the heap copies of any records that the helper did not get to,
+     * including the ones that were never published */
+    logring_publish(threadData->ring);
+    gconstpointer entry = NULL;
+    while ((entry = logring_peek(threadData->ring, NULL)) != NULL) {
+        logrecord_freeIndirect(entry);
+        logring_consume(threadData->ring);
     }
-    g_queue_free(threadData->localRecordBundle);
-    g_async_queue_unref(threadData->remoteLogHelperMailbox);
+    logring_free(threadData->ring);
+    g_ptr_array_free(threadData->callsitesByID, TRUE);
+    g_hash_table_destroy(threadData->callsites);
+    g_byte_array_free(threadData->encodeBuffer, TRUE);
 
     MAGIC_CLEAR(threadData);
     g_free(threadData);
@@ -128,13 +196,20 @@ void shadow_logger_setEnableBuffering(ShadowLogger* logger, gboolean enabled) {
 
 static void _logger_sendRegisterCommandToHelper(ShadowLogger* logger,
                                                 LoggerThreadData* threadData) {
-    LoggerHelperCommand* command = loggerhelpercommand_new(
-        LHC_REGISTER, threadData->remoteLogHelperMailbox);
-    g_async_queue_ref(threadData->remoteLogHelperMailbox);
+    LoggerHelperCommand* command =
+        loggerhelpercommand_new(LHC_REGISTER, threadData->ring);
     g_async_queue_push(logger->helperCommands, command);
 }
 
+static gboolean _logger_isHelperStopped(ShadowLogger* logger) {
+    return __atomic_load_n(&logger->helperStopped, __ATOMIC_ACQUIRE);
+}
+
 static void _logger_sendFlushCommandToHelper(ShadowLogger* logger) {
+    if (_logger_isHelperStopped(logger)) {
+        /* nobody would take the command off the queue */
+        return;
+    }
     LoggerHelperCommand* command = loggerhelpercommand_new(LHC_FLUSH, NULL);
     g_async_queue_push(logger->helperCommands, command);
 }
@@ -146,6 +221,10 @@ static void _logger_sendStopCommandToHelper(ShadowLogger* logger) {
 
 static void _logger_stopHelper(ShadowLogger* logger) {
     MAGIC_ASSERT(logger);
+    if (_logger_isHelperStopped(logger)) {
+        return;
+    }
+
     /* tell the logger helper that we are done sending commands */
     _logger_sendStopCommandToHelper(logger);
 
@@ -154,6 +233,132 @@ static void _logger_stopHelper(ShadowLogger* logger) {
      * wait for the thread to indicate that it finished everything instead. */
     // pthread_join(logger->helper);
     countdownlatch_await(logger->helperLatch);
+
+    /* the helper will not read the rings anymore */
+    __atomic_store_n(&logger->helperStopped, TRUE, __ATOMIC_RELEASE);
+}
+
+static LoggerThreadData* _logger_getThreadData(ShadowLogger* logger) {
+    if (cachedThreadDataLogger != logger ||
+        cachedThreadDataGeneration != logger->generation) {
+        LoggerThreadData* threadData = g_hash_table_lookup(
+            logger->threadToDataMap, GUINT_TO_POINTER(pthread_self()));
+        MAGIC_ASSERT(threadData);
+
+        cachedThreadDataLogger = logger;
+        cachedThreadDataGeneration = logger->generation;
+        cachedThreadData = threadData;
+    }
+    return cachedThreadData;
+}
+
+/* appends the log line for an entry to lines, the way the helper would */
+static void _logger_formatEntry(LoggerThreadData* threadData,
+                                gconstpointer entry, GString* lines) {
+    if (logrecord_getEntryType(entry) == LOG_ENTRY_CALLSITE) {
+        /* we already have our call sites */
+        return;
+    }
+
+    gconstpointer record = logrecord_getRecord(entry);
+    guint32 id = logrecord_getCallsiteID(record);
+    utility_assert(id < threadData->callsitesByID->len);
+    logrecord_format(record, g_ptr_array_index(threadData->callsitesByID, id),
+                     lines);
+}
+
+/* formats the entries left in the ring and the entry in the encode buffer on
+ * this thread, for when the helper no longer reads the ring */
+static void _logger_writeEntryDirectly(LoggerThreadData* threadData) {
+    GString* lines = g_string_new(NULL);
+
+    /* once the helper stopped, we are the only reader of the ring */
+    logring_publish(threadData->ring);
+    gconstpointer entry = NULL;
+    while ((entry = logring_peek(threadData->ring, NULL)) != NULL) {
+        _logger_formatEntry(threadData, entry, lines);
+        logrecord_freeIndirect(entry);
+        logring_consume(threadData->ring);
+    }
+
+    _logger_formatEntry(threadData, threadData->encodeBuffer->data, lines);
+
+    fwrite(lines->str, 1, lines->len, stdout);
+    fflush(stdout);
+    g_string_free(lines, TRUE);
+}
+
+/* copies the entry in the encode buffer into the ring */
+static void _logger_writeEntry(ShadowLogger* logger,
+                               LoggerThreadData* threadData) {
+    GByteArray* buffer = threadData->encodeBuffer;
+
+    if (_logger_isHelperStopped(logger)) {
+        _logger_writeEntryDirectly(threadData);
+        return;
+    }
+
+    if (buffer->len > logring_getMaxEntryLength(threadData->ring)) {
+        /* too large for the ring, so the helper gets it on the heap */
+        gpointer record = g_malloc(buffer->len);
+        memcpy(record, buffer->data, buffer->len);
+        logrecord_encodeIndirect(buffer, record);
+    }
+
+    if (!logring_write(threadData->ring, buffer->data, buffer->len)) {
+        /* the ring is full, wait for the helper to read everything in it */
+        logring_publish(threadData->ring);
+        _logger_sendFlushCommandToHelper(logger);
+        while (!logring_write(threadData->ring, buffer->data, buffer->len)) {
+            if (_logger_isHelperStopped(logger)) {
+                /* it stopped before it got to our records (after an error) */
+                _logger_writeEntryDirectly(threadData);
+                return;
+            }
+            g_thread_yield();
+        }
+    }
+}
+
+static LogCallsite* _logger_getCallsite(ShadowLogger* logger,
+                                        LoggerThreadData* threadData,
+                                        const gchar* fileName,
+                                        const gchar* functionName,
+                                        const gint lineNumber,
+                                        const gchar* format) {
+    LoggerCallsiteKey key = {
+        .fileName = fileName,
+        .functionName = functionName,
+        .format = format,
+        .lineNumber = lineNumber,
+    };
+    guint slot =
+        _logger_hashCallsiteKey(&key) & (LOGGER_CALLSITE_CACHE_SIZE - 1);
+
+    LoggerCallsite* loggerCallsite = threadData->callsiteCache[slot];
+    if (loggerCallsite && _logger_isEqualCallsiteKey(&loggerCallsite->key, &key)) {
+        return loggerCallsite->callsite;
+    }
+
+    loggerCallsite = g_hash_table_lookup(threadData->callsites, &key);
+    if (!loggerCallsite) {
+        loggerCallsite = g_new0(LoggerCallsite, 1);
+        loggerCallsite->key = key;
+        loggerCallsite->callsite =
+            logcallsite_new(threadData->nextCallsiteID++, fileName,
+                            functionName, lineNumber, format);
+        g_hash_table_insert(threadData->callsites, &loggerCallsite->key,
+                            loggerCallsite);
+        g_ptr_array_add(threadData->callsitesByID, loggerCallsite->callsite);
+
+        /* the helper reads the call site before the records that refer to it */
+        logrecord_encodeCallsite(threadData->encodeBuffer,
+                                 loggerCallsite->callsite);
+        _logger_writeEntry(logger, threadData);
+    }
+
+    threadData->callsiteCache[slot] = loggerCallsite;
+    return loggerCallsite->callsite;
 }
 
 void shadow_logger_logVA(ShadowLogger* logger, LogLevel level,
@@ -171,43 +376,36 @@ void shadow_logger_logVA(ShadowLogger* logger, LogLevel level,
         return;
     }
 
-    LoggerThreadData* threadData = g_hash_table_lookup(
-        logger->threadToDataMap, GUINT_TO_POINTER(pthread_self()));
-    MAGIC_ASSERT(threadData);
+    LoggerThreadData* threadData = _logger_getThreadData(logger);
 
     gdouble timespan = (double)logger_elapsed_micros() / G_USEC_PER_SEC;
 
-    LogRecord* record =
-        logrecord_new(level, timespan, fileName, functionName, lineNumber);
-    logrecord_formatMessageVA(record, format, vargs);
+    LogCallsite* callsite = _logger_getCallsite(
+        logger, threadData, fileName, functionName, lineNumber, format);
+
+    SimulationTime simElapsedNanos = SIMTIME_INVALID;
+    gint threadID = 0;
+    const gchar* hostName = NULL;
+    const gchar* hostIP = NULL;
 
     if (worker_isAlive()) {
-        /* time info */
-        logrecord_setTime(record, worker_getCurrentTime());
+        simElapsedNanos = worker_getCurrentTime();
+        threadID = worker_getThreadID();
 
-        /* name info for the host */
-        GString* hostNameBuffer = g_string_new("n/a");
         Host* activeHost = worker_getActiveHost();
         if (activeHost) {
             Address* hostAddress = host_getDefaultAddress(activeHost);
             if (hostAddress) {
-                g_string_printf(hostNameBuffer, "%s~%s",
-                                host_getName(activeHost),
-                                address_toHostIPString(hostAddress));
+                hostName = host_getName(activeHost);
+                hostIP = address_toHostIPString(hostAddress);
             }
         }
-
-        /* name info for the thread */
-        GString* threadNameBuffer = g_string_new(NULL);
-        g_string_printf(threadNameBuffer, "thread-%i", worker_getThreadID());
-
-        /* set and cleanup */
-        logrecord_setNames(record, threadNameBuffer->str, hostNameBuffer->str);
-        g_string_free(threadNameBuffer, TRUE);
-        g_string_free(hostNameBuffer, TRUE);
     }
 
-    g_queue_push_tail(threadData->localRecordBundle, record);
+    /* the helper formats the message, we only copy the arguments */
+    logrecord_encode(threadData->encodeBuffer, callsite, level, timespan,
+                     simElapsedNanos, threadID, hostName, hostIP, vargs);
+    _logger_writeEntry(logger, threadData);
 
     if (level == LOGLEVEL_ERROR || !logger->shouldBuffer ||
         (timespan - logger->lastTimespan) >= 5) {
@@ -262,12 +460,8 @@ void shadow_logger_flushRecords(ShadowLogger* logger, pthread_t callerThread) {
     LoggerThreadData* threadData = g_hash_table_lookup(
         logger->threadToDataMap, GUINT_TO_POINTER(callerThread));
     MAGIC_ASSERT(threadData);
-    /* send log messages from this thread to the helper */
-    if (!g_queue_is_empty(threadData->localRecordBundle)) {
-        g_async_queue_push(threadData->remoteLogHelperMailbox,
-                           threadData->localRecordBundle);
-        threadData->localRecordBundle = g_queue_new();
-    }
+    /* let the helper see the log records from this thread */
+    logring_publish(threadData->ring);
 }
 
 static gchar* _logger_getNewLocalTimeStr(ShadowLogger* logger) {
@@ -366,6 +560,8 @@ ShadowLogger* shadow_logger_new(LogLevel filterLevel) {
             g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
                                   (GDestroyNotify)_loggerthreaddata_free),
 
+        .generation = __atomic_add_fetch(&loggerGeneration, 1, __ATOMIC_RELAXED),
+
         .helperCommands = g_async_queue_new(),
         .helperLatch = countdownlatch_new(1),
     };
@@ -11,8 +11,10 @@
 
 #include "support/logger/log_level.h"
 
-// ShadowLogger is a Logger that uses per-thread log queues to avoid global
-// lock, and adds Shadow-specific context to each log entry.
+// ShadowLogger is a Logger that uses per-thread rings of log records to avoid
+// a global lock, and adds Shadow-specific context to each log entry. Threads
+// only copy the arguments of a message into their ring; a helper thread
+// formats the messages in time order and writes them out.
 typedef struct _ShadowLogger ShadowLogger;
 
 ShadowLogger* shadow_logger_new(LogLevel filterLevel);
@@ -21,6 +23,8 @@ void shadow_logger_ref(ShadowLogger* logger);
 void shadow_logger_unref(ShadowLogger* logger);
 
 void shadow_logger_register(ShadowLogger* logger, pthread_t callerThread);
+// Makes the records that callerThread logged so far visible to the helper.
+// Must be called by callerThread itself.
 void shadow_logger_flushRecords(ShadowLogger* logger, pthread_t callerThread);
 void shadow_logger_syncToDisk(ShadowLogger* logger);
 
@@ -27,6 +27,7 @@
 #include "main/host/host.h"
 #include "main/routing/address.h"
 #include "main/routing/dns.h"
+#include "main/routing/packet.h"
 #include "main/routing/topology.h"
 #include "main/utility/random.h"
 #include "main/utility/utility.h"
@@ -63,6 +64,14 @@ struct _Master {
     /* if we run in unlimited bandwidth mode, this is when we go back to bw enforcement */
     SimulationTime bootstrapEndTime;
 
+    /* number of execution windows, and how many were extended by host lookahead */
+    guint64 numRounds;
+    guint64 numLookaheadRounds;
+
+    /* true if any host logs at debug level, so packets must keep their
+     * status history for the debug messages */
+    gboolean hasDebugHosts;
+
     Slave* slave;
 
     MAGIC_DECLARE;
@@ -336,6 +345,9 @@ static void _master_registerHostCallback(ConfigurationHostElement* he, Master* m
         params->logLevel = he->loglevel.isSet ?
                 loglevel_fromStr(he->loglevel.string->str) :
                 options_getLogLevel(master->options);
+        if(params->logLevel == LOGLEVEL_DEBUG) {
+            master->hasDebugHosts = TRUE;
+        }
 
         params->heartbeatLogLevel = he->heartbeatloglevel.isSet ?
                 loglevel_fromStr(he->heartbeatloglevel.string->str) :
@@ -366,6 +378,7 @@ static void _master_registerHostCallback(ConfigurationHostElement* he, Master* m
         params->interfaceBufSize = he->interfacebuffer.isSet ? he->interfacebuffer.integer :
                 options_getInterfaceBufferSize(master->options);
         params->qdisc = options_getQueuingDiscipline(master->options);
+        params->refillMode = options_getInterfaceRefillMode(master->options);
 
         /* requested attributes from shadow config */
         params->ipHint = he->ipHint.isSet ? he->ipHint.string->str : NULL;
@@ -424,6 +437,27 @@ gint master_run(Master* master) {
     _master_registerPlugins(master);
     _master_registerHosts(master);
 
+    /* all hosts are attached now, so we know which paths we may need.
+     * host lookahead is computed from the precomputed paths. */
+    if(options_doPrecomputeTopologyPaths(master->options) || options_doUseHostLookahead(master->options)) {
+        gdouble minPathLatency = 0.0f;
+        guint nThreads = MAX(options_getNWorkerThreads(master->options), 1);
+        if(topology_precomputePaths(master->topology, nThreads, &minPathLatency) && minPathLatency > 0) {
+            master_updateMinTimeJump(master, minPathLatency);
+        }
+    }
+
+    /* packets only pay for status tracking if someone will look at it */
+    PacketTraceMode traceMode = PACKET_TRACE_NONE;
+    if(master->hasDebugHosts || options_getLogLevel(master->options) == LOGLEVEL_DEBUG) {
+        traceMode |= PACKET_TRACE_LOG;
+    }
+    if(options_doTracePackets(master->options)) {
+        message("writing packet traces to the data directory");
+        traceMode |= PACKET_TRACE_FILE;
+    }
+    packet_setTraceMode(traceMode);
+
     message("running simulation");
 
     /* dont buffer log messages in debug mode */
@@ -442,13 +476,18 @@ gint master_run(Master* master) {
         shadow_logger_setEnableBuffering(shadow_logger_getDefault(), FALSE);
     }
 
+    if(options_doUseHostLookahead(master->options)) {
+        message("ran %"G_GUINT64_FORMAT" execution windows, %"G_GUINT64_FORMAT" of which were extended by host lookahead",
+                master->numRounds, master->numLookaheadRounds);
+    }
+
     message("simulation finished, cleaning up now");
 
     return slave_free(master->slave);
 }
 
 gboolean master_slaveFinishedCurrentRound(Master* master, SimulationTime minNextEventTime,
-        SimulationTime* executeWindowStart, SimulationTime* executeWindowEnd) {
+        SimulationTime minNextSafeTime, SimulationTime* executeWindowStart, SimulationTime* executeWindowEnd) {
     MAGIC_ASSERT(master);
     utility_assert(executeWindowStart && executeWindowEnd);
 
@@ -462,6 +501,14 @@ gboolean master_slaveFinishedCurrentRound(Master* master, SimulationTime minNext
     SimulationTime newStart = minNextEventTime;
     SimulationTime newEnd = minNextEventTime + _master_getMinTimeJump(master);
 
+    /* if we know the lookahead of every host, then no host may receive an event from
+     * another host before the safe time, so we can run at least until then */
+    master->numRounds++;
+    if(minNextSafeTime != SIMTIME_INVALID && minNextSafeTime > newEnd) {
+        newEnd = minNextSafeTime;
+        master->numLookaheadRounds++;
+    }
+
     /* update the new window end as one interval past the new window start,
      * making sure we dont run over the experiment end time */
     if(newEnd > master->endTime) {
@@ -10,6 +10,7 @@
 #include <math.h>
 #include <pthread.h>
 #include <stddef.h>
+#include <stdlib.h>
 #include <sys/types.h>
 
 #include "main/core/logger/shadow_logger.h"
@@ -19,11 +20,20 @@
 #include "main/core/work/event.h"
 #include "main/core/worker.h"
 #include "main/host/host.h"
+#include "main/host/network_interface.h"
 #include "main/utility/count_down_latch.h"
 #include "main/utility/random.h"
+#include "main/utility/round_barrier.h"
 #include "main/utility/utility.h"
 #include "support/logger/logger.h"
 
+/* the most hosts we move in one rebalancing step, so that a single noisy
+ * measurement can't reshuffle the whole simulation */
+#define SCHEDULER_REBALANCE_MAX_MIGRATIONS 16
+/* we only move hosts if the busiest thread is busier than the least busy
+ * thread by at least this fraction of its busy time */
+#define SCHEDULER_REBALANCE_MIN_IMBALANCE 0.1
+
 struct _Scheduler {
     /* all worker threads used by the scheduler */
     GQueue* threadItems;
@@ -41,6 +51,15 @@ struct _Scheduler {
     /* barrier to wait for main thread to finish updating for the next round */
     CountDownLatch* prepareRoundBarrier;
 
+    /* the primitive used for the round barriers. if SB_SPIN, the three round
+     * latches above are replaced by the two spin barriers below */
+    SchedulerBarrierType barrierType;
+    /* barrier to wait for worker threads to finish processing this round */
+    RoundBarrier* executeEventsSpinBarrier;
+    /* workers wait here after collecting info, and the main thread releases them
+     * once it has finished updating for the next round */
+    RoundBarrier* collectPrepareSpinBarrier;
+
     /* holds a timer for each thread to track how long threads wait for execution barrier */
     GHashTable* threadToWaitTimerMap;
 
@@ -54,12 +73,24 @@ struct _Scheduler {
     /* used to randomize host-to-thread assignment */
     Random* random;
 
+    /* if set, we also collect the time before which no host may receive
+     * an event from another host, according to each host's lookahead */
+    gboolean useHostLookahead;
+
+    /* the thread each host is assigned to, and how much time it used */
+    GHashTable* hostToHostItemMap;
+    /* if positive, we move hosts off of the busiest threads between rounds
+     * whenever this many seconds of real time have passed */
+    gdouble rebalanceInterval;
+    GTimer* rebalanceTimer;
+
     /* auxiliary information about current running state */
     gboolean isRunning;
     SimulationTime endTime;
     struct {
         SimulationTime endTime;
         SimulationTime minNextEventTime;
+        SimulationTime minNextSafeTime;
     } currentRound;
 
     /* for memory management */
@@ -67,9 +98,21 @@ struct _Scheduler {
     MAGIC_DECLARE;
 };
 
+typedef struct _SchedulerHostItem SchedulerHostItem;
+struct _SchedulerHostItem {
+    Host* host;
+    pthread_t thread;
+    /* the total execution time of the host when we last rebalanced */
+    gdouble lastExecutionTime;
+    /* the execution time since we last rebalanced */
+    gdouble cost;
+};
+
 typedef struct _SchedulerThreadItem SchedulerThreadItem;
 struct _SchedulerThreadItem {
     pthread_t thread;
+    /* the total execution barrier wait time when we last rebalanced */
+    gdouble lastWaitTime;
     CountDownLatch* notifyDoneRunning;
     CountDownLatch* notifyReadyToJoin;
     CountDownLatch* notifyJoined;
@@ -112,7 +155,7 @@ static void _scheduler_stopHosts(Scheduler* scheduler) {
     }
 }
 
-Scheduler* scheduler_new(SchedulerPolicyType policyType, guint nWorkers, gpointer threadUserData,
+Scheduler* scheduler_new(SchedulerPolicyType policyType, SchedulerBarrierType barrierType, guint nWorkers, gpointer threadUserData,
         guint schedulerSeed, SimulationTime endTime) {
     Scheduler* scheduler = g_new0(Scheduler, 1);
     MAGIC_INIT(scheduler);
@@ -122,16 +165,28 @@ Scheduler* scheduler_new(SchedulerPolicyType policyType, guint nWorkers, gpointe
 
     scheduler->startBarrier = countdownlatch_new(nWorkers+1);
     scheduler->finishBarrier = countdownlatch_new(nWorkers+1);
-    scheduler->executeEventsBarrier = countdownlatch_new(nWorkers+1);
-    scheduler->collectInfoBarrier = countdownlatch_new(nWorkers+1);
-    scheduler->prepareRoundBarrier = countdownlatch_new(nWorkers+1);
+
+    /* without worker threads the main thread runs the events itself, and never
+     * releases the spin barriers that the start and finish wait on */
+    scheduler->barrierType = (nWorkers == 0) ? SB_LATCH : barrierType;
+    if(scheduler->barrierType == SB_SPIN) {
+        /* the main thread takes part in the execute barrier, and coordinates the other */
+        scheduler->executeEventsSpinBarrier = roundbarrier_new(nWorkers+1, FALSE);
+        scheduler->collectPrepareSpinBarrier = roundbarrier_new(nWorkers, TRUE);
+    } else {
+        scheduler->executeEventsBarrier = countdownlatch_new(nWorkers+1);
+        scheduler->collectInfoBarrier = countdownlatch_new(nWorkers+1);
+        scheduler->prepareRoundBarrier = countdownlatch_new(nWorkers+1);
+    }
 
     scheduler->endTime = endTime;
     scheduler->currentRound.endTime = scheduler->endTime;// default to one single round
     scheduler->currentRound.minNextEventTime = SIMTIME_MAX;
+    scheduler->currentRound.minNextSafeTime = SIMTIME_MAX;
 
     scheduler->threadToWaitTimerMap = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)g_timer_destroy);
     scheduler->hostIDToHostMap = g_hash_table_new(g_direct_hash, g_direct_equal);
+    scheduler->hostToHostItemMap = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
 
     scheduler->random = random_new(schedulerSeed);
 
@@ -166,6 +221,10 @@ Scheduler* scheduler_new(SchedulerPolicyType policyType, guint nWorkers, gpointe
             scheduler->policy = schedulerpolicythreadperhost_new();
             break;
         }
+        case SP_PARALLEL_THREAD_CALENDAR: {
+            scheduler->policy = schedulerpolicythreadcalendar_new();
+            break;
+        }
         case SP_SERIAL_GLOBAL:
         default: {
             scheduler->policy = schedulerpolicyglobalsingle_new();
@@ -283,6 +342,10 @@ static void _scheduler_free(Scheduler* scheduler) {
     if(scheduler->threadToWaitTimerMap) {
         g_hash_table_destroy(scheduler->threadToWaitTimerMap);
     }
+    if(scheduler->rebalanceTimer) {
+        g_timer_destroy(scheduler->rebalanceTimer);
+    }
+    g_hash_table_destroy(scheduler->hostToHostItemMap);
 
     guint nWorkers = g_queue_get_length(scheduler->threadItems);
 
@@ -304,9 +367,14 @@ static void _scheduler_free(Scheduler* scheduler) {
 
     g_queue_free(scheduler->threadItems);
 
-    countdownlatch_free(scheduler->executeEventsBarrier);
-    countdownlatch_free(scheduler->collectInfoBarrier);
-    countdownlatch_free(scheduler->prepareRoundBarrier);
+    if(scheduler->barrierType == SB_SPIN) {
+        roundbarrier_free(scheduler->executeEventsSpinBarrier);
+        roundbarrier_free(scheduler->collectPrepareSpinBarrier);
+    } else {
+        countdownlatch_free(scheduler->executeEventsBarrier);
+        countdownlatch_free(scheduler->collectInfoBarrier);
+        countdownlatch_free(scheduler->prepareRoundBarrier);
+    }
     countdownlatch_free(scheduler->startBarrier);
     countdownlatch_free(scheduler->finishBarrier);
 
@@ -383,14 +451,26 @@ Event* scheduler_pop(Scheduler* scheduler) {
             if(executeEventsBarrierWaitTime) {
                 g_timer_continue(executeEventsBarrierWaitTime);
             }
-            countdownlatch_countDownAwait(scheduler->executeEventsBarrier);
+            if(scheduler->barrierType == SB_SPIN) {
+                roundbarrier_await(scheduler->executeEventsSpinBarrier);
+            } else {
+                countdownlatch_countDownAwait(scheduler->executeEventsBarrier);
+            }
             if(executeEventsBarrierWaitTime) {
                 g_timer_stop(executeEventsBarrierWaitTime);
             }
 
             /* now all threads reached the current round end barrier time.
              * asynchronously collect some stats that the main thread will use. */
-            if(scheduler->policy->getNextTime) {
+            if(scheduler->useHostLookahead) {
+                /* both times come from the same pass over our hosts */
+                SimulationTime nextTime = SIMTIME_MAX, nextSafeTime = SIMTIME_MAX;
+                scheduler->policy->getNextTimes(scheduler->policy, &nextTime, &nextSafeTime);
+                g_mutex_lock(&(scheduler->globalLock));
+                scheduler->currentRound.minNextEventTime = MIN(scheduler->currentRound.minNextEventTime, nextTime);
+                scheduler->currentRound.minNextSafeTime = MIN(scheduler->currentRound.minNextSafeTime, nextSafeTime);
+                g_mutex_unlock(&(scheduler->globalLock));
+            } else if(scheduler->policy->getNextTime) {
                 SimulationTime nextTime = scheduler->policy->getNextTime(scheduler->policy);
                 g_mutex_lock(&(scheduler->globalLock));
                 scheduler->currentRound.minNextEventTime = MIN(scheduler->currentRound.minNextEventTime, nextTime);
@@ -401,11 +481,17 @@ Event* scheduler_pop(Scheduler* scheduler) {
             shadow_logger_flushRecords(shadow_logger_getDefault(),
                                        pthread_self());
 
-            /* wait for other threads to finish their collect step */
-            countdownlatch_countDownAwait(scheduler->collectInfoBarrier);
+            if(scheduler->barrierType == SB_SPIN) {
+                /* the main thread waits for all of us to finish the collect step,
+                 * updates for the next round, and then lets us through */
+                roundbarrier_await(scheduler->collectPrepareSpinBarrier);
+            } else {
+                /* wait for other threads to finish their collect step */
+                countdownlatch_countDownAwait(scheduler->collectInfoBarrier);
 
-            /* now wait for main thread to process a barrier update for the next round */
-            countdownlatch_countDownAwait(scheduler->prepareRoundBarrier);
+                /* now wait for main thread to process a barrier update for the next round */
+                countdownlatch_countDownAwait(scheduler->prepareRoundBarrier);
+            }
         }
     }
 
@@ -434,6 +520,15 @@ static void _scheduler_appendHostToQueue(gpointer uintKey, Host* host, GQueue* a
     g_queue_push_tail(allHosts, host);
 }
 
+GQueue* scheduler_getAllHosts(Scheduler* scheduler) {
+    MAGIC_ASSERT(scheduler);
+    GQueue* hosts = g_queue_new();
+    g_mutex_lock(&scheduler->globalLock);
+    g_hash_table_foreach(scheduler->hostIDToHostMap, (GHFunc)_scheduler_appendHostToQueue, hosts);
+    g_mutex_unlock(&scheduler->globalLock);
+    return hosts;
+}
+
 static void _scheduler_shuffleQueue(Scheduler* scheduler, GQueue* queue) {
     if(queue == NULL) {
         return;
@@ -471,6 +566,42 @@ static void _scheduler_shuffleQueue(Scheduler* scheduler, GQueue* queue) {
     }
 }
 
+typedef struct _SchedulerHostCost SchedulerHostCost;
+struct _SchedulerHostCost {
+    Host* host;
+    gdouble cost;
+    /* the position after shuffling, which breaks ties between equal costs */
+    guint index;
+};
+
+static gint _scheduler_compareHostCost(const SchedulerHostCost* a, const SchedulerHostCost* b) {
+    if(a->cost != b->cost) {
+        return (a->cost > b->cost) ? -1 : 1;
+    }
+    return (a->index < b->index) ? -1 : (a->index > b->index) ? 1 : 0;
+}
+
+/* before any host has run, the best indication of how much work it will generate
+ * is how much traffic its network interface can carry */
+static gdouble _scheduler_estimateHostCost(Host* host) {
+    NetworkInterface* interface = host_lookupInterface(host, host_getDefaultIP(host));
+    if(!interface) {
+        return 1.0;
+    }
+    return 1.0 + (gdouble)networkinterface_getSpeedUpKiBps(interface) +
+            (gdouble)networkinterface_getSpeedDownKiBps(interface);
+}
+
+static void _scheduler_assignHost(Scheduler* scheduler, Host* host, pthread_t thread) {
+    scheduler->policy->addHost(scheduler->policy, host, thread);
+
+    /* remember the assignment so that we can rebalance later */
+    SchedulerHostItem* hostItem = g_new0(SchedulerHostItem, 1);
+    hostItem->host = host;
+    hostItem->thread = thread;
+    g_hash_table_replace(scheduler->hostToHostItemMap, host, hostItem);
+}
+
 static void _scheduler_assignHostsToThread(Scheduler* scheduler, GQueue* hosts, pthread_t thread, uint maxAssignments) {
     MAGIC_ASSERT(scheduler);
     utility_assert(hosts);
@@ -480,7 +611,7 @@ static void _scheduler_assignHostsToThread(Scheduler* scheduler, GQueue* hosts,
     while((maxAssignments == 0 || numAssignments < maxAssignments) && !g_queue_is_empty(hosts)) {
         Host* host = (Host*) g_queue_pop_head(hosts);
         utility_assert(host);
-        scheduler->policy->addHost(scheduler->policy, host, thread);
+        _scheduler_assignHost(scheduler, host, thread);
         numAssignments++;
     }
 }
@@ -510,18 +641,41 @@ static void _scheduler_assignHosts(Scheduler* scheduler) {
         _scheduler_assignHostsToThread(scheduler, hosts, chosen, 0);
         utility_assert(g_queue_is_empty(hosts));
     } else {
-        /* we need to shuffle the list of hosts to make sure they are randomly assigned */
+        /* we need to shuffle the list of hosts so that hosts of equal cost are randomly assigned */
         _scheduler_shuffleQueue(scheduler, hosts);
 
-        /* now that our host order has been randomized, assign them evenly to worker threads */
-        while(!g_queue_is_empty(hosts)) {
-            SchedulerThreadItem* item = g_queue_pop_head(scheduler->threadItems);
-            pthread_t nextThread = item->thread;
-
-            _scheduler_assignHostsToThread(scheduler, hosts, nextThread, 1);
+        guint nHosts = g_queue_get_length(hosts);
+        SchedulerHostCost* costs = g_new0(SchedulerHostCost, nHosts);
+        for(guint i = 0; i < nHosts; i++) {
+            costs[i].host = g_queue_pop_head(hosts);
+            costs[i].cost = _scheduler_estimateHostCost(costs[i].host);
+            costs[i].index = i;
+        }
+        qsort(costs, nHosts, sizeof(SchedulerHostCost), (GCompareFunc)_scheduler_compareHostCost);
+
+        /* longest-processing-time-first: give each host, most expensive first,
+         * to the thread with the least total cost so far */
+        gdouble* threadCosts = g_new0(gdouble, nThreads);
+        SchedulerThreadItem** items = g_new0(SchedulerThreadItem*, nThreads);
+        guint t = 0;
+        for(GList* link = g_queue_peek_head_link(scheduler->threadItems); link; link = link->next) {
+            items[t++] = link->data;
+        }
 
-            g_queue_push_tail(scheduler->threadItems, item);
+        for(guint i = 0; i < nHosts; i++) {
+            guint chosen = 0;
+            for(guint j = 1; j < nThreads; j++) {
+                if(threadCosts[j] < threadCosts[chosen]) {
+                    chosen = j;
+                }
+            }
+            _scheduler_assignHost(scheduler, costs[i].host, items[chosen]->thread);
+            threadCosts[chosen] += costs[i].cost;
         }
+
+        g_free(items);
+        g_free(threadCosts);
+        g_free(costs);
     }
 
     if(hosts) {
@@ -530,33 +684,107 @@ static void _scheduler_assignHosts(Scheduler* scheduler) {
     g_mutex_unlock(&scheduler->globalLock);
 }
 
+static gint _scheduler_compareHostItemCost(const SchedulerHostItem** a, const SchedulerHostItem** b) {
+    if((*a)->cost != (*b)->cost) {
+        return ((*a)->cost > (*b)->cost) ? -1 : 1;
+    }
+    return host_compare((*a)->host, (*b)->host, NULL);
+}
+
+/* this must only run in the main thread while the workers wait between rounds */
 static void _scheduler_rebalanceHosts(Scheduler* scheduler) {
     MAGIC_ASSERT(scheduler);
+    utility_assert(scheduler->policy->migrateHost);
 
-    // WARNING if this is run, then all existing eventSequenceCounters
-    // need to get set to the max of all existing counters to ensure order correctness
+    gdouble elapsed = g_timer_elapsed(scheduler->rebalanceTimer, NULL);
+    if(elapsed < scheduler->rebalanceInterval) {
+        return;
+    }
+    g_timer_start(scheduler->rebalanceTimer);
 
-    /* get queue of all hosts */
-    GQueue* hosts = g_queue_new();
-    g_hash_table_foreach(scheduler->hostIDToHostMap, (GHFunc)_scheduler_appendHostToQueue, hosts);
+    /* a thread was busy for as long as it did not wait at the execution barrier */
+    guint nThreads = g_queue_get_length(scheduler->threadItems);
+    SchedulerThreadItem** items = g_new0(SchedulerThreadItem*, nThreads);
+    gdouble* busyTimes = g_new0(gdouble, nThreads);
+    guint t = 0;
+    for(GList* link = g_queue_peek_head_link(scheduler->threadItems); link; link = link->next, t++) {
+        items[t] = link->data;
+        GTimer* waitTimer = g_hash_table_lookup(scheduler->threadToWaitTimerMap, GUINT_TO_POINTER(items[t]->thread));
+        gdouble waitTime = waitTimer ? g_timer_elapsed(waitTimer, NULL) : 0.0;
+        busyTimes[t] = MAX(elapsed - (waitTime - items[t]->lastWaitTime), 0.0);
+        items[t]->lastWaitTime = waitTime;
+    }
 
-    _scheduler_shuffleQueue(scheduler, hosts);
+    /* hosts that used the most time are the first candidates to move */
+    GPtrArray* hostItems = g_ptr_array_sized_new(g_hash_table_size(scheduler->hostToHostItemMap));
+    GHashTableIter iter;
+    gpointer value = NULL;
+    g_hash_table_iter_init(&iter, scheduler->hostToHostItemMap);
+    while(g_hash_table_iter_next(&iter, NULL, &value)) {
+        SchedulerHostItem* hostItem = value;
+        gdouble executionTime = host_getElapsedExecutionTime(hostItem->host);
+        hostItem->cost = executionTime - hostItem->lastExecutionTime;
+        hostItem->lastExecutionTime = executionTime;
+        g_ptr_array_add(hostItems, hostItem);
+    }
+    g_ptr_array_sort(hostItems, (GCompareFunc)_scheduler_compareHostItemCost);
+
+    guint numMigrations = 0;
+    while(nThreads > 1 && numMigrations < SCHEDULER_REBALANCE_MAX_MIGRATIONS) {
+        guint busiest = 0, idlest = 0;
+        for(guint i = 1; i < nThreads; i++) {
+            if(busyTimes[i] > busyTimes[busiest]) {
+                busiest = i;
+            }
+            if(busyTimes[i] < busyTimes[idlest]) {
+                idlest = i;
+            }
+        }
 
-    /* now that our host order has been randomized, assign them evenly to worker threads */
-    while(!g_queue_is_empty(hosts)) {
-        Host* host = g_queue_pop_head(hosts);
-        SchedulerThreadItem* item = g_queue_pop_head(scheduler->threadItems);
-        pthread_t newThread = item->thread;
+        gdouble imbalance = busyTimes[busiest] - busyTimes[idlest];
+        if(imbalance <= busyTimes[busiest] * SCHEDULER_REBALANCE_MIN_IMBALANCE) {
+            break;
+        }
 
-//        TODO this needs to get uncommented/updated when migration code is added
-//        scheduler->policy->migrateHost(scheduler->policy, host, newThread);
+        /* moving the host whose cost is closest to half of the imbalance evens
+         * out the two threads the most. hosts that cost more than the imbalance
+         * would just make the other thread the busiest one. */
+        SchedulerHostItem* chosen = NULL;
+        for(guint i = 0; i < hostItems->len; i++) {
+            SchedulerHostItem* hostItem = g_ptr_array_index(hostItems, i);
+            if(!pthread_equal(hostItem->thread, items[busiest]->thread) ||
+                    hostItem->cost <= 0.0 || hostItem->cost >= imbalance) {
+                continue;
+            }
+            if(!chosen || fabs(hostItem->cost - imbalance / 2) < fabs(chosen->cost - imbalance / 2)) {
+                chosen = hostItem;
+            }
+        }
+        if(!chosen) {
+            break;
+        }
 
-        g_queue_push_tail(scheduler->threadItems, item);
+        /* the policy delays every event between two hosts to the next round no matter
+         * which threads run them, and event ids are counted per source host, so moving
+         * a host does not change when or in which order its events run. that is why the
+         * host costs and the moments we rebalance can come from the real time. */
+        scheduler->policy->migrateHost(scheduler->policy, chosen->host, items[idlest]->thread);
+        chosen->thread = items[idlest]->thread;
+
+        busyTimes[busiest] -= chosen->cost;
+        busyTimes[idlest] += chosen->cost;
+        /* don't move the same host twice in one step */
+        chosen->cost = 0.0;
+        numMigrations++;
     }
 
-    if(hosts) {
-        g_queue_free(hosts);
+    if(numMigrations > 0) {
+        info("rebalanced %u hosts across %u threads after %f seconds", numMigrations, nThreads, elapsed);
     }
+
+    g_ptr_array_free(hostItems, TRUE);
+    g_free(busyTimes);
+    g_free(items);
 }
 
 SchedulerPolicyType scheduler_getPolicy(Scheduler* scheduler) {
@@ -569,6 +797,49 @@ gboolean scheduler_isRunning(Scheduler* scheduler) {
     return scheduler->isRunning;
 }
 
+gboolean scheduler_enableHostLookahead(Scheduler* scheduler) {
+    MAGIC_ASSERT(scheduler);
+
+    /* this must be set before the workers start running rounds */
+    utility_assert(!scheduler->isRunning);
+
+    if(scheduler->policyType == SP_SERIAL_GLOBAL) {
+        /* the single queue is never limited by the round window */
+        return FALSE;
+    }
+
+    if(!scheduler->policy->getNextTimes) {
+        warning("the configured scheduler policy does not track the next event time of "
+                "each host, so host lookahead will not be used; use the 'host' or 'steal' policy instead");
+        return FALSE;
+    }
+
+    scheduler->useHostLookahead = TRUE;
+    return TRUE;
+}
+
+gboolean scheduler_enableRebalancing(Scheduler* scheduler, gdouble interval) {
+    MAGIC_ASSERT(scheduler);
+
+    /* this must be set before the workers start running rounds */
+    utility_assert(!scheduler->isRunning);
+
+    if(scheduler->policyType == SP_SERIAL_GLOBAL || g_queue_get_length(scheduler->threadItems) < 2) {
+        /* there is nowhere to move the hosts to */
+        return FALSE;
+    }
+
+    if(!scheduler->policy->migrateHost) {
+        warning("the configured scheduler policy can not move hosts between threads without "
+                "changing the simulation results, so hosts will not be rebalanced; use the 'host' policy instead");
+        return FALSE;
+    }
+
+    scheduler->rebalanceInterval = interval;
+    scheduler->rebalanceTimer = g_timer_new();
+    return TRUE;
+}
+
 void scheduler_awaitStart(Scheduler* scheduler) {
     /* set up the thread timer map */
     g_mutex_lock(&scheduler->globalLock);
@@ -586,7 +857,11 @@ void scheduler_awaitStart(Scheduler* scheduler) {
     _scheduler_startHosts(scheduler);
 
     /* everyone is waiting for the next round to be ready */
-    countdownlatch_countDownAwait(scheduler->prepareRoundBarrier);
+    if(scheduler->barrierType == SB_SPIN) {
+        roundbarrier_await(scheduler->collectPrepareSpinBarrier);
+    } else {
+        countdownlatch_countDownAwait(scheduler->prepareRoundBarrier);
+    }
 }
 
 void scheduler_awaitFinish(Scheduler* scheduler) {
@@ -608,6 +883,10 @@ void scheduler_start(Scheduler* scheduler) {
     scheduler->isRunning = TRUE;
     g_mutex_unlock(&scheduler->globalLock);
 
+    if(scheduler->rebalanceTimer) {
+        g_timer_start(scheduler->rebalanceTimer);
+    }
+
     if(scheduler->policyType != SP_SERIAL_GLOBAL) {
         /* this will cause a worker to execute the locked initialization in awaitStart */
         countdownlatch_countDownAwait(scheduler->startBarrier);
@@ -618,22 +897,33 @@ void scheduler_continueNextRound(Scheduler* scheduler, SimulationTime windowStar
     g_mutex_lock(&scheduler->globalLock);
     scheduler->currentRound.endTime = windowEnd;
     scheduler->currentRound.minNextEventTime = SIMTIME_MAX;
+    scheduler->currentRound.minNextSafeTime = SIMTIME_MAX;
     g_mutex_unlock(&scheduler->globalLock);
 
     if(scheduler->policyType != SP_SERIAL_GLOBAL) {
         /* workers are waiting for preparation of the next round
          * this will cause them to start running events */
-        countdownlatch_countDownAwait(scheduler->prepareRoundBarrier);
+        if(scheduler->barrierType == SB_SPIN) {
+            roundbarrier_release(scheduler->collectPrepareSpinBarrier);
+        } else {
+            countdownlatch_countDownAwait(scheduler->prepareRoundBarrier);
 
-        /* workers are running events now, and will wait at executeEventsBarrier
-         * when blocked because there are no more events available in the current round */
-        countdownlatch_reset(scheduler->prepareRoundBarrier);
+            /* workers are running events now, and will wait at executeEventsBarrier
+             * when blocked because there are no more events available in the current round */
+            countdownlatch_reset(scheduler->prepareRoundBarrier);
+        }
     }
 }
 
 SimulationTime scheduler_awaitNextRound(Scheduler* scheduler) {
     /* this function is called by the slave main thread */
-    if(scheduler->policyType != SP_SERIAL_GLOBAL) {
+    if(scheduler->policyType != SP_SERIAL_GLOBAL && scheduler->barrierType == SB_SPIN) {
+        /* other workers will also wait at this barrier when they are finished with their events */
+        roundbarrier_await(scheduler->executeEventsSpinBarrier);
+        /* then they collect stats and wait at the prepare barrier until we release them
+         * in scheduler_continueNextRound */
+        roundbarrier_awaitArrivals(scheduler->collectPrepareSpinBarrier);
+    } else if(scheduler->policyType != SP_SERIAL_GLOBAL) {
         /* other workers will also wait at this barrier when they are finished with their events */
         countdownlatch_countDownAwait(scheduler->executeEventsBarrier);
         countdownlatch_reset(scheduler->executeEventsBarrier);
@@ -642,6 +932,11 @@ SimulationTime scheduler_awaitNextRound(Scheduler* scheduler) {
         countdownlatch_reset(scheduler->collectInfoBarrier);
     }
 
+    /* none of the workers are running hosts now, so they can be moved */
+    if(scheduler->rebalanceTimer) {
+        _scheduler_rebalanceHosts(scheduler);
+    }
+
     SimulationTime minNextEventTime = SIMTIME_MAX;
     g_mutex_lock(&scheduler->globalLock);
     minNextEventTime = scheduler->currentRound.minNextEventTime;
@@ -649,6 +944,21 @@ SimulationTime scheduler_awaitNextRound(Scheduler* scheduler) {
     return minNextEventTime;
 }
 
+SimulationTime scheduler_getNextSafeTime(Scheduler* scheduler) {
+    MAGIC_ASSERT(scheduler);
+
+    if(!scheduler->useHostLookahead) {
+        return SIMTIME_INVALID;
+    }
+
+    /* this is called by the slave main thread after scheduler_awaitNextRound */
+    SimulationTime minNextSafeTime = SIMTIME_MAX;
+    g_mutex_lock(&scheduler->globalLock);
+    minNextSafeTime = scheduler->currentRound.minNextSafeTime;
+    g_mutex_unlock(&scheduler->globalLock);
+    return minNextSafeTime;
+}
+
 void scheduler_finish(Scheduler* scheduler) {
     /* make sure when the workers wake up they know we are done */
     g_mutex_lock(&scheduler->globalLock);
@@ -658,7 +968,11 @@ void scheduler_finish(Scheduler* scheduler) {
     if(scheduler->policyType != SP_SERIAL_GLOBAL) {
         /* wake up threads from their waiting for the next round.
          * because isRunning is now false, they will all exit and wait at finishBarrier */
-        countdownlatch_countDownAwait(scheduler->prepareRoundBarrier);
+        if(scheduler->barrierType == SB_SPIN) {
+            roundbarrier_release(scheduler->collectPrepareSpinBarrier);
+        } else {
+            countdownlatch_countDownAwait(scheduler->prepareRoundBarrier);
+        }
 
         /* wait for them to be ready to finish */
         countdownlatch_countDownAwait(scheduler->finishBarrier);
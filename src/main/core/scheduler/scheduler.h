@@ -16,7 +16,17 @@
 
 typedef struct _Scheduler Scheduler;
 
-Scheduler* scheduler_new(SchedulerPolicyType policyType, guint nWorkers, gpointer threadUserData,
+typedef enum {
+    /* every round synchronization step uses a mutex/condition latch that the
+     * main thread resets after each round */
+    SB_LATCH,
+    /* rounds are synchronized with spin-then-futex barriers that never need a reset,
+     * and the workers' collect step and the main thread's round preparation share
+     * a single barrier crossing */
+    SB_SPIN,
+} SchedulerBarrierType;
+
+Scheduler* scheduler_new(SchedulerPolicyType policyType, SchedulerBarrierType barrierType, guint nWorkers, gpointer threadUserData,
         guint schedulerSeed, SimulationTime endTime);
 void scheduler_ref(Scheduler*);
 void scheduler_unref(Scheduler*);
@@ -27,6 +37,7 @@ void scheduler_awaitFinish(Scheduler*);
 void scheduler_start(Scheduler*);
 void scheduler_continueNextRound(Scheduler*, SimulationTime, SimulationTime);
 SimulationTime scheduler_awaitNextRound(Scheduler*);
+SimulationTime scheduler_getNextSafeTime(Scheduler*);
 void scheduler_finish(Scheduler*);
 
 gboolean scheduler_push(Scheduler*, Event*, Host* sender, Host* receiver);
@@ -34,7 +45,10 @@ Event* scheduler_pop(Scheduler*);
 
 void scheduler_addHost(Scheduler*, Host*);
 Host* scheduler_getHost(Scheduler*, GQuark);
+GQueue* scheduler_getAllHosts(Scheduler*);
 SchedulerPolicyType scheduler_getPolicy(Scheduler*);
 gboolean scheduler_isRunning(Scheduler* scheduler);
+gboolean scheduler_enableHostLookahead(Scheduler* scheduler);
+gboolean scheduler_enableRebalancing(Scheduler* scheduler, gdouble interval);
 
 #endif /* SHD_SCHEDULER_H_ */
@@ -26,6 +26,9 @@ typedef enum {
     /* every thread has a locked pqueue for every host, each thread inserts into its one
      * assigned host queue and max queue contention is 2 threads at any time */
     SP_PARALLEL_THREAD_PERHOST,
+    /* like SP_PARALLEL_THREAD_SINGLE, but the pqueue is a calendar queue so that pushing
+     * and popping take amortized constant time even with millions of pending events */
+    SP_PARALLEL_THREAD_CALENDAR,
 } SchedulerPolicyType;
 
 typedef struct _SchedulerPolicy SchedulerPolicy;
@@ -35,6 +38,8 @@ typedef GQueue* (*SchedulerPolicyGetHostsFunc)(SchedulerPolicy*);
 typedef void (*SchedulerPolicyPushFunc)(SchedulerPolicy*, Event*, Host*, Host*, SimulationTime);
 typedef Event* (*SchedulerPolicyPopFunc)(SchedulerPolicy*, SimulationTime);
 typedef SimulationTime (*SchedulerPolicyGetNextTimeFunc)(SchedulerPolicy*);
+typedef void (*SchedulerPolicyGetNextTimesFunc)(SchedulerPolicy*, SimulationTime*, SimulationTime*);
+typedef void (*SchedulerPolicyMigrateHostFunc)(SchedulerPolicy*, Host*, pthread_t);
 typedef void (*SchedulerPolicyFreeFunc)(SchedulerPolicy*);
 
 struct _SchedulerPolicy {
@@ -46,6 +51,14 @@ struct _SchedulerPolicy {
     SchedulerPolicyPushFunc push;
     SchedulerPolicyPopFunc pop;
     SchedulerPolicyGetNextTimeFunc getNextTime;
+    /* optional, gets both the next event time and the min over assigned hosts of
+     * the next event time plus the host lookahead, in one pass over the hosts */
+    SchedulerPolicyGetNextTimesFunc getNextTimes;
+    /* optional, reassigns a host and its pending events to another thread. this is only
+     * called between rounds, while all of the worker threads are waiting for the next one.
+     * only policies that delay every event between two hosts to the next round may provide
+     * it, since for them the thread a host runs on can't change when its events run. */
+    SchedulerPolicyMigrateHostFunc migrateHost;
     SchedulerPolicyFreeFunc free;
     MAGIC_DECLARE;
 };
@@ -56,5 +69,6 @@ SchedulerPolicy* schedulerpolicyhoststeal_new();
 SchedulerPolicy* schedulerpolicythreadsingle_new();
 SchedulerPolicy* schedulerpolicythreadperthread_new();
 SchedulerPolicy* schedulerpolicythreadperhost_new();
+SchedulerPolicy* schedulerpolicythreadcalendar_new();
 
 #endif /* SHD_SCHEDULER_POLICY_H_ */
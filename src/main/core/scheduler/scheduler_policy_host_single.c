@@ -10,15 +10,15 @@
 #include "main/core/scheduler/scheduler_policy.h"
 #include "main/core/support/definitions.h"
 #include "main/core/work/event.h"
+#include "main/core/work/event_queue.h"
 #include "main/host/host.h"
-#include "main/utility/priority_queue.h"
 #include "main/utility/utility.h"
 #include "support/logger/logger.h"
 
 typedef struct _HostSingleQueueData HostSingleQueueData;
 struct _HostSingleQueueData {
     GMutex lock;
-    PriorityQueue* pq;
+    EventQueue* pq;
     SimulationTime lastEventTime;
     gsize nPushed;
     gsize nPopped;
@@ -49,6 +49,8 @@ typedef struct _HostSingleSearchState HostSingleSearchState;
 struct _HostSingleSearchState {
     HostSinglePolicyData* data;
     SimulationTime nextEventTime;
+    /* the earliest time that any of the hosts may send an event to another host */
+    SimulationTime nextSafeTime;
 };
 
 static HostSingleThreadData* _hostsinglethreaddata_new() {
@@ -101,7 +103,7 @@ static HostSingleQueueData* _hostsinglequeuedata_new() {
     HostSingleQueueData* qdata = g_new0(HostSingleQueueData, 1);
 
     g_mutex_init(&(qdata->lock));
-    qdata->pq = priorityqueue_new((GCompareDataFunc)event_compare, NULL, (GDestroyNotify)event_unref);
+    qdata->pq = eventqueue_new();
 
     return qdata;
 }
@@ -109,7 +111,7 @@ static HostSingleQueueData* _hostsinglequeuedata_new() {
 static void _hostsinglequeuedata_free(HostSingleQueueData* qdata) {
     if(qdata) {
         if(qdata->pq) {
-            priorityqueue_free(qdata->pq);
+            eventqueue_free(qdata->pq);
         }
         g_mutex_clear(&(qdata->lock));
         g_free(qdata);
@@ -139,6 +141,29 @@ static void _schedulerpolicyhostsingle_addHost(SchedulerPolicy* policy, Host* ho
     g_hash_table_replace(data->hostToThreadMap, host, GUINT_TO_POINTER(assignedThread));
 }
 
+static void _schedulerpolicyhostsingle_migrateHost(SchedulerPolicy* policy, Host* host, pthread_t newThread) {
+    MAGIC_ASSERT(policy);
+    HostSinglePolicyData* data = policy->data;
+
+    pthread_t oldThread = (pthread_t)g_hash_table_lookup(data->hostToThreadMap, host);
+    if(pthread_equal(oldThread, newThread)) {
+        return;
+    }
+
+    /* the events stay in the host's own queue, we only need to move the host itself */
+    HostSingleThreadData* tdata = g_hash_table_lookup(data->threadToThreadDataMap, GUINT_TO_POINTER(oldThread));
+    if(tdata) {
+        if(!g_queue_remove(tdata->processedHosts, host)) {
+            g_queue_remove(tdata->unprocessedHosts, host);
+        }
+
+        /* migrate the TLS of all objects associated with this host */
+        host_migrate(host, &oldThread, &newThread);
+    }
+
+    _schedulerpolicyhostsingle_addHost(policy, host, newThread);
+}
+
 static void concat_queue_iter(Host* hostItem, GQueue* userQueue) {
     g_queue_push_tail(userQueue, hostItem);
 }
@@ -200,7 +225,7 @@ static void _schedulerpolicyhostsingle_push(SchedulerPolicy* policy, Event* even
     }
 
     /* 'deliver' the event to the destination queue */
-    priorityqueue_push(qdata->pq, event);
+    eventqueue_push(qdata->pq, event);
     qdata->nPushed++;
 
     /* release the destination queue lock */
@@ -244,13 +269,13 @@ static Event* _schedulerpolicyhostsingle_pop(SchedulerPolicy* policy, Simulation
         g_mutex_lock(&(qdata->lock));
         g_timer_stop(tdata->popIdleTime);
 
-        Event* nextEvent = priorityqueue_peek(qdata->pq);
+        Event* nextEvent = eventqueue_peek(qdata->pq);
         SimulationTime eventTime = (nextEvent != NULL) ? event_getTime(nextEvent) : SIMTIME_INVALID;
 
         if(nextEvent != NULL && eventTime < barrier) {
             utility_assert(eventTime >= qdata->lastEventTime);
             qdata->lastEventTime = eventTime;
-            nextEvent = priorityqueue_pop(qdata->pq);
+            nextEvent = eventqueue_pop(qdata->pq);
             qdata->nPopped++;
         } else {
             nextEvent = NULL;
@@ -275,35 +300,50 @@ static void _schedulerpolicyhostsingle_findMinTime(Host* host, HostSingleSearchS
     utility_assert(qdata);
 
     g_mutex_lock(&(qdata->lock));
-    Event* event = priorityqueue_peek(qdata->pq);
+    SimulationTime eventTime = eventqueue_peekTime(qdata->pq);
     g_mutex_unlock(&(qdata->lock));
 
-    if(event != NULL) {
-        state->nextEventTime = MIN(state->nextEventTime, event_getTime(event));
+    if(eventTime != SIMTIME_INVALID) {
+        state->nextEventTime = MIN(state->nextEventTime, eventTime);
+        state->nextSafeTime = MIN(state->nextSafeTime, eventTime + host_getLookahead(host));
     }
 }
 
-static SimulationTime _schedulerpolicyhostsingle_getNextTime(SchedulerPolicy* policy) {
+static void _schedulerpolicyhostsingle_search(SchedulerPolicy* policy, HostSingleSearchState* searchState) {
     MAGIC_ASSERT(policy);
     HostSinglePolicyData* data = policy->data;
 
     /* set up state that we need for the foreach queue iterator */
-    HostSingleSearchState searchState;
-    memset(&searchState, 0, sizeof(HostSingleSearchState));
-    searchState.data = data;
-    searchState.nextEventTime = SIMTIME_MAX;
+    memset(searchState, 0, sizeof(HostSingleSearchState));
+    searchState->data = data;
+    searchState->nextEventTime = SIMTIME_MAX;
+    searchState->nextSafeTime = SIMTIME_MAX;
 
     HostSingleThreadData* tdata = g_hash_table_lookup(data->threadToThreadDataMap, GUINT_TO_POINTER(pthread_self()));
     if(tdata) {
         /* make sure we get all hosts, which are probably held in the processedHosts queue between rounds */
-        g_queue_foreach(tdata->unprocessedHosts, (GFunc)_schedulerpolicyhostsingle_findMinTime, &searchState);
-        g_queue_foreach(tdata->processedHosts, (GFunc)_schedulerpolicyhostsingle_findMinTime, &searchState);
+        g_queue_foreach(tdata->unprocessedHosts, (GFunc)_schedulerpolicyhostsingle_findMinTime, searchState);
+        g_queue_foreach(tdata->processedHosts, (GFunc)_schedulerpolicyhostsingle_findMinTime, searchState);
     }
-    info("next event at time %"G_GUINT64_FORMAT, searchState.nextEventTime);
+}
 
+static SimulationTime _schedulerpolicyhostsingle_getNextTime(SchedulerPolicy* policy) {
+    HostSingleSearchState searchState;
+    _schedulerpolicyhostsingle_search(policy, &searchState);
+    info("next event at time %"G_GUINT64_FORMAT, searchState.nextEventTime);
     return searchState.nextEventTime;
 }
 
+static void _schedulerpolicyhostsingle_getNextTimes(SchedulerPolicy* policy,
+        SimulationTime* nextEventTime, SimulationTime* nextSafeTime) {
+    HostSingleSearchState searchState;
+    _schedulerpolicyhostsingle_search(policy, &searchState);
+    info("next event at time %"G_GUINT64_FORMAT", next safe time for events between hosts is %"G_GUINT64_FORMAT,
+            searchState.nextEventTime, searchState.nextSafeTime);
+    *nextEventTime = searchState.nextEventTime;
+    *nextSafeTime = searchState.nextSafeTime;
+}
+
 static void _schedulerpolicyhostsingle_free(SchedulerPolicy* policy) {
     MAGIC_ASSERT(policy);
     HostSinglePolicyData* data = policy->data;
@@ -330,6 +370,8 @@ SchedulerPolicy* schedulerpolicyhostsingle_new() {
     policy->push = _schedulerpolicyhostsingle_push;
     policy->pop = _schedulerpolicyhostsingle_pop;
     policy->getNextTime = _schedulerpolicyhostsingle_getNextTime;
+    policy->getNextTimes = _schedulerpolicyhostsingle_getNextTimes;
+    policy->migrateHost = _schedulerpolicyhostsingle_migrateHost;
     policy->free = _schedulerpolicyhostsingle_free;
 
     policy->type = SP_PARALLEL_HOST_SINGLE;
@@ -10,18 +10,42 @@
 #include "main/core/scheduler/scheduler_policy.h"
 #include "main/core/support/definitions.h"
 #include "main/core/work/event.h"
+#include "main/core/work/event_inbox.h"
+#include "main/core/work/event_queue.h"
 #include "main/host/host.h"
-#include "main/utility/priority_queue.h"
 #include "main/utility/utility.h"
 #include "support/logger/logger.h"
 
+/* the weight of the newest round in the moving average of a host's time per event */
+#define HOSTSTEAL_COST_EWMA_WEIGHT 0.25
+/* the time per event we assume for a host that has not run any events yet */
+#define HOSTSTEAL_DEFAULT_SECONDS_PER_EVENT 0.00001
+
+/* The queues of a host are only touched by the thread that is currently running the
+ * host, or that holds it in its unprocessedHosts or processedHosts queues, so they need
+ * no lock of their own. Events from other hosts arrive through the lock-free inbox and are
+ * moved into the private event queue when the owner next looks at it. Cross-host events
+ * are always delayed until at least the end of the current round, so the owner never
+ * needs one before it drains the inbox. */
 typedef struct _HostStealQueueData HostStealQueueData;
 struct _HostStealQueueData {
-    GMutex lock;
-    PriorityQueue* pq;
+    EventQueue* pq;
+    EventInbox* inbox;
+    /* the thread the host is currently assigned to, so the pop path can check if the
+     * host needs to be migrated without taking the policy lock */
+    pthread_t assignedThread;
     SimulationTime lastEventTime;
-    gsize nPushed;
     gsize nPopped;
+
+    /* we estimate the cost of running a host in a round as the number of its events
+     * before the barrier times its average execution time per event, so that the most
+     * expensive hosts can be run (and stolen) first */
+    gsize nPoppedThisRound;
+    gdouble lastElapsedExecutionTime;
+    gdouble secondsPerEvent;
+    /* the cost estimate of the round ending at costBarrier */
+    gdouble cost;
+    SimulationTime costBarrier;
 };
 
 typedef struct _HostStealThreadData HostStealThreadData;
@@ -37,7 +61,7 @@ struct _HostStealThreadData {
     /* the host this worker is running; belongs to neither unprocessedHosts nor processedHosts */
     Host* runningHost;
     SimulationTime currentBarrier;
-    GTimer* pushIdleTime;
+    /* pushes never wait, since other threads' events go through lock-free inboxes */
     GTimer* popIdleTime;
     /* which worker thread this is */
     guint tnumber;
@@ -59,6 +83,8 @@ typedef struct _HostStealSearchState HostStealSearchState;
 struct _HostStealSearchState {
     HostStealPolicyData* data;
     SimulationTime nextEventTime;
+    /* the earliest time that any of the hosts may send an event to another host */
+    SimulationTime nextSafeTime;
 };
 
 static HostStealThreadData* _hoststealthreaddata_new() {
@@ -67,12 +93,10 @@ static HostStealThreadData* _hoststealthreaddata_new() {
     tdata->unprocessedHosts = g_queue_new();
     tdata->processedHosts = g_queue_new();
 
-    /* Create new timers to track thread idle times. The timers start in a 'started' state,
-     * so we want to stop them immediately so we can continue/stop later around blocking code
+    /* Create a new timer to track thread idle time. The timer starts in a 'started' state,
+     * so we want to stop it immediately so we can continue/stop later around blocking code
      * to collect total elapsed idle time in the scheduling process throughout the entire
      * runtime of the program. */
-    tdata->pushIdleTime = g_timer_new();
-    g_timer_stop(tdata->pushIdleTime);
     tdata->popIdleTime = g_timer_new();
     g_timer_stop(tdata->popIdleTime);
     g_mutex_init(&(tdata->lock));
@@ -92,11 +116,6 @@ static void _hoststealthreaddata_free(HostStealThreadData* tdata) {
             g_queue_free(tdata->processedHosts);
         }
 
-        gdouble totalPushWaitTime = 0.0;
-        if(tdata->pushIdleTime) {
-            totalPushWaitTime = g_timer_elapsed(tdata->pushIdleTime, NULL);
-            g_timer_destroy(tdata->pushIdleTime);
-        }
         gdouble totalPopWaitTime = 0.0;
         if(tdata->popIdleTime) {
             totalPopWaitTime = g_timer_elapsed(tdata->popIdleTime, NULL);
@@ -104,16 +123,16 @@ static void _hoststealthreaddata_free(HostStealThreadData* tdata) {
         }
 
         g_free(tdata);
-        message("scheduler thread data destroyed, total push wait time was %f seconds, "
-                "total pop wait time was %f seconds", totalPushWaitTime, totalPopWaitTime);
+        message("scheduler thread data destroyed, total pop wait time was %f seconds",
+                totalPopWaitTime);
     }
 }
 
 static HostStealQueueData* _hoststealqueuedata_new() {
     HostStealQueueData* qdata = g_new0(HostStealQueueData, 1);
 
-    g_mutex_init(&(qdata->lock));
-    qdata->pq = priorityqueue_new((GCompareDataFunc)event_compare, NULL, (GDestroyNotify)event_unref);
+    qdata->pq = eventqueue_new();
+    qdata->inbox = eventinbox_new();
 
     return qdata;
 }
@@ -121,29 +140,80 @@ static HostStealQueueData* _hoststealqueuedata_new() {
 static void _hoststealqueuedata_free(HostStealQueueData* qdata) {
     if(qdata) {
         if(qdata->pq) {
-            priorityqueue_free(qdata->pq);
+            eventqueue_free(qdata->pq);
+        }
+        if(qdata->inbox) {
+            eventinbox_free(qdata->inbox);
         }
-        g_mutex_clear(&(qdata->lock));
         g_free(qdata);
     }
 }
 
+/* fold the execution time of the round the host just finished into its average time per
+ * event. must be called by the thread that ran the host. */
+static void _hoststealqueuedata_updateCost(HostStealQueueData* qdata, Host* host) {
+    gdouble elapsed = host_getElapsedExecutionTime(host);
+    gdouble roundTime = elapsed - qdata->lastElapsedExecutionTime;
+    qdata->lastElapsedExecutionTime = elapsed;
+
+    if(qdata->nPoppedThisRound > 0) {
+        gdouble sample = roundTime / (gdouble)qdata->nPoppedThisRound;
+        if(qdata->secondsPerEvent > 0.0) {
+            qdata->secondsPerEvent = (HOSTSTEAL_COST_EWMA_WEIGHT * sample) +
+                    ((1.0 - HOSTSTEAL_COST_EWMA_WEIGHT) * qdata->secondsPerEvent);
+        } else {
+            qdata->secondsPerEvent = sample;
+        }
+        qdata->nPoppedThisRound = 0;
+    }
+}
+
+/* the estimated time it will take to run the host's events before the barrier.
+ * the caller must own the host, or hold the lock of the thread that does. */
+static gdouble _hoststealqueuedata_getCost(HostStealQueueData* qdata, SimulationTime barrier) {
+    if(qdata->costBarrier != barrier) {
+        gsize nEvents = eventqueue_countBefore(qdata->pq, barrier);
+        gdouble secondsPerEvent = (qdata->secondsPerEvent > 0.0) ?
+                qdata->secondsPerEvent : HOSTSTEAL_DEFAULT_SECONDS_PER_EVENT;
+        qdata->cost = (gdouble)nEvents * secondsPerEvent;
+        qdata->costBarrier = barrier;
+    }
+    return qdata->cost;
+}
+
+/* sorts the most expensive hosts first */
+static gint _schedulerpolicyhoststeal_compareHostCost(Host* a, Host* b, SimulationTime* barrier) {
+    gdouble costA = _hoststealqueuedata_getCost(host_getSchedulerData(a), *barrier);
+    gdouble costB = _hoststealqueuedata_getCost(host_getSchedulerData(b), *barrier);
+    if(costA != costB) {
+        return (costA > costB) ? -1 : 1;
+    }
+    GQuark idA = host_getID(a), idB = host_getID(b);
+    return (idA < idB) ? -1 : (idA > idB) ? 1 : 0;
+}
+
 /* this must be run synchronously, or the thread must be protected by locks */
 static void _schedulerpolicyhoststeal_addHost(SchedulerPolicy* policy, Host* host, pthread_t randomThread) {
     MAGIC_ASSERT(policy);
     HostStealPolicyData* data = policy->data;
 
-    /* each host has its own queue
+    /* each host has its own queue, which we also store in the host so we don't have
+     * to look it up for every event.
      * we don't read lock data->lock because we only modify the table here anyway
      */
-    if(!g_hash_table_lookup(data->hostToQueueDataMap, host)) {
+    HostStealQueueData* qdata = g_hash_table_lookup(data->hostToQueueDataMap, host);
+    if(!qdata) {
+        qdata = _hoststealqueuedata_new();
         g_rw_lock_writer_lock(&data->lock);
-        g_hash_table_replace(data->hostToQueueDataMap, host, _hoststealqueuedata_new());
+        g_hash_table_replace(data->hostToQueueDataMap, host, qdata);
         g_rw_lock_writer_unlock(&data->lock);
+        host_setSchedulerData(host, qdata);
+        qdata->lastElapsedExecutionTime = host_getElapsedExecutionTime(host);
     }
 
     /* each thread keeps track of the hosts it needs to run */
     pthread_t assignedThread = (randomThread != 0) ? randomThread : pthread_self();
+    qdata->assignedThread = assignedThread;
     g_rw_lock_reader_lock(&data->lock);
     HostStealThreadData* tdata = g_hash_table_lookup(data->threadToThreadDataMap, GUINT_TO_POINTER(assignedThread));
     g_rw_lock_reader_unlock(&data->lock);
@@ -241,33 +311,16 @@ static void _schedulerpolicyhoststeal_push(SchedulerPolicy* policy, Event* event
                 "to ensure event causality", eventTime, barrier);
     }
 
-    g_rw_lock_reader_lock(&data->lock);
-    /* we want to track how long this thread spends idle waiting to push the event */
-    HostStealThreadData* tdata = g_hash_table_lookup(data->threadToThreadDataMap, GUINT_TO_POINTER(pthread_self()));
-
     /* get the queue for the destination */
-    HostStealQueueData* qdata = g_hash_table_lookup(data->hostToQueueDataMap, dstHost);
-    g_rw_lock_reader_unlock(&data->lock);
+    HostStealQueueData* qdata = host_getSchedulerData(dstHost);
     utility_assert(qdata);
 
-    /* tracking idle time spent waiting for the destination queue lock */
-    if(tdata) {
-        g_timer_continue(tdata->pushIdleTime);
-        g_mutex_lock(&(tdata->lock));
-    }
-    g_mutex_lock(&(qdata->lock));
-    if(tdata) {
-        g_timer_stop(tdata->pushIdleTime);
-    }
-
-    /* 'deliver' the event to the destination queue */
-    priorityqueue_push(qdata->pq, event);
-    qdata->nPushed++;
-
-    /* release the destination queue lock */
-    g_mutex_unlock(&(qdata->lock));
-    if(tdata) {
-        g_mutex_unlock(&(tdata->lock));
+    /* 'deliver' the event to the destination queue. a host only sends events to itself
+     * while we are running it, so we own its queue and don't need to lock anything. */
+    if(srcHost == dstHost) {
+        eventqueue_push(qdata->pq, event);
+    } else {
+        eventinbox_push(qdata->inbox, event);
     }
 }
 
@@ -277,42 +330,39 @@ static Event* _schedulerpolicyhoststeal_popFromThread(SchedulerPolicy* policy, H
         return NULL;
     }
 
-    HostStealPolicyData* data = policy->data;
-
     while(!g_queue_is_empty(assignedHosts) || tdata->runningHost) {
         /* if there's no running host, we completed the last assignment and need a new one */
         if(!tdata->runningHost) {
             tdata->runningHost = g_queue_pop_head(assignedHosts);
         }
         Host* host = tdata->runningHost;
-        g_rw_lock_reader_lock(&data->lock);
-        HostStealQueueData* qdata = g_hash_table_lookup(data->hostToQueueDataMap, host);
-        g_rw_lock_reader_unlock(&data->lock);
+        HostStealQueueData* qdata = host_getSchedulerData(host);
         utility_assert(qdata);
 
-        g_mutex_lock(&(qdata->lock));
-        Event* nextEvent = priorityqueue_peek(qdata->pq);
-        SimulationTime eventTime = (nextEvent != NULL) ? event_getTime(nextEvent) : SIMTIME_INVALID;
+        /* we own the host now, so collect the events other hosts sent to it */
+        eventinbox_drain(qdata->inbox, qdata->pq);
+
+        SimulationTime eventTime = eventqueue_peekTime(qdata->pq);
+        Event* nextEvent = NULL;
 
-        if(nextEvent != NULL && eventTime < barrier) {
+        if(eventTime != SIMTIME_INVALID && eventTime < barrier) {
             utility_assert(eventTime >= qdata->lastEventTime);
             qdata->lastEventTime = eventTime;
-            nextEvent = priorityqueue_pop(qdata->pq);
+            nextEvent = eventqueue_pop(qdata->pq);
             qdata->nPopped++;
+            qdata->nPoppedThisRound++;
             /* migrate iff a migration is needed */
-            _schedulerpolicyhoststeal_migrateHost(policy, host, pthread_self());
+            pthread_t self = pthread_self();
+            if(!pthread_equal(qdata->assignedThread, self)) {
+                _schedulerpolicyhoststeal_migrateHost(policy, host, self);
+            }
         } else {
-            nextEvent = NULL;
-        }
-
-        if(nextEvent == NULL) {
             /* no more events on the runningHost, mark it as NULL so we get a new one */
+            _hoststealqueuedata_updateCost(qdata, host);
             g_queue_push_tail(tdata->processedHosts, host);
             tdata->runningHost = NULL;
         }
 
-        g_mutex_unlock(&(qdata->lock));
-
         if(nextEvent != NULL) {
             return nextEvent;
         }
@@ -355,6 +405,17 @@ static Event* _schedulerpolicyhoststeal_pop(SchedulerPolicy* policy, SimulationT
                 g_queue_push_tail(tdata->unprocessedHosts, g_queue_pop_head(tdata->processedHosts));
             }
         }
+
+        /* run the most expensive hosts first, so that we and anyone stealing from us
+         * leave the cheap ones to fill in the gaps at the end of the round. hosts run
+         * independently within a round, so their order doesn't change the results. */
+        g_rw_lock_reader_lock(&data->lock);
+        guint threadCount = data->threadCount;
+        g_rw_lock_reader_unlock(&data->lock);
+        if(threadCount > 1) {
+            g_queue_sort(tdata->unprocessedHosts,
+                    (GCompareDataFunc)_schedulerpolicyhoststeal_compareHostCost, &barrier);
+        }
     }
     /* attempt to get an event from this thread's queue */
     Event* nextEvent = _schedulerpolicyhoststeal_popFromThread(policy, tdata, tdata->unprocessedHosts, barrier);
@@ -418,43 +479,56 @@ static Event* _schedulerpolicyhoststeal_pop(SchedulerPolicy* policy, SimulationT
 }
 
 static void _schedulerpolicyhoststeal_findMinTime(Host* host, HostStealSearchState* state) {
-    g_rw_lock_reader_lock(&state->data->lock);
-    HostStealQueueData* qdata = g_hash_table_lookup(state->data->hostToQueueDataMap, host);
-    g_rw_lock_reader_unlock(&state->data->lock);
+    HostStealQueueData* qdata = host_getSchedulerData(host);
     utility_assert(qdata);
 
-    g_mutex_lock(&(qdata->lock));
-    Event* event = priorityqueue_peek(qdata->pq);
-    g_mutex_unlock(&(qdata->lock));
+    /* the host is ours between rounds, and all pushes of the last round are done */
+    eventinbox_drain(qdata->inbox, qdata->pq);
+    SimulationTime eventTime = eventqueue_peekTime(qdata->pq);
 
-    if(event != NULL) {
-        state->nextEventTime = MIN(state->nextEventTime, event_getTime(event));
+    if(eventTime != SIMTIME_INVALID) {
+        state->nextEventTime = MIN(state->nextEventTime, eventTime);
+        state->nextSafeTime = MIN(state->nextSafeTime, eventTime + host_getLookahead(host));
     }
 }
 
-static SimulationTime _schedulerpolicyhoststeal_getNextTime(SchedulerPolicy* policy) {
+static void _schedulerpolicyhoststeal_search(SchedulerPolicy* policy, HostStealSearchState* searchState) {
     MAGIC_ASSERT(policy);
     HostStealPolicyData* data = policy->data;
 
     /* set up state that we need for the foreach queue iterator */
-    HostStealSearchState searchState;
-    memset(&searchState, 0, sizeof(HostStealSearchState));
-    searchState.data = data;
-    searchState.nextEventTime = SIMTIME_MAX;
+    memset(searchState, 0, sizeof(HostStealSearchState));
+    searchState->data = data;
+    searchState->nextEventTime = SIMTIME_MAX;
+    searchState->nextSafeTime = SIMTIME_MAX;
 
     g_rw_lock_reader_lock(&data->lock);
     HostStealThreadData* tdata = g_hash_table_lookup(data->threadToThreadDataMap, GUINT_TO_POINTER(pthread_self()));
     g_rw_lock_reader_unlock(&data->lock);
     if(tdata) {
         /* make sure we get all hosts, which are probably held in the processedHosts queue between rounds */
-        g_queue_foreach(tdata->unprocessedHosts, (GFunc)_schedulerpolicyhoststeal_findMinTime, &searchState);
-        g_queue_foreach(tdata->processedHosts, (GFunc)_schedulerpolicyhoststeal_findMinTime, &searchState);
+        g_queue_foreach(tdata->unprocessedHosts, (GFunc)_schedulerpolicyhoststeal_findMinTime, searchState);
+        g_queue_foreach(tdata->processedHosts, (GFunc)_schedulerpolicyhoststeal_findMinTime, searchState);
     }
-    info("next event at time %"G_GUINT64_FORMAT, searchState.nextEventTime);
+}
 
+static SimulationTime _schedulerpolicyhoststeal_getNextTime(SchedulerPolicy* policy) {
+    HostStealSearchState searchState;
+    _schedulerpolicyhoststeal_search(policy, &searchState);
+    info("next event at time %"G_GUINT64_FORMAT, searchState.nextEventTime);
     return searchState.nextEventTime;
 }
 
+static void _schedulerpolicyhoststeal_getNextTimes(SchedulerPolicy* policy,
+        SimulationTime* nextEventTime, SimulationTime* nextSafeTime) {
+    HostStealSearchState searchState;
+    _schedulerpolicyhoststeal_search(policy, &searchState);
+    info("next event at time %"G_GUINT64_FORMAT", next safe time for events between hosts is %"G_GUINT64_FORMAT,
+            searchState.nextEventTime, searchState.nextSafeTime);
+    *nextEventTime = searchState.nextEventTime;
+    *nextSafeTime = searchState.nextSafeTime;
+}
+
 static void _schedulerpolicyhoststeal_free(SchedulerPolicy* policy) {
     MAGIC_ASSERT(policy);
     HostStealPolicyData* data = policy->data;
@@ -484,6 +558,7 @@ SchedulerPolicy* schedulerpolicyhoststeal_new() {
     policy->push = _schedulerpolicyhoststeal_push;
     policy->pop = _schedulerpolicyhoststeal_pop;
     policy->getNextTime = _schedulerpolicyhoststeal_getNextTime;
+    policy->getNextTimes = _schedulerpolicyhoststeal_getNextTimes;
     policy->free = _schedulerpolicyhoststeal_free;
 
     policy->type = SP_PARALLEL_HOST_STEAL;
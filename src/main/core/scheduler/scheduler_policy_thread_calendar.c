@@ -0,0 +1,201 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include <glib.h>
+#include <pthread.h>
+#include <stddef.h>
+
+#include "main/core/scheduler/scheduler_policy.h"
+#include "main/core/support/definitions.h"
+#include "main/core/work/calendar_queue.h"
+#include "main/core/work/event.h"
+#include "main/host/host.h"
+#include "main/utility/utility.h"
+#include "support/logger/logger.h"
+
+typedef struct _ThreadCalendarThreadData ThreadCalendarThreadData;
+struct _ThreadCalendarThreadData {
+    GQueue* assignedHosts;
+    GMutex lock;
+    CalendarQueue* cq;
+    SimulationTime lastEventTime;
+    gsize nPushed;
+    gsize nPopped;
+};
+
+typedef struct _ThreadCalendarPolicyData ThreadCalendarPolicyData;
+struct _ThreadCalendarPolicyData {
+    GHashTable* threadToThreadDataMap;
+    GHashTable* hostToThreadMap;
+    MAGIC_DECLARE;
+};
+
+static ThreadCalendarThreadData* _threadcalendarthreaddata_new() {
+    ThreadCalendarThreadData* tdata = g_new0(ThreadCalendarThreadData, 1);
+    g_mutex_init(&(tdata->lock));
+    tdata->cq = calendarqueue_new();
+    tdata->assignedHosts = g_queue_new();
+    return tdata;
+}
+
+static void _threadcalendarthreaddata_free(ThreadCalendarThreadData* tdata) {
+    if(tdata) {
+        if(tdata->assignedHosts) {
+            g_queue_free(tdata->assignedHosts);
+        }
+        if(tdata->cq) {
+            const CalendarQueueStats* stats = calendarqueue_getStats(tdata->cq);
+            message("scheduler thread calendar queue destroyed after %"G_GUINT64_FORMAT" pushes and "
+                    "%"G_GUINT64_FORMAT" pops; the buckets grew %u times and shrank %u times, "
+                    "to at most %u buckets; the last resize left %u buckets of width %"G_GUINT64_FORMAT" "
+                    "nanoseconds; the next event was found by searching all buckets %"G_GUINT64_FORMAT" times",
+                    stats->numPushed, stats->numPopped, stats->numGrows, stats->numShrinks,
+                    stats->maxNumBuckets, stats->numBuckets, stats->bucketWidth,
+                    stats->numDirectSearches);
+            calendarqueue_free(tdata->cq);
+        }
+        g_mutex_clear(&(tdata->lock));
+        g_free(tdata);
+    }
+}
+
+/* this must be run synchronously, or the call must be protected by locks */
+static void _schedulerpolicythreadcalendar_addHost(SchedulerPolicy* policy, Host* host, pthread_t randomThread) {
+    MAGIC_ASSERT(policy);
+    ThreadCalendarPolicyData* data = policy->data;
+
+    /* each thread keeps track of the hosts it needs to run */
+    pthread_t assignedThread = (randomThread != 0) ? randomThread : pthread_self();
+    ThreadCalendarThreadData* tdata = g_hash_table_lookup(data->threadToThreadDataMap, GUINT_TO_POINTER(assignedThread));
+    if(!tdata) {
+        tdata = _threadcalendarthreaddata_new();
+        g_hash_table_replace(data->threadToThreadDataMap, GUINT_TO_POINTER(assignedThread), tdata);
+    }
+    g_queue_push_tail(tdata->assignedHosts, host);
+
+    /* finally, store the host-to-thread mapping */
+    g_hash_table_replace(data->hostToThreadMap, host, GUINT_TO_POINTER(assignedThread));
+}
+
+static GQueue* _schedulerpolicythreadcalendar_getHosts(SchedulerPolicy* policy) {
+    MAGIC_ASSERT(policy);
+    ThreadCalendarPolicyData* data = policy->data;
+    ThreadCalendarThreadData* tdata = g_hash_table_lookup(data->threadToThreadDataMap, GUINT_TO_POINTER(pthread_self()));
+    return (tdata != NULL) ? tdata->assignedHosts : NULL;
+}
+
+static void _schedulerpolicythreadcalendar_push(SchedulerPolicy* policy, Event* event, Host* srcHost, Host* dstHost, SimulationTime barrier) {
+    MAGIC_ASSERT(policy);
+    ThreadCalendarPolicyData* data = policy->data;
+
+    /* non-local events must be properly delayed so the event wont show up at another worker
+     * before the next scheduling interval. this is only a problem if the sender and
+     * receivers have been assigned to different worker threads. */
+    pthread_t srcThread = GPOINTER_TO_UINT(g_hash_table_lookup(data->hostToThreadMap, srcHost));
+    pthread_t dstThread = GPOINTER_TO_UINT(g_hash_table_lookup(data->hostToThreadMap, dstHost));
+
+    SimulationTime eventTime = event_getTime(event);
+
+    if(!pthread_equal(srcThread, dstThread) && eventTime < barrier) {
+        event_setTime(event, barrier);
+        info("Inter-host event time %"G_GUINT64_FORMAT" changed to %"G_GUINT64_FORMAT" "
+                "to ensure event causality", eventTime, barrier);
+    }
+
+    /* get the queue for the destination */
+    ThreadCalendarThreadData* tdata = g_hash_table_lookup(data->threadToThreadDataMap, GUINT_TO_POINTER(dstThread));
+    utility_assert(tdata);
+
+    /* 'deliver' the event there */
+    g_mutex_lock(&(tdata->lock));
+    calendarqueue_push(tdata->cq, event);
+    tdata->nPushed++;
+    g_mutex_unlock(&(tdata->lock));
+}
+
+static Event* _schedulerpolicythreadcalendar_pop(SchedulerPolicy* policy, SimulationTime barrier) {
+    MAGIC_ASSERT(policy);
+    ThreadCalendarPolicyData* data = policy->data;
+
+    /* figure out which hosts we should be checking */
+    ThreadCalendarThreadData* tdata = g_hash_table_lookup(data->threadToThreadDataMap, GUINT_TO_POINTER(pthread_self()));
+    /* if there is no tdata, that means this thread didn't get any hosts assigned to it */
+    if(!tdata) {
+        /* this thread will remain idle */
+        return NULL;
+    }
+
+    g_mutex_lock(&(tdata->lock));
+
+    Event* nextEvent = calendarqueue_peek(tdata->cq);
+    SimulationTime eventTime = (nextEvent != NULL) ? event_getTime(nextEvent) : SIMTIME_INVALID;
+
+    if(nextEvent && eventTime < barrier) {
+        utility_assert(eventTime >= tdata->lastEventTime);
+        tdata->lastEventTime = eventTime;
+        nextEvent = calendarqueue_pop(tdata->cq);
+        tdata->nPopped++;
+    } else {
+        /* if we make it here, all hosts for this thread have no more events before barrier */
+        nextEvent = NULL;
+    }
+
+    g_mutex_unlock(&(tdata->lock));
+
+    return nextEvent;
+}
+
+static SimulationTime _schedulerpolicythreadcalendar_getNextTime(SchedulerPolicy* policy) {
+    MAGIC_ASSERT(policy);
+    ThreadCalendarPolicyData* data = policy->data;
+
+    SimulationTime nextTime = SIMTIME_MAX;
+
+    ThreadCalendarThreadData* tdata = g_hash_table_lookup(data->threadToThreadDataMap, GUINT_TO_POINTER(pthread_self()));
+    if(tdata) {
+        g_mutex_lock(&(tdata->lock));
+        SimulationTime eventTime = calendarqueue_peekTime(tdata->cq);
+        g_mutex_unlock(&(tdata->lock));
+        if(eventTime != SIMTIME_INVALID) {
+            nextTime = MIN(nextTime, eventTime);
+        }
+    }
+
+    return nextTime;
+}
+
+static void _schedulerpolicythreadcalendar_free(SchedulerPolicy* policy) {
+    MAGIC_ASSERT(policy);
+    ThreadCalendarPolicyData* data = policy->data;
+
+    g_hash_table_destroy(data->threadToThreadDataMap);
+    g_hash_table_destroy(data->hostToThreadMap);
+    g_free(data);
+
+    MAGIC_CLEAR(policy);
+    g_free(policy);
+}
+
+SchedulerPolicy* schedulerpolicythreadcalendar_new() {
+    ThreadCalendarPolicyData* data = g_new0(ThreadCalendarPolicyData, 1);
+    data->threadToThreadDataMap = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)_threadcalendarthreaddata_free);
+    data->hostToThreadMap = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    SchedulerPolicy* policy = g_new0(SchedulerPolicy, 1);
+    MAGIC_INIT(policy);
+    policy->addHost = _schedulerpolicythreadcalendar_addHost;
+    policy->getAssignedHosts = _schedulerpolicythreadcalendar_getHosts;
+    policy->push = _schedulerpolicythreadcalendar_push;
+    policy->pop = _schedulerpolicythreadcalendar_pop;
+    policy->getNextTime = _schedulerpolicythreadcalendar_getNextTime;
+    policy->free = _schedulerpolicythreadcalendar_free;
+
+    policy->type = SP_PARALLEL_THREAD_CALENDAR;
+    policy->data = data;
+    policy->referenceCount = 1;
+
+    return policy;
+}
+
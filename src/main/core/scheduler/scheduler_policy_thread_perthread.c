@@ -10,14 +10,14 @@
 #include "main/core/scheduler/scheduler_policy.h"
 #include "main/core/support/definitions.h"
 #include "main/core/work/event.h"
+#include "main/core/work/event_queue.h"
 #include "main/host/host.h"
-#include "main/utility/priority_queue.h"
 #include "main/utility/utility.h"
 #include "support/logger/logger.h"
 
 typedef struct _ThreadPerThreadQueueData ThreadPerThreadQueueData;
 struct _ThreadPerThreadQueueData {
-    PriorityQueue* pq;
+    EventQueue* pq;
     SimulationTime lastEventTime;
     gsize nPushed;
     gsize nPopped;
@@ -30,7 +30,7 @@ struct _ThreadPerThreadThreadData {
     /* the main event queue for this thread */
     ThreadPerThreadQueueData* qdata;
     /* this thread has gqueue that holds future events during each round, and is emptied into
-     * the priority queue in qdata after each round */
+     * the event queue in qdata after each round */
     GHashTable* threadToPQueueMap;
 };
 
@@ -44,7 +44,7 @@ struct _ThreadPerThreadPolicyData {
 static ThreadPerThreadQueueData* _threadperthreadqueuedata_new() {
     ThreadPerThreadQueueData* qdata = g_new0(ThreadPerThreadQueueData, 1);
 
-    qdata->pq = priorityqueue_new((GCompareDataFunc)event_compare, NULL, (GDestroyNotify)event_unref);
+    qdata->pq = eventqueue_new();
 
     return qdata;
 }
@@ -52,7 +52,7 @@ static ThreadPerThreadQueueData* _threadperthreadqueuedata_new() {
 static void _threadperthreadqueuedata_free(ThreadPerThreadQueueData* qdata) {
     if(qdata) {
         if(qdata->pq) {
-            priorityqueue_free(qdata->pq);
+            eventqueue_free(qdata->pq);
         }
         g_free(qdata);
     }
@@ -60,7 +60,7 @@ static void _threadperthreadqueuedata_free(ThreadPerThreadQueueData* qdata) {
 
 static ThreadPerThreadThreadData* _threadperthreadthreaddata_new() {
     ThreadPerThreadThreadData* tdata = g_new0(ThreadPerThreadThreadData, 1);
-    tdata->threadToPQueueMap = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)priorityqueue_free);
+    tdata->threadToPQueueMap = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)eventqueue_free);
     tdata->qdata = _threadperthreadqueuedata_new();
     tdata->assignedHosts = g_queue_new();
     g_mutex_init(&(tdata->lock));
@@ -130,7 +130,7 @@ static void _schedulerpolicythreadperthread_push(SchedulerPolicy* policy, Event*
 
     pthread_t self = pthread_self();
     if(pthread_equal(dstThread, self)) {
-        priorityqueue_push(tdata->qdata->pq, event);
+        eventqueue_push(tdata->qdata->pq, event);
         tdata->qdata->nPushed++;
     } else {
         /* we need to lock this if srcThread != pthread_self */
@@ -139,14 +139,14 @@ static void _schedulerpolicythreadperthread_push(SchedulerPolicy* policy, Event*
         }
 
         /* now make sure we have a mailbox for the source and create one if needed */
-        PriorityQueue* futureEvents = g_hash_table_lookup(tdata->threadToPQueueMap, GUINT_TO_POINTER(srcThread));
+        EventQueue* futureEvents = g_hash_table_lookup(tdata->threadToPQueueMap, GUINT_TO_POINTER(srcThread));
         if(!futureEvents) {
-            futureEvents = priorityqueue_new((GCompareDataFunc)event_compare, NULL, (GDestroyNotify)event_unref);
+            futureEvents = eventqueue_new();
             g_hash_table_replace(tdata->threadToPQueueMap, GUINT_TO_POINTER(srcThread), futureEvents);
         }
 
         /* 'deliver' the event there */
-        priorityqueue_push(futureEvents, event);
+        eventqueue_push(futureEvents, event);
 
         if(!pthread_equal(srcThread, self)) {
             g_mutex_unlock(&(tdata->lock));
@@ -166,13 +166,13 @@ static Event* _schedulerpolicythreadperthread_pop(SchedulerPolicy* policy, Simul
         return NULL;
     }
 
-    Event* nextEvent = priorityqueue_peek(tdata->qdata->pq);
+    Event* nextEvent = eventqueue_peek(tdata->qdata->pq);
     SimulationTime eventTime = (nextEvent != NULL) ? event_getTime(nextEvent) : SIMTIME_INVALID;
 
     if(nextEvent && eventTime < barrier) {
         utility_assert(eventTime >= tdata->qdata->lastEventTime);
         tdata->qdata->lastEventTime = eventTime;
-        nextEvent = priorityqueue_pop(tdata->qdata->pq);
+        nextEvent = eventqueue_pop(tdata->qdata->pq);
         tdata->qdata->nPopped++;
     } else {
         /* if we make it here, all hosts for this thread have no more events before barrier */
@@ -190,15 +190,15 @@ static SimulationTime _schedulerpolicythreadperthread_getNextTime(SchedulerPolic
 
     ThreadPerThreadThreadData* tdata = g_hash_table_lookup(data->threadToThreadDataMap, GUINT_TO_POINTER(pthread_self()));
     if(tdata) {
-        /* we are in between rounds. first we have to drain all future events into the priority queue */
+        /* we are in between rounds. first we have to drain all future events into the event queue */
         GList* values = g_hash_table_get_values(tdata->threadToPQueueMap);
         GList* item = values;
         while(item) {
-            PriorityQueue* futureEvents = item->data;
+            EventQueue* futureEvents = item->data;
 
-            while(!priorityqueue_isEmpty(futureEvents)) {
-                Event* event = priorityqueue_pop(futureEvents);
-                priorityqueue_push(tdata->qdata->pq, event);
+            while(!eventqueue_isEmpty(futureEvents)) {
+                Event* event = eventqueue_pop(futureEvents);
+                eventqueue_push(tdata->qdata->pq, event);
                 tdata->qdata->nPushed++;
             }
 
@@ -209,9 +209,9 @@ static SimulationTime _schedulerpolicythreadperthread_getNextTime(SchedulerPolic
         }
 
         /* now get the min time */
-        Event* nextEvent = priorityqueue_peek(tdata->qdata->pq);
-        if(nextEvent != NULL) {
-            nextTime = MIN(nextTime, event_getTime(nextEvent));
+        SimulationTime eventTime = eventqueue_peekTime(tdata->qdata->pq);
+        if(eventTime != SIMTIME_INVALID) {
+            nextTime = MIN(nextTime, eventTime);
         }
     }
 
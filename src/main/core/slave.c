@@ -5,6 +5,7 @@
 
 #include <errno.h>
 #include <glib.h>
+#include <math.h>
 #include <netinet/in.h>
 #include <pthread.h>
 #include <stddef.h>
@@ -113,12 +114,26 @@ static SchedulerPolicyType _slave_getEventSchedulerPolicy(Slave* slave) {
         return SP_PARALLEL_THREAD_PERTHREAD;
     } else if (g_ascii_strcasecmp(policyStr, "threadXhost") == 0) {
         return SP_PARALLEL_THREAD_PERHOST;
+    } else if (g_ascii_strcasecmp(policyStr, "calendar") == 0) {
+        return SP_PARALLEL_THREAD_CALENDAR;
     } else {
-        error("unknown event scheduler policy '%s'; valid values are 'thread', 'host', 'threadXthread', or 'threadXhost'", policyStr);
+        error("unknown event scheduler policy '%s'; valid values are 'thread', 'host', 'threadXthread', 'threadXhost', or 'calendar'", policyStr);
         return SP_SERIAL_GLOBAL;
     }
 }
 
+static SchedulerBarrierType _slave_getSchedulerBarrierType(Slave* slave) {
+    const gchar* barrierStr = options_getSchedulerBarrier(slave->options);
+    if (g_ascii_strcasecmp(barrierStr, "latch") == 0) {
+        return SB_LATCH;
+    } else if (g_ascii_strcasecmp(barrierStr, "spin") == 0) {
+        return SB_SPIN;
+    } else {
+        error("unknown scheduler barrier '%s'; valid values are 'latch' or 'spin'", barrierStr);
+        return SB_LATCH;
+    }
+}
+
 _ProgramMeta* _program_meta_new(const gchar* name, const gchar* path, const gchar* startSymbol) {
     if((name == NULL) || (path == NULL)) {
         error("attempting to register a program with a null name and/or path");
@@ -195,8 +210,9 @@ Slave* slave_new(Master* master, Options* options, SimulationTime endTime, Simul
 
     guint nWorkers = options_getNWorkerThreads(options);
     SchedulerPolicyType policy = _slave_getEventSchedulerPolicy(slave);
+    SchedulerBarrierType barrier = _slave_getSchedulerBarrierType(slave);
     guint schedulerSeed = _slave_nextRandomUInt(slave);
-    slave->scheduler = scheduler_new(policy, nWorkers, slave, schedulerSeed, endTime);
+    slave->scheduler = scheduler_new(policy, barrier, nWorkers, slave, schedulerSeed, endTime);
 
     slave->cwdPath = g_get_current_dir();
     slave->dataPath = g_build_filename(slave->cwdPath, options_getDataOutputPath(options), NULL);
@@ -237,6 +253,7 @@ gint slave_free(Slave* slave) {
     if(slave->objectCounts != NULL) {
         message("%s", objectcounter_valuesToString(slave->objectCounts));
         message("%s", objectcounter_diffsToString(slave->objectCounts));
+        message("%s", objectcounter_poolsToString(slave->objectCounts));
         objectcounter_free(slave->objectCounts);
     }
 
@@ -410,8 +427,60 @@ static void _slave_heartbeat(Slave* slave, SimulationTime simClockNow) {
     }
 }
 
+static void _slave_setHostLookaheads(Slave* slave) {
+    MAGIC_ASSERT(slave);
+
+    Topology* topology = slave_getTopology(slave);
+    GQueue* hosts = scheduler_getAllHosts(slave->scheduler);
+    guint numHosts = g_queue_get_length(hosts);
+
+    SimulationTime minLookahead = SIMTIME_MAX, maxLookahead = 0;
+    guint numUnknown = 0;
+
+    while(!g_queue_is_empty(hosts)) {
+        Host* host = g_queue_pop_head(hosts);
+        gdouble minLatency = topology_getMinimumOutgoingLatency(topology, host_getDefaultAddress(host));
+
+        /* packet delays are rounded up from the path latency in worker_sendPacket,
+         * so rounding down here keeps the lookahead conservative */
+        SimulationTime lookahead = 0;
+        if(minLatency > 0) {
+            lookahead = (SimulationTime) floor(minLatency * SIMTIME_ONE_MILLISECOND);
+            minLookahead = MIN(minLookahead, lookahead);
+            maxLookahead = MAX(maxLookahead, lookahead);
+        } else {
+            numUnknown++;
+        }
+
+        host_setLookahead(host, lookahead);
+    }
+
+    g_queue_free(hosts);
+
+    if(numUnknown == numHosts) {
+        warning("unable to compute the lookahead of any host, using the global minimum time jump instead");
+        return;
+    }
+
+    if(scheduler_enableHostLookahead(slave->scheduler)) {
+        message("using host lookahead to extend execution windows; lookahead of %u hosts is between "
+                "%"G_GUINT64_FORMAT" and %"G_GUINT64_FORMAT" nanoseconds, %u hosts have no lookahead",
+                numHosts - numUnknown, minLookahead, maxLookahead, numUnknown);
+    }
+}
+
 void slave_run(Slave* slave) {
     MAGIC_ASSERT(slave);
+    if(options_doUseHostLookahead(slave->options)) {
+        _slave_setHostLookaheads(slave);
+    }
+
+    guint rebalanceInterval = options_getSchedulerRebalanceInterval(slave->options);
+    if(rebalanceInterval > 0 &&
+            scheduler_enableRebalancing(slave->scheduler, (gdouble)rebalanceInterval / 1000.0)) {
+        message("moving hosts away from the busiest worker threads every %u milliseconds", rebalanceInterval);
+    }
+
     if(scheduler_getPolicy(slave->scheduler) == SP_SERIAL_GLOBAL) {
         scheduler_start(slave->scheduler);
 
@@ -430,6 +499,7 @@ void slave_run(Slave* slave) {
         /* we are the main thread, we manage the execution window updates while the workers run events */
         SimulationTime windowStart = 0, windowEnd = 1;
         SimulationTime minNextEventTime = SIMTIME_INVALID;
+        SimulationTime minNextSafeTime = SIMTIME_INVALID;
         gboolean keepRunning = TRUE;
 
         scheduler_start(slave->scheduler);
@@ -451,6 +521,7 @@ void slave_run(Slave* slave) {
 
             /* wait for the workers to finish processing nodes before we update the execution window */
             minNextEventTime = scheduler_awaitNextRound(slave->scheduler);
+            minNextSafeTime = scheduler_getNextSafeTime(slave->scheduler);
 
             /* we are in control now, the workers are waiting for the next round */
             info("finished execution window [%"G_GUINT64_FORMAT"--%"G_GUINT64_FORMAT"] next event at %"G_GUINT64_FORMAT,
@@ -458,7 +529,8 @@ void slave_run(Slave* slave) {
 
             /* notify master that we finished this round, and the time of our next event
              * in order to fast-forward our execute window if possible */
-            keepRunning = master_slaveFinishedCurrentRound(slave->master, minNextEventTime, &windowStart, &windowEnd);
+            keepRunning = master_slaveFinishedCurrentRound(slave->master, minNextEventTime, minNextSafeTime,
+                    &windowStart, &windowEnd);
         }
 
         scheduler_finish(slave->scheduler);
@@ -477,6 +549,11 @@ const gchar* slave_getHostsRootPath(Slave* slave) {
     return slave->hostsPath;
 }
 
+const gchar* slave_getDataPath(Slave* slave) {
+    MAGIC_ASSERT(slave);
+    return slave->dataPath;
+}
+
 void slave_storeCounts(Slave* slave, ObjectCounter* objectCounter) {
     MAGIC_ASSERT(slave);
     _slave_lock(slave);
@@ -51,6 +51,7 @@ SimulationTime slave_getBootstrapEndTime(Slave* slave);
 
 void slave_incrementPluginError(Slave* slave);
 const gchar* slave_getHostsRootPath(Slave* slave);
+const gchar* slave_getDataPath(Slave* slave);
 
 void slave_updateMinTimeJump(Slave* slave, gdouble minPathLatency);
 
@@ -8,6 +8,7 @@
 #include <stddef.h>
 
 #include "main/core/support/definitions.h"
+#include "main/utility/object_pool.h"
 #include "main/utility/utility.h"
 
 typedef struct _ObjectCounts ObjectCounts;
@@ -16,6 +17,15 @@ struct _ObjectCounts {
     guint64 free;
 };
 
+typedef struct _ObjectPoolCounts ObjectPoolCounts;
+struct _ObjectPoolCounts {
+    guint64 hits;
+    guint64 misses;
+    guint64 remoteReturns;
+    /* the sum of the high-water marks of all pools */
+    guint64 maxInUse;
+};
+
 struct _ObjectCounter {
     /* counting objects for debugging memory leaks */
     struct {
@@ -35,6 +45,13 @@ struct _ObjectCounter {
         ObjectCounts timer;
     } counters;
 
+    /* the objects that are allocated from per-worker pools */
+    struct {
+        ObjectPoolCounts task;
+        ObjectPoolCounts event;
+        ObjectPoolCounts packet;
+    } pools;
+
     GString* stringBuffer;
 
     MAGIC_DECLARE;
@@ -87,6 +104,31 @@ static void _objectcount_incrementAll(ObjectCounts* counts, ObjectCounts* increm
     counts->free += increments->free;
 }
 
+static void _objectpoolcount_increment(ObjectPoolCounts* counts, const ObjectPoolStats* stats) {
+    utility_assert(counts != NULL);
+    utility_assert(stats != NULL);
+
+    counts->hits += stats->numHits;
+    counts->misses += stats->numMisses;
+    counts->remoteReturns += stats->numRemoteReturns;
+    counts->maxInUse += stats->maxInUse;
+}
+
+static void _objectpoolcount_incrementAll(ObjectPoolCounts* counts, ObjectPoolCounts* increments) {
+    utility_assert(counts != NULL);
+    utility_assert(increments != NULL);
+
+    counts->hits += increments->hits;
+    counts->misses += increments->misses;
+    counts->remoteReturns += increments->remoteReturns;
+    counts->maxInUse += increments->maxInUse;
+}
+
+static gdouble _objectpoolcount_getHitPercent(ObjectPoolCounts* counts) {
+    guint64 total = counts->hits + counts->misses;
+    return (total > 0) ? (100.0f * (gdouble)counts->hits / (gdouble)total) : 0.0f;
+}
+
 void objectcounter_incrementOne(ObjectCounter* counter, ObjectType otype, CounterType ctype) {
     MAGIC_ASSERT(counter);
 
@@ -185,6 +227,35 @@ void objectcounter_incrementAll(ObjectCounter* counter, ObjectCounter* increment
     _objectcount_incrementAll(&(counter->counters.udp), &(increment->counters.udp));
     _objectcount_incrementAll(&(counter->counters.epoll), &(increment->counters.epoll));
     _objectcount_incrementAll(&(counter->counters.timer), &(increment->counters.timer));
+    _objectpoolcount_incrementAll(&(counter->pools.task), &(increment->pools.task));
+    _objectpoolcount_incrementAll(&(counter->pools.event), &(increment->pools.event));
+    _objectpoolcount_incrementAll(&(counter->pools.packet), &(increment->pools.packet));
+}
+
+void objectcounter_incrementPool(ObjectCounter* counter, ObjectType otype, const ObjectPoolStats* stats) {
+    MAGIC_ASSERT(counter);
+
+    switch(otype) {
+        case OBJECT_TYPE_TASK: {
+            _objectpoolcount_increment(&(counter->pools.task), stats);
+            break;
+        }
+
+        case OBJECT_TYPE_EVENT: {
+            _objectpoolcount_increment(&(counter->pools.event), stats);
+            break;
+        }
+
+        case OBJECT_TYPE_PACKET: {
+            _objectpoolcount_increment(&(counter->pools.packet), stats);
+            break;
+        }
+
+        default: {
+            /* we don't pool any other objects */
+            break;
+        }
+    }
 }
 
 const gchar* objectcounter_valuesToString(ObjectCounter* counter) {
@@ -266,3 +337,33 @@ const gchar* objectcounter_diffsToString(ObjectCounter* counter) {
 
     return (const gchar*) counter->stringBuffer->str;
 }
+
+const gchar* objectcounter_poolsToString(ObjectCounter* counter) {
+    MAGIC_ASSERT(counter);
+
+    if(!counter->stringBuffer) {
+        counter->stringBuffer = g_string_new(NULL);
+    }
+
+    g_string_printf(counter->stringBuffer, "ObjectCounter: pool values: "
+            "task_hits=%"G_GUINT64_FORMAT" task_misses=%"G_GUINT64_FORMAT" "
+            "task_hit_percent=%.2f task_remote_returns=%"G_GUINT64_FORMAT" "
+            "task_max_in_use=%"G_GUINT64_FORMAT" "
+            "event_hits=%"G_GUINT64_FORMAT" event_misses=%"G_GUINT64_FORMAT" "
+            "event_hit_percent=%.2f event_remote_returns=%"G_GUINT64_FORMAT" "
+            "event_max_in_use=%"G_GUINT64_FORMAT" "
+            "packet_hits=%"G_GUINT64_FORMAT" packet_misses=%"G_GUINT64_FORMAT" "
+            "packet_hit_percent=%.2f packet_remote_returns=%"G_GUINT64_FORMAT" "
+            "packet_max_in_use=%"G_GUINT64_FORMAT" ",
+            counter->pools.task.hits, counter->pools.task.misses,
+            _objectpoolcount_getHitPercent(&(counter->pools.task)),
+            counter->pools.task.remoteReturns, counter->pools.task.maxInUse,
+            counter->pools.event.hits, counter->pools.event.misses,
+            _objectpoolcount_getHitPercent(&(counter->pools.event)),
+            counter->pools.event.remoteReturns, counter->pools.event.maxInUse,
+            counter->pools.packet.hits, counter->pools.packet.misses,
+            _objectpoolcount_getHitPercent(&(counter->pools.packet)),
+            counter->pools.packet.remoteReturns, counter->pools.packet.maxInUse);
+
+    return (const gchar*) counter->stringBuffer->str;
+}
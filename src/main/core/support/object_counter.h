@@ -8,6 +8,8 @@
 
 #include <glib.h>
 
+#include "main/utility/object_pool.h"
+
 typedef enum _ObjectType ObjectType;
 enum _ObjectType {
     OBJECT_TYPE_NONE,
@@ -45,6 +47,9 @@ void objectcounter_incrementOne(ObjectCounter* counter, ObjectType otype, Counte
 /* add all counter values from 'increment' into the values of 'counter' */
 void objectcounter_incrementAll(ObjectCounter* counter, ObjectCounter* increment);
 
+/* add the allocation statistics of a pool of objects of type otype */
+void objectcounter_incrementPool(ObjectCounter* counter, ObjectType otype, const ObjectPoolStats* stats);
+
 /* prints the current values of the counters as a string that can be logged.
  * the string is owned by the object counter, and should not be freed by the caller. */
 const gchar* objectcounter_valuesToString(ObjectCounter* counter);
@@ -53,4 +58,8 @@ const gchar* objectcounter_valuesToString(ObjectCounter* counter);
  * the string is owned by the object counter, and should not be freed by the caller. */
 const gchar* objectcounter_diffsToString(ObjectCounter* counter);
 
+/* prints the pool hits, misses, hit rates, and high-water marks as a string that can be logged.
+ * the string is owned by the object counter, and should not be freed by the caller. */
+const gchar* objectcounter_poolsToString(ObjectCounter* counter);
+
 #endif /* SRC_MAIN_CORE_SUPPORT_SHD_OBJECT_COUNTER_H_ */
@@ -29,6 +29,8 @@ struct _Options {
     gboolean debug;
     gchar* dataDirPath;
     gchar* dataTemplatePath;
+    gboolean useHostLookahead;
+    gboolean tracePackets;
 
     GOptionGroup* networkOptionGroup;
     gint cpuThreshold;
@@ -41,10 +43,14 @@ struct _Options {
     gboolean autotuneSocketReceiveBuffer;
     gboolean autotuneSocketSendBuffer;
     gchar* interfaceQueuingDiscipline;
+    gchar* interfaceRefillMode;
     gchar* eventSchedulingPolicy;
+    gchar* schedulerBarrier;
+    gint schedulerRebalanceInterval;
     SimulationTime interfaceBatchTime;
     gchar* tcpCongestionControl;
     gint tcpSlowStartThreshold;
+    gboolean precomputeTopologyPaths;
 
     GOptionGroup* pluginsOptionGroup;
     gboolean runTGenExample;
@@ -89,13 +95,17 @@ Options* options_new(gint argc, gchar* argv[]) {
       { "data-template", 'e', 0, G_OPTION_ARG_STRING, &(options->dataTemplatePath), "PATH to recursively copy during startup and use as the data-directory ['shadow.data.template']", "PATH" },
       { "gdb", 'g', 0, G_OPTION_ARG_NONE, &(options->debug), "Pause at startup for debugger attachment", NULL },
       { "heartbeat-frequency", 'h', 0, G_OPTION_ARG_INT, &(options->heartbeatInterval), "Log node statistics every N seconds [1]", "N" },
-      { "heartbeat-log-info", 'i', 0, G_OPTION_ARG_STRING, &(options->heartbeatLogInfo), "Comma separated list of information contained in heartbeat ('node','socket','ram') ['node']", "LIST"},
+      { "heartbeat-log-info", 'i', 0, G_OPTION_ARG_STRING, &(options->heartbeatLogInfo), "Comma separated list of information contained in heartbeat ('node','socket','ram','ram-sampled') ['node']", "LIST"},
       { "heartbeat-log-level", 'j', 0, G_OPTION_ARG_STRING, &(options->heartbeatLogLevelInput), "Log LEVEL at which to print node statistics ['message']", "LEVEL" },
       { "log-level", 'l', 0, G_OPTION_ARG_STRING, &(options->logLevelInput), "Log LEVEL above which to filter messages ('error' < 'critical' < 'warning' < 'message' < 'info' < 'debug') ['message']", "LEVEL" },
+      { "lookahead", 0, 0, G_OPTION_ARG_NONE, &(options->useHostLookahead), "Extend execution windows using the minimum path latency out of each host instead of the global minimum path latency, implies --topology-precompute (only for 'host' and 'steal' scheduler policies)", NULL },
+      { "packet-trace", 0, 0, G_OPTION_ARG_NONE, &(options->tracePackets), "Record the delivery status history of every packet and write it to binary packet trace files in the data directory, one per worker thread", NULL },
       { "preload", 'p', 0, G_OPTION_ARG_STRING, &(options->preloads), "LD_PRELOAD environment VALUE to use for function interposition (/path/to/lib:...) [None]", "VALUE" },
       { "runahead", 'r', 0, G_OPTION_ARG_INT, &(options->minRunAhead), "If set, overrides the automatically calculated minimum TIME workers may run ahead when sending events between nodes, in milliseconds [0]", "TIME" },
       { "seed", 's', 0, G_OPTION_ARG_INT, &(options->randomSeed), "Initialize randomness for each thread using seed N [1]", "N" },
-      { "scheduler-policy", 't', 0, G_OPTION_ARG_STRING, &(options->eventSchedulingPolicy), "The event scheduler's policy for thread synchronization ('thread', 'host', 'steal', 'threadXthread', 'threadXhost') ['steal']", "SPOL" },
+      { "scheduler-policy", 't', 0, G_OPTION_ARG_STRING, &(options->eventSchedulingPolicy), "The event scheduler's policy for thread synchronization ('thread', 'host', 'steal', 'threadXthread', 'threadXhost', 'calendar') ['steal']", "SPOL" },
+      { "scheduler-barrier", 0, 0, G_OPTION_ARG_STRING, &(options->schedulerBarrier), "The primitive worker threads use to synchronize between rounds ('latch', 'spin') ['latch']", "SBAR" },
+      { "scheduler-rebalance", 0, 0, G_OPTION_ARG_INT, &(options->schedulerRebalanceInterval), "Every N milliseconds of real time, move hosts from the busiest worker threads to the least busy ones, or 0 to keep the initial assignment (only for the 'host' scheduler policy) [0]", "N" },
       { "workers", 'w', 0, G_OPTION_ARG_INT, &(options->nWorkerThreads), "Run concurrently with N worker threads [0]", "N" },
       { "valgrind", 'x', 0, G_OPTION_ARG_NONE, &(options->runValgrind), "Run through valgrind for debugging", NULL },
       { "version", 'v', 0, G_OPTION_ARG_NONE, &(options->printSoftwareVersion), "Print software version and exit", NULL },
@@ -131,11 +141,13 @@ Options* options_new(gint argc, gchar* argv[]) {
       { "interface-batch", 0, 0, G_OPTION_ARG_INT, &(options->interfaceBatchTime), "Batch TIME for network interface sends and receives, in microseconds [5000]", "TIME" },
       { "interface-buffer", 0, 0, G_OPTION_ARG_INT, &(options->interfaceBufferSize), "Size of the network interface receive buffer, in bytes [1024000]", "N" },
       { "interface-qdisc", 0, 0, G_OPTION_ARG_STRING, &(options->interfaceQueuingDiscipline), "The interface queuing discipline QDISC used to select the next sendable socket ('fifo' or 'rr') ['fifo']", "QDISC" },
+      { "interface-refill", 0, 0, G_OPTION_ARG_STRING, &(options->interfaceRefillMode), "The MODE used to refill the interface token buckets ('interval' adds tokens every millisecond, 'lazy' adds tokens from the elapsed time whenever they are used) ['interval']", "MODE" },
       { "socket-recv-buffer", 0, 0, G_OPTION_ARG_INT, &(options->initialSocketReceiveBufferSize), sockrecv->str, "N" },
       { "socket-send-buffer", 0, 0, G_OPTION_ARG_INT, &(options->initialSocketSendBufferSize), socksend->str, "N" },
       { "tcp-congestion-control", 0, 0, G_OPTION_ARG_STRING, &(options->tcpCongestionControl), "Congestion control algorithm to use for TCP ('aimd', 'reno', 'cubic') ['reno']", "TCPCC" },
       { "tcp-ssthresh", 0, 0, G_OPTION_ARG_INT, &(options->tcpSlowStartThreshold), "Set TCP ssthresh value instead of discovering it via packet loss or hystart [0]", "N" },
       { "tcp-windows", 0, 0, G_OPTION_ARG_INT, &(options->initialTCPWindow), "Initialize the TCP send, receive, and congestion windows to N packets [10]", "N" },
+      { "topology-precompute", 0, 0, G_OPTION_ARG_NONE, &(options->precomputeTopologyPaths), "Compute all shortest paths between vertices with attached hosts during startup and store them in a dense latency matrix, trading memory for lock-free path lookups", NULL },
       { NULL },
     };
 
@@ -195,9 +207,15 @@ Options* options_new(gint argc, gchar* argv[]) {
     if(options->interfaceQueuingDiscipline == NULL) {
         options->interfaceQueuingDiscipline = g_strdup("fifo");
     }
+    if(options->interfaceRefillMode == NULL) {
+        options->interfaceRefillMode = g_strdup("interval");
+    }
     if(options->eventSchedulingPolicy == NULL) {
         options->eventSchedulingPolicy = g_strdup("steal");
     }
+    if(options->schedulerBarrier == NULL) {
+        options->schedulerBarrier = g_strdup("latch");
+    }
     if(!options->initialSocketReceiveBufferSize) {
         options->initialSocketReceiveBufferSize = CONFIG_RECV_BUFFER_SIZE;
         options->autotuneSocketReceiveBuffer = TRUE;
@@ -225,6 +243,15 @@ Options* options_new(gint argc, gchar* argv[]) {
         g_string_free(sockrecv, TRUE);
     }
 
+    /* the other policies only delay the events between hosts on different threads
+     * until the next round, so moving a host would change when its events run */
+    if(options->schedulerRebalanceInterval > 0 &&
+            g_ascii_strcasecmp(options->eventSchedulingPolicy, "host") != 0) {
+        g_printerr("** --scheduler-rebalance is only supported by the 'host' scheduler policy **\n");
+        options_free(options);
+        return NULL;
+    }
+
     return options;
 }
 
@@ -238,7 +265,9 @@ void options_free(Options* options) {
     g_free(options->heartbeatLogLevelInput);
     g_free(options->heartbeatLogInfo);
     g_free(options->interfaceQueuingDiscipline);
+    g_free(options->interfaceRefillMode);
     g_free(options->eventSchedulingPolicy);
+    g_free(options->schedulerBarrier);
     g_free(options->tcpCongestionControl);
     if(options->argstr) {
         g_free(options->argstr);
@@ -288,8 +317,10 @@ LogInfoFlags options_toHeartbeatLogInfo(Options* options, const gchar* input) {
                 flags |= LOG_INFO_FLAGS_SOCKET;
             } else if(!g_ascii_strcasecmp(parts[i], "ram")) {
                 flags |= LOG_INFO_FLAGS_RAM;
+            } else if(!g_ascii_strcasecmp(parts[i], "ram-sampled")) {
+                flags |= LOG_INFO_FLAGS_RAM_SAMPLED;
             } else {
-                warning("Did not recognize log info '%s', possible choices are 'node','socket','ram'.", parts[i]);
+                warning("Did not recognize log info '%s', possible choices are 'node','socket','ram','ram-sampled'.", parts[i]);
             }
         }
         g_strfreev(parts);
@@ -316,11 +347,35 @@ QDiscMode options_getQueuingDiscipline(Options* options) {
     return QDISC_MODE_NONE;
 }
 
+RefillMode options_getInterfaceRefillMode(Options* options) {
+    MAGIC_ASSERT(options);
+
+    if(options->interfaceRefillMode) {
+        if(!g_ascii_strcasecmp(options->interfaceRefillMode, "interval")) {
+            return REFILL_MODE_INTERVAL;
+        } else if(!g_ascii_strcasecmp(options->interfaceRefillMode, "lazy")) {
+            return REFILL_MODE_LAZY;
+        }
+    }
+
+    return REFILL_MODE_NONE;
+}
+
 gchar* options_getEventSchedulerPolicy(Options* options) {
     MAGIC_ASSERT(options);
     return options->eventSchedulingPolicy;
 }
 
+gchar* options_getSchedulerBarrier(Options* options) {
+    MAGIC_ASSERT(options);
+    return options->schedulerBarrier;
+}
+
+guint options_getSchedulerRebalanceInterval(Options* options) {
+    MAGIC_ASSERT(options);
+    return options->schedulerRebalanceInterval > 0 ? (guint)options->schedulerRebalanceInterval : 0;
+}
+
 guint options_getNWorkerThreads(Options* options) {
     MAGIC_ASSERT(options);
     return options->nWorkerThreads > 0 ? (guint)options->nWorkerThreads : 0;
@@ -426,6 +481,21 @@ gboolean options_doAutotuneSendBuffer(Options* options) {
     return options->autotuneSocketSendBuffer;
 }
 
+gboolean options_doPrecomputeTopologyPaths(Options* options) {
+    MAGIC_ASSERT(options);
+    return options->precomputeTopologyPaths;
+}
+
+gboolean options_doUseHostLookahead(Options* options) {
+    MAGIC_ASSERT(options);
+    return options->useHostLookahead;
+}
+
+gboolean options_doTracePackets(Options* options) {
+    MAGIC_ASSERT(options);
+    return options->tracePackets;
+}
+
 const GString* options_getInputXMLFilename(Options* options) {
     MAGIC_ASSERT(options);
     return options->inputXMLFilename;
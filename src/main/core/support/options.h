@@ -26,6 +26,8 @@ enum _LogInfoFlags {
     LOG_INFO_FLAGS_NODE = 1<<0,
     LOG_INFO_FLAGS_SOCKET = 1<<1,
     LOG_INFO_FLAGS_RAM = 1<<2,
+    /* estimate the ram info from a sample of the allocations */
+    LOG_INFO_FLAGS_RAM_SAMPLED = 1<<3,
 };
 
 typedef enum _QDiscMode QDiscMode;
@@ -33,6 +35,11 @@ enum _QDiscMode {
     QDISC_MODE_NONE=0, QDISC_MODE_FIFO=1, QDISC_MODE_RR=2,
 };
 
+typedef enum _RefillMode RefillMode;
+enum _RefillMode {
+    REFILL_MODE_NONE=0, REFILL_MODE_INTERVAL=1, REFILL_MODE_LAZY=2,
+};
+
 /**
  * Create a new #Configuration and parse the command line arguments given in
  * argv. Errors encountered during parsing are printed to stderr.
@@ -89,7 +96,16 @@ SimulationTime options_getHeartbeatInterval(Options* options);
  */
 QDiscMode options_getQueuingDiscipline(Options* options);
 
+/**
+ * Get the mode the network interfaces use to refill their token buckets.
+ * @param config a #Configuration object created with configuration_new()
+ * @return the refill mode, or REFILL_MODE_NONE if the mode string is invalid
+ */
+RefillMode options_getInterfaceRefillMode(Options* options);
+
 gchar* options_getEventSchedulerPolicy(Options* options);
+gchar* options_getSchedulerBarrier(Options* options);
+guint options_getSchedulerRebalanceInterval(Options* options);
 
 guint options_getNWorkerThreads(Options* options);
 
@@ -117,6 +133,9 @@ gint options_getSocketReceiveBufferSize(Options* options);
 gint options_getSocketSendBufferSize(Options* options);
 gboolean options_doAutotuneReceiveBuffer(Options* options);
 gboolean options_doAutotuneSendBuffer(Options* options);
+gboolean options_doPrecomputeTopologyPaths(Options* options);
+gboolean options_doUseHostLookahead(Options* options);
+gboolean options_doTracePackets(Options* options);
 
 const GString* options_getInputXMLFilename(Options* options);
 
@@ -0,0 +1,327 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/core/work/calendar_queue.h"
+
+#include <glib.h>
+
+#include "main/utility/utility.h"
+
+/* must be a power of 2 so we can mask instead of mod */
+#define CALENDARQUEUE_MIN_BUCKETS 16
+/* the number of earliest events whose spacing is used to pick the bucket width */
+#define CALENDARQUEUE_NUM_WIDTH_SAMPLES 25
+
+static const SimulationTime INITIAL_BUCKET_WIDTH = SIMTIME_ONE_MILLISECOND;
+/* empty buckets larger than this return their memory */
+static const guint MAX_IDLE_BUCKET_CAPACITY = 64;
+
+typedef struct _CalendarEntry CalendarEntry;
+struct _CalendarEntry {
+    EventKey key;
+    Event* event;
+};
+
+/* a binary min-heap of the events hashed to a bucket. buckets usually hold
+ * one or two events, but a heap keeps bursts of events at the same time
+ * (which no bucket width can separate) logarithmic instead of linear. */
+typedef struct _CalendarBucket CalendarBucket;
+struct _CalendarBucket {
+    CalendarEntry* entries;
+    guint size;
+    guint capacity;
+};
+
+struct _CalendarQueue {
+    CalendarBucket* buckets;
+    /* always a power of 2 */
+    guint numBuckets;
+    SimulationTime bucketWidth;
+    gsize size;
+
+    /* the bucket to dequeue from next, and the exclusive end of the time slot
+     * it covers in the current year. no event in the queue is earlier than
+     * the start of that slot. */
+    guint currentBucket;
+    SimulationTime currentBucketEnd;
+
+    CalendarQueueStats stats;
+    MAGIC_DECLARE;
+};
+
+static inline SimulationTime _calendarqueue_addTime(SimulationTime a, SimulationTime b) {
+    /* saturate so that slots near the end of time don't wrap around */
+    return (a > SIMTIME_INVALID - b) ? SIMTIME_INVALID : a + b;
+}
+
+static inline guint _calendarqueue_getBucketIndex(CalendarQueue* queue, SimulationTime time) {
+    return (guint)((time / queue->bucketWidth) & (queue->numBuckets - 1));
+}
+
+static void _calendarqueue_setPosition(CalendarQueue* queue, SimulationTime time) {
+    SimulationTime slotStart = (time / queue->bucketWidth) * queue->bucketWidth;
+    queue->currentBucket = _calendarqueue_getBucketIndex(queue, time);
+    queue->currentBucketEnd = _calendarqueue_addTime(slotStart, queue->bucketWidth);
+}
+
+static void _calendarbucket_push(CalendarBucket* bucket, const CalendarEntry* entry) {
+    if(bucket->size >= bucket->capacity) {
+        bucket->capacity = MAX(bucket->capacity * 2, 2);
+        bucket->entries = g_renew(CalendarEntry, bucket->entries, bucket->capacity);
+    }
+
+    guint index = bucket->size++;
+    while(index > 0) {
+        guint parent = (index - 1) / 2;
+        if(!event_isKeyBefore(&entry->key, &bucket->entries[parent].key)) {
+            break;
+        }
+        bucket->entries[index] = bucket->entries[parent];
+        index = parent;
+    }
+    bucket->entries[index] = *entry;
+}
+
+static void _calendarbucket_pop(CalendarBucket* bucket, CalendarEntry* entryOut) {
+    utility_assert(bucket->size > 0);
+    *entryOut = bucket->entries[0];
+
+    bucket->size--;
+    if(bucket->size > 0) {
+        CalendarEntry last = bucket->entries[bucket->size];
+        guint index = 0;
+        while(TRUE) {
+            guint child = 2 * index + 1;
+            if(child >= bucket->size) {
+                break;
+            }
+            if(child + 1 < bucket->size &&
+                    event_isKeyBefore(&bucket->entries[child + 1].key, &bucket->entries[child].key)) {
+                child++;
+            }
+            if(!event_isKeyBefore(&bucket->entries[child].key, &last.key)) {
+                break;
+            }
+            bucket->entries[index] = bucket->entries[child];
+            index = child;
+        }
+        bucket->entries[index] = last;
+    } else if(bucket->capacity > MAX_IDLE_BUCKET_CAPACITY) {
+        /* a burst of events went through this bucket */
+        g_free(bucket->entries);
+        bucket->entries = NULL;
+        bucket->capacity = 0;
+    }
+}
+
+static void _calendarqueue_insert(CalendarQueue* queue, const CalendarEntry* entry) {
+    /* keep the invariant that nothing is earlier than the current slot */
+    SimulationTime currentBucketStart = queue->currentBucketEnd - queue->bucketWidth;
+    if(queue->size == 0 || entry->key.time < currentBucketStart) {
+        _calendarqueue_setPosition(queue, entry->key.time);
+    }
+
+    guint index = _calendarqueue_getBucketIndex(queue, entry->key.time);
+    _calendarbucket_push(&queue->buckets[index], entry);
+    queue->size++;
+}
+
+/* returns the bucket holding the next event, advancing the current position to it */
+static CalendarBucket* _calendarqueue_findNext(CalendarQueue* queue) {
+    if(queue->size == 0) {
+        return NULL;
+    }
+
+    /* the next event is the first one we find in the slot of the current year */
+    for(guint i = 0; i < queue->numBuckets; i++) {
+        CalendarBucket* bucket = &queue->buckets[queue->currentBucket];
+        if(bucket->size > 0 && bucket->entries[0].key.time < queue->currentBucketEnd) {
+            return bucket;
+        }
+        queue->currentBucket = (queue->currentBucket + 1) & (queue->numBuckets - 1);
+        queue->currentBucketEnd = _calendarqueue_addTime(queue->currentBucketEnd, queue->bucketWidth);
+    }
+
+    /* the events are sparse compared to the year length, so jump directly
+     * to the earliest event instead of scanning year by year */
+    queue->stats.numDirectSearches++;
+    CalendarBucket* next = NULL;
+    for(guint i = 0; i < queue->numBuckets; i++) {
+        CalendarBucket* bucket = &queue->buckets[i];
+        if(bucket->size > 0 &&
+                (next == NULL || event_isKeyBefore(&bucket->entries[0].key, &next->entries[0].key))) {
+            next = bucket;
+        }
+    }
+
+    utility_assert(next);
+    _calendarqueue_setPosition(queue, next->entries[0].key.time);
+    return next;
+}
+
+static void _calendarqueue_remove(CalendarQueue* queue, CalendarEntry* entryOut) {
+    CalendarBucket* bucket = _calendarqueue_findNext(queue);
+    utility_assert(bucket);
+    _calendarbucket_pop(bucket, entryOut);
+    queue->size--;
+}
+
+/* estimate a bucket width such that a few events fall into each slot near the
+ * front of the queue, following Brown's sampling method */
+static SimulationTime _calendarqueue_computeBucketWidth(CalendarQueue* queue) {
+    guint numSamples = (guint)MIN(queue->size, CALENDARQUEUE_NUM_WIDTH_SAMPLES);
+    if(numSamples < 2) {
+        return queue->bucketWidth;
+    }
+
+    CalendarEntry samples[CALENDARQUEUE_NUM_WIDTH_SAMPLES];
+    for(guint i = 0; i < numSamples; i++) {
+        _calendarqueue_remove(queue, &samples[i]);
+    }
+    for(guint i = 0; i < numSamples; i++) {
+        _calendarqueue_insert(queue, &samples[i]);
+    }
+
+    SimulationTime totalSeparation = samples[numSamples - 1].key.time - samples[0].key.time;
+    SimulationTime averageSeparation = totalSeparation / (numSamples - 1);
+
+    /* ignore the outliers that are much further apart than the average */
+    SimulationTime trimmedSeparation = 0;
+    guint numTrimmed = 0;
+    for(guint i = 1; i < numSamples; i++) {
+        SimulationTime separation = samples[i].key.time - samples[i - 1].key.time;
+        if(separation <= 2 * averageSeparation) {
+            trimmedSeparation += separation;
+            numTrimmed++;
+        }
+    }
+
+    if(numTrimmed == 0 || trimmedSeparation == 0) {
+        /* all of the samples happen at the same time, so they can't tell us anything */
+        return queue->bucketWidth;
+    }
+
+    return MAX(3 * (trimmedSeparation / numTrimmed), 1);
+}
+
+static void _calendarqueue_resize(CalendarQueue* queue, guint newNumBuckets) {
+    SimulationTime newBucketWidth = _calendarqueue_computeBucketWidth(queue);
+
+    CalendarBucket* oldBuckets = queue->buckets;
+    guint oldNumBuckets = queue->numBuckets;
+
+    queue->buckets = g_new0(CalendarBucket, newNumBuckets);
+    queue->numBuckets = newNumBuckets;
+    queue->bucketWidth = newBucketWidth;
+    queue->size = 0;
+
+    for(guint i = 0; i < oldNumBuckets; i++) {
+        CalendarBucket* bucket = &oldBuckets[i];
+        for(guint j = 0; j < bucket->size; j++) {
+            _calendarqueue_insert(queue, &bucket->entries[j]);
+        }
+        g_free(bucket->entries);
+    }
+    g_free(oldBuckets);
+
+    queue->stats.numBuckets = queue->numBuckets;
+    queue->stats.maxNumBuckets = MAX(queue->stats.maxNumBuckets, queue->numBuckets);
+    queue->stats.bucketWidth = queue->bucketWidth;
+}
+
+CalendarQueue* calendarqueue_new() {
+    CalendarQueue* queue = g_new0(CalendarQueue, 1);
+    MAGIC_INIT(queue);
+
+    queue->numBuckets = CALENDARQUEUE_MIN_BUCKETS;
+    queue->buckets = g_new0(CalendarBucket, queue->numBuckets);
+    queue->bucketWidth = INITIAL_BUCKET_WIDTH;
+    _calendarqueue_setPosition(queue, 0);
+
+    queue->stats.numBuckets = queue->numBuckets;
+    queue->stats.maxNumBuckets = queue->numBuckets;
+    queue->stats.bucketWidth = queue->bucketWidth;
+
+    return queue;
+}
+
+void calendarqueue_free(CalendarQueue* queue) {
+    MAGIC_ASSERT(queue);
+
+    for(guint i = 0; i < queue->numBuckets; i++) {
+        CalendarBucket* bucket = &queue->buckets[i];
+        for(guint j = 0; j < bucket->size; j++) {
+            event_unref(bucket->entries[j].event);
+        }
+        g_free(bucket->entries);
+    }
+    g_free(queue->buckets);
+
+    MAGIC_CLEAR(queue);
+    g_free(queue);
+}
+
+gsize calendarqueue_getLength(CalendarQueue* queue) {
+    MAGIC_ASSERT(queue);
+    return queue->size;
+}
+
+gboolean calendarqueue_isEmpty(CalendarQueue* queue) {
+    MAGIC_ASSERT(queue);
+    return queue->size == 0;
+}
+
+const CalendarQueueStats* calendarqueue_getStats(CalendarQueue* queue) {
+    MAGIC_ASSERT(queue);
+    return &queue->stats;
+}
+
+void calendarqueue_push(CalendarQueue* queue, Event* event) {
+    MAGIC_ASSERT(queue);
+    utility_assert(event);
+
+    CalendarEntry entry;
+    event_getKey(event, &entry.key);
+    entry.event = event;
+
+    _calendarqueue_insert(queue, &entry);
+    queue->stats.numPushed++;
+
+    if(queue->size > 2 * (gsize)queue->numBuckets) {
+        _calendarqueue_resize(queue, queue->numBuckets * 2);
+        queue->stats.numGrows++;
+    }
+}
+
+Event* calendarqueue_peek(CalendarQueue* queue) {
+    MAGIC_ASSERT(queue);
+    CalendarBucket* bucket = _calendarqueue_findNext(queue);
+    return (bucket != NULL) ? bucket->entries[0].event : NULL;
+}
+
+SimulationTime calendarqueue_peekTime(CalendarQueue* queue) {
+    MAGIC_ASSERT(queue);
+    CalendarBucket* bucket = _calendarqueue_findNext(queue);
+    return (bucket != NULL) ? bucket->entries[0].key.time : SIMTIME_INVALID;
+}
+
+Event* calendarqueue_pop(CalendarQueue* queue) {
+    MAGIC_ASSERT(queue);
+
+    if(queue->size == 0) {
+        return NULL;
+    }
+
+    CalendarEntry entry;
+    _calendarqueue_remove(queue, &entry);
+    queue->stats.numPopped++;
+
+    if(queue->numBuckets > CALENDARQUEUE_MIN_BUCKETS && queue->size < queue->numBuckets / 2) {
+        _calendarqueue_resize(queue, queue->numBuckets / 2);
+        queue->stats.numShrinks++;
+    }
+
+    return entry.event;
+}
@@ -0,0 +1,63 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_CALENDAR_QUEUE_H_
+#define SHD_CALENDAR_QUEUE_H_
+
+#include <glib.h>
+
+#include "main/core/support/definitions.h"
+#include "main/core/work/event.h"
+
+/**
+ * A calendar queue of events (R. Brown, CACM 31(10), 1988) with the same
+ * ordering as event_compare. Events are hashed by time into an array of
+ * buckets that each cover bucketWidth nanoseconds of a "year" of
+ * numBuckets * bucketWidth nanoseconds, and each bucket keeps its events in
+ * a binary min-heap ordered by the full event key. The number of buckets
+ * follows the number of events and the bucket width is re-estimated from the
+ * event spacing whenever the buckets are resized, so that push and pop take
+ * amortized constant time for the event distributions we usually see.
+ *
+ * A CalendarQueue is not thread-safe; callers that share one must lock it.
+ */
+
+typedef struct _CalendarQueue CalendarQueue;
+
+typedef struct _CalendarQueueStats CalendarQueueStats;
+struct _CalendarQueueStats {
+    /* the number of times the buckets were doubled or halved */
+    guint numGrows;
+    guint numShrinks;
+    guint maxNumBuckets;
+    /* the current bucket configuration */
+    guint numBuckets;
+    SimulationTime bucketWidth;
+    /* the number of times a pop found no event in a whole year and
+     * had to search all of the buckets for the next one */
+    guint64 numDirectSearches;
+    guint64 numPushed;
+    guint64 numPopped;
+};
+
+CalendarQueue* calendarqueue_new();
+/* unrefs the events still in the queue */
+void calendarqueue_free(CalendarQueue* queue);
+
+gsize calendarqueue_getLength(CalendarQueue* queue);
+gboolean calendarqueue_isEmpty(CalendarQueue* queue);
+const CalendarQueueStats* calendarqueue_getStats(CalendarQueue* queue);
+
+/* the queue takes the caller's reference to the event */
+void calendarqueue_push(CalendarQueue* queue, Event* event);
+/* returns the next event without removing it, or NULL if the queue is empty */
+Event* calendarqueue_peek(CalendarQueue* queue);
+/* returns the time of the next event, or SIMTIME_INVALID if the queue is empty */
+SimulationTime calendarqueue_peekTime(CalendarQueue* queue);
+/* removes and returns the next event, passing its reference to the caller,
+ * or returns NULL if the queue is empty */
+Event* calendarqueue_pop(CalendarQueue* queue);
+
+#endif /* SHD_CALENDAR_QUEUE_H_ */
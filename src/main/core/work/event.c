@@ -12,6 +12,7 @@
 #include "main/host/cpu.h"
 #include "main/host/host.h"
 #include "main/host/tracker.h"
+#include "main/utility/object_pool.h"
 #include "main/utility/utility.h"
 #include "support/logger/logger.h"
 
@@ -22,12 +23,18 @@ struct _Event {
     SimulationTime time;
     guint64 srcHostEventID;
     gint referenceCount;
+    /* the next event while this one waits in an inbox */
+    Event* next;
     MAGIC_DECLARE;
 };
 
+static ObjectPool* _event_getObjectPool() {
+    return worker_getObjectPool(OBJECT_TYPE_EVENT, sizeof(Event));
+}
+
 Event* event_new_(Task* task, SimulationTime time, gpointer srcHost, gpointer dstHost) {
     utility_assert(task != NULL);
-    Event* event = g_new0(Event, 1);
+    Event* event = objectpool_alloc(_event_getObjectPool(), sizeof(Event));
     MAGIC_INIT(event);
 
     event->srcHost = (Host*)srcHost;
@@ -45,7 +52,7 @@ Event* event_new_(Task* task, SimulationTime time, gpointer srcHost, gpointer ds
 static void _event_free(Event* event) {
     task_unref(event->task);
     MAGIC_CLEAR(event);
-    g_free(event);
+    objectpool_release(_event_getObjectPool(), event);
     worker_countObject(OBJECT_TYPE_EVENT, COUNTER_TYPE_FREE);
 }
 
@@ -84,7 +91,10 @@ void event_execute(Event* event) {
     } else {
         /* cpu is not blocked, its ok to execute the event */
         host_continueExecutionTimer(event->dstHost);
+        /* epoll listeners hear about descriptor status changes once, after the task */
+        host_beginDescriptorStatusBatch(event->dstHost);
         task_execute(event->task);
+        host_endDescriptorStatusBatch(event->dstHost);
         host_stopExecutionTimer(event->dstHost);
     }
 
@@ -107,6 +117,23 @@ void event_setTime(Event* event, SimulationTime time) {
     event->time = time;
 }
 
+Event** event_getNextReference(Event* event) {
+    MAGIC_ASSERT(event);
+    return &(event->next);
+}
+
+void event_getKey(Event* event, EventKey* key) {
+    MAGIC_ASSERT(event);
+    utility_assert(key);
+
+    /* GQuarks are 32 bits, so comparing the packed ids compares the dst host
+     * ids first and then the src host ids, the same as event_compare */
+    key->time = event->time;
+    key->hostIDs = (((guint64)host_getID(event->dstHost)) << 32) |
+            ((guint64)host_getID(event->srcHost));
+    key->srcHostEventID = event->srcHostEventID;
+}
+
 gint event_compare(const Event* a, const Event* b, gpointer userData) {
     MAGIC_ASSERT(a);
     MAGIC_ASSERT(b);
@@ -16,15 +16,40 @@
  * (These are packets sent between hosts on the same machine.) */
 typedef struct _Event Event;
 
+/* the fields that determine the execution order of events, in the form
+ * that the event queue stores inline. see event_compare for the order. */
+typedef struct _EventKey EventKey;
+struct _EventKey {
+    SimulationTime time;
+    /* the dst host id in the high 32 bits and the src host id in the low 32 bits */
+    guint64 hostIDs;
+    guint64 srcHostEventID;
+};
+
 Event* event_new_(Task* task, SimulationTime time, gpointer srcHost, gpointer dstHost);
 void event_ref(Event* event);
 void event_unref(Event* event);
 
 void event_execute(Event* event);
 gint event_compare(const Event* a, const Event* b, gpointer userData);
+void event_getKey(Event* event, EventKey* key);
+
+/* returns TRUE if the event with key a executes before the event with key b */
+static inline gboolean event_isKeyBefore(const EventKey* a, const EventKey* b) {
+    if(a->time != b->time) {
+        return a->time < b->time;
+    } else if(a->hostIDs != b->hostIDs) {
+        return a->hostIDs < b->hostIDs;
+    } else {
+        return a->srcHostEventID < b->srcHostEventID;
+    }
+}
 
 gpointer event_getHost(Event* event);
 SimulationTime event_getTime(Event* event);
 void event_setTime(Event* event, SimulationTime time);
 
+/* the link that an EventInbox uses to chain the events it holds */
+Event** event_getNextReference(Event* event);
+
 #endif /* SHD_EVENT_H_ */
@@ -0,0 +1,94 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/core/work/event_inbox.h"
+
+#include <glib.h>
+
+#include "main/utility/utility.h"
+
+/* marks the link of an event that was made the head of the inbox, but whose
+ * pusher has not yet linked it to the rest of the list */
+#define EVENTINBOX_LINK_PENDING ((Event*)1)
+
+struct _EventInbox {
+    /* the most recently pushed event, which links to the ones before it */
+    Event* head;
+    MAGIC_DECLARE;
+};
+
+EventInbox* eventinbox_new() {
+    EventInbox* inbox = g_new0(EventInbox, 1);
+    MAGIC_INIT(inbox);
+    return inbox;
+}
+
+static Event* _eventinbox_takeAll(EventInbox* inbox) {
+    return __atomic_exchange_n(&inbox->head, NULL, __ATOMIC_ACQUIRE);
+}
+
+static Event* _eventinbox_getNext(Event* event) {
+    Event** link = event_getNextReference(event);
+    Event* next = NULL;
+
+    /* the pusher is between its two steps, which only takes a few instructions */
+    while((next = __atomic_load_n(link, __ATOMIC_ACQUIRE)) == EVENTINBOX_LINK_PENDING) {
+        utility_cpuRelax();
+    }
+
+    *link = NULL;
+    return next;
+}
+
+void eventinbox_free(EventInbox* inbox) {
+    MAGIC_ASSERT(inbox);
+
+    Event* event = _eventinbox_takeAll(inbox);
+    while(event) {
+        Event* next = _eventinbox_getNext(event);
+        event_unref(event);
+        event = next;
+    }
+
+    MAGIC_CLEAR(inbox);
+    g_free(inbox);
+}
+
+void eventinbox_push(EventInbox* inbox, Event* event) {
+    MAGIC_ASSERT(inbox);
+    utility_assert(event);
+
+    /* swap ourselves in as the head first, so that the push never has to
+     * retry, and then link to the old head */
+    Event** link = event_getNextReference(event);
+    __atomic_store_n(link, EVENTINBOX_LINK_PENDING, __ATOMIC_RELAXED);
+    Event* previousHead = __atomic_exchange_n(&inbox->head, event, __ATOMIC_ACQ_REL);
+    __atomic_store_n(link, previousHead, __ATOMIC_RELEASE);
+}
+
+gboolean eventinbox_isEmpty(EventInbox* inbox) {
+    MAGIC_ASSERT(inbox);
+    return __atomic_load_n(&inbox->head, __ATOMIC_ACQUIRE) == NULL;
+}
+
+gsize eventinbox_drain(EventInbox* inbox, EventQueue* queue) {
+    MAGIC_ASSERT(inbox);
+
+    if(eventinbox_isEmpty(inbox)) {
+        return 0;
+    }
+
+    /* the list is in reverse push order, but the queue sorts the events anyway */
+    gsize numDrained = 0;
+    Event* event = _eventinbox_takeAll(inbox);
+    while(event) {
+        Event* next = _eventinbox_getNext(event);
+        eventqueue_push(queue, event);
+        numDrained++;
+        event = next;
+    }
+
+    return numDrained;
+}
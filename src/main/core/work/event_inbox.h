@@ -0,0 +1,38 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_EVENT_INBOX_H_
+#define SHD_EVENT_INBOX_H_
+
+#include <glib.h>
+
+#include "main/core/work/event.h"
+#include "main/core/work/event_queue.h"
+
+/**
+ * An unordered collection of events that any number of threads may push to
+ * without locking, and that a single consumer empties into an EventQueue.
+ * Events are chained through their own link field, so a push never
+ * allocates and completes in a constant number of steps no matter how many
+ * other threads are pushing.
+ *
+ * Only one thread at a time may call eventinbox_drain. Events that are
+ * pushed after a drain started are left for the next drain.
+ */
+
+typedef struct _EventInbox EventInbox;
+
+EventInbox* eventinbox_new();
+/* unrefs the events still in the inbox */
+void eventinbox_free(EventInbox* inbox);
+
+/* the inbox takes the caller's reference to the event. safe to call from any thread. */
+void eventinbox_push(EventInbox* inbox, Event* event);
+/* returns TRUE if no events are waiting in the inbox */
+gboolean eventinbox_isEmpty(EventInbox* inbox);
+/* moves all of the waiting events into queue and returns how many were moved */
+gsize eventinbox_drain(EventInbox* inbox, EventQueue* queue);
+
+#endif /* SHD_EVENT_INBOX_H_ */
@@ -0,0 +1,212 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/core/work/event_queue.h"
+
+#include <glib.h>
+
+#include "main/utility/utility.h"
+
+/* the number of children of each heap node */
+#define EVENTQUEUE_ARITY 4
+
+static const gsize INITIAL_CAPACITY = 128;
+
+typedef struct _EventQueueEntry EventQueueEntry;
+struct _EventQueueEntry {
+    EventKey key;
+    Event* event;
+};
+
+struct _EventQueue {
+    EventQueueEntry* entries;
+    gsize size;
+    gsize capacity;
+    MAGIC_DECLARE;
+};
+
+static void _eventqueue_resize(EventQueue* queue, gsize newCapacity) {
+    utility_assert(newCapacity >= queue->size);
+    queue->entries = g_renew(EventQueueEntry, queue->entries, newCapacity);
+    queue->capacity = newCapacity;
+}
+
+/* move the entry up from the hole at index until its parent is before it */
+static void _eventqueue_siftUp(EventQueue* queue, gsize index, const EventQueueEntry* entry) {
+    EventQueueEntry* entries = queue->entries;
+
+    while(index > 0) {
+        gsize parent = (index - 1) / EVENTQUEUE_ARITY;
+        if(!event_isKeyBefore(&entry->key, &entries[parent].key)) {
+            break;
+        }
+        entries[index] = entries[parent];
+        index = parent;
+    }
+
+    entries[index] = *entry;
+}
+
+/* move the entry down from the hole at index until it is before all of its children */
+static void _eventqueue_siftDown(EventQueue* queue, gsize index, const EventQueueEntry* entry) {
+    EventQueueEntry* entries = queue->entries;
+
+    while(TRUE) {
+        gsize firstChild = index * EVENTQUEUE_ARITY + 1;
+        if(firstChild >= queue->size) {
+            break;
+        }
+
+        gsize endChild = MIN(firstChild + EVENTQUEUE_ARITY, queue->size);
+        gsize minChild = firstChild;
+        for(gsize child = firstChild + 1; child < endChild; child++) {
+            if(event_isKeyBefore(&entries[child].key, &entries[minChild].key)) {
+                minChild = child;
+            }
+        }
+
+        if(!event_isKeyBefore(&entries[minChild].key, &entry->key)) {
+            break;
+        }
+        entries[index] = entries[minChild];
+        index = minChild;
+    }
+
+    entries[index] = *entry;
+}
+
+EventQueue* eventqueue_new() {
+    EventQueue* queue = g_new0(EventQueue, 1);
+    MAGIC_INIT(queue);
+
+    queue->entries = g_new(EventQueueEntry, INITIAL_CAPACITY);
+    queue->capacity = INITIAL_CAPACITY;
+
+    return queue;
+}
+
+void eventqueue_free(EventQueue* queue) {
+    MAGIC_ASSERT(queue);
+
+    for(gsize i = 0; i < queue->size; i++) {
+        event_unref(queue->entries[i].event);
+    }
+    g_free(queue->entries);
+
+    MAGIC_CLEAR(queue);
+    g_free(queue);
+}
+
+gsize eventqueue_getLength(EventQueue* queue) {
+    MAGIC_ASSERT(queue);
+    return queue->size;
+}
+
+gboolean eventqueue_isEmpty(EventQueue* queue) {
+    MAGIC_ASSERT(queue);
+    return queue->size == 0;
+}
+
+void eventqueue_push(EventQueue* queue, Event* event) {
+    MAGIC_ASSERT(queue);
+    utility_assert(event);
+
+    if(queue->size >= queue->capacity) {
+        _eventqueue_resize(queue, queue->capacity * 2);
+    }
+
+    EventQueueEntry entry;
+    event_getKey(event, &entry.key);
+    entry.event = event;
+
+    queue->size++;
+    _eventqueue_siftUp(queue, queue->size - 1, &entry);
+}
+
+Event* eventqueue_peek(EventQueue* queue) {
+    MAGIC_ASSERT(queue);
+    return (queue->size > 0) ? queue->entries[0].event : NULL;
+}
+
+SimulationTime eventqueue_peekTime(EventQueue* queue) {
+    MAGIC_ASSERT(queue);
+    return (queue->size > 0) ? queue->entries[0].key.time : SIMTIME_INVALID;
+}
+
+static gsize _eventqueue_countBefore(EventQueue* queue, gsize index, SimulationTime time) {
+    /* every entry below one that is not early enough is not early enough either */
+    if(index >= queue->size || queue->entries[index].key.time >= time) {
+        return 0;
+    }
+
+    gsize count = 1;
+    gsize firstChild = index * EVENTQUEUE_ARITY + 1;
+    for(gsize child = firstChild; child < firstChild + EVENTQUEUE_ARITY; child++) {
+        count += _eventqueue_countBefore(queue, child, time);
+    }
+    return count;
+}
+
+gsize eventqueue_countBefore(EventQueue* queue, SimulationTime time) {
+    MAGIC_ASSERT(queue);
+    return _eventqueue_countBefore(queue, 0, time);
+}
+
+gsize eventqueue_moveHostEvents(EventQueue* queue, EventQueue* destination, gpointer host) {
+    MAGIC_ASSERT(queue);
+    MAGIC_ASSERT(destination);
+    utility_assert(queue != destination);
+
+    /* compact the entries we keep to the front of the array */
+    gsize numKept = 0;
+    for(gsize i = 0; i < queue->size; i++) {
+        if(event_getHost(queue->entries[i].event) == host) {
+            eventqueue_push(destination, queue->entries[i].event);
+        } else {
+            queue->entries[numKept++] = queue->entries[i];
+        }
+    }
+
+    gsize numMoved = queue->size - numKept;
+    if(numMoved == 0) {
+        return 0;
+    }
+    queue->size = numKept;
+
+    /* rebuild the heap bottom-up, which is linear in the number of entries */
+    if(queue->size > 1) {
+        gsize index = (queue->size - 2) / EVENTQUEUE_ARITY + 1;
+        while(index > 0) {
+            index--;
+            EventQueueEntry entry = queue->entries[index];
+            _eventqueue_siftDown(queue, index, &entry);
+        }
+    }
+
+    return numMoved;
+}
+
+Event* eventqueue_pop(EventQueue* queue) {
+    MAGIC_ASSERT(queue);
+
+    if(queue->size == 0) {
+        return NULL;
+    }
+
+    Event* event = queue->entries[0].event;
+
+    /* fill the hole at the root with the last entry */
+    queue->size--;
+    if(queue->size > 0) {
+        EventQueueEntry last = queue->entries[queue->size];
+        _eventqueue_siftDown(queue, 0, &last);
+    }
+
+    if(queue->capacity > INITIAL_CAPACITY && queue->size * 4 < queue->capacity) {
+        _eventqueue_resize(queue, queue->capacity / 2);
+    }
+
+    return event;
+}
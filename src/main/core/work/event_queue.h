@@ -0,0 +1,52 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_EVENT_QUEUE_H_
+#define SHD_EVENT_QUEUE_H_
+
+#include <glib.h>
+
+#include "main/core/support/definitions.h"
+#include "main/core/work/event.h"
+
+/**
+ * A min-heap of events ordered the same way as event_compare. The sort key of
+ * each event is copied into the heap array next to the event pointer when the
+ * event is pushed, so ordering the heap never dereferences an event, and the
+ * heap has four children per node so that sifting touches fewer cache lines.
+ *
+ * Unlike PriorityQueue, events can't be found or removed by pointer, and an
+ * event's time must not change while it is in the queue.
+ *
+ * An EventQueue is not thread-safe; callers that share one must lock it.
+ */
+
+typedef struct _EventQueue EventQueue;
+
+EventQueue* eventqueue_new();
+/* unrefs the events still in the queue */
+void eventqueue_free(EventQueue* queue);
+
+gsize eventqueue_getLength(EventQueue* queue);
+gboolean eventqueue_isEmpty(EventQueue* queue);
+
+/* the queue takes the caller's reference to the event */
+void eventqueue_push(EventQueue* queue, Event* event);
+/* returns the next event without removing it, or NULL if the queue is empty */
+Event* eventqueue_peek(EventQueue* queue);
+/* returns the time of the next event without touching the event itself,
+ * or SIMTIME_INVALID if the queue is empty */
+SimulationTime eventqueue_peekTime(EventQueue* queue);
+/* returns the number of events in the queue that are earlier than time. this
+ * only visits those events and their direct children, not the whole queue. */
+gsize eventqueue_countBefore(EventQueue* queue, SimulationTime time);
+/* moves every event whose destination is host from queue into destination, keeping
+ * the order of the rest of the queue, and returns the number of events moved */
+gsize eventqueue_moveHostEvents(EventQueue* queue, EventQueue* destination, gpointer host);
+/* removes and returns the next event, passing its reference to the caller,
+ * or returns NULL if the queue is empty */
+Event* eventqueue_pop(EventQueue* queue);
+
+#endif /* SHD_EVENT_QUEUE_H_ */
@@ -0,0 +1,128 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/core/work/lazy_timer.h"
+
+#include <glib.h>
+
+#include "main/core/work/task.h"
+#include "main/core/worker.h"
+#include "main/utility/utility.h"
+
+struct _LazyTimer {
+    LazyTimerExpiredFunc expiredFunc;
+    gpointer owner;
+    LazyTimerOwnerRefFunc ownerRef;
+    LazyTimerOwnerUnrefFunc ownerUnref;
+
+    /* when the timer should expire, or SIMTIME_INVALID if it is disarmed */
+    SimulationTime expireTime;
+    /* when the live event fires, or SIMTIME_INVALID if there is none.
+     * events that fire at any other time are stale. */
+    SimulationTime eventTime;
+
+    MAGIC_DECLARE;
+};
+
+LazyTimer* lazytimer_new(LazyTimerExpiredFunc expiredFunc, gpointer owner,
+        LazyTimerOwnerRefFunc ownerRef, LazyTimerOwnerUnrefFunc ownerUnref) {
+    utility_assert(expiredFunc);
+
+    LazyTimer* timer = g_new0(LazyTimer, 1);
+    MAGIC_INIT(timer);
+
+    timer->expiredFunc = expiredFunc;
+    timer->owner = owner;
+    timer->ownerRef = ownerRef;
+    timer->ownerUnref = ownerUnref;
+    timer->expireTime = SIMTIME_INVALID;
+    timer->eventTime = SIMTIME_INVALID;
+
+    return timer;
+}
+
+void lazytimer_free(LazyTimer* timer) {
+    MAGIC_ASSERT(timer);
+    MAGIC_CLEAR(timer);
+    g_free(timer);
+}
+
+static void _lazytimer_scheduleEvent(LazyTimer* timer, SimulationTime now);
+
+static void _lazytimer_onEventFired(gpointer owner, LazyTimer* timer) {
+    MAGIC_ASSERT(timer);
+
+    SimulationTime now = worker_getCurrentTime();
+
+    if(now != timer->eventTime) {
+        /* an earlier event replaced this one */
+        return;
+    }
+    timer->eventTime = SIMTIME_INVALID;
+
+    if(timer->expireTime == SIMTIME_INVALID) {
+        /* disarmed after the event was scheduled */
+        return;
+    } else if(timer->expireTime > now) {
+        /* rearmed for a later time after the event was scheduled */
+        _lazytimer_scheduleEvent(timer, now);
+        return;
+    }
+
+    timer->expireTime = SIMTIME_INVALID;
+    timer->expiredFunc(timer->owner);
+}
+
+static void _lazytimer_scheduleEvent(LazyTimer* timer, SimulationTime now) {
+    SimulationTime delay = timer->expireTime > now ? timer->expireTime - now : 0;
+
+    /* the task holds the owner reference */
+    if(timer->ownerRef) {
+        timer->ownerRef(timer->owner);
+    }
+    Task* task = task_new((TaskCallbackFunc)_lazytimer_onEventFired, timer->owner, timer,
+            (TaskObjectFreeFunc)timer->ownerUnref, NULL);
+
+    if(worker_scheduleTask(task, delay)) {
+        timer->eventTime = now + delay;
+    } else {
+        /* the scheduler refused the event (e.g., it is past the end of the
+         * simulation), so the timer can't expire. don't let it look armed,
+         * or nobody would arm it again. */
+        timer->expireTime = SIMTIME_INVALID;
+    }
+
+    task_unref(task);
+}
+
+void lazytimer_arm(LazyTimer* timer, SimulationTime expireTime) {
+    MAGIC_ASSERT(timer);
+    utility_assert(expireTime != SIMTIME_INVALID);
+
+    timer->expireTime = expireTime;
+
+    if(timer->eventTime != SIMTIME_INVALID && timer->eventTime <= expireTime) {
+        /* the live event fires first and takes care of the rest */
+        return;
+    }
+
+    _lazytimer_scheduleEvent(timer, worker_getCurrentTime());
+}
+
+void lazytimer_disarm(LazyTimer* timer) {
+    MAGIC_ASSERT(timer);
+    /* a pending event will find the timer disarmed when it fires */
+    timer->expireTime = SIMTIME_INVALID;
+}
+
+gboolean lazytimer_isArmed(LazyTimer* timer) {
+    MAGIC_ASSERT(timer);
+    return timer->expireTime != SIMTIME_INVALID ? TRUE : FALSE;
+}
+
+SimulationTime lazytimer_getExpireTime(LazyTimer* timer) {
+    MAGIC_ASSERT(timer);
+    return timer->expireTime;
+}
@@ -0,0 +1,45 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_LAZY_TIMER_H_
+#define SHD_LAZY_TIMER_H_
+
+#include <glib.h>
+
+#include "main/core/support/definitions.h"
+
+/**
+ * A timer for the currently active host that keeps at most one live event in
+ * the scheduler, no matter how often it is rearmed. Arming the timer for a
+ * later time than its pending event only updates the expiration time; when
+ * the pending event fires early, it schedules a new event for the remaining
+ * time instead of calling the callback. Only arming it for an earlier time
+ * than the pending event schedules a new event, and the event it replaces is
+ * recognized as stale and ignored when it fires.
+ *
+ * The timer holds a reference to its owner while an event is pending, so the
+ * owner can only be freed (and free the timer) once no event is pending.
+ */
+
+typedef struct _LazyTimer LazyTimer;
+
+typedef void (*LazyTimerExpiredFunc)(gpointer owner);
+typedef void (*LazyTimerOwnerRefFunc)(gpointer owner);
+typedef void (*LazyTimerOwnerUnrefFunc)(gpointer owner);
+
+LazyTimer* lazytimer_new(LazyTimerExpiredFunc expiredFunc, gpointer owner,
+        LazyTimerOwnerRefFunc ownerRef, LazyTimerOwnerUnrefFunc ownerUnref);
+void lazytimer_free(LazyTimer* timer);
+
+/* expiredFunc is called at the given absolute time, unless the timer is
+ * rearmed or disarmed before then */
+void lazytimer_arm(LazyTimer* timer, SimulationTime expireTime);
+void lazytimer_disarm(LazyTimer* timer);
+
+gboolean lazytimer_isArmed(LazyTimer* timer);
+/* returns the absolute expiration time, or SIMTIME_INVALID if the timer is not armed */
+SimulationTime lazytimer_getExpireTime(LazyTimer* timer);
+
+#endif /* SHD_LAZY_TIMER_H_ */
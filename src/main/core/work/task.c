@@ -8,6 +8,7 @@
 #include "main/core/support/definitions.h"
 #include "main/core/support/object_counter.h"
 #include "main/core/worker.h"
+#include "main/utility/object_pool.h"
 #include "main/utility/utility.h"
 
 struct _Task {
@@ -20,12 +21,15 @@ struct _Task {
     MAGIC_DECLARE;
 };
 
+static ObjectPool* _task_getObjectPool() {
+    return worker_getObjectPool(OBJECT_TYPE_TASK, sizeof(Task));
+}
 
 Task* task_new(TaskCallbackFunc callback, gpointer callbackObject, gpointer callbackArgument,
         TaskObjectFreeFunc objectFree, TaskArgumentFreeFunc argumentFree) {
     utility_assert(callback != NULL);
 
-    Task* task = g_new0(Task, 1);
+    Task* task = objectpool_alloc(_task_getObjectPool(), sizeof(Task));
 
     task->execute = callback;
     task->callbackObject = callbackObject;
@@ -48,7 +52,7 @@ static void _task_free(Task* task) {
         task->argumentFree(task->callbackArgument);
     }
     MAGIC_CLEAR(task);
-    g_free(task);
+    objectpool_release(_task_getObjectPool(), task);
     worker_countObject(OBJECT_TYPE_TASK, COUNTER_TYPE_FREE);
 }
 
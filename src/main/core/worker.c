@@ -25,14 +25,32 @@
 #include "main/routing/address.h"
 #include "main/routing/dns.h"
 #include "main/routing/packet.h"
+#include "main/routing/packet_trace.h"
+#include "main/routing/path.h"
 #include "main/routing/router.h"
 #include "main/routing/topology.h"
 #include "main/utility/count_down_latch.h"
+#include "main/utility/object_pool.h"
 #include "main/utility/random.h"
+#include "main/utility/slab_cache.h"
 #include "main/utility/utility.h"
 #include "support/logger/log_level.h"
 #include "support/logger/logger.h"
 
+/* the number of entries in the per-worker path cache, must be a power of 2 */
+#define WORKER_PATH_CACHE_SIZE 4096
+
+typedef struct _WorkerPathCacheEntry WorkerPathCacheEntry;
+struct _WorkerPathCacheEntry {
+    in_addr_t srcIP;
+    in_addr_t dstIP;
+    /* the ID of the destination host, so we can skip the DNS lookups */
+    GQuark dstID;
+    /* owned by the topology, valid until the topology is freed.
+     * NULL if this entry is unused. */
+    Path* path;
+};
+
 struct _Worker {
     /* our thread and an id that is unique among all threads */
     pthread_t thread;
@@ -61,9 +79,34 @@ struct _Worker {
 
     ObjectCounter* objectCounts;
 
+    /* free lists of recently released memory blocks, so that short-lived
+     * objects such as packet payloads can avoid the system allocator */
+    SlabCache* slabCache;
+
+    /* pools of the objects that pass through the scheduler on every event.
+     * each is created the first time this worker allocates an object of
+     * its type, and objects freed by other workers are returned to it. */
+    struct {
+        ObjectPool* task;
+        ObjectPool* event;
+        ObjectPool* packet;
+    } objectPools;
+
+    /* a direct-mapped cache of the paths that packets sent by this worker
+     * recently took, so repeated sends between the same pair of addresses
+     * don't have to take the global DNS and topology locks */
+    WorkerPathCacheEntry* pathCache;
+
+    /* where packets record their delivery statuses, or NULL if packet
+     * tracing is disabled */
+    PacketTrace* packetTrace;
+
     MAGIC_DECLARE;
 };
 
+/* the number of bytes of free blocks the slab cache keeps for each size class */
+#define WORKER_SLAB_CACHE_BYTES_PER_CLASS (4 * 1024 * 1024)
+
 static Worker* _worker_new(Slave*, guint);
 static void _worker_free(Worker*);
 
@@ -96,9 +139,19 @@ static Worker* _worker_new(Slave* slave, guint threadID) {
     worker->clock.last = SIMTIME_INVALID;
     worker->clock.barrier = SIMTIME_INVALID;
     worker->objectCounts = objectcounter_new();
+    worker->slabCache = slabcache_new(WORKER_SLAB_CACHE_BYTES_PER_CLASS);
+    worker->pathCache = g_new0(WorkerPathCacheEntry, WORKER_PATH_CACHE_SIZE);
 
     worker->bootstrapEndTime = slave_getBootstrapEndTime(worker->slave);
 
+    if(options_doTracePackets(slave_getOptions(worker->slave))) {
+        gchar* traceName = g_strdup_printf("packet-trace.%u.bin", threadID);
+        gchar* tracePath = g_build_filename(slave_getDataPath(worker->slave), traceName, NULL);
+        worker->packetTrace = packettrace_new(tracePath);
+        g_free(tracePath);
+        g_free(traceName);
+    }
+
     g_private_replace(&workerKey, worker);
 
     return worker;
@@ -111,6 +164,29 @@ static void _worker_free(Worker* worker) {
         objectcounter_free(worker->objectCounts);
     }
 
+    if(worker->slabCache != NULL) {
+        slabcache_free(worker->slabCache);
+    }
+
+    if(worker->pathCache != NULL) {
+        g_free(worker->pathCache);
+    }
+
+    if(worker->packetTrace != NULL) {
+        packettrace_free(worker->packetTrace);
+    }
+
+    /* objects that are still alive keep their pool around until they are freed */
+    if(worker->objectPools.task != NULL) {
+        objectpool_free(worker->objectPools.task);
+    }
+    if(worker->objectPools.event != NULL) {
+        objectpool_free(worker->objectPools.event);
+    }
+    if(worker->objectPools.packet != NULL) {
+        objectpool_free(worker->objectPools.packet);
+    }
+
     g_private_set(&workerKey, NULL);
 
     MAGIC_CLEAR(worker);
@@ -144,6 +220,62 @@ Options* worker_getOptions() {
     return slave_getOptions(worker->slave);
 }
 
+SlabCache* worker_getSlabCache() {
+    Worker* worker = _worker_getPrivate();
+    return worker->slabCache;
+}
+
+PacketTrace* worker_getPacketTrace() {
+    /* packets may be destroyed by threads that have no worker */
+    if(!worker_isAlive()) {
+        return NULL;
+    }
+    Worker* worker = _worker_getPrivate();
+    return worker->packetTrace;
+}
+
+static ObjectPool** _worker_getObjectPoolSlot(Worker* worker, ObjectType otype) {
+    switch(otype) {
+        case OBJECT_TYPE_TASK: return &(worker->objectPools.task);
+        case OBJECT_TYPE_EVENT: return &(worker->objectPools.event);
+        case OBJECT_TYPE_PACKET: return &(worker->objectPools.packet);
+        default: return NULL;
+    }
+}
+
+ObjectPool* worker_getObjectPool(ObjectType otype, gsize objectSize) {
+    /* objects may be created and destroyed by threads that have no worker */
+    if(!worker_isAlive()) {
+        return NULL;
+    }
+
+    Worker* worker = _worker_getPrivate();
+    ObjectPool** slot = _worker_getObjectPoolSlot(worker, otype);
+    if(slot == NULL) {
+        return NULL;
+    }
+
+    if(*slot == NULL) {
+        *slot = objectpool_new(objectSize);
+    }
+    return *slot;
+}
+
+static void _worker_countObjectPools(Worker* worker) {
+    if(worker->objectPools.task != NULL) {
+        objectcounter_incrementPool(worker->objectCounts, OBJECT_TYPE_TASK,
+                objectpool_getStats(worker->objectPools.task));
+    }
+    if(worker->objectPools.event != NULL) {
+        objectcounter_incrementPool(worker->objectCounts, OBJECT_TYPE_EVENT,
+                objectpool_getStats(worker->objectPools.event));
+    }
+    if(worker->objectPools.packet != NULL) {
+        objectcounter_incrementPool(worker->objectCounts, OBJECT_TYPE_PACKET,
+                objectpool_getStats(worker->objectPools.packet));
+    }
+}
+
 /* this is the entry point for worker threads when running in parallel mode,
  * and otherwise is the main event loop when running in serial mode */
 gpointer worker_run(WorkerRunData* data) {
@@ -190,7 +322,15 @@ gpointer worker_run(WorkerRunData* data) {
         countdownlatch_await(data->notifyReadyToJoin);
     }
 
+    /* the worker is not freed here when running in global mode,
+     * so close the packet trace now to make sure it is written out */
+    if(worker->packetTrace != NULL) {
+        packettrace_free(worker->packetTrace);
+        worker->packetTrace = NULL;
+    }
+
     /* cleanup is all done, send object counts to slave */
+    _worker_countObjectPools(worker);
     slave_storeCounts(worker->slave, worker->objectCounts);
 
     /* synchronize thread join */
@@ -240,6 +380,42 @@ static void _worker_runDeliverPacketTask(Packet* packet, gpointer userData) {
     router_enqueue(router, packet);
 }
 
+static WorkerPathCacheEntry* _worker_lookupPath(Worker* worker, in_addr_t srcIP, in_addr_t dstIP) {
+    guint64 key = (((guint64)srcIP) << 32) | ((guint64)dstIP);
+    guint slot = (guint)((key * G_GUINT64_CONSTANT(0x9e3779b97f4a7c15)) >> 32) &
+            (WORKER_PATH_CACHE_SIZE - 1);
+    WorkerPathCacheEntry* entry = &worker->pathCache[slot];
+
+    if(entry->path != NULL && entry->srcIP == srcIP && entry->dstIP == dstIP) {
+        /* cache hit, no locks needed */
+        return entry;
+    }
+
+    /* cache miss, go through the global DNS and topology */
+    Address* srcAddress = worker_resolveIPToAddress(srcIP);
+    Address* dstAddress = worker_resolveIPToAddress(dstIP);
+
+    if(!srcAddress || !dstAddress) {
+        error("unable to schedule packet because of null addresses");
+        return NULL;
+    }
+
+    Path* path = topology_getPath(worker_getTopology(), srcAddress, dstAddress);
+    if(!path) {
+        error("unable to find path between node %s and node %s",
+                address_toString(srcAddress), address_toString(dstAddress));
+        return NULL;
+    }
+
+    /* replace whatever was in this slot */
+    entry->srcIP = srcIP;
+    entry->dstIP = dstIP;
+    entry->dstID = (GQuark)address_getID(dstAddress);
+    entry->path = path;
+
+    return entry;
+}
+
 void worker_sendPacket(Packet* packet) {
     utility_assert(packet != NULL);
 
@@ -253,18 +429,16 @@ void worker_sendPacket(Packet* packet) {
     in_addr_t srcIP = packet_getSourceIP(packet);
     in_addr_t dstIP = packet_getDestinationIP(packet);
 
-    Address* srcAddress = worker_resolveIPToAddress(srcIP);
-    Address* dstAddress = worker_resolveIPToAddress(dstIP);
-
-    if(!srcAddress || !dstAddress) {
-        error("unable to schedule packet because of null addresses");
+    /* resolve the path and destination in one lookup */
+    WorkerPathCacheEntry* entry = _worker_lookupPath(worker, srcIP, dstIP);
+    if(!entry) {
         return;
     }
 
     gboolean bootstrapping = worker_isBootstrapActive();
 
     /* check if network reliability forces us to 'drop' the packet */
-    gdouble reliability = topology_getReliability(worker_getTopology(), srcAddress, dstAddress);
+    gdouble reliability = path_getReliability(entry->path);
     Random* random = host_getRandom(worker_getActiveHost());
     gdouble chance = random_nextDouble(random);
 
@@ -272,18 +446,17 @@ void worker_sendPacket(Packet* packet) {
      * control has problems responding to packet loss */
     if(bootstrapping || chance <= reliability || packet_getPayloadLength(packet) == 0) {
         /* the sender's packet will make it through, find latency */
-        gdouble latency = topology_getLatency(worker_getTopology(), srcAddress, dstAddress);
+        gdouble latency = path_getLatency(entry->path);
         SimulationTime delay = (SimulationTime) ceil(latency * SIMTIME_ONE_MILLISECOND);
         SimulationTime deliverTime = worker->clock.now + delay;
 
-        topology_incrementPathPacketCounter(worker_getTopology(), srcAddress, dstAddress);
+        path_incrementPacketCount(entry->path);
 
         /* TODO this should change for sending to remote slave (on a different machine)
          * this is the only place where tasks are sent between separate hosts */
 
         Host* srcHost = worker->active.host;
-        GQuark dstID = (GQuark)address_getID(dstAddress);
-        Host* dstHost = scheduler_getHost(worker->scheduler, dstID);
+        Host* dstHost = scheduler_getHost(worker->scheduler, entry->dstID);
         utility_assert(dstHost);
 
         packet_addDeliveryStatus(packet, PDS_INET_SENT);
@@ -19,8 +19,11 @@
 #include "main/routing/address.h"
 #include "main/routing/dns.h"
 #include "main/routing/packet.h"
+#include "main/routing/packet_trace.h"
 #include "main/routing/topology.h"
 #include "main/utility/count_down_latch.h"
+#include "main/utility/object_pool.h"
+#include "main/utility/slab_cache.h"
 #include "support/logger/log_level.h"
 
 typedef struct _WorkerRunData WorkerRunData;
@@ -38,6 +41,14 @@ typedef struct _Worker Worker;
 DNS* worker_getDNS();
 Topology* worker_getTopology();
 Options* worker_getOptions();
+SlabCache* worker_getSlabCache();
+/* returns this worker's pool for objects of type otype, creating it if
+ * needed, or NULL if objects of that type are not pooled or no worker is
+ * running on this thread */
+ObjectPool* worker_getObjectPool(ObjectType otype, gsize objectSize);
+/* returns this worker's packet trace, or NULL if packet tracing is disabled
+ * or no worker is running on this thread */
+PacketTrace* worker_getPacketTrace();
 gpointer worker_run(WorkerRunData*);
 gboolean worker_scheduleTask(Task* task, SimulationTime nanoDelay);
 void worker_sendPacket(Packet* packet);
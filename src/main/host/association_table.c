@@ -0,0 +1,223 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/host/association_table.h"
+
+#include <glib.h>
+#include <netinet/in.h>
+
+#include "main/utility/utility.h"
+
+/* must be a power of 2 so we can mask instead of mod */
+static const guint INITIAL_CAPACITY = 16;
+
+typedef struct _AssociationEntry AssociationEntry;
+struct _AssociationEntry {
+    /* the peer ip in the high bits and the peer port in the low 16 bits */
+    guint64 peer;
+    /* the protocol in the high bits and the local port in the low 16 bits */
+    guint32 local;
+    /* the associated socket, or NULL if this slot is empty */
+    gpointer value;
+};
+
+struct _AssociationTable {
+    AssociationEntry* entries;
+    /* number of slots in entries, always a power of 2 */
+    guint capacity;
+    /* number of slots that hold a value */
+    guint size;
+    GDestroyNotify valueFreeFunc;
+    MAGIC_DECLARE;
+};
+
+static inline guint32 _associationtable_packLocal(ProtocolType type, in_port_t port) {
+    return (((guint32)type) << 16) | ((guint32)port);
+}
+
+static inline guint64 _associationtable_packPeer(in_addr_t peerIP, in_port_t peerPort) {
+    return (((guint64)peerIP) << 16) | ((guint64)peerPort);
+}
+
+static inline guint _associationtable_hash(guint32 local, guint64 peer) {
+    /* the splitmix64 finalizer, so that keys differing only in the
+     * low-entropy port bits still spread across the table */
+    guint64 x = peer ^ (((guint64)local) << 48) ^ (((guint64)local) >> 16);
+    x ^= x >> 30;
+    x *= G_GUINT64_CONSTANT(0xbf58476d1ce4e5b9);
+    x ^= x >> 27;
+    x *= G_GUINT64_CONSTANT(0x94d049bb133111eb);
+    x ^= x >> 31;
+    return (guint)x;
+}
+
+static inline guint _associationtable_homeSlot(AssociationTable* table,
+        guint32 local, guint64 peer) {
+    return _associationtable_hash(local, peer) & (table->capacity - 1);
+}
+
+/* returns the slot holding the key, or the empty slot where it would go */
+static guint _associationtable_findSlot(AssociationTable* table, guint32 local, guint64 peer) {
+    guint mask = table->capacity - 1;
+    guint slot = _associationtable_homeSlot(table, local, peer);
+
+    /* the load factor is kept below 1 so there is always an empty slot */
+    while(table->entries[slot].value != NULL) {
+        AssociationEntry* entry = &table->entries[slot];
+        if(entry->local == local && entry->peer == peer) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+static void _associationtable_resize(AssociationTable* table, guint newCapacity) {
+    AssociationEntry* oldEntries = table->entries;
+    guint oldCapacity = table->capacity;
+
+    table->entries = g_new0(AssociationEntry, newCapacity);
+    table->capacity = newCapacity;
+
+    for(guint i = 0; i < oldCapacity; i++) {
+        AssociationEntry* entry = &oldEntries[i];
+        if(entry->value != NULL) {
+            guint slot = _associationtable_findSlot(table, entry->local, entry->peer);
+            table->entries[slot] = *entry;
+        }
+    }
+
+    g_free(oldEntries);
+}
+
+AssociationTable* associationtable_new(GDestroyNotify valueFreeFunc) {
+    AssociationTable* table = g_new0(AssociationTable, 1);
+    MAGIC_INIT(table);
+
+    table->entries = g_new0(AssociationEntry, INITIAL_CAPACITY);
+    table->capacity = INITIAL_CAPACITY;
+    table->valueFreeFunc = valueFreeFunc;
+
+    return table;
+}
+
+void associationtable_free(AssociationTable* table) {
+    MAGIC_ASSERT(table);
+
+    if(table->valueFreeFunc) {
+        for(guint i = 0; i < table->capacity; i++) {
+            if(table->entries[i].value != NULL) {
+                table->valueFreeFunc(table->entries[i].value);
+            }
+        }
+    }
+
+    g_free(table->entries);
+
+    MAGIC_CLEAR(table);
+    g_free(table);
+}
+
+guint associationtable_getSize(AssociationTable* table) {
+    MAGIC_ASSERT(table);
+    return table->size;
+}
+
+void associationtable_insert(AssociationTable* table, ProtocolType type,
+        in_port_t port, in_addr_t peerIP, in_port_t peerPort, gpointer value) {
+    MAGIC_ASSERT(table);
+    utility_assert(value != NULL);
+
+    /* keep the load factor at or below 1/2 so probe sequences stay short */
+    if((table->size + 1) * 2 > table->capacity) {
+        _associationtable_resize(table, table->capacity * 2);
+    }
+
+    guint32 local = _associationtable_packLocal(type, port);
+    guint64 peer = _associationtable_packPeer(peerIP, peerPort);
+    guint slot = _associationtable_findSlot(table, local, peer);
+
+    /* make sure there is no collision */
+    utility_assert(table->entries[slot].value == NULL);
+
+    table->entries[slot].local = local;
+    table->entries[slot].peer = peer;
+    table->entries[slot].value = value;
+    table->size++;
+}
+
+gboolean associationtable_remove(AssociationTable* table, ProtocolType type,
+        in_port_t port, in_addr_t peerIP, in_port_t peerPort) {
+    MAGIC_ASSERT(table);
+
+    guint32 local = _associationtable_packLocal(type, port);
+    guint64 peer = _associationtable_packPeer(peerIP, peerPort);
+    guint hole = _associationtable_findSlot(table, local, peer);
+
+    gpointer value = table->entries[hole].value;
+    if(value == NULL) {
+        return FALSE;
+    }
+
+    /* backward-shift deletion: move later entries of the probe sequence into
+     * the hole so that lookups never need tombstones */
+    guint mask = table->capacity - 1;
+    guint next = (hole + 1) & mask;
+    while(table->entries[next].value != NULL) {
+        AssociationEntry* entry = &table->entries[next];
+        guint home = _associationtable_homeSlot(table, entry->local, entry->peer);
+
+        /* the entry may move if its home slot is not cyclically in (hole, next] */
+        gboolean canMove = (hole <= next) ? (home <= hole || home > next) :
+                                            (home <= hole && home > next);
+        if(canMove) {
+            table->entries[hole] = *entry;
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+
+    table->entries[hole].local = 0;
+    table->entries[hole].peer = 0;
+    table->entries[hole].value = NULL;
+    table->size--;
+
+    if(table->capacity > INITIAL_CAPACITY && table->size * 8 < table->capacity) {
+        _associationtable_resize(table, table->capacity / 2);
+    }
+
+    if(table->valueFreeFunc) {
+        table->valueFreeFunc(value);
+    }
+
+    return TRUE;
+}
+
+gpointer associationtable_lookup(AssociationTable* table, ProtocolType type,
+        in_port_t port, in_addr_t peerIP, in_port_t peerPort) {
+    MAGIC_ASSERT(table);
+
+    guint32 local = _associationtable_packLocal(type, port);
+    guint64 peer = _associationtable_packPeer(peerIP, peerPort);
+    guint slot = _associationtable_findSlot(table, local, peer);
+
+    return table->entries[slot].value;
+}
+
+gpointer associationtable_demux(AssociationTable* table, ProtocolType type,
+        in_port_t port, in_addr_t peerIP, in_port_t peerPort) {
+    MAGIC_ASSERT(table);
+
+    /* the first check is for servers who don't associate with specific destinations */
+    gpointer value = associationtable_lookup(table, type, port, 0, 0);
+
+    if(!value && (peerIP != 0 || peerPort != 0)) {
+        /* now check the destination-specific key */
+        value = associationtable_lookup(table, type, port, peerIP, peerPort);
+    }
+
+    return value;
+}
@@ -0,0 +1,45 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_ASSOCIATION_TABLE_H_
+#define SHD_ASSOCIATION_TABLE_H_
+
+#include <glib.h>
+#include <netinet/in.h>
+
+#include "main/host/protocol.h"
+
+/**
+ * Maps a (protocol, local port, peer ip, peer port) tuple to a socket for a
+ * single network interface. The local ip is implied by the interface, so it
+ * is not part of the key. Keys are stored inline in an open-addressing table
+ * with linear probing, so none of the operations allocate unless the table
+ * needs to grow. Sockets that are not connected to a specific peer (e.g.,
+ * listening servers) are stored with a peer ip and port of 0.
+ */
+
+typedef struct _AssociationTable AssociationTable;
+
+AssociationTable* associationtable_new(GDestroyNotify valueFreeFunc);
+void associationtable_free(AssociationTable* table);
+
+guint associationtable_getSize(AssociationTable* table);
+
+/* insert the value for the exact key. the key must not already exist. */
+void associationtable_insert(AssociationTable* table, ProtocolType type,
+        in_port_t port, in_addr_t peerIP, in_port_t peerPort, gpointer value);
+/* remove the value for the exact key, calling valueFreeFunc if it exists.
+ * returns TRUE if the key existed. */
+gboolean associationtable_remove(AssociationTable* table, ProtocolType type,
+        in_port_t port, in_addr_t peerIP, in_port_t peerPort);
+/* lookup the value stored for the exact key, or NULL if none exists */
+gpointer associationtable_lookup(AssociationTable* table, ProtocolType type,
+        in_port_t port, in_addr_t peerIP, in_port_t peerPort);
+/* find the socket that should receive a packet: sockets not associated with a
+ * specific peer take precedence, then we check for one associated with the peer */
+gpointer associationtable_demux(AssociationTable* table, ProtocolType type,
+        in_port_t port, in_addr_t peerIP, in_port_t peerPort);
+
+#endif /* SHD_ASSOCIATION_TABLE_H_ */
@@ -7,6 +7,7 @@
 #include "main/host/descriptor/descriptor.h"
 
 #include <stddef.h>
+#include <string.h>
 
 #include "main/core/support/object_counter.h"
 #include "main/core/worker.h"
@@ -23,7 +24,8 @@ void descriptor_init(Descriptor* descriptor, DescriptorType type,
     descriptor->funcTable = funcTable;
     descriptor->handle = handle;
     descriptor->type = type;
-    descriptor->epollListeners = g_hash_table_new_full(g_int_hash, g_int_equal, NULL, descriptor_unref);
+    descriptor->epollListeners = descriptor->inlineEpollListeners;
+    descriptor->epollListenersCapacity = DESCRIPTOR_INLINE_LISTENERS;
     descriptor->referenceCount = 1;
 
     worker_countObject(OBJECT_TYPE_DESCRIPTOR, COUNTER_TYPE_NEW);
@@ -33,8 +35,11 @@ static void _descriptor_free(Descriptor* descriptor) {
     MAGIC_ASSERT(descriptor);
     MAGIC_ASSERT(descriptor->funcTable);
 
-    if(descriptor->epollListeners) {
-        g_hash_table_destroy(descriptor->epollListeners);
+    for(guint i = 0; i < descriptor->numEpollListeners; i++) {
+        descriptor_unref(descriptor->epollListeners[i]);
+    }
+    if(descriptor->epollListeners != descriptor->inlineEpollListeners) {
+        g_free(descriptor->epollListeners);
     }
 
     MAGIC_CLEAR(descriptor);
@@ -86,15 +91,30 @@ gint* descriptor_getHandleReference(Descriptor* descriptor) {
     return &(descriptor->handle);
 }
 
-static void _descriptor_notifyEpollListener(gpointer key, gpointer value, gpointer user_data) {
-    Descriptor* descriptor = user_data;
-    Epoll* epoll = value;
-    epoll_descriptorStatusChanged(epoll, descriptor);
+void descriptor_flushStatus(Descriptor* descriptor) {
+    MAGIC_ASSERT(descriptor);
+
+    descriptor->isNotificationPending = FALSE;
+
+    DescriptorStatus toggled = descriptor->toggledStatus;
+    descriptor->toggledStatus = DS_NONE;
+    if(toggled == DS_NONE) {
+        return;
+    }
+
+    /* tell our epoll listeners their was some activity on this descriptor.
+     * bits that flipped back while we waited still count, since e.g. data
+     * that was read and then arrived again is a new edge in EPOLLET mode. */
+    for(guint i = 0; i < descriptor->numEpollListeners; i++) {
+        epoll_descriptorStatusChanged((Epoll*)descriptor->epollListeners[i], descriptor, toggled);
+    }
 }
 
 void descriptor_adjustStatus(Descriptor* descriptor, DescriptorStatus status, gboolean doSetBits){
     MAGIC_ASSERT(descriptor);
 
+    DescriptorStatus oldStatus = descriptor->status;
+
     /* adjust our status as requested */
     if(doSetBits) {
         if((status & DS_ACTIVE) && !(descriptor->status & DS_ACTIVE)) {
@@ -132,8 +152,24 @@ void descriptor_adjustStatus(Descriptor* descriptor, DescriptorStatus status, gb
         }
     }
 
-    /* tell our epoll listeners their was some activity on this descriptor */
-    g_hash_table_foreach(descriptor->epollListeners, _descriptor_notifyEpollListener, descriptor);
+    if(descriptor->status == oldStatus || descriptor->numEpollListeners == 0) {
+        /* nothing new to tell, or nobody to tell it to */
+        return;
+    }
+    descriptor->toggledStatus |= oldStatus ^ descriptor->status;
+
+    if(descriptor->isNotificationPending) {
+        /* we already will tell them */
+        return;
+    }
+
+    /* coalesce the changes made while the current event runs */
+    Host* host = worker_isAlive() ? worker_getActiveHost() : NULL;
+    if(host && host_batchDescriptorStatus(host, descriptor)) {
+        descriptor->isNotificationPending = TRUE;
+    } else {
+        descriptor_flushStatus(descriptor);
+    }
 }
 
 DescriptorStatus descriptor_getStatus(Descriptor* descriptor) {
@@ -159,15 +195,41 @@ DescriptorStatus descriptor_getStatus(Descriptor* descriptor) {
 
 void descriptor_addEpollListener(Descriptor* descriptor, Descriptor* epoll) {
     MAGIC_ASSERT(descriptor);
-    /* we are string the epoll instance, so increase the ref */
+
+    for(guint i = 0; i < descriptor->numEpollListeners; i++) {
+        if(descriptor->epollListeners[i] == epoll) {
+            return;
+        }
+    }
+
+    if(descriptor->numEpollListeners == descriptor->epollListenersCapacity) {
+        guint capacity = descriptor->epollListenersCapacity * 2;
+        Descriptor** listeners = g_new(Descriptor*, capacity);
+        memcpy(listeners, descriptor->epollListeners, descriptor->numEpollListeners * sizeof(Descriptor*));
+        if(descriptor->epollListeners != descriptor->inlineEpollListeners) {
+            g_free(descriptor->epollListeners);
+        }
+        descriptor->epollListeners = listeners;
+        descriptor->epollListenersCapacity = capacity;
+    }
+
+    /* we are storing the epoll instance, so increase the ref */
     descriptor_ref(epoll);
-    g_hash_table_insert(descriptor->epollListeners, &epoll->handle, epoll);
+    descriptor->epollListeners[descriptor->numEpollListeners++] = epoll;
 }
 
 void descriptor_removeEpollListener(Descriptor* descriptor, Descriptor* epoll) {
     MAGIC_ASSERT(descriptor);
-    /* this will automatically call descriptor_unref on the epoll instance */
-    g_hash_table_remove(descriptor->epollListeners, &epoll->handle);
+
+    for(guint i = 0; i < descriptor->numEpollListeners; i++) {
+        if(descriptor->epollListeners[i] == epoll) {
+            /* the order of the listeners doesn't matter */
+            descriptor->numEpollListeners--;
+            descriptor->epollListeners[i] = descriptor->epollListeners[descriptor->numEpollListeners];
+            descriptor_unref(epoll);
+            return;
+        }
+    }
 }
 
 gint descriptor_getFlags(Descriptor* descriptor) {
@@ -30,6 +30,10 @@ enum _DescriptorStatus {
     DS_CLOSED = 1 << 3,
 };
 
+/* most descriptors are watched by at most one epoll, so that many listeners
+ * are stored in the descriptor itself before we allocate an array */
+#define DESCRIPTOR_INLINE_LISTENERS 2
+
 typedef struct _Descriptor Descriptor;
 typedef struct _DescriptorFunctionTable DescriptorFunctionTable;
 
@@ -51,7 +55,17 @@ struct _Descriptor {
     gint handle;
     DescriptorType type;
     DescriptorStatus status;
-    GHashTable* epollListeners;
+    /* the status bits that flipped since our epoll listeners were last told,
+     * including the ones that flipped back */
+    DescriptorStatus toggledStatus;
+    /* TRUE if we are queued on the host to notify our listeners */
+    gboolean isNotificationPending;
+    /* the epolls watching us, pointing at inlineEpollListeners until more
+     * than DESCRIPTOR_INLINE_LISTENERS are added */
+    Descriptor** epollListeners;
+    guint numEpollListeners;
+    guint epollListenersCapacity;
+    Descriptor* inlineEpollListeners[DESCRIPTOR_INLINE_LISTENERS];
     gint referenceCount;
     gint flags;
     MAGIC_DECLARE;
@@ -67,7 +81,13 @@ gint descriptor_compare(const Descriptor* foo, const Descriptor* bar, gpointer u
 DescriptorType descriptor_getType(Descriptor* descriptor);
 gint* descriptor_getHandleReference(Descriptor* descriptor);
 
+/* epoll listeners are only told about changes of the status bits. while the
+ * active host batches status changes, they are told when the batch is flushed,
+ * along with all the bits that flipped in the meantime. */
 void descriptor_adjustStatus(Descriptor* descriptor, DescriptorStatus status, gboolean doSetBits);
+/* tells the epoll listeners about the current status, if any bits flipped
+ * since they were last told */
+void descriptor_flushStatus(Descriptor* descriptor);
 DescriptorStatus descriptor_getStatus(Descriptor* descriptor);
 
 void descriptor_addEpollListener(Descriptor* descriptor, Descriptor* epoll);
@@ -93,8 +93,21 @@ struct _Epoll {
     GHashTable* ready;
 
     Process* ownerProcess;
+
+    /* the application may want us to watch some system files, so we offload
+     * that task to a real OS epoll. the OS epoll fds are only created when the
+     * first OS file is registered, and are -1 until then. */
     gint osEpollChild;
     gint osEpollParent;
+    /* the number of OS files registered in the child, so we can skip asking
+     * the OS for events when there are none. files that the application
+     * closes without removing them first are still counted. */
+    guint numOSWatched;
+    /* the simulation time at which the OS last said it has events for us.
+     * the files stay ready until we collect the events or they change, so we
+     * don't ask the OS again at that time. the OS files can become ready at
+     * any time though, so we ask again whenever the OS said no. */
+    SimulationTime osReadyCheckTime;
 
     MAGIC_DECLARE;
 };
@@ -148,9 +161,15 @@ static void _epoll_free(Epoll* epoll) {
     g_hash_table_destroy(epoll->watching);
     g_hash_table_destroy(epoll->ready);
 
-    epoll_ctl(epoll->osEpollParent, EPOLL_CTL_DEL, epoll->osEpollChild, NULL);
-    close(epoll->osEpollChild);
-    close(epoll->osEpollParent);
+    if(epoll->osEpollParent >= 0 && epoll->osEpollChild >= 0) {
+        epoll_ctl(epoll->osEpollParent, EPOLL_CTL_DEL, epoll->osEpollChild, NULL);
+    }
+    if(epoll->osEpollChild >= 0) {
+        close(epoll->osEpollChild);
+    }
+    if(epoll->osEpollParent >= 0) {
+        close(epoll->osEpollParent);
+    }
 
     utility_assert(epoll->ownerProcess);
     process_unref(epoll->ownerProcess);
@@ -214,26 +233,10 @@ Epoll* epoll_new(gint handle) {
     epoll->watching = g_hash_table_new_full(g_int_hash, g_int_equal, NULL, (GDestroyNotify)_epollwatch_unref);
     epoll->ready = g_hash_table_new_full(g_int_hash, g_int_equal, NULL, (GDestroyNotify)_epollwatch_unref);
 
-    /* the application may want us to watch some system files, so we need a
-     * real OS epoll fd so we can offload that task.
-     */
-    epoll->osEpollParent = epoll_create(1);
-    if(epoll->osEpollParent == -1) {
-        warning("error in epoll_create for parent OS events, errno=%i msg:%s", errno, g_strerror(errno));
-    }
-    epoll->osEpollChild = epoll_create(1000);
-    if(epoll->osEpollChild == -1) {
-        warning("error in epoll_create for child OS events, errno=%i msg:%s", errno, g_strerror(errno));
-    } else {
-        struct epoll_event epoll_ev;
-        memset(&epoll_ev, 0, sizeof(struct epoll_event));
-        epoll_ev.events = EPOLLIN;
-        /* watch to see when child becomes ready */
-        gint res = epoll_ctl(epoll->osEpollParent, EPOLL_CTL_ADD, epoll->osEpollChild, &epoll_ev);
-        if(res != 0) {
-            warning("error in epoll_ctl for child OS events, errno=%i msg:%s", errno, g_strerror(errno));
-        }
-    }
+    /* the OS epoll is created when the application first needs it */
+    epoll->osEpollChild = -1;
+    epoll->osEpollParent = -1;
+    epoll->osReadyCheckTime = SIMTIME_INVALID;
 
     /* keep track of which virtual application we need to notify of events
     epoll_new should be called as a result of an application syscall */
@@ -249,7 +252,7 @@ Epoll* epoll_new(gint handle) {
     return epoll;
 }
 
-static void _epollwatch_updateStatus(EpollWatch* watch) {
+static void _epollwatch_updateStatus(EpollWatch* watch, DescriptorStatus toggled) {
     MAGIC_ASSERT(watch);
 
     /* store the old flags that are only lazily updated */
@@ -278,11 +281,13 @@ static void _epollwatch_updateStatus(EpollWatch* watch) {
     /* add back in our lazyFlags that we dont check separately */
     watch->flags |= lazyFlags;
 
-    /* update changed status for edgetrigger mode */
-    if((oldFlags & EWF_READABLE) != (watch->flags & EWF_READABLE)) {
+    /* update changed status for edgetrigger mode. the descriptor may have
+     * become unreadable and readable again since we last looked, which is a
+     * change even though the flag is the same. */
+    if((oldFlags & EWF_READABLE) != (watch->flags & EWF_READABLE) || (toggled & DS_READABLE)) {
         watch->flags |= EWF_READCHANGED;
     }
-    if((oldFlags & EWF_WRITEABLE) != (watch->flags & EWF_WRITEABLE)) {
+    if((oldFlags & EWF_WRITEABLE) != (watch->flags & EWF_WRITEABLE) || (toggled & DS_WRITABLE)) {
         watch->flags |= EWF_WRITECHANGED;
     }
 }
@@ -325,21 +330,64 @@ static gboolean _epollwatch_isReady(EpollWatch* watch) {
     return isReady;
 }
 
+static gboolean _epoll_createOS(Epoll* epoll) {
+    MAGIC_ASSERT(epoll);
+
+    if(epoll->osEpollChild >= 0) {
+        return TRUE;
+    }
+
+    epoll->osEpollParent = epoll_create(1);
+    if(epoll->osEpollParent == -1) {
+        warning("error in epoll_create for parent OS events, errno=%i msg:%s", errno, g_strerror(errno));
+        return FALSE;
+    }
+    epoll->osEpollChild = epoll_create(1000);
+    if(epoll->osEpollChild == -1) {
+        warning("error in epoll_create for child OS events, errno=%i msg:%s", errno, g_strerror(errno));
+        close(epoll->osEpollParent);
+        epoll->osEpollParent = -1;
+        return FALSE;
+    }
+
+    struct epoll_event epoll_ev;
+    memset(&epoll_ev, 0, sizeof(struct epoll_event));
+    epoll_ev.events = EPOLLIN;
+    /* watch to see when child becomes ready */
+    gint res = epoll_ctl(epoll->osEpollParent, EPOLL_CTL_ADD, epoll->osEpollChild, &epoll_ev);
+    if(res != 0) {
+        warning("error in epoll_ctl for child OS events, errno=%i msg:%s", errno, g_strerror(errno));
+    }
+
+    return TRUE;
+}
+
 static gboolean _epoll_isReadyOS(Epoll* epoll) {
     MAGIC_ASSERT(epoll);
 
+    /* most applications never register OS files, don't bother the OS then */
+    if(epoll->numOSWatched == 0) {
+        return FALSE;
+    }
+
+    SimulationTime now = worker_getCurrentTime();
+    if(now != SIMTIME_INVALID && now == epoll->osReadyCheckTime) {
+        return TRUE;
+    }
+
     /* the os epoll will be readable when ready */
     struct epoll_event epoll_ev;
     memset(&epoll_ev, 0, sizeof(struct epoll_event));
 
+    /* the parent is readable, which means the child has events we should collect */
     gint ret = epoll_wait(epoll->osEpollParent, &epoll_ev, 1, 0);
-    if(ret > 0 && epoll_ev.events == EPOLLIN) {
-        /* the parent is readable, which means the child has events we should collect */
-        return TRUE;
+    gboolean isReady = (ret > 0 && epoll_ev.events == EPOLLIN) ? TRUE : FALSE;
+
+    if(isReady) {
+        epoll->osReadyCheckTime = now;
     }
 
-    /* the os descriptor has no events */
-    return FALSE;
+    return isReady;
 }
 
 static void _epoll_scheduleNotification(Epoll* epoll) {
@@ -433,7 +481,7 @@ gint epoll_control(Epoll* epoll, gint operation, Descriptor* descriptor, struct
             descriptor_addEpollListener(watch->descriptor, (Descriptor*)epoll);
 
             /* initiate a callback if the new watched descriptor is ready */
-            epoll_descriptorStatusChanged(epoll, descriptor);
+            epoll_descriptorStatusChanged(epoll, descriptor, DS_NONE);
 
             break;
         }
@@ -454,7 +502,7 @@ gint epoll_control(Epoll* epoll, gint operation, Descriptor* descriptor, struct
             watch->flags &= ~EWF_ONESHOT_REPORTED;
 
             /* initiate a callback if the new event type on the watched descriptor is ready */
-            epoll_descriptorStatusChanged(epoll, descriptor);
+            epoll_descriptorStatusChanged(epoll, descriptor, DS_NONE);
 
             break;
         }
@@ -490,11 +538,26 @@ gint epoll_control(Epoll* epoll, gint operation, Descriptor* descriptor, struct
 gint epoll_controlOS(Epoll* epoll, gint operation, gint fileDescriptor,
         struct epoll_event* event) {
     MAGIC_ASSERT(epoll);
+
+    if(!_epoll_createOS(epoll)) {
+        return ENOMEM;
+    }
+
     /* ask the OS about any events on our kernel epoll descriptor */
     gint ret = epoll_ctl(epoll->osEpollChild, operation, fileDescriptor, event);
     if(ret < 0) {
-        ret = errno;
+        return errno;
     }
+
+    if(operation == EPOLL_CTL_ADD) {
+        epoll->numOSWatched++;
+    } else if(operation == EPOLL_CTL_DEL && epoll->numOSWatched > 0) {
+        epoll->numOSWatched--;
+    }
+
+    /* the registered files changed, so the OS needs to be asked again */
+    epoll->osReadyCheckTime = SIMTIME_INVALID;
+
     return ret;
 }
 
@@ -502,6 +565,13 @@ gint epoll_getEvents(Epoll* epoll, struct epoll_event* eventArray, gint eventArr
     MAGIC_ASSERT(epoll);
     utility_assert(nEvents);
 
+    /* the application may have changed the status of descriptors since the
+     * current event started, make sure our ready set reflects that */
+    Host* host = worker_getActiveHost();
+    if(host) {
+        host_flushDescriptorStatusBatch(host);
+    }
+
     /* return the available events in the eventArray, making sure not to
      * overflow. the number of actual events is returned in nEvents. */
     gint eventIndex = 0;
@@ -513,7 +583,12 @@ gint epoll_getEvents(Epoll* epoll, struct epoll_event* eventArray, gint eventArr
         EpollWatch* watch = value;
         MAGIC_ASSERT(watch);
 
-        if(_epollwatch_isReady(watch)) {
+        if(!_epollwatch_isReady(watch)) {
+            /* we only hear about status changes, so drop watches that stopped
+             * being ready without one (e.g., after reporting an ET event).
+             * every later flip of their status bits adds them back. */
+            g_hash_table_iter_remove(&iter);
+        } else {
             /* report the event */
             eventArray[eventIndex] = watch->event;
             eventArray[eventIndex].events = 0;
@@ -559,6 +634,9 @@ gint epoll_getEvents(Epoll* epoll, struct epoll_event* eventArray, gint eventArr
             warning("error in epoll_wait for OS events on epoll fd %i", epoll->osEpollChild);
         }
 
+        /* we may have collected all of the events, so the OS needs to be asked again */
+        epoll->osReadyCheckTime = SIMTIME_INVALID;
+
         /* nos will fit into eventArray */
         for(gint j = 0; j < nos; j++) {
             eventArray[eventIndex] = osEvents[j];
@@ -580,7 +658,7 @@ gint epoll_getEvents(Epoll* epoll, struct epoll_event* eventArray, gint eventArr
     return 0;
 }
 
-void epoll_descriptorStatusChanged(Epoll* epoll, Descriptor* descriptor) {
+void epoll_descriptorStatusChanged(Epoll* epoll, Descriptor* descriptor, DescriptorStatus toggled) {
     MAGIC_ASSERT(epoll);
 
     /* make sure we are actually watching the descriptor */
@@ -593,7 +671,7 @@ void epoll_descriptorStatusChanged(Epoll* epoll, Descriptor* descriptor) {
     debug("status changed in epoll %i for descriptor %i", epoll->super.handle, descriptor->handle);
 
     /* update the status for the child watch fd */
-    _epollwatch_updateStatus(watch);
+    _epollwatch_updateStatus(watch, toggled);
 
     /* check if its ready (has an event to report) now */
     if(_epollwatch_isReady(watch)) {
@@ -23,7 +23,9 @@ gint epoll_controlOS(Epoll* epoll, gint operation, gint fileDescriptor,
 gint epoll_getEvents(Epoll* epoll, struct epoll_event* eventArray,
         gint eventArrayLength, gint* nEvents);
 
-void epoll_descriptorStatusChanged(Epoll* epoll, Descriptor* descriptor);
+/* toggled holds the status bits that flipped since the last call, including
+ * bits that flipped back */
+void epoll_descriptorStatusChanged(Epoll* epoll, Descriptor* descriptor, DescriptorStatus toggled);
 void epoll_clearWatchListeners(Epoll* epoll);
 
 #endif /* SHD_EPOLL_H_ */
@@ -22,12 +22,14 @@
 #include "main/core/support/definitions.h"
 #include "main/core/support/object_counter.h"
 #include "main/core/support/options.h"
+#include "main/core/work/lazy_timer.h"
 #include "main/core/work/task.h"
 #include "main/core/worker.h"
 #include "main/host/descriptor/descriptor.h"
 #include "main/host/descriptor/socket.h"
 #include "main/host/descriptor/tcp_cong.h"
 #include "main/host/descriptor/tcp_cong_reno.h"
+#include "main/host/descriptor/tcp_retransmit_queue.h"
 #include "main/host/descriptor/tcp_retransmit_tally.h"
 #include "main/host/descriptor/transport.h"
 #include "main/host/host.h"
@@ -35,6 +37,7 @@
 #include "main/host/protocol.h"
 #include "main/host/tracker.h"
 #include "main/routing/address.h"
+#include "main/routing/payload.h"
 #include "main/utility/priority_queue.h"
 #include "main/utility/utility.h"
 #include "support/logger/logger.h"
@@ -166,7 +169,8 @@ struct _TCP {
         guint32 packetsSent;
         /* total number of quick acknowledgments sent */
         guint32 numQuickACKsSent;
-        gboolean delayedACKIsScheduled;
+        /* sends one ACK for all packets received before it expires */
+        LazyTimer* delayedACKTimer;
         guint32 delayedACKCounter;
         /* list of selective ACKs, packets received after a missing packet */
         GList* selectiveACKs;
@@ -174,15 +178,13 @@ struct _TCP {
 
     struct {
         /* TCP provides reliable transport, keep track of packets until they are acked */
-        GHashTable* queue;
+        RetransmitQueue* queue;
         /* track amount of queued application data */
         gsize queueLength;
         /* retransmission timeout value (rto), in milliseconds */
         gint timeout;
-        /* when the scheduled timer events will expire; empty if no retransmit is scheduled */
-        PriorityQueue* scheduledTimerExpirations;
-        /* our updated expiration time, to determine if previous events are still valid */
-        SimulationTime desiredTimerExpiration;
+        /* expires when the RTO is reached; disarmed if no retransmit is scheduled */
+        LazyTimer* timer;
         /* number of times we backed off due to congestion */
         guint backoffCount;
 
@@ -788,7 +790,10 @@ static void _tcp_updateSendWindow(TCP* tcp) {
     tcp->send.window = (guint32)MIN(tcp->cong.cwnd, (gint)tcp->receive.lastWindow);
 }
 
-static Packet* _tcp_createPacket(TCP* tcp, enum ProtocolTCPFlags flags, gconstpointer payload, gsize payloadLength) {
+/* the packet data is a view of payloadLength bytes at payloadOffset in the
+ * payload, which may be shared with the other segments of the same write */
+static Packet* _tcp_createPacket(TCP* tcp, enum ProtocolTCPFlags flags,
+        Payload* payload, gsize payloadOffset, gsize payloadLength) {
     MAGIC_ASSERT(tcp);
 
     /*
@@ -822,7 +827,8 @@ static Packet* _tcp_createPacket(TCP* tcp, enum ProtocolTCPFlags flags, gconstpo
 
     /* create the TCP packet. the ack, window, and timestamps will be set in _tcp_flush */
     Host* host = worker_getActiveHost();
-    Packet* packet = packet_new(payload, payloadLength, (guint)host_getID(host), host_getNewPacketID(host));
+    Packet* packet = packet_newWithPayloadView(payload, payloadOffset, payloadLength,
+            (guint)host_getID(host), host_getNewPacketID(host));
     packet_setTCP(packet, flags, sourceIP, sourcePort, destinationIP, destinationPort, sequence);
     packet_addDeliveryStatus(packet, PDS_SND_CREATED);
 
@@ -838,7 +844,7 @@ static void _tcp_sendControlPacket(TCP* tcp, enum ProtocolTCPFlags flags) {
     MAGIC_ASSERT(tcp);
 
     /* create the ack packet, without any payload data */
-    Packet* control = _tcp_createPacket(tcp, flags, NULL, 0);
+    Packet* control = _tcp_createPacket(tcp, flags, NULL, 0, 0);
 
     /* make sure it gets sent before whatever else is in the queue */
     packet_setPriority(control, 0.0);
@@ -855,12 +861,10 @@ static void _tcp_addRetransmit(TCP* tcp, Packet* packet) {
     MAGIC_ASSERT(tcp);
 
     PacketTCPHeader* header = packet_getTCPHeader(packet);
-    gpointer key = GINT_TO_POINTER(header->sequence);
 
     /* if it is already in the queue, it won't consume another packet reference */
-    if(g_hash_table_lookup(tcp->retransmit.queue, key) == NULL) {
+    if(retransmitqueue_insert(tcp->retransmit.queue, header->sequence, packet)) {
         /* its not in the queue yet */
-        g_hash_table_insert(tcp->retransmit.queue, key, packet);
         packet_ref(packet);
 
         packet_addDeliveryStatus(packet, PDS_SND_TCP_ENQUEUE_RETRANSMIT);
@@ -872,109 +876,45 @@ static void _tcp_addRetransmit(TCP* tcp, Packet* packet) {
     }
 }
 
-/* remove all packets with a sequence number less than the sequence parameter */
-static void _tcp_clearRetransmit(TCP* tcp, guint sequence) {
-    MAGIC_ASSERT(tcp);
-
-    GHashTableIter iter;
-    gpointer key, value;
-    g_hash_table_iter_init(&iter, tcp->retransmit.queue);
-
-    while(g_hash_table_iter_next(&iter, &key, &value)) {
-        guint ackedSequence = GPOINTER_TO_INT(key);
-        Packet* ackedPacket = (Packet*)value;
-
-        if(ackedSequence < sequence) {
-            tcp->retransmit.queueLength -= packet_getPayloadLength(ackedPacket);
-            packet_addDeliveryStatus(ackedPacket, PDS_SND_TCP_DEQUEUE_RETRANSMIT);
-            g_hash_table_iter_remove(&iter);
-        }
-    }
-
-    if(_tcp_getBufferSpaceOut(tcp) > 0) {
-        descriptor_adjustStatus((Descriptor*)tcp, DS_WRITABLE, TRUE);
-    }
+static void _tcp_onRetransmitDequeued(Packet* packet, TCP* tcp) {
+    tcp->retransmit.queueLength -= packet_getPayloadLength(packet);
+    packet_addDeliveryStatus(packet, PDS_SND_TCP_DEQUEUE_RETRANSMIT);
 }
 
 /* Remove packets in the half-open interval [begin, end) */
 static void _tcp_clearRetransmitRange(TCP* tcp, guint begin, guint end) {
     MAGIC_ASSERT(tcp);
 
-
-    for (uint32_t seq = begin; seq < end; ++seq) {
-        Packet *packet = g_hash_table_lookup(tcp->retransmit.queue,
-                                             GINT_TO_POINTER(seq));
-
-        if (packet != NULL) {
-            tcp->retransmit.queueLength -= packet_getPayloadLength(packet);
-            packet_addDeliveryStatus(packet, PDS_SND_TCP_DEQUEUE_RETRANSMIT);
-            bool success = g_hash_table_remove(tcp->retransmit.queue,
-                                               GINT_TO_POINTER(seq));
-            utility_assert(success);
-        }
-    }
+    retransmitqueue_removeRange(tcp->retransmit.queue, begin, end,
+            (RetransmitQueueRemoveFunc)_tcp_onRetransmitDequeued, tcp);
 
     if(_tcp_getBufferSpaceOut(tcp) > 0) {
         descriptor_adjustStatus((Descriptor*)tcp, DS_WRITABLE, TRUE);
     }
 }
 
-// XXX forward declaration
-static void _tcp_runRetransmitTimerExpiredTask(TCP* tcp, gpointer userData);
-
-static void _tcp_scheduleRetransmitTimer(TCP* tcp, SimulationTime now, SimulationTime delay) {
-    MAGIC_ASSERT(tcp);
-
-    SimulationTime* expireTimePtr = g_new0(SimulationTime, 1);
-    *expireTimePtr = now + delay;
-    gboolean success = priorityqueue_push(tcp->retransmit.scheduledTimerExpirations, expireTimePtr);
-
-    if(success) {
-        descriptor_ref(tcp);
-        Task* retexpTask = task_new((TaskCallbackFunc)_tcp_runRetransmitTimerExpiredTask,
-                tcp, NULL, descriptor_unref, NULL);
-        worker_scheduleTask(retexpTask, delay);
-        task_unref(retexpTask);
-
-        debug("%s retransmit timer scheduled for %"G_GUINT64_FORMAT" ns",
-                tcp->super.boundString, *expireTimePtr);
-    } else {
-        warning("%s could not schedule a retransmit timer for %"G_GUINT64_FORMAT" ns",
-                tcp->super.boundString, *expireTimePtr);
-        g_free(expireTimePtr);
-    }
-}
-
-static void _tcp_scheduleRetransmitTimerIfNeeded(TCP* tcp, SimulationTime now) {
-    /* logic for scheduling retransmission events. we only need to schedule one if
-     * we have no events that will allow us to schedule one later. */
-    SimulationTime* nextTimePtr = priorityqueue_peek(tcp->retransmit.scheduledTimerExpirations);
-    if(nextTimePtr && *nextTimePtr <= tcp->retransmit.desiredTimerExpiration) {
-        /* another event will fire before the RTO expires, check again then */
-        return;
-    }
-
-    /* no existing timer will expire as early as desired */
-    SimulationTime delay = tcp->retransmit.desiredTimerExpiration - now;
-    _tcp_scheduleRetransmitTimer(tcp, now, delay);
+/* remove all packets with a sequence number less than the sequence parameter */
+static void _tcp_clearRetransmit(TCP* tcp, guint sequence) {
+    _tcp_clearRetransmitRange(tcp, 0, sequence);
 }
 
 static void _tcp_setRetransmitTimer(TCP* tcp, SimulationTime now) {
     MAGIC_ASSERT(tcp);
 
     /* our retransmission timer needs to change
-     * track the new expiration time based on the current RTO */
+     * track the new expiration time based on the current RTO. the timer only
+     * schedules an event if the one it has pending would fire too late. */
     SimulationTime delay = tcp->retransmit.timeout * SIMTIME_ONE_MILLISECOND;
-    tcp->retransmit.desiredTimerExpiration = now + delay;
+    lazytimer_arm(tcp->retransmit.timer, now + delay);
 
-    _tcp_scheduleRetransmitTimerIfNeeded(tcp, now);
+    debug("%s retransmit timer set to expire at %"G_GUINT64_FORMAT" ns",
+            tcp->super.boundString, now + delay);
 }
 
 static void _tcp_stopRetransmitTimer(TCP* tcp) {
     MAGIC_ASSERT(tcp);
-    /* we want to stop the timer. since there may be an event already scheduled,
-     * lets mark our desired time as 0 so we know to cancel when the event fires. */
-    tcp->retransmit.desiredTimerExpiration = 0;
+    /* a pending event will find the timer disarmed when it fires */
+    lazytimer_disarm(tcp->retransmit.timer);
 
     debug("%s retransmit timer disabled", tcp->super.boundString);
 }
@@ -1027,7 +967,8 @@ static void _tcp_updateRTTEstimate(TCP* tcp, SimulationTime timestamp) {
 static void _tcp_retransmitPacket(TCP* tcp, gint sequence) {
     MAGIC_ASSERT(tcp);
 
-    Packet* packet = g_hash_table_lookup(tcp->retransmit.queue, GINT_TO_POINTER(sequence));
+    /* remove from queue, which means that the packet ref count is not decremented */
+    Packet* packet = retransmitqueue_steal(tcp->retransmit.queue, (guint)sequence);
     /* if packet wasn't found is was most likely retransmitted from a previous SACK
      * but has yet to be received/acknowledged by the receiver */
     if(!packet) {
@@ -1040,10 +981,6 @@ static void _tcp_retransmitPacket(TCP* tcp, gint sequence) {
     debug("retransmitting packet %d", sequence);
     // fprintf(stderr, "R- retransmitting packet %d with ts %llu\n", sequence, hdr.timestampValue);
 
-    /* remove from queue and update length and status.
-     * calling steal means that the packet ref count is not decremented */
-    g_hash_table_steal(tcp->retransmit.queue, GINT_TO_POINTER(sequence));
-
     /* update queue length and status */
     tcp->retransmit.queueLength -= packet_getPayloadLength(packet);
     packet_addDeliveryStatus(packet, PDS_SND_TCP_DEQUEUE_RETRANSMIT);
@@ -1078,7 +1015,7 @@ static void _tcp_sendShutdownFin(TCP* tcp) {
 
     if(sendFin) {
         /* send a fin */
-        Packet* fin = _tcp_createPacket(tcp, PTCP_FIN, NULL, 0);
+        Packet* fin = _tcp_createPacket(tcp, PTCP_FIN, NULL, 0, 0);
         _tcp_bufferPacketOut(tcp, fin);
         _tcp_flush(tcp);
 
@@ -1112,7 +1049,7 @@ void tcp_networkInterfaceIsAboutToSendPacket(TCP* tcp, Packet* packet) {
         _tcp_addRetransmit(tcp, packet);
 
         /* start retransmit timer if its not running (rfc 6298, section 5.1) */
-        if(!tcp->retransmit.desiredTimerExpiration) {
+        if(!lazytimer_isArmed(tcp->retransmit.timer)) {
             _tcp_setRetransmitTimer(tcp, now);
         }
     }
@@ -1277,14 +1214,10 @@ static void _tcp_flush(TCP* tcp) {
     }
 }
 
-static void _tcp_runRetransmitTimerExpiredTask(TCP* tcp, gpointer userData) {
+static void _tcp_onRetransmitTimerExpired(TCP* tcp) {
     MAGIC_ASSERT(tcp);
 
-    /* a timer expired, update our timer tracking state */
     SimulationTime now = worker_getCurrentTime();
-    SimulationTime* scheduledTimerExpirationPtr = priorityqueue_pop(tcp->retransmit.scheduledTimerExpirations);
-    utility_assert(scheduledTimerExpirationPtr);
-    g_free(scheduledTimerExpirationPtr);
 
     debug("%s a scheduled retransmit timer expired", tcp->super.boundString);
 
@@ -1295,18 +1228,7 @@ static void _tcp_runRetransmitTimerExpiredTask(TCP* tcp, gpointer userData) {
         return;
     }
 
-    if(g_hash_table_size(tcp->retransmit.queue) == 0) {
-        _tcp_stopRetransmitTimer(tcp);
-        return;
-    }
-
-    /* if the timer should be off or was reset, ignore this event */
-    if(tcp->retransmit.desiredTimerExpiration == 0) {
-        return;
-    } else if(tcp->retransmit.desiredTimerExpiration > now) {
-        /* the timer was reset after this event was scheduled, check if we need to
-         * schedule another event, or if we can do it when the next event fires instead */
-        _tcp_scheduleRetransmitTimerIfNeeded(tcp, now);
+    if(retransmitqueue_isEmpty(tcp->retransmit.queue)) {
         return;
     }
 
@@ -1764,9 +1686,8 @@ static void _tcp_logCongestionInfo(TCP* tcp) {
             tcp->super.super.super.handle);
 }
 
-static void _tcp_sendACKTaskCallback(TCP* tcp, gpointer userData) {
+static void _tcp_onDelayedACKTimerExpired(TCP* tcp) {
     MAGIC_ASSERT(tcp);
-    tcp->send.delayedACKIsScheduled = FALSE;
     if(tcp->send.delayedACKCounter > 0) {
         _tcp_sendControlPacket(tcp, PTCP_ACK);
         tcp->send.delayedACKCounter = 0;
@@ -2011,14 +1932,9 @@ void tcp_processPacket(TCP* tcp, Packet* packet) {
         return;
     }
 
-    GList* selectiveACKs = packet_copyTCPSelectiveACKs(packet);
-
-    if (selectiveACKs) {
-       retransmit_tally_mark_sacked(tcp->retransmit.tally, selectiveACKs);
-    }
-
-    if(selectiveACKs) {
-        g_list_free(selectiveACKs);
+    for(guint i = 0; i < header->numSelectiveACKs; i++) {
+        retransmit_tally_mark_sacked(tcp->retransmit.tally,
+                header->selectiveACKs[i].begin, header->selectiveACKs[i].end);
     }
 
     /* update the last time stamp value (RFC 1323) */
@@ -2063,13 +1979,9 @@ void tcp_processPacket(TCP* tcp, Packet* packet) {
             /* just send the response now */
             _tcp_sendControlPacket(tcp, responseFlags);
         } else {
-            if(tcp->send.delayedACKIsScheduled == FALSE) {
-                /* we need to send an ACK, lets schedule a task so we don't send an ACK
+            if(!lazytimer_isArmed(tcp->send.delayedACKTimer)) {
+                /* we need to send an ACK, lets delay it so we don't send an ACK
                  * for all packets that are received during this same simtime receiving round. */
-                Task* sendACKTask = task_new((TaskCallbackFunc)_tcp_sendACKTaskCallback,
-                                tcp, NULL, descriptor_unref, NULL);
-                /* taks holds a ref to tcp */
-                descriptor_ref(tcp);
 
                 /* figure out what we should use as delay */
                 SimulationTime delay = 0;
@@ -2082,10 +1994,7 @@ void tcp_processPacket(TCP* tcp, Packet* packet) {
                     delay = 5*SIMTIME_ONE_MILLISECOND;
                 }
 
-                worker_scheduleTask(sendACKTask, delay);
-                task_unref(sendACKTask);
-
-                tcp->send.delayedACKIsScheduled = TRUE;
+                lazytimer_arm(tcp->send.delayedACKTimer, worker_getCurrentTime() + delay);
             }
             tcp->send.delayedACKCounter++;
         }
@@ -2144,7 +2053,13 @@ gssize tcp_sendUserData(TCP* tcp, gconstpointer buffer, gsize nBytes, in_addr_t
     gsize space = _tcp_getBufferSpaceOut(tcp);
     gsize remaining = MIN(acceptable, space);
 
-    /* break data into segments and send each in a packet */
+    /* copy the whole write into one payload, and break it into segments that
+     * each send a view of the payload in a packet. the receiver copies the data
+     * straight out of the payload, so it is only copied once in each direction.
+     * the payload is only freed once every segment was acked and read, so a
+     * single unacked or unread segment keeps the whole write (at most 64 KiB
+     * as per the limit above) in memory, which the buffer sizes don't count. */
+    Payload* payload = remaining > 0 ? payload_new(buffer, remaining) : NULL;
     gsize maxPacketLength = CONFIG_MTU - CONFIG_HEADER_SIZE_TCPIPETH;
     gsize bytesCopied = 0;
 
@@ -2153,7 +2068,7 @@ gssize tcp_sendUserData(TCP* tcp, gconstpointer buffer, gsize nBytes, in_addr_t
         gsize copyLength = MIN(maxPacketLength, remaining);
 
         /* use helper to create the packet */
-        Packet* packet = _tcp_createPacket(tcp, PTCP_ACK, buffer + bytesCopied, copyLength);
+        Packet* packet = _tcp_createPacket(tcp, PTCP_ACK, payload, bytesCopied, copyLength);
         if(copyLength > 0) {
             /* we are sending more user data */
             tcp->send.end++;
@@ -2169,6 +2084,11 @@ gssize tcp_sendUserData(TCP* tcp, gconstpointer buffer, gsize nBytes, in_addr_t
         bytesCopied += copyLength;
     }
 
+    /* the packets hold their own refs to the payload */
+    if(payload) {
+        payload_unref(payload);
+    }
+
     debug("%s <-> %s: sending %"G_GSIZE_FORMAT" user bytes", tcp->super.boundString, tcp->super.peerString, bytesCopied);
 
     /* now flush as much as possible out to socket */
@@ -2331,8 +2251,9 @@ void tcp_free(TCP* tcp) {
 
     priorityqueue_free(tcp->throttledOutput);
     priorityqueue_free(tcp->unorderedInput);
-    g_hash_table_destroy(tcp->retransmit.queue);
-    priorityqueue_free(tcp->retransmit.scheduledTimerExpirations);
+    retransmitqueue_free(tcp->retransmit.queue);
+    lazytimer_free(tcp->retransmit.timer);
+    lazytimer_free(tcp->send.delayedACKTimer);
 
     if(tcp->child) {
         MAGIC_ASSERT(tcp->child);
@@ -2496,13 +2417,15 @@ TCP* tcp_new(gint handle, guint receiveBufferSize, guint sendBufferSize) {
             priorityqueue_new((GCompareDataFunc)packet_compareTCPSequence, NULL, (GDestroyNotify)packet_unref);
     tcp->unorderedInput =
             priorityqueue_new((GCompareDataFunc)packet_compareTCPSequence, NULL, (GDestroyNotify)packet_unref);
-    tcp->retransmit.queue =
-            g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)packet_unref);
+    tcp->retransmit.queue = retransmitqueue_new((GDestroyNotify)packet_unref);
 
     retransmit_tally_init(&tcp->retransmit.tally);
 
-    tcp->retransmit.scheduledTimerExpirations =
-            priorityqueue_new((GCompareDataFunc)utility_simulationTimeCompare, NULL, g_free);
+    /* pending timer events hold a reference to the tcp */
+    tcp->retransmit.timer = lazytimer_new((LazyTimerExpiredFunc)_tcp_onRetransmitTimerExpired,
+            tcp, descriptor_ref, descriptor_unref);
+    tcp->send.delayedACKTimer = lazytimer_new((LazyTimerExpiredFunc)_tcp_onDelayedACKTimerExpired,
+            tcp, descriptor_ref, descriptor_unref);
 
     /* initialize tcp retransmission timeout */
     _tcp_setRetransmitTimeout(tcp, CONFIG_TCP_RTO_INIT);
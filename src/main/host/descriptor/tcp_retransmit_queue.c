@@ -0,0 +1,222 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/host/descriptor/tcp_retransmit_queue.h"
+
+#include <glib.h>
+
+#include "main/utility/utility.h"
+
+/* must be a power of 2 */
+#define RETRANSMIT_QUEUE_INITIAL_CAPACITY 64
+
+struct _RetransmitQueue {
+    /* circular array of values, NULL where a sequence number is not queued.
+     * slots outside of the covered span are always NULL. */
+    gpointer* slots;
+    /* number of slots, always a power of 2 */
+    guint capacity;
+    /* the slot holding firstSequence */
+    guint head;
+    /* the lowest queued sequence number, if the queue is not empty */
+    guint firstSequence;
+    /* number of sequence numbers covered, from firstSequence to the highest
+     * queued sequence number */
+    guint span;
+    /* number of queued values */
+    guint length;
+
+    GDestroyNotify valueDestroyFunc;
+
+    MAGIC_DECLARE;
+};
+
+RetransmitQueue* retransmitqueue_new(GDestroyNotify valueDestroyFunc) {
+    RetransmitQueue* queue = g_new0(RetransmitQueue, 1);
+    MAGIC_INIT(queue);
+
+    queue->capacity = RETRANSMIT_QUEUE_INITIAL_CAPACITY;
+    queue->slots = g_new0(gpointer, queue->capacity);
+    queue->valueDestroyFunc = valueDestroyFunc;
+
+    return queue;
+}
+
+static inline guint _retransmitqueue_getSlot(RetransmitQueue* queue, guint offset) {
+    return (queue->head + offset) & (queue->capacity - 1);
+}
+
+void retransmitqueue_free(RetransmitQueue* queue) {
+    MAGIC_ASSERT(queue);
+
+    if(queue->valueDestroyFunc) {
+        for(guint offset = 0; offset < queue->span; offset++) {
+            gpointer value = queue->slots[_retransmitqueue_getSlot(queue, offset)];
+            if(value) {
+                queue->valueDestroyFunc(value);
+            }
+        }
+    }
+
+    g_free(queue->slots);
+
+    MAGIC_CLEAR(queue);
+    g_free(queue);
+}
+
+/* make room for at least minCapacity slots, keeping the covered span in order */
+static void _retransmitqueue_grow(RetransmitQueue* queue, guint minCapacity) {
+    guint newCapacity = queue->capacity;
+    while(newCapacity < minCapacity) {
+        newCapacity *= 2;
+    }
+    if(newCapacity == queue->capacity) {
+        return;
+    }
+
+    gpointer* newSlots = g_new0(gpointer, newCapacity);
+    for(guint offset = 0; offset < queue->span; offset++) {
+        newSlots[offset] = queue->slots[_retransmitqueue_getSlot(queue, offset)];
+    }
+
+    g_free(queue->slots);
+    queue->slots = newSlots;
+    queue->capacity = newCapacity;
+    queue->head = 0;
+}
+
+/* drop the empty slots at both ends of the span */
+static void _retransmitqueue_trim(RetransmitQueue* queue) {
+    while(queue->span > 0 && queue->slots[queue->head] == NULL) {
+        queue->head = _retransmitqueue_getSlot(queue, 1);
+        queue->firstSequence++;
+        queue->span--;
+    }
+    while(queue->span > 0 && queue->slots[_retransmitqueue_getSlot(queue, queue->span - 1)] == NULL) {
+        queue->span--;
+    }
+}
+
+gboolean retransmitqueue_insert(RetransmitQueue* queue, guint sequence, gpointer value) {
+    MAGIC_ASSERT(queue);
+    utility_assert(value);
+
+    if(queue->length == 0) {
+        queue->head = 0;
+        queue->firstSequence = sequence;
+        queue->span = 0;
+    }
+
+    if(sequence >= queue->firstSequence) {
+        guint offset = sequence - queue->firstSequence;
+
+        if(offset < queue->span) {
+            guint slot = _retransmitqueue_getSlot(queue, offset);
+            if(queue->slots[slot] != NULL) {
+                return FALSE;
+            }
+            queue->slots[slot] = value;
+        } else {
+            _retransmitqueue_grow(queue, offset + 1);
+            queue->slots[_retransmitqueue_getSlot(queue, offset)] = value;
+            queue->span = offset + 1;
+        }
+    } else {
+        /* e.g., a packet that was taken out for a retransmission comes back
+         * after the packets before it were acked */
+        guint shift = queue->firstSequence - sequence;
+
+        _retransmitqueue_grow(queue, queue->span + shift);
+        queue->head = (queue->head - shift) & (queue->capacity - 1);
+        queue->firstSequence = sequence;
+        queue->span += shift;
+        queue->slots[queue->head] = value;
+    }
+
+    queue->length++;
+    return TRUE;
+}
+
+static gpointer* _retransmitqueue_getReference(RetransmitQueue* queue, guint sequence) {
+    if(queue->length == 0 || sequence < queue->firstSequence) {
+        return NULL;
+    }
+
+    guint offset = sequence - queue->firstSequence;
+    if(offset >= queue->span) {
+        return NULL;
+    }
+
+    return &queue->slots[_retransmitqueue_getSlot(queue, offset)];
+}
+
+gpointer retransmitqueue_lookup(RetransmitQueue* queue, guint sequence) {
+    MAGIC_ASSERT(queue);
+    gpointer* reference = _retransmitqueue_getReference(queue, sequence);
+    return reference ? *reference : NULL;
+}
+
+gpointer retransmitqueue_steal(RetransmitQueue* queue, guint sequence) {
+    MAGIC_ASSERT(queue);
+
+    gpointer* reference = _retransmitqueue_getReference(queue, sequence);
+    if(!reference || !*reference) {
+        return NULL;
+    }
+
+    gpointer value = *reference;
+    *reference = NULL;
+    queue->length--;
+    _retransmitqueue_trim(queue);
+
+    return value;
+}
+
+guint retransmitqueue_removeRange(RetransmitQueue* queue, guint begin, guint end,
+        RetransmitQueueRemoveFunc removeFunc, gpointer userData) {
+    MAGIC_ASSERT(queue);
+
+    if(queue->length == 0 || end <= begin) {
+        return 0;
+    }
+
+    /* only the part of the range that the queue covers can hold values */
+    guint64 coveredEnd = (guint64)queue->firstSequence + queue->span;
+    guint64 rangeBegin = MAX((guint64)begin, (guint64)queue->firstSequence);
+    guint64 rangeEnd = MIN((guint64)end, coveredEnd);
+
+    guint numRemoved = 0;
+    for(guint64 sequence = rangeBegin; sequence < rangeEnd; sequence++) {
+        guint slot = _retransmitqueue_getSlot(queue, (guint)(sequence - queue->firstSequence));
+        gpointer value = queue->slots[slot];
+
+        if(value) {
+            queue->slots[slot] = NULL;
+            queue->length--;
+            numRemoved++;
+
+            if(removeFunc) {
+                removeFunc(value, userData);
+            }
+            if(queue->valueDestroyFunc) {
+                queue->valueDestroyFunc(value);
+            }
+        }
+    }
+
+    _retransmitqueue_trim(queue);
+
+    return numRemoved;
+}
+
+guint retransmitqueue_getLength(RetransmitQueue* queue) {
+    MAGIC_ASSERT(queue);
+    return queue->length;
+}
+
+gboolean retransmitqueue_isEmpty(RetransmitQueue* queue) {
+    MAGIC_ASSERT(queue);
+    return queue->length == 0 ? TRUE : FALSE;
+}
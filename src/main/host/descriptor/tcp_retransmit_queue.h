@@ -0,0 +1,51 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_TCP_RETRANSMIT_QUEUE_H_
+#define SHD_TCP_RETRANSMIT_QUEUE_H_
+
+#include <glib.h>
+
+/**
+ * Holds the packets that TCP sent but that were not acknowledged yet, indexed
+ * by their sequence number. Shadow numbers TCP packets consecutively, so the
+ * queue is a circular array that covers the sequence numbers from the lowest
+ * one in the queue to the highest one. Sequence numbers that are not in the
+ * queue (e.g., packets that were taken out for a retransmission) leave empty
+ * slots behind.
+ *
+ * Looking up, adding or taking out a packet is O(1). Removing the packets that
+ * a cumulative or selective ACK covers only touches the slots of the acked
+ * range, instead of every packet in the queue.
+ */
+
+typedef struct _RetransmitQueue RetransmitQueue;
+
+/* called for each value that retransmitqueue_removeRange removes, before the
+ * value is destroyed */
+typedef void (*RetransmitQueueRemoveFunc)(gpointer value, gpointer userData);
+
+/* valueDestroyFunc (may be NULL) is called on values that the queue drops */
+RetransmitQueue* retransmitqueue_new(GDestroyNotify valueDestroyFunc);
+void retransmitqueue_free(RetransmitQueue* queue);
+
+/* the queue takes ownership of value. returns FALSE and leaves the queue
+ * unchanged if a value with the same sequence number is already queued. */
+gboolean retransmitqueue_insert(RetransmitQueue* queue, guint sequence, gpointer value);
+/* returns the value with the given sequence number, or NULL */
+gpointer retransmitqueue_lookup(RetransmitQueue* queue, guint sequence);
+/* removes the value with the given sequence number and returns it without
+ * destroying it, or returns NULL if there is no such value */
+gpointer retransmitqueue_steal(RetransmitQueue* queue, guint sequence);
+/* removes and destroys all values with a sequence number in [begin, end), and
+ * returns how many were removed. removeFunc (may be NULL) is called on each. */
+guint retransmitqueue_removeRange(RetransmitQueue* queue, guint begin, guint end,
+        RetransmitQueueRemoveFunc removeFunc, gpointer userData);
+
+/* the number of queued values */
+guint retransmitqueue_getLength(RetransmitQueue* queue);
+gboolean retransmitqueue_isEmpty(RetransmitQueue* queue);
+
+#endif /* SHD_TCP_RETRANSMIT_QUEUE_H_ */
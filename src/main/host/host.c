@@ -76,6 +76,11 @@ struct _Host {
     /* all file, socket, and epoll descriptors we know about and track */
     GHashTable* descriptors;
 
+    /* while an event runs, descriptors whose status changed are queued here
+     * (holding a ref) and tell their epoll listeners once the event is done */
+    GQueue* changedDescriptors;
+    gboolean isBatchingDescriptorStatus;
+
     /* map from the descriptor handle we returned to the plug-in, and
      * descriptor handle that the OS gave us for files, etc.
      * We do this so that we can give out low descriptor numbers even though the OS
@@ -98,6 +103,13 @@ struct _Host {
     /* track the time spent executing this host */
     GTimer* executionTimer;
 
+    /* the minimum delay of any packet this host sends to another host, or 0 if unknown.
+     * this is set before the simulation starts and is read-only afterwards. */
+    SimulationTime lookahead;
+
+    /* the scheduler policy's per-host state, so it doesn't need to look it up */
+    gpointer schedulerData;
+
     gchar* dataDirPath;
 
     gint referenceCount;
@@ -137,6 +149,7 @@ Host* host_new(HostParameters* params) {
 
     /* virtual descriptor management */
     host->descriptors = g_hash_table_new_full(g_int_hash, g_int_equal, NULL, descriptor_unref);
+    host->changedDescriptors = g_queue_new();
     host->shadowToOSHandleMap = g_hash_table_new(g_direct_hash, g_direct_equal);
     host->osToShadowHandleMap = g_hash_table_new(g_direct_hash, g_direct_equal);
     host->randomShadowHandleMap = g_hash_table_new(g_direct_hash, g_direct_equal);
@@ -192,9 +205,11 @@ void host_setup(Host* host, DNS* dns, Topology* topology, guint rawCPUFreq, cons
 
     /* virtual addresses and interfaces for managing network I/O */
     NetworkInterface* loopback = networkinterface_new(loopbackAddress, G_MAXUINT32, G_MAXUINT32,
-            host->params.logPcap, host->params.pcapDir, host->params.qdisc, host->params.interfaceBufSize);
+            host->params.logPcap, host->params.pcapDir, host->params.qdisc, host->params.refillMode,
+            host->params.interfaceBufSize);
     NetworkInterface* ethernet = networkinterface_new(ethernetAddress, bwDownKiBps, bwUpKiBps,
-            host->params.logPcap, host->params.pcapDir, host->params.qdisc, host->params.interfaceBufSize);
+            host->params.logPcap, host->params.pcapDir, host->params.qdisc, host->params.refillMode,
+            host->params.interfaceBufSize);
 
     g_hash_table_replace(host->interfaces, GUINT_TO_POINTER((guint)address_toNetworkIP(ethernetAddress)), ethernet);
     g_hash_table_replace(host->interfaces, GUINT_TO_POINTER((guint)htonl(INADDR_LOOPBACK)), loopback);
@@ -271,6 +286,11 @@ void host_shutdown(Host* host) {
         g_hash_table_destroy(host->descriptors);
     }
 
+    if(host->changedDescriptors) {
+        /* we never batch outside of events, so this should be empty */
+        g_queue_free_full(host->changedDescriptors, descriptor_unref);
+    }
+
     if(host->shadowToOSHandleMap) {
         g_hash_table_destroy(host->shadowToOSHandleMap);
     }
@@ -345,6 +365,40 @@ void host_unlock(Host* host) {
     g_mutex_unlock(&(host->lock));
 }
 
+void host_beginDescriptorStatusBatch(Host* host) {
+    MAGIC_ASSERT(host);
+    host->isBatchingDescriptorStatus = TRUE;
+}
+
+gboolean host_batchDescriptorStatus(Host* host, Descriptor* descriptor) {
+    MAGIC_ASSERT(host);
+
+    if(!host->isBatchingDescriptorStatus) {
+        return FALSE;
+    }
+
+    descriptor_ref(descriptor);
+    g_queue_push_tail(host->changedDescriptors, descriptor);
+    return TRUE;
+}
+
+void host_flushDescriptorStatusBatch(Host* host) {
+    MAGIC_ASSERT(host);
+
+    /* notifying listeners may change more statuses, which are queued again */
+    Descriptor* descriptor = NULL;
+    while((descriptor = g_queue_pop_head(host->changedDescriptors)) != NULL) {
+        descriptor_flushStatus(descriptor);
+        descriptor_unref(descriptor);
+    }
+}
+
+void host_endDescriptorStatusBatch(Host* host) {
+    MAGIC_ASSERT(host);
+    host_flushDescriptorStatusBatch(host);
+    host->isBatchingDescriptorStatus = FALSE;
+}
+
 /* resumes the execution timer for this host */
 void host_continueExecutionTimer(Host* host) {
     MAGIC_ASSERT(host);
@@ -373,7 +427,8 @@ void host_boot(Host* host) {
     MAGIC_ASSERT(host);
 
     /* must be done after the default IP exists so tracker_heartbeat works */
-    host->tracker = tracker_new(host->params.heartbeatInterval, host->params.heartbeatLogLevel, host->params.heartbeatLogInfo);
+    host->tracker = tracker_new(host->params.heartbeatInterval, host->params.heartbeatLogLevel,
+            host->params.heartbeatLogInfo, host->params.nodeSeed);
 
     /* start refilling the token buckets for all interfaces */
     GHashTableIter iter;
@@ -479,6 +534,26 @@ Random* host_getRandom(Host* host) {
     return host->random;
 }
 
+void host_setLookahead(Host* host, SimulationTime lookahead) {
+    MAGIC_ASSERT(host);
+    host->lookahead = lookahead;
+}
+
+SimulationTime host_getLookahead(Host* host) {
+    MAGIC_ASSERT(host);
+    return host->lookahead;
+}
+
+void host_setSchedulerData(Host* host, gpointer schedulerData) {
+    MAGIC_ASSERT(host);
+    host->schedulerData = schedulerData;
+}
+
+gpointer host_getSchedulerData(Host* host) {
+    MAGIC_ASSERT(host);
+    return host->schedulerData;
+}
+
 gboolean host_autotuneReceiveBuffer(Host* host) {
     MAGIC_ASSERT(host);
     return host->params.autotuneRecvBuf;
@@ -52,6 +52,7 @@ struct _HostParameters {
     gboolean logPcap;
     gchar* pcapDir;
     QDiscMode qdisc;
+    RefillMode refillMode;
     guint64 recvBufSize;
     gboolean autotuneRecvBuf;
     guint64 sendBufSize;
@@ -66,6 +67,15 @@ void host_unref(Host* host);
 void host_lock(Host* host);
 void host_unlock(Host* host);
 
+/* while a batch is open, descriptors that change status wait until the batch
+ * is flushed or ended to tell their epoll listeners, so a listener hears about
+ * each descriptor once no matter how often its status flipped in between */
+void host_beginDescriptorStatusBatch(Host* host);
+/* returns FALSE if no batch is open, otherwise queues the descriptor */
+gboolean host_batchDescriptorStatus(Host* host, Descriptor* descriptor);
+void host_flushDescriptorStatusBatch(Host* host);
+void host_endDescriptorStatusBatch(Host* host);
+
 void host_continueExecutionTimer(Host* host);
 void host_stopExecutionTimer(Host* host);
 gdouble host_getElapsedExecutionTime(Host* host);
@@ -90,6 +100,10 @@ gchar* host_getName(Host* host);
 Address* host_getDefaultAddress(Host* host);
 in_addr_t host_getDefaultIP(Host* host);
 Random* host_getRandom(Host* host);
+void host_setLookahead(Host* host, SimulationTime lookahead);
+SimulationTime host_getLookahead(Host* host);
+void host_setSchedulerData(Host* host, gpointer schedulerData);
+gpointer host_getSchedulerData(Host* host);
 gdouble host_getNextPacketPriority(Host* host);
 
 gboolean host_autotuneReceiveBuffer(Host* host);
@@ -13,6 +13,7 @@
 #include "main/core/support/options.h"
 #include "main/core/work/task.h"
 #include "main/core/worker.h"
+#include "main/host/association_table.h"
 #include "main/host/descriptor/descriptor.h"
 #include "main/host/descriptor/socket.h"
 #include "main/host/descriptor/tcp.h"
@@ -37,6 +38,11 @@ struct _NetworkInterfaceTokenBucket {
     guint64 bytesRemaining;
     /* The number of bytes that get added to the bucket every millisecond */
     guint64 bytesRefill;
+    /* In lazy refill mode, the time up to which tokens were last added, and the
+     * fraction of a byte (in units of 1/refill-interval bytes) that we owe the
+     * bucket from the time since then that did not add up to a whole byte. */
+    SimulationTime timeLastRefilled;
+    guint64 partialBytesRefill;
 };
 
 struct _NetworkInterface {
@@ -48,11 +54,15 @@ struct _NetworkInterface {
      * sending of packets from sockets. */
     QDiscMode qdisc;
 
+    /* How we add tokens to the buckets: either in chunks every refill interval
+     * from a periodic refill task, or from the elapsed time whenever we use them */
+    RefillMode refillMode;
+
     /* The address associated with this interface */
     Address* address;
 
-    /* (protocol,port)-to-socket bindings */
-    GHashTable* boundSockets;
+    /* (protocol,port,peerIP,peerPort)-to-socket bindings */
+    AssociationTable* boundSockets;
 
     /* Transports wanting to send data out */
     GQueue* rrQueue;
@@ -73,6 +83,10 @@ struct _NetworkInterface {
     /* If we have scheduled a refill task but it has not yet executed. */
     gboolean isRefillPending;
 
+    /* In lazy refill mode, the earliest time for which we have scheduled a
+     * wakeup task, or SIMTIME_INVALID if none is pending */
+    SimulationTime timeRefillWakeup;
+
     /* To support capturing incoming and outgoing packets */
     PCapWriter* pcap;
 
@@ -83,6 +97,8 @@ struct _NetworkInterface {
 static void _networkinterface_sendPackets(NetworkInterface* interface);
 static void _networkinterface_refillTokenBucketsCB(NetworkInterface* interface,
                                                    gpointer userData);
+static void _networkinterface_refillWakeupCB(NetworkInterface* interface,
+                                             gpointer userData);
 
 static gint _networkinterface_compareSocket(const Socket* sa, const Socket* sb, gpointer userData) {
     Packet* pa = socket_peekNextPacket(sa);
@@ -118,6 +134,54 @@ _networkinterface_consumeTokenBucket(NetworkInterfaceTokenBucket* bucket,
     }
 }
 
+/* add the tokens accumulated since the last refill, as if they had been
+ * trickling in continuously at the rate of bytesRefill every refill interval */
+static void _networkinterface_refillTokenBucketLazily(NetworkInterfaceTokenBucket* bucket,
+                                                      SimulationTime now) {
+    if(now <= bucket->timeLastRefilled) {
+        return;
+    }
+
+    SimulationTime elapsed = now - bucket->timeLastRefilled;
+    bucket->timeLastRefilled = now;
+
+    if(bucket->bytesRemaining >= bucket->bytesCapacity || bucket->bytesRefill == 0) {
+        bucket->partialBytesRefill = 0;
+        return;
+    }
+
+    /* check if the bucket filled up first, which also bounds the product below */
+    SimulationTime interval = _networkinterface_getRefillInterval();
+    guint64 bytesMissing = bucket->bytesCapacity - bucket->bytesRemaining;
+    guint64 unitsMissing = bytesMissing * interval - bucket->partialBytesRefill;
+    SimulationTime timeUntilFull = (unitsMissing + bucket->bytesRefill - 1) / bucket->bytesRefill;
+
+    if(elapsed >= timeUntilFull) {
+        bucket->bytesRemaining = bucket->bytesCapacity;
+        bucket->partialBytesRefill = 0;
+    } else {
+        guint64 units = elapsed * bucket->bytesRefill + bucket->partialBytesRefill;
+        bucket->bytesRemaining += units / interval;
+        bucket->partialBytesRefill = units % interval;
+    }
+}
+
+/* the time from now until the bucket holds enough tokens for a full packet,
+ * or SIMTIME_INVALID if it never will */
+static SimulationTime _networkinterface_getTimeUntilMTU(NetworkInterfaceTokenBucket* bucket) {
+    if(bucket->bytesRemaining >= CONFIG_MTU) {
+        return 0;
+    }
+    if(bucket->bytesRefill == 0) {
+        return SIMTIME_INVALID;
+    }
+
+    SimulationTime interval = _networkinterface_getRefillInterval();
+    guint64 bytesMissing = CONFIG_MTU - bucket->bytesRemaining;
+    guint64 unitsMissing = bytesMissing * interval - bucket->partialBytesRefill;
+    return (unitsMissing + bucket->bytesRefill - 1) / bucket->bytesRefill;
+}
+
 static void _networkinterface_scheduleRefillTask(NetworkInterface* interface,
                                                  TaskCallbackFunc func,
                                                  SimulationTime delay) {
@@ -155,11 +219,65 @@ static gboolean _networkinterface_isRefillNeeded(NetworkInterface* interface) {
 
 static void
 _networkinterface_scheduleNextRefillIfNeeded(NetworkInterface* interface) {
+    /* in lazy mode, we only wake up when someone is waiting for tokens */
+    if (interface->refillMode == REFILL_MODE_LAZY) {
+        return;
+    }
     if (_networkinterface_isRefillNeeded(interface)) {
         _networkinterface_scheduleNextRefill(interface);
     }
 }
 
+static void _networkinterface_refillTokenBucketsLazily(NetworkInterface* interface) {
+    if (interface->refillMode == REFILL_MODE_LAZY) {
+        SimulationTime now = worker_getCurrentTime();
+        _networkinterface_refillTokenBucketLazily(&interface->receiveBucket, now);
+        _networkinterface_refillTokenBucketLazily(&interface->sendBucket, now);
+    }
+}
+
+/* in lazy mode, call back at the exact time the bucket will have enough tokens
+ * for the packet that is waiting on it */
+static void _networkinterface_scheduleRefillWakeup(NetworkInterface* interface,
+                                                   NetworkInterfaceTokenBucket* bucket) {
+    utility_assert(interface->refillMode == REFILL_MODE_LAZY);
+
+    SimulationTime delay = _networkinterface_getTimeUntilMTU(bucket);
+    if (delay == SIMTIME_INVALID) {
+        return;
+    }
+
+    SimulationTime wakeupTime = worker_getCurrentTime() + MAX(delay, 1);
+
+    /* an earlier pending wakeup will check again, so we don't need another */
+    if (interface->timeRefillWakeup != SIMTIME_INVALID &&
+        interface->timeRefillWakeup <= wakeupTime) {
+        return;
+    }
+
+    _networkinterface_scheduleRefillTask(
+        interface, (TaskCallbackFunc)_networkinterface_refillWakeupCB,
+        wakeupTime - worker_getCurrentTime());
+    interface->timeRefillWakeup = wakeupTime;
+}
+
+static void _networkinterface_refillWakeupCB(NetworkInterface* interface,
+                                             gpointer userData) {
+    MAGIC_ASSERT(interface);
+
+    if (interface->timeRefillWakeup != SIMTIME_INVALID &&
+        interface->timeRefillWakeup <= worker_getCurrentTime()) {
+        interface->timeRefillWakeup = SIMTIME_INVALID;
+    }
+
+    /* the send and receive functions refill the buckets themselves, and
+     * schedule the next wakeup if they run out of tokens again */
+    if(interface->router) {
+        networkinterface_receivePackets(interface);
+    }
+    _networkinterface_sendPackets(interface);
+}
+
 static void _networkinterface_refillTokenBucketsCB(NetworkInterface* interface,
                                                    gpointer userData) {
     MAGIC_ASSERT(interface);
@@ -186,7 +304,17 @@ void networkinterface_startRefillingTokenBuckets(NetworkInterface* interface) {
     MAGIC_ASSERT(interface);
 
     interface->timeStartedRefillingBuckets = worker_getCurrentTime();
-    _networkinterface_refillTokenBucketsCB(interface, NULL);
+
+    if(interface->refillMode == REFILL_MODE_LAZY) {
+        /* start with the same tokens the first interval refill would give us */
+        _networkinterface_refillTokenBucket(&interface->receiveBucket);
+        _networkinterface_refillTokenBucket(&interface->sendBucket);
+        interface->receiveBucket.timeLastRefilled = interface->timeStartedRefillingBuckets;
+        interface->sendBucket.timeLastRefilled = interface->timeStartedRefillingBuckets;
+        _networkinterface_refillWakeupCB(interface, NULL);
+    } else {
+        _networkinterface_refillTokenBucketsCB(interface, NULL);
+    }
 }
 
 static void _networkinterface_setupTokenBuckets(NetworkInterface* interface,
@@ -252,86 +380,59 @@ guint32 networkinterface_getSpeedDownKiBps(NetworkInterface* interface) {
     return (guint32)kibPerSecond;
 }
 
-static gchar* _networkinterface_getAssociationKey(NetworkInterface* interface,
-        ProtocolType type, in_port_t port, in_addr_t peerAddr, in_port_t peerPort) {
-    MAGIC_ASSERT(interface);
-
-    GString* strBuffer = g_string_new(NULL);
-    g_string_printf(strBuffer,
-            "%s|%"G_GUINT32_FORMAT":%"G_GUINT16_FORMAT"|%"G_GUINT32_FORMAT":%"G_GUINT16_FORMAT,
-            protocol_toString(type),
-            (guint)address_toNetworkIP(interface->address),
-            port, peerAddr, peerPort);
-
-    return g_string_free(strBuffer, FALSE);
-}
-
-static gchar* _networkinterface_socketToAssociationKey(NetworkInterface* interface, Socket* socket) {
-    MAGIC_ASSERT(interface);
-
-    ProtocolType type = socket_getProtocol(socket);
+static void _networkinterface_getSocketAssociation(Socket* socket, ProtocolType* type,
+        in_port_t* port, in_addr_t* peerIP, in_port_t* peerPort) {
+    *type = socket_getProtocol(socket);
 
-    in_addr_t peerIP = 0;
-    in_port_t peerPort = 0;
-    socket_getPeerName(socket, &peerIP, &peerPort);
+    *peerIP = 0;
+    *peerPort = 0;
+    socket_getPeerName(socket, peerIP, peerPort);
 
     in_addr_t boundIP = 0;
-    in_port_t boundPort = 0;
-    socket_getSocketName(socket, &boundIP, &boundPort);
-
-    gchar* key = _networkinterface_getAssociationKey(interface, type, boundPort, peerIP, peerPort);
-    return key;
+    *port = 0;
+    socket_getSocketName(socket, &boundIP, port);
 }
 
 gboolean networkinterface_isAssociated(NetworkInterface* interface, ProtocolType type,
         in_port_t port, in_addr_t peerAddr, in_port_t peerPort) {
     MAGIC_ASSERT(interface);
 
-    gboolean isFound = FALSE;
-
     /* we need to check the general key too (ie the ones listening sockets use) */
-    gchar* general = _networkinterface_getAssociationKey(interface, type, port, 0, 0);
-    if(g_hash_table_lookup(interface->boundSockets, general)) {
-        isFound = TRUE;
-    }
-    g_free(general);
-
-    if(!isFound) {
-        gchar* specific = _networkinterface_getAssociationKey(interface, type, port, peerAddr, peerPort);
-        if(g_hash_table_lookup(interface->boundSockets, specific)) {
-            isFound = TRUE;
-        }
-        g_free(specific);
-    }
-
-    return isFound;
+    gpointer socket = associationtable_demux(interface->boundSockets, type, port, peerAddr, peerPort);
+    return socket != NULL ? TRUE : FALSE;
 }
 
 void networkinterface_associate(NetworkInterface* interface, Socket* socket) {
     MAGIC_ASSERT(interface);
 
-    gchar* key = _networkinterface_socketToAssociationKey(interface, socket);
+    ProtocolType type;
+    in_port_t port, peerPort;
+    in_addr_t peerIP;
+    _networkinterface_getSocketAssociation(socket, &type, &port, &peerIP, &peerPort);
 
-    /* make sure there is no collision */
-    utility_assert(!g_hash_table_contains(interface->boundSockets, key));
-
-    /* insert to our storage, key is now owned by table */
-    g_hash_table_replace(interface->boundSockets, key, socket);
+    /* insert to our storage, the table asserts there is no collision */
+    associationtable_insert(interface->boundSockets, type, port, peerIP, peerPort, socket);
     descriptor_ref(socket);
 
-    debug("associated socket key %s", key);
+    debug("associated socket %s|%"G_GUINT32_FORMAT":%"G_GUINT16_FORMAT"|%"G_GUINT32_FORMAT":%"G_GUINT16_FORMAT,
+            protocol_toString(type), (guint)address_toNetworkIP(interface->address),
+            port, peerIP, peerPort);
 }
 
 void networkinterface_disassociate(NetworkInterface* interface, Socket* socket) {
     MAGIC_ASSERT(interface);
 
-    gchar* key = _networkinterface_socketToAssociationKey(interface, socket);
+    ProtocolType type;
+    in_port_t port, peerPort;
+    in_addr_t peerIP;
+    _networkinterface_getSocketAssociation(socket, &type, &port, &peerIP, &peerPort);
 
     /* we will no longer receive packets for this port, this unrefs descriptor */
-    g_hash_table_remove(interface->boundSockets, key);
+    associationtable_remove(interface->boundSockets, type, port, peerIP, peerPort);
 
-    debug("disassociated socket key %s", key);
-    g_free(key);
+    debug("disassociated socket %s|%"G_GUINT32_FORMAT":%"G_GUINT16_FORMAT"|%"G_GUINT32_FORMAT":%"G_GUINT16_FORMAT,
+            protocol_toString(type), (guint)address_toNetworkIP(interface->address),
+            port, peerIP, peerPort);
 }
 
 static void _networkinterface_capturePacket(NetworkInterface* interface, Packet* packet) {
@@ -385,22 +486,12 @@ static void _networkinterface_receivePacket(NetworkInterface* interface, Packet*
     ProtocolType ptype = packet_getProtocol(packet);
     in_port_t bindPort = packet_getDestinationPort(packet);
 
-    /* the first check is for servers who don't associate with specific destinations */
-    gchar* key = _networkinterface_getAssociationKey(interface, ptype, bindPort, 0, 0);
-    debug("looking for socket associated with general key %s", key);
-    Socket* socket = g_hash_table_lookup(interface->boundSockets, key);
-    g_free(key);
+    in_addr_t peerIP = packet_getSourceIP(packet);
+    in_port_t peerPort = packet_getSourcePort(packet);
 
-    if(!socket) {
-        /* now check the destination-specific key */
-        in_addr_t peerIP = packet_getSourceIP(packet);
-        in_port_t peerPort = packet_getSourcePort(packet);
-
-        key = _networkinterface_getAssociationKey(interface, ptype, bindPort, peerIP, peerPort);
-        debug("looking for socket associated with specific key %s", key);
-        socket = g_hash_table_lookup(interface->boundSockets, key);
-        g_free(key);
-    }
+    /* servers who don't associate with specific destinations take precedence,
+     * then we check for a socket associated with the packet source */
+    Socket* socket = associationtable_demux(interface->boundSockets, ptype, bindPort, peerIP, peerPort);
 
     /* if the socket closed, just drop the packet */
     gint socketHandle = -1;
@@ -431,6 +522,8 @@ void networkinterface_receivePackets(NetworkInterface* interface) {
     /* get the bootstrapping mode */
     gboolean bootstrapping = worker_isBootstrapActive();
 
+    _networkinterface_refillTokenBucketsLazily(interface);
+
     while(bootstrapping || interface->receiveBucket.bytesRemaining >= CONFIG_MTU) {
         /* we are now the owner of the packet reference from the router */
         Packet* packet = router_dequeue(interface->router);
@@ -452,6 +545,12 @@ void networkinterface_receivePackets(NetworkInterface* interface) {
             _networkinterface_scheduleNextRefillIfNeeded(interface);
         }
     }
+
+    /* come back when we can receive the packets we left in the router */
+    if(interface->refillMode == REFILL_MODE_LAZY && !bootstrapping &&
+       interface->receiveBucket.bytesRemaining < CONFIG_MTU && router_peek(interface->router)) {
+        _networkinterface_scheduleRefillWakeup(interface, &interface->receiveBucket);
+    }
 }
 
 static void _networkinterface_updatePacketHeader(Descriptor* descriptor, Packet* packet) {
@@ -521,6 +620,8 @@ static void _networkinterface_sendPackets(NetworkInterface* interface) {
 
     gboolean bootstrapping = worker_isBootstrapActive();
 
+    _networkinterface_refillTokenBucketsLazily(interface);
+
     /* loop until we find a socket that has something to send */
     while(interface->sendBucket.bytesRemaining >= CONFIG_MTU) {
         gint socketHandle = -1;
@@ -576,6 +677,17 @@ static void _networkinterface_sendPackets(NetworkInterface* interface) {
         /* sending side is done with its ref */
         packet_unref(packet);
     }
+
+    /* come back when we can send the packets the sockets still have queued */
+    if(interface->refillMode == REFILL_MODE_LAZY && !bootstrapping &&
+       interface->sendBucket.bytesRemaining < CONFIG_MTU) {
+        gboolean hasSendable = (interface->qdisc == QDISC_MODE_RR) ?
+                !g_queue_is_empty(interface->rrQueue) :
+                !priorityqueue_isEmpty(interface->fifoQueue);
+        if(hasSendable) {
+            _networkinterface_scheduleRefillWakeup(interface, &interface->sendBucket);
+        }
+    }
 }
 
 void networkinterface_wantsSend(NetworkInterface* interface, Socket* socket) {
@@ -621,7 +733,8 @@ Router* networkinterface_getRouter(NetworkInterface* interface) {
 }
 
 NetworkInterface* networkinterface_new(Address* address, guint64 bwDownKiBps, guint64 bwUpKiBps,
-        gboolean logPcap, gchar* pcapDir, QDiscMode qdisc, guint64 interfaceReceiveLength) {
+        gboolean logPcap, gchar* pcapDir, QDiscMode qdisc, RefillMode refillMode,
+        guint64 interfaceReceiveLength) {
     NetworkInterface* interface = g_new0(NetworkInterface, 1);
     MAGIC_INIT(interface);
 
@@ -629,7 +742,7 @@ NetworkInterface* networkinterface_new(Address* address, guint64 bwDownKiBps, gu
     address_ref(interface->address);
 
     /* incoming packets get passed along to sockets */
-    interface->boundSockets = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, descriptor_unref);
+    interface->boundSockets = associationtable_new(descriptor_unref);
 
     /* sockets tell us when they want to start sending */
     interface->rrQueue = g_queue_new();
@@ -638,6 +751,10 @@ NetworkInterface* networkinterface_new(Address* address, guint64 bwDownKiBps, gu
     /* parse queuing discipline */
     interface->qdisc = (qdisc == QDISC_MODE_NONE) ? QDISC_MODE_FIFO : qdisc;
 
+    /* parse token bucket refill mode */
+    interface->refillMode = (refillMode == REFILL_MODE_NONE) ? REFILL_MODE_INTERVAL : refillMode;
+    interface->timeRefillWakeup = SIMTIME_INVALID;
+
     if(logPcap) {
         GString* filename = g_string_new(NULL);
         g_string_printf(filename, "%s-%s",
@@ -670,7 +787,7 @@ void networkinterface_free(NetworkInterface* interface) {
 
     priorityqueue_free(interface->fifoQueue);
 
-    g_hash_table_destroy(interface->boundSockets);
+    associationtable_free(interface->boundSockets);
 
     if(interface->router) {
         router_unref(interface->router);
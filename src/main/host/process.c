@@ -278,6 +278,12 @@ static ProcessContext _process_changeContext(Process* proc, ProcessContext from,
         prevContext = proc->activeContext;
         proc->activeContext = to;
     }
+
+    /* let the preload lib know which process its intercepted calls belong to,
+     * so it does not have to ask us on every call */
+    extern void interposer_setEmulatedProcess(Process*);
+    interposer_setEmulatedProcess(to == PCTX_SHADOW ? NULL : proc);
+
     return prevContext;
 }
 
@@ -7,6 +7,7 @@
 /* a packet is a 'data' packet if it has a payload attached, and a 'control' packet otherwise.
  * each packet is either a 'normal' packet or a 'retransmitted' packet. */
 #include <glib.h>
+#include <math.h>
 #include <netinet/in.h>
 #include <string.h>
 
@@ -18,6 +19,7 @@
 #include "main/host/tracker.h"
 #include "main/routing/address.h"
 #include "main/routing/packet.h"
+#include "main/utility/random.h"
 #include "main/utility/utility.h"
 #include "support/logger/log_level.h"
 #include "support/logger/logger.h"
@@ -48,6 +50,30 @@ typedef struct {
     Counters outCounters;
 } IFaceCounters;
 
+/* the mean number of allocated bytes between two sampled allocations */
+#define TRACKER_RAM_SAMPLE_PERIOD (512*1024)
+
+/* an allocation that was picked by the sampling, and how much of the
+ * allocations it stands for */
+typedef struct {
+    gdouble estimatedBytes;
+    gdouble estimatedCount;
+} SampledAllocation;
+
+typedef struct {
+    Random* random;
+    /* the number of bytes that can still be allocated before the next sample */
+    gdouble bytesUntilSample;
+
+    /* the sampled allocations that were not freed yet */
+    GHashTable* sampledLocations;
+    gdouble estimatedBytesTotal;
+    gdouble estimatedCountTotal;
+
+    gsize allocatedBytesLastInterval;
+    gdouble estimatedDeallocatedBytesLastInterval;
+} RAMSampler;
+
 struct _Tracker {
     /* our personal settings as configured in the shadow xml config file */
     SimulationTime interval;
@@ -56,6 +82,7 @@ struct _Tracker {
 
     gboolean didLogNodeHeader;
     gboolean didLogRAMHeader;
+    gboolean didLogRAMSampledHeader;
     gboolean didLogSocketHeader;
 
     SimulationTime processingTimeTotal;
@@ -75,6 +102,8 @@ struct _Tracker {
     gsize deallocatedBytesLastInterval;
     guint numFailedFrees;
 
+    RAMSampler ramSampler;
+
     GHashTable* socketStats;
 
     SimulationTime lastHeartbeat;
@@ -126,7 +155,15 @@ static void _socketstats_free(SocketStats* ss) {
     }
 }
 
-Tracker* tracker_new(SimulationTime interval, LogLevel loglevel, LogInfoFlags loginfo) {
+/* sampling points are a Poisson process over the allocated bytes, so the
+ * number of bytes from one to the next is exponentially distributed */
+static void _tracker_pickNextSample(RAMSampler* sampler) {
+    /* avoid log(0) */
+    gdouble uniform = MAX(random_nextDouble(sampler->random), G_MINDOUBLE);
+    sampler->bytesUntilSample = -log(uniform) * TRACKER_RAM_SAMPLE_PERIOD;
+}
+
+Tracker* tracker_new(SimulationTime interval, LogLevel loglevel, LogInfoFlags loginfo, guint seed) {
     Tracker* tracker = g_new0(Tracker, 1);
     MAGIC_INIT(tracker);
 
@@ -135,6 +172,14 @@ Tracker* tracker_new(SimulationTime interval, LogLevel loglevel, LogInfoFlags lo
     tracker->loginfo = loginfo;
 
     tracker->allocatedLocations = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    if(tracker->loginfo & LOG_INFO_FLAGS_RAM_SAMPLED) {
+        tracker->ramSampler.random = random_new(seed);
+        tracker->ramSampler.sampledLocations = g_hash_table_new_full(g_direct_hash,
+                g_direct_equal, NULL, g_free);
+        _tracker_pickNextSample(&tracker->ramSampler);
+    }
+
     tracker->socketStats = g_hash_table_new_full(g_int_hash, g_int_equal, NULL, (GDestroyNotify)_socketstats_free);
 
     /* send an alive message, and start periodic heartbeats */
@@ -156,6 +201,13 @@ void tracker_free(Tracker* tracker) {
     g_hash_table_destroy(tracker->allocatedLocations);
     g_hash_table_destroy(tracker->socketStats);
 
+    if(tracker->ramSampler.sampledLocations) {
+        g_hash_table_destroy(tracker->ramSampler.sampledLocations);
+    }
+    if(tracker->ramSampler.random) {
+        random_free(tracker->ramSampler.random);
+    }
+
     MAGIC_CLEAR(tracker);
     g_free(tracker);
 }
@@ -277,6 +329,27 @@ void tracker_addOutputBytes(Tracker* tracker, Packet* packet, gint handle) {
     }
 }
 
+static void _tracker_sampleAllocation(RAMSampler* sampler, gpointer location, gsize allocatedBytes) {
+    /* the probability that a sampling point fell into an allocation of this
+     * size, so each sampled allocation stands for 1/probability allocations */
+    gdouble probability = -expm1(-((gdouble)allocatedBytes) / TRACKER_RAM_SAMPLE_PERIOD);
+
+    SampledAllocation* sample = g_new(SampledAllocation, 1);
+    sample->estimatedBytes = allocatedBytes / probability;
+    sample->estimatedCount = 1.0 / probability;
+
+    /* the location may still be here if its free was not tracked */
+    SampledAllocation* previous = g_hash_table_lookup(sampler->sampledLocations, location);
+    if(previous) {
+        sampler->estimatedBytesTotal -= previous->estimatedBytes;
+        sampler->estimatedCountTotal -= previous->estimatedCount;
+    }
+
+    g_hash_table_insert(sampler->sampledLocations, location, sample);
+    sampler->estimatedBytesTotal += sample->estimatedBytes;
+    sampler->estimatedCountTotal += sample->estimatedCount;
+}
+
 void tracker_addAllocatedBytes(Tracker* tracker, gpointer location, gsize allocatedBytes) {
     MAGIC_ASSERT(tracker);
 
@@ -285,6 +358,18 @@ void tracker_addAllocatedBytes(Tracker* tracker, gpointer location, gsize alloca
         tracker->allocatedBytesLastInterval += allocatedBytes;
         g_hash_table_insert(tracker->allocatedLocations, location, GSIZE_TO_POINTER(allocatedBytes));
     }
+
+    if(tracker->loginfo & LOG_INFO_FLAGS_RAM_SAMPLED) {
+        RAMSampler* sampler = &tracker->ramSampler;
+        sampler->allocatedBytesLastInterval += allocatedBytes;
+
+        /* most allocations only count down to the next sampling point */
+        sampler->bytesUntilSample -= allocatedBytes;
+        if(sampler->bytesUntilSample <= 0) {
+            _tracker_sampleAllocation(sampler, location, allocatedBytes);
+            _tracker_pickNextSample(sampler);
+        }
+    }
 }
 
 void tracker_removeAllocatedBytes(Tracker* tracker, gpointer location) {
@@ -303,6 +388,19 @@ void tracker_removeAllocatedBytes(Tracker* tracker, gpointer location) {
             (tracker->numFailedFrees)++;
         }
     }
+
+    if(tracker->loginfo & LOG_INFO_FLAGS_RAM_SAMPLED) {
+        RAMSampler* sampler = &tracker->ramSampler;
+
+        /* the table only holds the sampled allocations, so it stays small */
+        SampledAllocation* sample = g_hash_table_lookup(sampler->sampledLocations, location);
+        if(sample) {
+            sampler->estimatedBytesTotal -= sample->estimatedBytes;
+            sampler->estimatedCountTotal -= sample->estimatedCount;
+            sampler->estimatedDeallocatedBytesLastInterval += sample->estimatedBytes;
+            g_hash_table_remove(sampler->sampledLocations, location);
+        }
+    }
 }
 
 void tracker_addSocket(Tracker* tracker, gint handle, ProtocolType type, gsize inputBufferSize, gsize outputBufferSize) {
@@ -563,6 +661,25 @@ static void _tracker_logRAM(Tracker* tracker, LogLevel level, SimulationTime int
         tracker->allocatedBytesTotal, numptrs, tracker->numFailedFrees);
 }
 
+static void _tracker_logRAMSampled(Tracker* tracker, LogLevel level, SimulationTime interval) {
+    RAMSampler* sampler = &tracker->ramSampler;
+    guint seconds = (guint) (interval / SIMTIME_ONE_SECOND);
+
+    if(!tracker->didLogRAMSampledHeader) {
+        tracker->didLogRAMSampledHeader = TRUE;
+        logger_log(logger_getDefault(), level, __FILE__, __FUNCTION__, __LINE__,
+                "[shadow-heartbeat] [ram-sampled-header] interval-seconds,alloc-bytes,"
+                "estimated-dealloc-bytes,estimated-total-bytes,estimated-pointers-count,sampled-pointers-count");
+    }
+
+    /* rounding errors may leave the estimates slightly negative once everything was freed */
+    logger_log(logger_getDefault(), level, __FILE__, __FUNCTION__, __LINE__,
+        "[shadow-heartbeat] [ram-sampled] %u,%"G_GSIZE_FORMAT",%.0f,%.0f,%.0f,%u",
+        seconds, sampler->allocatedBytesLastInterval, sampler->estimatedDeallocatedBytesLastInterval,
+        MAX(sampler->estimatedBytesTotal, 0.0), MAX(sampler->estimatedCountTotal, 0.0),
+        g_hash_table_size(sampler->sampledLocations));
+}
+
 void tracker_heartbeat(Tracker* tracker, gpointer userData) {
     MAGIC_ASSERT(tracker);
 
@@ -581,12 +698,19 @@ void tracker_heartbeat(Tracker* tracker, gpointer userData) {
         _tracker_logRAM(tracker, tracker->loglevel, tracker->interval);
     }
 
+    /* check to see if sampled ram info is being logged */
+    if(tracker->loginfo & LOG_INFO_FLAGS_RAM_SAMPLED) {
+        _tracker_logRAMSampled(tracker, tracker->loglevel, tracker->interval);
+    }
+
     /* clear interval stats */
     tracker->processingTimeLastInterval = 0;
     tracker->delayTimeLastInterval = 0;
     tracker->numDelayedLastInterval = 0;
     tracker->allocatedBytesLastInterval = 0;
     tracker->deallocatedBytesLastInterval = 0;
+    tracker->ramSampler.allocatedBytesLastInterval = 0;
+    tracker->ramSampler.estimatedDeallocatedBytesLastInterval = 0;
 
     /* clear the counters */
     memset(&tracker->local, 0, sizeof(IFaceCounters));
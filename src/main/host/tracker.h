@@ -18,7 +18,8 @@
 
 typedef struct _Tracker Tracker;
 
-Tracker* tracker_new(SimulationTime interval, LogLevel loglevel, LogInfoFlags loginfo);
+/* seed is only used to pick the allocations that are sampled for LOG_INFO_FLAGS_RAM_SAMPLED */
+Tracker* tracker_new(SimulationTime interval, LogLevel loglevel, LogInfoFlags loginfo, guint seed);
 void tracker_free(Tracker* tracker);
 
 void tracker_addProcessingTime(Tracker* tracker, SimulationTime processingTime);
@@ -6,17 +6,24 @@
 
 #include <netinet/in.h>
 #include <stddef.h>
+#include <string.h>
 
 #include "main/core/support/object_counter.h"
 #include "main/core/worker.h"
 #include "main/host/host.h"
 #include "main/routing/address.h"
 #include "main/routing/packet.h"
+#include "main/routing/packet_trace.h"
 #include "main/routing/payload.h"
+#include "main/utility/object_pool.h"
 #include "main/utility/utility.h"
 #include "support/logger/log_level.h"
 #include "support/logger/logger.h"
 
+/* the number of most recent statuses a packet remembers in order when
+ * tracing is enabled */
+#define PACKET_STATUS_HISTORY_SIZE 24
+
 /* thread-safe structure representing a data/network packet */
 
 typedef struct _PacketLocalHeader PacketLocalHeader;
@@ -45,9 +52,18 @@ struct _Packet {
     /* id of the packet created on the host given by hostID */
     guint64 packetID;
 
+    /* the header is stored inline, protocol tells which one is set */
     ProtocolType protocol;
-    gpointer header;
+    union {
+        PacketLocalHeader local;
+        PacketUDPHeader udp;
+        PacketTCPHeader tcp;
+    } header;
+    /* the packet data is the payloadLength bytes starting at payloadOffset
+     * in the payload, which may be shared with other packets */
     Payload* payload;
+    gsize payloadOffset;
+    gsize payloadLength;
 
     /* tracks application priority so we flush packets from the interface to
      * the wire in the order intended by the application. this is used in
@@ -57,11 +73,22 @@ struct _Packet {
     gdouble priority;
 
     PacketDeliveryStatusFlags allStatus;
-    GQueue* orderedStatus;
+    /* ring of the bit positions of the most recent statuses, where status
+     * number i is stored at index i % PACKET_STATUS_HISTORY_SIZE.
+     * only filled in when tracing is enabled. */
+    guint8 orderedStatus[PACKET_STATUS_HISTORY_SIZE];
+    guint numStatus;
 
     MAGIC_DECLARE;
 };
 
+/* written once during setup, before the worker threads start */
+static PacketTraceMode packetTraceMode = PACKET_TRACE_NONE;
+
+void packet_setTraceMode(PacketTraceMode mode) {
+    packetTraceMode = mode;
+}
+
 const gchar* protocol_toString(ProtocolType type) {
     switch (type) {
         case PLOCAL: return "LOCAL";
@@ -71,8 +98,12 @@ const gchar* protocol_toString(ProtocolType type) {
     }
 }
 
-Packet* packet_new(gconstpointer payload, gsize payloadLength, guint hostID, guint64 packetID) {
-    Packet* packet = g_new0(Packet, 1);
+static ObjectPool* _packet_getObjectPool() {
+    return worker_getObjectPool(OBJECT_TYPE_PACKET, sizeof(Packet));
+}
+
+static Packet* _packet_new(guint hostID, guint64 packetID) {
+    Packet* packet = objectpool_alloc(_packet_getObjectPool(), sizeof(Packet));
     MAGIC_INIT(packet);
 
     packet->referenceCount = 1;
@@ -80,17 +111,41 @@ Packet* packet_new(gconstpointer payload, gsize payloadLength, guint hostID, gui
     packet->hostID = hostID;
     packet->packetID = packetID;
 
+    worker_countObject(OBJECT_TYPE_PACKET, COUNTER_TYPE_NEW);
+    return packet;
+}
+
+Packet* packet_new(gconstpointer payload, gsize payloadLength, guint hostID, guint64 packetID) {
+    Packet* packet = _packet_new(hostID, packetID);
+
     if(payload != NULL && payloadLength > 0) {
         /* the payload starts with 1 ref, which we hold */
         packet->payload = payload_new(payload, payloadLength);
+        packet->payloadLength = payloadLength;
 
         /* application data needs a priority ordering for FIFO onto the wire */
         packet->priority = host_getNextPacketPriority(worker_getActiveHost());
     }
 
-    packet->orderedStatus = g_queue_new();
+    return packet;
+}
+
+Packet* packet_newWithPayloadView(Payload* payload, gsize payloadOffset, gsize payloadLength,
+        guint hostID, guint64 packetID) {
+    Packet* packet = _packet_new(hostID, packetID);
+
+    if(payload != NULL && payloadLength > 0) {
+        utility_assert(payloadOffset + payloadLength <= payload_getLength(payload));
+
+        payload_ref(payload);
+        packet->payload = payload;
+        packet->payloadOffset = payloadOffset;
+        packet->payloadLength = payloadLength;
+
+        /* application data needs a priority ordering for FIFO onto the wire */
+        packet->priority = host_getNextPacketPriority(worker_getActiveHost());
+    }
 
-    worker_countObject(OBJECT_TYPE_PACKET, COUNTER_TYPE_NEW);
     return packet;
 }
 
@@ -100,7 +155,7 @@ Packet* packet_new(gconstpointer payload, gsize payloadLength, guint hostID, gui
 Packet* packet_copy(Packet* packet) {
     MAGIC_ASSERT(packet);
 
-    Packet* copy = g_new0(Packet, 1);
+    Packet* copy = objectpool_alloc(_packet_getObjectPool(), sizeof(Packet));
     MAGIC_INIT(copy);
 
     copy->referenceCount = 1;
@@ -110,51 +165,19 @@ Packet* packet_copy(Packet* packet) {
 
     if(packet->payload) {
         copy->payload = packet->payload;
+        copy->payloadOffset = packet->payloadOffset;
+        copy->payloadLength = packet->payloadLength;
         payload_ref(packet->payload);
         copy->priority = packet->priority;
     }
 
     copy->allStatus = packet->allStatus;
+    memcpy(copy->orderedStatus, packet->orderedStatus, sizeof(packet->orderedStatus));
+    copy->numStatus = packet->numStatus;
 
-    if(packet->orderedStatus) {
-        /* this is ok because we store ints in the pointers, not objects */
-        copy->orderedStatus = g_queue_copy(packet->orderedStatus);
-    }
-
+    /* the headers have no pointers, so this copies the SACKs too */
     copy->protocol = packet->protocol;
-    if(packet->header) {
-        switch (packet->protocol) {
-            case PLOCAL: {
-                copy->header = g_memdup(packet->header, sizeof(PacketLocalHeader));
-                break;
-            }
-
-            case PUDP: {
-                copy->header = g_memdup(packet->header, sizeof(PacketUDPHeader));
-                break;
-            }
-
-            case PTCP: {
-                copy->header = g_memdup(packet->header, sizeof(PacketTCPHeader));
-
-                PacketTCPHeader* packetHeader = (PacketTCPHeader*)packet->header;
-                PacketTCPHeader* copyHeader = (PacketTCPHeader*)copy->header;
-
-                copyHeader->selectiveACKs = NULL;
-
-                if(packetHeader->selectiveACKs) {
-                    /* g_list_copy is shallow, but we store integers in the data pointers, so its OK here */
-                    copyHeader->selectiveACKs = g_list_copy(packetHeader->selectiveACKs);
-                }
-                break;
-            }
-
-            default: {
-                error("unrecognized protocol");
-                break;
-            }
-        }
-    }
+    copy->header = packet->header;
 
     worker_countObject(OBJECT_TYPE_PACKET, COUNTER_TYPE_NEW);
     return copy;
@@ -163,25 +186,11 @@ Packet* packet_copy(Packet* packet) {
 static void _packet_free(Packet* packet) {
     MAGIC_ASSERT(packet);
 
-    if(packet->protocol == PTCP) {
-        PacketTCPHeader* header = (PacketTCPHeader*)packet->header;
-        if(header->selectiveACKs) {
-            g_list_free(header->selectiveACKs);
-        }
-    }
-
-    if(packet->header) {
-        g_free(packet->header);
-    }
     if(packet->payload) {
         payload_unref(packet->payload);
     }
-    if(packet->orderedStatus) {
-        g_queue_free(packet->orderedStatus);
-    }
-
     MAGIC_CLEAR(packet);
-    g_free(packet);
+    objectpool_release(_packet_getObjectPool(), packet);
 
     worker_countObject(OBJECT_TYPE_PACKET, COUNTER_TYPE_FREE);
 }
@@ -212,10 +221,10 @@ gint packet_compareTCPSequence(Packet* packet1, Packet* packet2, gpointer user_d
     guint sequence1 = 0, sequence2 = 0;
 
     utility_assert(packet1->protocol == PTCP);
-    sequence1 = ((PacketTCPHeader*)(packet1->header))->sequence;
+    sequence1 = packet1->header.tcp.sequence;
 
     utility_assert(packet2->protocol == PTCP);
-    sequence2 = ((PacketTCPHeader*)(packet2->header))->sequence;
+    sequence2 = packet2->header.tcp.sequence;
 
     return sequence1 < sequence2 ? -1 : sequence1 > sequence2 ? 1 : 0;
 }
@@ -223,17 +232,16 @@ gint packet_compareTCPSequence(Packet* packet1, Packet* packet2, gpointer user_d
 void packet_setLocal(Packet* packet, enum ProtocolLocalFlags flags,
         gint sourceDescriptorHandle, gint destinationDescriptorHandle, in_port_t port) {
     MAGIC_ASSERT(packet);
-    utility_assert(!(packet->header) && packet->protocol == PNONE);
+    utility_assert(packet->protocol == PNONE);
     utility_assert(port > 0);
 
-    PacketLocalHeader* header = g_new0(PacketLocalHeader, 1);
+    PacketLocalHeader* header = &(packet->header.local);
 
     header->flags = flags;
     header->sourceDescriptorHandle = sourceDescriptorHandle;
     header->destinationDescriptorHandle = destinationDescriptorHandle;
     header->port = port;
 
-    packet->header = header;
     packet->protocol = PLOCAL;
 }
 
@@ -241,10 +249,10 @@ void packet_setUDP(Packet* packet, enum ProtocolUDPFlags flags,
         in_addr_t sourceIP, in_port_t sourcePort,
         in_addr_t destinationIP, in_port_t destinationPort) {
     MAGIC_ASSERT(packet);
-    utility_assert(!(packet->header) && packet->protocol == PNONE);
+    utility_assert(packet->protocol == PNONE);
     utility_assert(sourceIP && sourcePort && destinationIP && destinationPort);
 
-    PacketUDPHeader* header = g_new0(PacketUDPHeader, 1);
+    PacketUDPHeader* header = &(packet->header.udp);
 
     header->flags = flags;
     header->sourceIP = sourceIP;
@@ -252,7 +260,6 @@ void packet_setUDP(Packet* packet, enum ProtocolUDPFlags flags,
     header->destinationIP = destinationIP;
     header->destinationPort = destinationPort;
 
-    packet->header = header;
     packet->protocol = PUDP;
 }
 
@@ -260,10 +267,10 @@ void packet_setTCP(Packet* packet, enum ProtocolTCPFlags flags,
         in_addr_t sourceIP, in_port_t sourcePort,
         in_addr_t destinationIP, in_port_t destinationPort, guint sequence) {
     MAGIC_ASSERT(packet);
-    utility_assert(!(packet->header) && packet->protocol == PNONE);
+    utility_assert(packet->protocol == PNONE);
     utility_assert(sourceIP && sourcePort && destinationIP && destinationPort);
 
-    PacketTCPHeader* header = g_new0(PacketTCPHeader, 1);
+    PacketTCPHeader* header = &(packet->header.tcp);
 
     header->flags = flags;
     header->sourceIP = sourceIP;
@@ -272,27 +279,64 @@ void packet_setTCP(Packet* packet, enum ProtocolTCPFlags flags,
     header->destinationPort = destinationPort;
     header->sequence = sequence;
 
-    packet->header = header;
     packet->protocol = PTCP;
 }
 
+/* merges sequence into the sorted, non-adjacent blocks of the header. if all
+ * blocks are in use, the highest block is dropped, since the sender gets the
+ * most use out of the blocks right after the cumulative ack. */
+static void _packet_addTCPSelectiveACK(PacketTCPHeader* header, guint sequence) {
+    guint i = 0;
+    for(; i < header->numSelectiveACKs; i++) {
+        PacketTCPSelectiveACKBlock* block = &(header->selectiveACKs[i]);
+
+        if(sequence >= block->begin && sequence < block->end) {
+            return;
+        } else if(sequence == block->end) {
+            block->end++;
+            /* we may have closed the gap to the next block */
+            if(i + 1 < header->numSelectiveACKs && header->selectiveACKs[i + 1].begin == block->end) {
+                block->end = header->selectiveACKs[i + 1].end;
+                memmove(&(header->selectiveACKs[i + 1]), &(header->selectiveACKs[i + 2]),
+                        (header->numSelectiveACKs - i - 2) * sizeof(PacketTCPSelectiveACKBlock));
+                header->numSelectiveACKs--;
+            }
+            return;
+        } else if(sequence + 1 == block->begin) {
+            block->begin = sequence;
+            return;
+        } else if(sequence < block->begin) {
+            break;
+        }
+    }
+
+    if(i >= PACKET_TCP_MAX_SELECTIVE_ACKS) {
+        return;
+    }
+
+    /* insert a new block at i, dropping the last one if we are full */
+    guint numMoved = MIN(header->numSelectiveACKs, PACKET_TCP_MAX_SELECTIVE_ACKS - 1) - i;
+    memmove(&(header->selectiveACKs[i + 1]), &(header->selectiveACKs[i]),
+            numMoved * sizeof(PacketTCPSelectiveACKBlock));
+    header->selectiveACKs[i].begin = sequence;
+    header->selectiveACKs[i].end = sequence + 1;
+    header->numSelectiveACKs = MIN(header->numSelectiveACKs + 1, PACKET_TCP_MAX_SELECTIVE_ACKS);
+}
+
 void packet_updateTCP(Packet* packet, guint acknowledgement, GList* selectiveACKs,
         guint window, SimulationTime timestampValue, SimulationTime timestampEcho) {
     MAGIC_ASSERT(packet);
-    utility_assert(packet->header && (packet->protocol == PTCP));
-
-    PacketTCPHeader* header = (PacketTCPHeader*) packet->header;
+    utility_assert(packet->protocol == PTCP);
 
-    if(selectiveACKs && g_list_length(selectiveACKs) > 0) {
-        /* free the old ack list if it exists */
-        if(header->selectiveACKs != NULL) {
-            g_list_free(header->selectiveACKs);
-            header->selectiveACKs = NULL;
-        }
+    PacketTCPHeader* header = &(packet->header.tcp);
 
-        /* set the new sacks */
+    if(selectiveACKs) {
+        /* replace the old sacks */
         header->flags |= PTCP_SACK;
-        header->selectiveACKs = g_list_copy(selectiveACKs);
+        header->numSelectiveACKs = 0;
+        for(GList* iter = selectiveACKs; iter; iter = g_list_next(iter)) {
+            _packet_addTCPSelectiveACK(header, (guint)GPOINTER_TO_INT(iter->data));
+        }
     }
 
     header->acknowledgment = acknowledgement;
@@ -303,11 +347,7 @@ void packet_updateTCP(Packet* packet, guint acknowledgement, GList* selectiveACK
 
 guint packet_getPayloadLength(Packet* packet) {
     MAGIC_ASSERT(packet);
-    if(packet->payload) {
-        return (guint)payload_getLength(packet->payload);
-    } else {
-        return 0;
-    }
+    return (guint)packet->payloadLength;
 }
 
 gdouble packet_getPriority(Packet* packet) {
@@ -333,13 +373,13 @@ in_addr_t packet_getDestinationIP(Packet* packet) {
         }
 
         case PUDP: {
-            PacketUDPHeader* header = packet->header;
+            PacketUDPHeader* header = &(packet->header.udp);
             ip = header->destinationIP;
             break;
         }
 
         case PTCP: {
-            PacketTCPHeader* header = packet->header;
+            PacketTCPHeader* header = &(packet->header.tcp);
             ip = header->destinationIP;
             break;
         }
@@ -360,19 +400,19 @@ in_port_t packet_getDestinationPort(Packet* packet) {
 
     switch (packet->protocol) {
         case PLOCAL: {
-            PacketLocalHeader* header = packet->header;
+            PacketLocalHeader* header = &(packet->header.local);
             port = header->port;
             break;
         }
 
         case PUDP: {
-            PacketUDPHeader* header = packet->header;
+            PacketUDPHeader* header = &(packet->header.udp);
             port = header->destinationPort;
             break;
         }
 
         case PTCP: {
-            PacketTCPHeader* header = packet->header;
+            PacketTCPHeader* header = &(packet->header.tcp);
             port = header->destinationPort;
             break;
         }
@@ -398,13 +438,13 @@ in_addr_t packet_getSourceIP(Packet* packet) {
         }
 
         case PUDP: {
-            PacketUDPHeader* header = packet->header;
+            PacketUDPHeader* header = &(packet->header.udp);
             ip = header->sourceIP;
             break;
         }
 
         case PTCP: {
-            PacketTCPHeader* header = packet->header;
+            PacketTCPHeader* header = &(packet->header.tcp);
             ip = header->sourceIP;
             break;
         }
@@ -425,19 +465,19 @@ in_port_t packet_getSourcePort(Packet* packet) {
 
     switch (packet->protocol) {
         case PLOCAL: {
-            PacketLocalHeader* header = packet->header;
+            PacketLocalHeader* header = &(packet->header.local);
             port = header->port;
             break;
         }
 
         case PUDP: {
-            PacketUDPHeader* header = packet->header;
+            PacketUDPHeader* header = &(packet->header.udp);
             port = header->sourcePort;
             break;
         }
 
         case PTCP: {
-            PacketTCPHeader* header = packet->header;
+            PacketTCPHeader* header = &(packet->header.tcp);
             port = header->sourcePort;
             break;
         }
@@ -460,32 +500,20 @@ guint packet_copyPayload(Packet* packet, gsize payloadOffset, gpointer buffer, g
     MAGIC_ASSERT(packet);
 
     if(packet->payload) {
-        return (guint) payload_getData(packet->payload, payloadOffset, buffer, bufferLength);
+        /* copy straight out of the (possibly shared) payload, limited to our view */
+        utility_assert(payloadOffset <= packet->payloadLength);
+        gsize copyLength = MIN(packet->payloadLength - payloadOffset, bufferLength);
+        return (guint) payload_getData(packet->payload, packet->payloadOffset + payloadOffset,
+                buffer, copyLength);
     } else {
         return 0;
     }
 }
 
-GList* packet_copyTCPSelectiveACKs(Packet* packet) {
-    MAGIC_ASSERT(packet);
-    utility_assert(packet->protocol == PTCP);
-
-    PacketTCPHeader* packetHeader = (PacketTCPHeader*)packet->header;
-
-    /* make sure to do a deep copy of all pointers to avoid concurrency issues */
-    GList* selectiveACKsCopy = NULL;
-    if(packetHeader->selectiveACKs) {
-        /* g_list_copy is shallow, but we store integers in the data pointers, so its OK here */
-        selectiveACKsCopy = g_list_copy(packetHeader->selectiveACKs);
-    }
-
-    return selectiveACKsCopy;
-}
-
 PacketTCPHeader* packet_getTCPHeader(Packet* packet) {
     MAGIC_ASSERT(packet);
     utility_assert(packet->protocol == PTCP);
-    return (PacketTCPHeader*)packet->header;
+    return &(packet->header.tcp);
 }
 
 static const gchar* _packet_deliveryStatusToAscii(PacketDeliveryStatusFlags status) {
@@ -522,11 +550,11 @@ gchar* packet_toString(Packet* packet) {
     g_string_append_printf(packetString, "packetID=%u:%"G_GUINT64_FORMAT" ",
             packet->hostID, packet->packetID);
 
-    guint payloadLength = (packet->payload) ? (guint)payload_getLength(packet->payload) : 0;
+    guint payloadLength = (guint)packet->payloadLength;
 
     switch (packet->protocol) {
         case PLOCAL: {
-            PacketLocalHeader* header = packet->header;
+            PacketLocalHeader* header = &(packet->header.local);
             g_string_append_printf(packetString, "%i -> %i bytes=%u",
                     header->sourceDescriptorHandle, header->destinationDescriptorHandle,
                     payloadLength);
@@ -534,7 +562,7 @@ gchar* packet_toString(Packet* packet) {
         }
 
         case PUDP: {
-            PacketUDPHeader* header = packet->header;
+            PacketUDPHeader* header = &(packet->header.udp);
             gchar* sourceIPString = address_ipToNewString(header->sourceIP);
             gchar* destinationIPString = address_ipToNewString(header->destinationIP);
 
@@ -550,7 +578,7 @@ gchar* packet_toString(Packet* packet) {
         }
 
         case PTCP: {
-            PacketTCPHeader* header = packet->header;
+            PacketTCPHeader* header = &(packet->header.tcp);
             gchar* sourceIPString = address_ipToNewString(header->sourceIP);
             gchar* destinationIPString = address_ipToNewString(header->destinationIP);
 
@@ -560,28 +588,19 @@ gchar* packet_toString(Packet* packet) {
                     destinationIPString, ntohs(header->destinationPort),
                     header->sequence, header->acknowledgment);
 
-            // Instead of printing out entire list of SACK, print out ranges to save space
-            gint firstSack = -1;
-            gint lastSack = -1;
-            for(GList *iter = header->selectiveACKs; iter; iter = g_list_next(iter)) {
-                gint seq = GPOINTER_TO_INT(iter->data);
-                if(firstSack == -1) {
-                    firstSack = seq;
-                } else if(lastSack == -1 || seq == lastSack + 1) {
-                    lastSack = seq;
+            /* print the inclusive range of sequence numbers in each SACK block */
+            for(guint i = 0; i < header->numSelectiveACKs; i++) {
+                PacketTCPSelectiveACKBlock* block = &(header->selectiveACKs[i]);
+                if(i > 0) {
+                    g_string_append_printf(packetString, " ");
+                }
+                if(block->end - block->begin > 1) {
+                    g_string_append_printf(packetString, "%u-%u", block->begin, block->end - 1);
                 } else {
-                    g_string_append_printf(packetString, "%d-%d ", firstSack, lastSack);
-                    firstSack = seq;
-                    lastSack = -1;
+                    g_string_append_printf(packetString, "%u", block->begin);
                 }
             }
-
-            if(firstSack != -1) {
-                g_string_append_printf(packetString, "%d", firstSack);
-                if(lastSack != -1) {
-                    g_string_append_printf(packetString,"-%d", lastSack);
-                }
-            } else {
+            if(header->numSelectiveACKs == 0) {
                 g_string_append_printf(packetString, "NA");
             }
 
@@ -620,21 +639,23 @@ gchar* packet_toString(Packet* packet) {
         }
     }
     
-    guint statusLength = g_queue_get_length(packet->orderedStatus);
-    if(statusLength > 0) {
+    if(packet->numStatus > 0) {
         g_string_append_printf(packetString, " status=");
+        if(packet->numStatus > PACKET_STATUS_HISTORY_SIZE) {
+            /* the oldest statuses were overwritten */
+            g_string_append_printf(packetString, "...,");
+        }
     }
-    for(int i = 0; i < statusLength; i++) {
-        gpointer statusPtr = g_queue_pop_head(packet->orderedStatus);
-        PacketDeliveryStatusFlags status = (PacketDeliveryStatusFlags) GPOINTER_TO_UINT(statusPtr);
+    guint numShown = MIN(packet->numStatus, PACKET_STATUS_HISTORY_SIZE);
+    for(guint i = packet->numStatus - numShown; i < packet->numStatus; i++) {
+        guint8 bit = packet->orderedStatus[i % PACKET_STATUS_HISTORY_SIZE];
+        PacketDeliveryStatusFlags status = (PacketDeliveryStatusFlags)(1 << bit);
 
-        if(i < statusLength - 1) {
+        if(i < packet->numStatus - 1) {
             g_string_append_printf(packetString, "%s,", _packet_deliveryStatusToAscii(status));
         } else {
             g_string_append_printf(packetString, "%s", _packet_deliveryStatusToAscii(status));
         }
-
-        g_queue_push_tail(packet->orderedStatus, statusPtr);
     }
 
     return g_string_free(packetString, FALSE);
@@ -644,20 +665,75 @@ gchar* _packet_getString(Packet* packet) {
     return packet_toString(packet);
 }
 
-void packet_addDeliveryStatus(Packet* packet, PacketDeliveryStatusFlags status) {
-    MAGIC_ASSERT(packet);
+static void _packet_fillTraceRecord(Packet* packet, PacketDeliveryStatusFlags status,
+        PacketTraceRecord* record) {
+    memset(record, 0, sizeof(PacketTraceRecord));
 
-    packet->allStatus |= status;
+    record->time = (guint64)worker_getCurrentTime();
+    record->packetID = packet->packetID;
+    record->hostID = packet->hostID;
+    record->status = (guint32)status;
+    record->protocol = (guint16)packet->protocol;
+    record->payloadLength = (guint32)packet->payloadLength;
+
+    /* the protocol header is not set yet for statuses added while creating the packet */
+    if(packet->protocol == PNONE) {
+        return;
+    }
+
+    if(packet->protocol == PUDP) {
+        PacketUDPHeader* header = &(packet->header.udp);
+        record->sourceIP = header->sourceIP;
+        record->destinationIP = header->destinationIP;
+        record->sourcePort = header->sourcePort;
+        record->destinationPort = header->destinationPort;
+    } else if(packet->protocol == PTCP) {
+        PacketTCPHeader* header = &(packet->header.tcp);
+        record->sourceIP = header->sourceIP;
+        record->destinationIP = header->destinationIP;
+        record->sourcePort = header->sourcePort;
+        record->destinationPort = header->destinationPort;
+        record->tcpFlags = (guint16)header->flags;
+        record->sequence = header->sequence;
+        record->acknowledgment = header->acknowledgment;
+    } else if(packet->protocol == PLOCAL) {
+        PacketLocalHeader* header = &(packet->header.local);
+        record->sourcePort = header->port;
+        record->destinationPort = header->port;
+    }
+}
 
-    gboolean skipDebug = worker_isFiltered(LOGLEVEL_DEBUG);
-    if(!skipDebug) {
-        g_queue_push_tail(packet->orderedStatus, GUINT_TO_POINTER(status));
+static void _packet_traceDeliveryStatus(Packet* packet, PacketDeliveryStatusFlags status) {
+    guint8 bit = (guint8)g_bit_nth_lsf((gulong)status, -1);
+    packet->orderedStatus[packet->numStatus % PACKET_STATUS_HISTORY_SIZE] = bit;
+    packet->numStatus++;
+
+    if(packetTraceMode & PACKET_TRACE_FILE) {
+        PacketTrace* trace = worker_getPacketTrace();
+        if(trace) {
+            PacketTraceRecord record;
+            _packet_fillTraceRecord(packet, status, &record);
+            packettrace_write(trace, &record);
+        }
+    }
+
+    if((packetTraceMode & PACKET_TRACE_LOG) && !worker_isFiltered(LOGLEVEL_DEBUG)) {
         gchar* packetStr = packet_toString(packet);
         message("[%s] %s", _packet_deliveryStatusToAscii(status), packetStr);
         g_free(packetStr);
     }
 }
 
+void packet_addDeliveryStatus(Packet* packet, PacketDeliveryStatusFlags status) {
+    MAGIC_ASSERT(packet);
+
+    packet->allStatus |= status;
+
+    if(G_UNLIKELY(packetTraceMode != PACKET_TRACE_NONE)) {
+        _packet_traceDeliveryStatus(packet, status);
+    }
+}
+
 PacketDeliveryStatusFlags packet_getDeliveryStatus(Packet* packet) {
     MAGIC_ASSERT(packet);
     return packet->allStatus;
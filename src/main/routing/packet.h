@@ -12,6 +12,7 @@
 
 #include "main/core/support/definitions.h"
 #include "main/host/protocol.h"
+#include "main/routing/payload.h"
 
 typedef struct _Packet Packet;
 
@@ -40,6 +41,26 @@ enum _PacketDeliveryStatusFlags {
     PDS_DESTROYED = 1 << 20,
 };
 
+/* what packet_addDeliveryStatus does besides setting the status bit */
+typedef enum _PacketTraceMode PacketTraceMode;
+enum _PacketTraceMode {
+    PACKET_TRACE_NONE = 0,
+    /* log the packet with each status it gets, if debug logging is enabled */
+    PACKET_TRACE_LOG = 1 << 0,
+    /* write each status to the worker's binary packet trace */
+    PACKET_TRACE_FILE = 1 << 1,
+};
+
+/* the most SACK blocks a TCP header carries */
+#define PACKET_TCP_MAX_SELECTIVE_ACKS 16
+
+/* a block of selectively acknowledged sequence numbers [begin, end) */
+typedef struct _PacketTCPSelectiveACKBlock PacketTCPSelectiveACKBlock;
+struct _PacketTCPSelectiveACKBlock {
+    guint begin;
+    guint end;
+};
+
 typedef struct _PacketTCPHeader PacketTCPHeader;
 struct _PacketTCPHeader {
     enum ProtocolTCPFlags flags;
@@ -49,7 +70,9 @@ struct _PacketTCPHeader {
     in_port_t destinationPort;
     guint sequence;
     guint acknowledgment;
-    GList* selectiveACKs;
+    /* sorted, non-overlapping and non-adjacent */
+    PacketTCPSelectiveACKBlock selectiveACKs[PACKET_TCP_MAX_SELECTIVE_ACKS];
+    guint numSelectiveACKs;
     guint window;
     SimulationTime timestampValue;
     SimulationTime timestampEcho;
@@ -57,7 +80,16 @@ struct _PacketTCPHeader {
 
 const gchar* protocol_toString(ProtocolType type);
 
+/* packets only keep their ordered status history when tracing is enabled.
+ * must be set before the workers start creating packets. */
+void packet_setTraceMode(PacketTraceMode mode);
+
 Packet* packet_new(gconstpointer payload, gsize payloadLength, guint hostID, guint64 packetID);
+/* creates a packet whose payload is the payloadLength bytes starting at
+ * payloadOffset in the given payload, without copying them. the packet holds
+ * its own ref, so several packets can carry views into the same payload. */
+Packet* packet_newWithPayloadView(Payload* payload, gsize payloadOffset, gsize payloadLength,
+        guint hostID, guint64 packetID);
 Packet* packet_copy(Packet* packet);
 
 void packet_ref(Packet* packet);
@@ -74,6 +106,8 @@ void packet_setTCP(Packet* packet, enum ProtocolTCPFlags flags,
         in_addr_t sourceIP, in_port_t sourcePort,
         in_addr_t destinationIP, in_port_t destinationPort, guint sequence);
 
+/* selectiveACKs holds the sequence numbers of the packets received out of
+ * order. they are stored as up to PACKET_TCP_MAX_SELECTIVE_ACKS blocks. */
 void packet_updateTCP(Packet* packet, guint acknowledgement, GList* selectiveACKs,
         guint window, SimulationTime timestampValue, SimulationTime timestampEcho);
 
@@ -88,7 +122,6 @@ in_port_t packet_getSourcePort(Packet* packet);
 ProtocolType packet_getProtocol(Packet* packet);
 
 guint packet_copyPayload(Packet* packet, gsize payloadOffset, gpointer buffer, gsize bufferLength);
-GList* packet_copyTCPSelectiveACKs(Packet* packet);
 PacketTCPHeader* packet_getTCPHeader(Packet* packet);
 gint packet_compareTCPSequence(Packet* packet1, Packet* packet2, gpointer user_data);
 
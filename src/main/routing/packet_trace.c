@@ -0,0 +1,96 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/routing/packet_trace.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "main/utility/utility.h"
+#include "support/logger/logger.h"
+
+/* the number of records we collect before writing them out */
+#define PACKET_TRACE_BUFFER_RECORDS 4096
+
+G_STATIC_ASSERT(sizeof(PacketTraceFileHeader) == 16);
+G_STATIC_ASSERT(sizeof(PacketTraceRecord) == 56);
+
+struct _PacketTrace {
+    FILE* file;
+    gchar* path;
+
+    PacketTraceRecord* records;
+    guint numRecords;
+
+    MAGIC_DECLARE;
+};
+
+PacketTrace* packettrace_new(const gchar* path) {
+    FILE* file = fopen(path, "wb");
+    if(!file) {
+        warning("unable to open packet trace file '%s': %s", path, g_strerror(errno));
+        return NULL;
+    }
+
+    PacketTraceFileHeader header;
+    memset(&header, 0, sizeof(PacketTraceFileHeader));
+    memcpy(header.magic, PACKET_TRACE_MAGIC, sizeof(header.magic));
+    header.version = PACKET_TRACE_VERSION;
+    header.recordSize = (guint32)sizeof(PacketTraceRecord);
+
+    if(fwrite(&header, sizeof(PacketTraceFileHeader), 1, file) != 1) {
+        warning("unable to write packet trace file '%s': %s", path, g_strerror(errno));
+        fclose(file);
+        return NULL;
+    }
+
+    PacketTrace* trace = g_new0(PacketTrace, 1);
+    MAGIC_INIT(trace);
+
+    trace->file = file;
+    trace->path = g_strdup(path);
+    trace->records = g_new(PacketTraceRecord, PACKET_TRACE_BUFFER_RECORDS);
+
+    return trace;
+}
+
+static void _packettrace_flush(PacketTrace* trace) {
+    if(trace->numRecords > 0 && trace->file) {
+        gsize written = fwrite(trace->records, sizeof(PacketTraceRecord), trace->numRecords, trace->file);
+        if(written != trace->numRecords) {
+            /* stop tracing rather than writing a corrupt file */
+            warning("unable to write packet trace file '%s': %s; no more packets will be traced",
+                    trace->path, g_strerror(errno));
+            fclose(trace->file);
+            trace->file = NULL;
+        }
+    }
+    trace->numRecords = 0;
+}
+
+void packettrace_free(PacketTrace* trace) {
+    MAGIC_ASSERT(trace);
+
+    _packettrace_flush(trace);
+    if(trace->file) {
+        fclose(trace->file);
+    }
+
+    g_free(trace->records);
+    g_free(trace->path);
+
+    MAGIC_CLEAR(trace);
+    g_free(trace);
+}
+
+void packettrace_write(PacketTrace* trace, const PacketTraceRecord* record) {
+    MAGIC_ASSERT(trace);
+
+    trace->records[trace->numRecords++] = *record;
+    if(trace->numRecords >= PACKET_TRACE_BUFFER_RECORDS) {
+        _packettrace_flush(trace);
+    }
+}
@@ -0,0 +1,66 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_PACKET_TRACE_H_
+#define SHD_PACKET_TRACE_H_
+
+#include <glib.h>
+
+/**
+ * Writes packet delivery status records to a binary trace file for offline
+ * analysis. Each worker thread writes its own file, so no locking is needed.
+ *
+ * The file starts with a PacketTraceFileHeader, followed by fixed-size
+ * PacketTraceRecords in the order the statuses were added. All fields are in
+ * host byte order, except IP addresses and ports, which are in network byte
+ * order as in the packet headers.
+ */
+
+#define PACKET_TRACE_MAGIC "SHDPKTTR"
+#define PACKET_TRACE_VERSION 1
+
+typedef struct _PacketTraceFileHeader PacketTraceFileHeader;
+struct _PacketTraceFileHeader {
+    gchar magic[8];
+    guint32 version;
+    /* the size of each record that follows, in bytes */
+    guint32 recordSize;
+};
+
+typedef struct _PacketTraceRecord PacketTraceRecord;
+struct _PacketTraceRecord {
+    /* the simulation time at which the status was added, in nanoseconds */
+    guint64 time;
+    /* the packet is identified by the pair (hostID, packetID) */
+    guint64 packetID;
+    guint32 hostID;
+    /* a single PacketDeliveryStatusFlags value */
+    guint32 status;
+    guint32 sourceIP;
+    guint32 destinationIP;
+    guint16 sourcePort;
+    guint16 destinationPort;
+    /* a ProtocolType value */
+    guint16 protocol;
+    /* the ProtocolTCPFlags, or 0 for other protocols */
+    guint16 tcpFlags;
+    /* TCP sequence and acknowledgment numbers, or 0 for other protocols */
+    guint32 sequence;
+    guint32 acknowledgment;
+    guint32 payloadLength;
+    /* always 0, keeps the record size a multiple of 8 bytes */
+    guint32 padding;
+};
+
+typedef struct _PacketTrace PacketTrace;
+
+/* returns NULL and logs a warning if the file can not be created */
+PacketTrace* packettrace_new(const gchar* path);
+/* writes out the remaining buffered records and closes the file */
+void packettrace_free(PacketTrace* trace);
+
+void packettrace_write(PacketTrace* trace, const PacketTraceRecord* record);
+
+#endif /* SHD_PACKET_TRACE_H_ */
@@ -6,34 +6,48 @@
 
 #include "main/routing/payload.h"
 
+#include <stddef.h>
 #include <string.h>
 
 #include "main/core/support/definitions.h"
 #include "main/core/support/object_counter.h"
 #include "main/core/worker.h"
+#include "main/utility/slab_cache.h"
 #include "main/utility/utility.h"
 
-/* packet payloads may be shared across hosts, so we must lock access to them */
+/* packet payloads may be shared across hosts. the data is immutable after
+ * creation, so only the reference count needs synchronization, which we do
+ * with atomic operations instead of a lock. */
 struct _Payload {
-    GMutex lock;
-    guint referenceCount;
-    gpointer data;
+    volatile gint referenceCount;
     gsize length;
     MAGIC_DECLARE;
+    /* the data is stored inline, in the same allocation as the payload */
+    guchar data[];
 };
 
+static inline gsize _payload_getAllocationSize(gsize dataLength) {
+    return offsetof(Payload, data) + dataLength;
+}
+
+static SlabCache* _payload_getSlabCache() {
+    /* the slave thread may free payloads after the workers are gone,
+     * in which case the block is simply returned to the system */
+    return worker_isAlive() ? worker_getSlabCache() : NULL;
+}
+
 Payload* payload_new(gconstpointer data, gsize dataLength) {
-    Payload* payload = g_new0(Payload, 1);
+    gsize length = (data && dataLength > 0) ? dataLength : 0;
+
+    Payload* payload = slabcache_alloc(_payload_getSlabCache(), _payload_getAllocationSize(length));
+    utility_assert(payload != NULL);
     MAGIC_INIT(payload);
 
-    g_mutex_init(&(payload->lock));
     payload->referenceCount = 1;
+    payload->length = length;
 
-    if(data && dataLength > 0) {
-        payload->data = g_malloc0(dataLength);
-        memmove(payload->data, data, dataLength);
-        utility_assert(payload->data != NULL);
-        payload->length = dataLength;
+    if(length > 0) {
+        memcpy(payload->data, data, length);
     }
 
     worker_countObject(OBJECT_TYPE_PAYLOAD, COUNTER_TYPE_NEW);
@@ -44,69 +58,42 @@ Payload* payload_new(gconstpointer data, gsize dataLength) {
 static void _payload_free(Payload* payload) {
     MAGIC_ASSERT(payload);
 
-    g_mutex_clear(&(payload->lock));
-
-    if(payload->data) {
-        g_free(payload->data);
-    }
+    gsize allocationSize = _payload_getAllocationSize(payload->length);
 
     MAGIC_CLEAR(payload);
-    g_free(payload);
+    slabcache_release(_payload_getSlabCache(), payload, allocationSize);
 
     worker_countObject(OBJECT_TYPE_PAYLOAD, COUNTER_TYPE_FREE);
 }
 
-static void _payload_lock(Payload* payload) {
-    MAGIC_ASSERT(payload);
-    g_mutex_lock(&(payload->lock));
-}
-
-static void _payload_unlock(Payload* payload) {
-    MAGIC_ASSERT(payload);
-    g_mutex_unlock(&(payload->lock));
-}
-
 void payload_ref(Payload* payload) {
     MAGIC_ASSERT(payload);
-    _payload_lock(payload);
-    (payload->referenceCount)++;
-    _payload_unlock(payload);
+    g_atomic_int_inc(&(payload->referenceCount));
 }
 
 void payload_unref(Payload* payload) {
     MAGIC_ASSERT(payload);
-    _payload_lock(payload);
-    (payload->referenceCount)--;
-    gboolean needsFree = (payload->referenceCount == 0) ? TRUE : FALSE;
-    _payload_unlock(payload);
-    if(needsFree) {
+    if(g_atomic_int_dec_and_test(&(payload->referenceCount))) {
         _payload_free(payload);
     }
 }
 
 gsize payload_getLength(Payload* payload) {
     MAGIC_ASSERT(payload);
-    _payload_lock(payload);
-    gsize length = payload->length;
-    _payload_unlock(payload);
-    return length;
+    return payload->length;
 }
 
 gsize payload_getData(Payload* payload, gsize offset, gpointer destBuffer, gsize destBufferLength) {
     MAGIC_ASSERT(payload);
 
-    _payload_lock(payload);
-
     utility_assert(offset <= payload->length);
 
     gsize targetLength = payload->length - offset;
     gsize copyLength = MIN(targetLength, destBufferLength);
 
     if(copyLength > 0) {
-        g_memmove(destBuffer, payload->data + offset, copyLength);
+        memcpy(destBuffer, payload->data + offset, copyLength);
     }
 
-    _payload_unlock(payload);
-
     return copyLength;
 }
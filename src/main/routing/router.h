@@ -47,5 +47,7 @@ void router_forward(Router* router, Packet* packet);
 void router_enqueue(Router* router, Packet* packet);
 /* dequeue a downstream packet, i.e., receive it from the network */
 Packet* router_dequeue(Router* router);
+/* returns the next downstream packet without removing it, or NULL if none are buffered */
+Packet* router_peek(Router* router);
 
 #endif /* SRC_MAIN_ROUTING_SHD_ROUTER_H_ */
@@ -21,6 +21,39 @@
 #include "main/utility/utility.h"
 #include "support/logger/logger.h"
 
+typedef struct _TopologyPathMatrix TopologyPathMatrix;
+struct _TopologyPathMatrix {
+    /* vertexIndex->ordinal, or -1 if no hosts were attached to the vertex */
+    gint* vertexOrdinals;
+    guint numVertices;
+    /* ordinal->vertexIndex */
+    igraph_integer_t* attachedVertices;
+    guint numAttachedVertices;
+    /* indexed by [srcOrdinal * numAttachedVertices + dstOrdinal].
+     * latencies are in milliseconds, and are negative if no path exists. they
+     * are stored at full precision so that they give the same simulation times
+     * as paths that are computed on demand. */
+    gdouble* latencies;
+    gdouble* reliabilities;
+    /* nonzero if the path is the edge between src and dst */
+    guint8* isDirectPaths;
+};
+
+/* a read-only copy of the graph in compressed sparse row form, so that
+ * many threads may run dijkstra concurrently without using igraph */
+typedef struct _TopologyArcs TopologyArcs;
+struct _TopologyArcs {
+    guint numVertices;
+    /* the outgoing arcs of vertex v are in [offsets[v], offsets[v+1]).
+     * undirected edges are stored as two arcs, one in each direction. */
+    guint* offsets;
+    guint* targets;
+    gdouble* latencies;
+    gdouble* reliabilities;
+    /* 1 - packetloss of each vertex */
+    gdouble* vertexReliabilities;
+};
+
 struct _Topology {
     /* the imported igraph graph data - operations on it after initializations
      * MUST be locked in cases where igraph is not thread-safe! */
@@ -46,6 +79,11 @@ struct _Topology {
     gdouble minimumPathLatency;
     GRWLock pathCacheLock;
 
+    /* optional dense path properties for every pair of vertices with attached hosts,
+     * computed once during startup. these are never modified after being computed,
+     * so they may be read without holding any lock. */
+    TopologyPathMatrix* pathMatrix;
+
     /******/
     /* START - items protected by a global topology lock */
     GMutex topologyLock;
@@ -1281,12 +1319,12 @@ static void _topology_clearCache(Topology* top) {
     g_mutex_unlock(&(top->topologyLock));
 }
 
-static Path* _topology_getPathFromCache(Topology* top, igraph_integer_t srcVertexIndex,
+/* @warning top->pathCacheLock must be held when calling this function!! */
+static Path* _topology_lookupPathInCache(Topology* top, igraph_integer_t srcVertexIndex,
         igraph_integer_t dstVertexIndex) {
     MAGIC_ASSERT(top);
 
     Path* path = NULL;
-    g_rw_lock_reader_lock(&(top->pathCacheLock));
 
     if(top->pathCache) {
         /* look for the source first level cache */
@@ -1298,12 +1336,48 @@ static Path* _topology_getPathFromCache(Topology* top, igraph_integer_t srcVerte
         }
     }
 
+    return path;
+}
+
+static Path* _topology_getPathFromCache(Topology* top, igraph_integer_t srcVertexIndex,
+        igraph_integer_t dstVertexIndex) {
+    MAGIC_ASSERT(top);
+
+    g_rw_lock_reader_lock(&(top->pathCacheLock));
+    Path* path = _topology_lookupPathInCache(top, srcVertexIndex, dstVertexIndex);
     g_rw_lock_reader_unlock(&(top->pathCacheLock));
 
     /* NULL if cache miss */
     return path;
 }
 
+/* @warning top->pathCacheLock must be held for writing when calling this function!! */
+static void _topology_insertPathInCache(Topology* top, Path* path) {
+    MAGIC_ASSERT(top);
+
+    igraph_integer_t srcVertexIndex = (igraph_integer_t) path_getSrcVertexIndex(path);
+    igraph_integer_t dstVertexIndex = (igraph_integer_t) path_getDstVertexIndex(path);
+
+    /* create latency cache on the fly */
+    if(!top->pathCache) {
+        /* stores hash tables for source address caches */
+        top->pathCache = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)g_hash_table_destroy);
+    }
+
+    GHashTable* srcCache = g_hash_table_lookup(top->pathCache, GINT_TO_POINTER(srcVertexIndex));
+    if(!srcCache) {
+        /* dont have a cache for this source yet, create one now */
+        srcCache = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)path_free);
+        g_hash_table_replace(top->pathCache, GINT_TO_POINTER(srcVertexIndex), srcCache);
+    }
+
+    /* store it in the cache. don't bother storing the path for the reverse direction,
+     * because we can check both directions for this cached path later.
+     * callers hold on to cached paths, so an existing entry must never be replaced. */
+    utility_assert(!g_hash_table_contains(srcCache, GINT_TO_POINTER(dstVertexIndex)));
+    g_hash_table_insert(srcCache, GINT_TO_POINTER(dstVertexIndex), path);
+}
+
 static gboolean _topology_shouldStorePath(Topology* top, gboolean isDirectPath,
         igraph_integer_t srcVertexIndex, igraph_integer_t dstVertexIndex) {
     MAGIC_ASSERT(top);
@@ -1351,25 +1425,17 @@ static void _topology_storePathInCache(Topology* top, gboolean isDirectPath,
 
     g_rw_lock_writer_lock(&(top->pathCacheLock));
 
-    /* create latency cache on the fly */
-    if(!top->pathCache) {
-        /* stores hash tables for source address caches */
-        top->pathCache = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)g_hash_table_destroy);
-    }
-
-    GHashTable* srcCache = g_hash_table_lookup(top->pathCache, GINT_TO_POINTER(srcVertexIndex));
-    if(!srcCache) {
-        /* dont have a cache for this source yet, create one now */
-        srcCache = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)path_free);
-        g_hash_table_replace(top->pathCache, GINT_TO_POINTER(srcVertexIndex), srcCache);
+    /* another worker may have stored the path while we were waiting for the lock,
+     * and we keep that one because callers may already hold on to it */
+    if(_topology_lookupPathInCache(top, srcVertexIndex, dstVertexIndex) ||
+            _topology_lookupPathInCache(top, dstVertexIndex, srcVertexIndex)) {
+        g_rw_lock_writer_unlock(&(top->pathCacheLock));
+        return;
     }
 
-    /* create the path */
+    /* create the path and cache it */
     Path* path = path_new(isDirectPath, (gint64)srcVertexIndex, (gint64)dstVertexIndex, latencyMS, reliability);
-
-    /* store it in the cache. don't bother storing the path for the reverse direction,
-     * because we can check both directions for this cached path later. */
-    g_hash_table_replace(srcCache, GINT_TO_POINTER(dstVertexIndex), path);
+    _topology_insertPathInCache(top, path);
 
     /* track the minimum network latency in the entire graph */
     if(top->minimumPathLatency == 0 || latencyMS < top->minimumPathLatency) {
@@ -1966,7 +2032,633 @@ static void _topology_logAllCachedPaths(Topology* top) {
     }
 }
 
-static Path* _topology_getPathEntry(Topology* top, Address* srcAddress, Address* dstAddress) {
+static void _topology_freeArcs(TopologyArcs* arcs) {
+    if(arcs) {
+        g_free(arcs->offsets);
+        g_free(arcs->targets);
+        g_free(arcs->latencies);
+        g_free(arcs->reliabilities);
+        g_free(arcs->vertexReliabilities);
+        g_free(arcs);
+    }
+}
+
+static TopologyArcs* _topology_newArcs(Topology* top) {
+    MAGIC_ASSERT(top);
+
+    _topology_lockGraph(top);
+    g_rw_lock_reader_lock(&(top->edgeWeightsLock));
+
+    guint numVertices = (guint) top->vertexCount;
+    guint numEdges = (guint) top->edgeCount;
+    guint numArcs = top->isDirected ? numEdges : 2 * numEdges;
+
+    TopologyArcs* arcs = g_new0(TopologyArcs, 1);
+    arcs->numVertices = numVertices;
+    arcs->offsets = g_new0(guint, numVertices + 1);
+    arcs->targets = g_new0(guint, numArcs);
+    arcs->latencies = g_new0(gdouble, numArcs);
+    arcs->reliabilities = g_new0(gdouble, numArcs);
+    arcs->vertexReliabilities = g_new0(gdouble, numVertices);
+
+    for(guint vertexIndex = 0; vertexIndex < numVertices; vertexIndex++) {
+        gdouble packetLoss;
+        if(_topology_findVertexAttributeDouble(top, (igraph_integer_t)vertexIndex, VERTEX_ATTR_PACKETLOSS, &packetLoss)) {
+            arcs->vertexReliabilities[vertexIndex] = 1.0f - packetLoss;
+        } else {
+            arcs->vertexReliabilities[vertexIndex] = 1.0f;
+        }
+    }
+
+    guint* edgeSources = g_new0(guint, numEdges);
+    guint* edgeTargets = g_new0(guint, numEdges);
+    gboolean isSuccess = TRUE;
+
+    /* first count the outgoing arcs of each vertex */
+    for(guint edgeIndex = 0; edgeIndex < numEdges; edgeIndex++) {
+        igraph_integer_t fromVertexIndex, toVertexIndex;
+        gint result = igraph_edge(&top->graph, (igraph_integer_t)edgeIndex, &fromVertexIndex, &toVertexIndex);
+        if(result != IGRAPH_SUCCESS) {
+            critical("igraph_edge return non-success code %i", result);
+            isSuccess = FALSE;
+            break;
+        }
+
+        edgeSources[edgeIndex] = (guint)fromVertexIndex;
+        edgeTargets[edgeIndex] = (guint)toVertexIndex;
+
+        arcs->offsets[edgeSources[edgeIndex] + 1]++;
+        if(!top->isDirected) {
+            arcs->offsets[edgeTargets[edgeIndex] + 1]++;
+        }
+    }
+
+    if(isSuccess) {
+        for(guint vertexIndex = 0; vertexIndex < numVertices; vertexIndex++) {
+            arcs->offsets[vertexIndex + 1] += arcs->offsets[vertexIndex];
+        }
+        utility_assert(arcs->offsets[numVertices] == numArcs);
+
+        /* now fill in the arcs, keeping each vertex's arcs in edge index order */
+        guint* nextArcs = g_new0(guint, numVertices);
+        memcpy(nextArcs, arcs->offsets, numVertices * sizeof(guint));
+
+        for(guint edgeIndex = 0; edgeIndex < numEdges; edgeIndex++) {
+            gdouble latency = (gdouble) igraph_vector_e(top->edgeWeights, (glong)edgeIndex);
+            gdouble packetLoss;
+            gboolean found = _topology_findEdgeAttributeDouble(top, (igraph_integer_t)edgeIndex, EDGE_ATTR_PACKETLOSS, &packetLoss);
+            utility_assert(found);
+
+            guint arcIndex = nextArcs[edgeSources[edgeIndex]]++;
+            arcs->targets[arcIndex] = edgeTargets[edgeIndex];
+            arcs->latencies[arcIndex] = latency;
+            arcs->reliabilities[arcIndex] = 1.0f - packetLoss;
+
+            if(!top->isDirected) {
+                arcIndex = nextArcs[edgeTargets[edgeIndex]]++;
+                arcs->targets[arcIndex] = edgeSources[edgeIndex];
+                arcs->latencies[arcIndex] = latency;
+                arcs->reliabilities[arcIndex] = 1.0f - packetLoss;
+            }
+        }
+
+        g_free(nextArcs);
+    }
+
+    g_rw_lock_reader_unlock(&(top->edgeWeightsLock));
+    _topology_unlockGraph(top);
+
+    g_free(edgeSources);
+    g_free(edgeTargets);
+
+    if(!isSuccess) {
+        _topology_freeArcs(arcs);
+        return NULL;
+    }
+
+    return arcs;
+}
+
+static void _topology_freePathMatrix(TopologyPathMatrix* matrix) {
+    if(matrix) {
+        g_free(matrix->vertexOrdinals);
+        g_free(matrix->attachedVertices);
+        g_free(matrix->latencies);
+        g_free(matrix->reliabilities);
+        g_free(matrix->isDirectPaths);
+        g_free(matrix);
+    }
+}
+
+static TopologyPathMatrix* _topology_newPathMatrix(Topology* top) {
+    MAGIC_ASSERT(top);
+
+    TopologyPathMatrix* matrix = g_new0(TopologyPathMatrix, 1);
+
+    matrix->numVertices = (guint) top->vertexCount;
+    matrix->vertexOrdinals = g_new(gint, matrix->numVertices);
+    for(guint vertexIndex = 0; vertexIndex < matrix->numVertices; vertexIndex++) {
+        matrix->vertexOrdinals[vertexIndex] = -1;
+    }
+
+    /* assign ordinals in vertex index order so that the layout does not
+     * depend on the hash table iteration order */
+    GQueue* attachedTargets = _topology_getUniqueVertexTargets(top);
+    for(GList* item = g_queue_peek_head_link(attachedTargets); item; item = g_list_next(item)) {
+        gint vertexIndex = GPOINTER_TO_INT(item->data);
+        utility_assert(vertexIndex >= 0 && vertexIndex < matrix->numVertices);
+        matrix->vertexOrdinals[vertexIndex] = 0;
+    }
+    matrix->numAttachedVertices = g_queue_get_length(attachedTargets);
+    g_queue_free(attachedTargets);
+
+    matrix->attachedVertices = g_new0(igraph_integer_t, matrix->numAttachedVertices);
+    guint ordinal = 0;
+    for(guint vertexIndex = 0; vertexIndex < matrix->numVertices; vertexIndex++) {
+        if(matrix->vertexOrdinals[vertexIndex] >= 0) {
+            matrix->attachedVertices[ordinal] = (igraph_integer_t) vertexIndex;
+            matrix->vertexOrdinals[vertexIndex] = (gint) ordinal;
+            ordinal++;
+        }
+    }
+    utility_assert(ordinal == matrix->numAttachedVertices);
+
+    gsize numEntries = ((gsize)matrix->numAttachedVertices) * ((gsize)matrix->numAttachedVertices);
+    matrix->latencies = g_new(gdouble, numEntries);
+    matrix->reliabilities = g_new(gdouble, numEntries);
+    matrix->isDirectPaths = g_new0(guint8, numEntries);
+
+    /* until proven otherwise, there is no path */
+    for(gsize i = 0; i < numEntries; i++) {
+        matrix->latencies[i] = -1.0;
+        matrix->reliabilities[i] = 0.0;
+    }
+
+    return matrix;
+}
+
+static gsize _topology_getPathMatrixSize(TopologyPathMatrix* matrix) {
+    gsize numEntries = ((gsize)matrix->numAttachedVertices) * ((gsize)matrix->numAttachedVertices);
+    return (numEntries * (sizeof(gdouble) + sizeof(gdouble) + sizeof(guint8))) +
+            (matrix->numVertices * sizeof(gint)) +
+            (matrix->numAttachedVertices * sizeof(igraph_integer_t));
+}
+
+static inline gsize _topology_getPathMatrixPosition(TopologyPathMatrix* matrix,
+        guint srcOrdinal, guint dstOrdinal) {
+    return (((gsize)srcOrdinal) * ((gsize)matrix->numAttachedVertices)) + ((gsize)dstOrdinal);
+}
+
+/* returns TRUE and sets the properties if the path between the vertices was precomputed */
+static gboolean _topology_lookupPrecomputedPath(Topology* top, igraph_integer_t srcVertexIndex,
+        igraph_integer_t dstVertexIndex, gdouble* latencyOut, gdouble* reliabilityOut, gboolean* isDirectOut) {
+    MAGIC_ASSERT(top);
+
+    TopologyPathMatrix* matrix = top->pathMatrix;
+    if(!matrix || srcVertexIndex < 0 || dstVertexIndex < 0 ||
+            srcVertexIndex >= matrix->numVertices || dstVertexIndex >= matrix->numVertices) {
+        return FALSE;
+    }
+
+    gint srcOrdinal = matrix->vertexOrdinals[(gsize)srcVertexIndex];
+    gint dstOrdinal = matrix->vertexOrdinals[(gsize)dstVertexIndex];
+    if(srcOrdinal < 0 || dstOrdinal < 0) {
+        /* the host was attached after we computed the matrix */
+        return FALSE;
+    }
+
+    gsize position = _topology_getPathMatrixPosition(matrix, (guint)srcOrdinal, (guint)dstOrdinal);
+    gdouble latency = matrix->latencies[position];
+    if(latency < 0) {
+        return FALSE;
+    }
+
+    if(latencyOut) {
+        *latencyOut = latency;
+    }
+    if(reliabilityOut) {
+        *reliabilityOut = matrix->reliabilities[position];
+    }
+    if(isDirectOut) {
+        *isDirectOut = matrix->isDirectPaths[position] ? TRUE : FALSE;
+    }
+    return TRUE;
+}
+
+typedef struct _TopologyHeapEntry TopologyHeapEntry;
+struct _TopologyHeapEntry {
+    gdouble latency;
+    guint vertexIndex;
+};
+
+typedef struct _TopologyPrecomputeJob TopologyPrecomputeJob;
+struct _TopologyPrecomputeJob {
+    TopologyArcs* arcs;
+    TopologyPathMatrix* matrix;
+    gboolean isDirected;
+    gboolean isComplete;
+    gboolean prefersDirectPaths;
+    /* the next source ordinal to compute, each thread claims one at a time */
+    volatile gint nextSourceOrdinal;
+};
+
+typedef struct _TopologyPrecomputeThread TopologyPrecomputeThread;
+struct _TopologyPrecomputeThread {
+    TopologyPrecomputeJob* job;
+    GThread* thread;
+
+    /* scratch space for dijkstra, indexed by vertex */
+    gdouble* pathLatencies;
+    guint* previousVertices;
+    guint* previousArcs;
+    guint8* isSettled;
+    gint* directArcs;
+    TopologyHeapEntry* heap;
+    guint heapSize;
+
+    /* results that the main thread merges and logs, since these threads can't log */
+    gdouble minimumPathLatency;
+    guint dijkstraCount;
+    guint pathCount;
+    guint missingPathCount;
+    guint zeroLatencyPathCount;
+};
+
+static void _topology_pushHeap(TopologyPrecomputeThread* thread, gdouble latency, guint vertexIndex) {
+    guint position = thread->heapSize++;
+    while(position > 0) {
+        guint parent = (position - 1) / 2;
+        if(thread->heap[parent].latency <= latency) {
+            break;
+        }
+        thread->heap[position] = thread->heap[parent];
+        position = parent;
+    }
+    thread->heap[position].latency = latency;
+    thread->heap[position].vertexIndex = vertexIndex;
+}
+
+static TopologyHeapEntry _topology_popHeap(TopologyPrecomputeThread* thread) {
+    utility_assert(thread->heapSize > 0);
+    TopologyHeapEntry minimum = thread->heap[0];
+    TopologyHeapEntry last = thread->heap[--thread->heapSize];
+
+    guint position = 0;
+    while(TRUE) {
+        guint child = (2 * position) + 1;
+        if(child >= thread->heapSize) {
+            break;
+        }
+        if(child + 1 < thread->heapSize && thread->heap[child + 1].latency < thread->heap[child].latency) {
+            child++;
+        }
+        if(last.latency <= thread->heap[child].latency) {
+            break;
+        }
+        thread->heap[position] = thread->heap[child];
+        position = child;
+    }
+    if(thread->heapSize > 0) {
+        thread->heap[position] = last;
+    }
+
+    return minimum;
+}
+
+/* computes the shortest path latency from the source to every vertex with attached hosts */
+static void _topology_runDijkstra(TopologyPrecomputeThread* thread, guint srcVertexIndex) {
+    TopologyArcs* arcs = thread->job->arcs;
+    TopologyPathMatrix* matrix = thread->job->matrix;
+
+    for(guint vertexIndex = 0; vertexIndex < arcs->numVertices; vertexIndex++) {
+        thread->pathLatencies[vertexIndex] = -1.0f;
+        thread->isSettled[vertexIndex] = 0;
+    }
+
+    guint numSettledTargets = 0;
+    thread->heapSize = 0;
+    thread->pathLatencies[srcVertexIndex] = 0.0f;
+    _topology_pushHeap(thread, 0.0f, srcVertexIndex);
+
+    while(thread->heapSize > 0 && numSettledTargets < matrix->numAttachedVertices) {
+        TopologyHeapEntry entry = _topology_popHeap(thread);
+        guint vertexIndex = entry.vertexIndex;
+
+        if(thread->isSettled[vertexIndex]) {
+            continue;
+        }
+        thread->isSettled[vertexIndex] = 1;
+        if(matrix->vertexOrdinals[vertexIndex] >= 0) {
+            numSettledTargets++;
+        }
+
+        for(guint arcIndex = arcs->offsets[vertexIndex]; arcIndex < arcs->offsets[vertexIndex + 1]; arcIndex++) {
+            guint targetIndex = arcs->targets[arcIndex];
+            gdouble latency = entry.latency + arcs->latencies[arcIndex];
+
+            if(!thread->isSettled[targetIndex] &&
+                    (thread->pathLatencies[targetIndex] < 0 || latency < thread->pathLatencies[targetIndex])) {
+                thread->pathLatencies[targetIndex] = latency;
+                thread->previousVertices[targetIndex] = vertexIndex;
+                thread->previousArcs[targetIndex] = arcIndex;
+                _topology_pushHeap(thread, latency, targetIndex);
+            }
+        }
+    }
+
+    thread->dijkstraCount++;
+}
+
+/* the path properties here must match those that the lazy lookup in topology_getPath
+ * would compute for the same vertices. returns FALSE if there is no path. */
+static gboolean _topology_precomputePath(TopologyPrecomputeThread* thread, guint srcVertexIndex,
+        guint dstVertexIndex, gboolean* hasRunDijkstra,
+        gdouble* latencyOut, gdouble* reliabilityOut, gboolean* isDirectOut) {
+    TopologyPrecomputeJob* job = thread->job;
+    TopologyArcs* arcs = job->arcs;
+
+    gint directArcIndex = thread->directArcs[dstVertexIndex];
+
+    if(job->isComplete || (job->prefersDirectPaths && directArcIndex >= 0)) {
+        /* see _topology_lookupDirectPath */
+        if(directArcIndex < 0) {
+            return FALSE;
+        }
+        *latencyOut = arcs->latencies[directArcIndex];
+        *reliabilityOut = arcs->vertexReliabilities[srcVertexIndex] *
+                arcs->vertexReliabilities[dstVertexIndex] * arcs->reliabilities[directArcIndex];
+        *isDirectOut = TRUE;
+        return TRUE;
+    }
+
+    *isDirectOut = FALSE;
+
+    if(srcVertexIndex == dstVertexIndex) {
+        /* see _topology_computeShortestPathToSelf */
+        gdouble minLatency = 0.0f;
+        gdouble reliabilityOfMinLatencyArc = 0.0f;
+        gboolean found = FALSE;
+
+        for(guint arcIndex = arcs->offsets[srcVertexIndex]; arcIndex < arcs->offsets[srcVertexIndex + 1]; arcIndex++) {
+            if(minLatency == 0 || arcs->latencies[arcIndex] < minLatency) {
+                minLatency = arcs->latencies[arcIndex];
+                reliabilityOfMinLatencyArc = arcs->reliabilities[arcIndex];
+                found = TRUE;
+            }
+        }
+
+        if(!found) {
+            return FALSE;
+        }
+
+        *latencyOut = 2.0f * minLatency;
+        *reliabilityOut = reliabilityOfMinLatencyArc * reliabilityOfMinLatencyArc;
+        return TRUE;
+    }
+
+    /* see _topology_computeSourcePaths and _topology_computePathProperties */
+    if(!(*hasRunDijkstra)) {
+        _topology_runDijkstra(thread, srcVertexIndex);
+        *hasRunDijkstra = TRUE;
+    }
+
+    if(thread->pathLatencies[dstVertexIndex] < 0) {
+        return FALSE;
+    }
+
+    gdouble reliability = arcs->vertexReliabilities[srcVertexIndex] * arcs->vertexReliabilities[dstVertexIndex];
+    for(guint vertexIndex = dstVertexIndex; vertexIndex != srcVertexIndex;
+            vertexIndex = thread->previousVertices[vertexIndex]) {
+        reliability *= arcs->reliabilities[thread->previousArcs[vertexIndex]];
+    }
+
+    gdouble latency = thread->pathLatencies[dstVertexIndex];
+    if(latency == 0) {
+        thread->zeroLatencyPathCount++;
+        latency = 1;
+    }
+
+    *latencyOut = latency;
+    *reliabilityOut = reliability;
+    return TRUE;
+}
+
+static void _topology_storePrecomputedPath(TopologyPrecomputeThread* thread, guint srcOrdinal,
+        guint dstOrdinal, gdouble latency, gdouble reliability, gboolean isDirect) {
+    TopologyPathMatrix* matrix = thread->job->matrix;
+
+    gsize position = _topology_getPathMatrixPosition(matrix, srcOrdinal, dstOrdinal);
+    matrix->latencies[position] = latency;
+    matrix->reliabilities[position] = reliability;
+    matrix->isDirectPaths[position] = isDirect ? 1 : 0;
+
+    if(!thread->job->isDirected) {
+        /* no other thread writes this entry, since it only computes rows with
+         * a destination ordinal at least as large as its source ordinal */
+        position = _topology_getPathMatrixPosition(matrix, dstOrdinal, srcOrdinal);
+        matrix->latencies[position] = latency;
+        matrix->reliabilities[position] = reliability;
+        matrix->isDirectPaths[position] = isDirect ? 1 : 0;
+    }
+
+    if(thread->minimumPathLatency == 0 || latency < thread->minimumPathLatency) {
+        thread->minimumPathLatency = latency;
+    }
+    thread->pathCount++;
+}
+
+static void _topology_precomputeSourcePaths(TopologyPrecomputeThread* thread, guint srcOrdinal) {
+    TopologyPrecomputeJob* job = thread->job;
+    TopologyArcs* arcs = job->arcs;
+    TopologyPathMatrix* matrix = job->matrix;
+
+    guint srcVertexIndex = (guint) matrix->attachedVertices[srcOrdinal];
+
+    /* remember the first edge to each neighbor, like igraph_get_eid */
+    for(guint arcIndex = arcs->offsets[srcVertexIndex]; arcIndex < arcs->offsets[srcVertexIndex + 1]; arcIndex++) {
+        if(thread->directArcs[arcs->targets[arcIndex]] < 0) {
+            thread->directArcs[arcs->targets[arcIndex]] = (gint) arcIndex;
+        }
+    }
+
+    gboolean hasRunDijkstra = FALSE;
+    guint firstDstOrdinal = job->isDirected ? 0 : srcOrdinal;
+
+    for(guint dstOrdinal = firstDstOrdinal; dstOrdinal < matrix->numAttachedVertices; dstOrdinal++) {
+        guint dstVertexIndex = (guint) matrix->attachedVertices[dstOrdinal];
+
+        gdouble latency = 0.0f, reliability = 0.0f;
+        gboolean isDirect = FALSE;
+
+        if(_topology_precomputePath(thread, srcVertexIndex, dstVertexIndex, &hasRunDijkstra,
+                &latency, &reliability, &isDirect)) {
+            _topology_storePrecomputedPath(thread, srcOrdinal, dstOrdinal, latency, reliability, isDirect);
+        } else {
+            thread->missingPathCount++;
+        }
+    }
+
+    for(guint arcIndex = arcs->offsets[srcVertexIndex]; arcIndex < arcs->offsets[srcVertexIndex + 1]; arcIndex++) {
+        thread->directArcs[arcs->targets[arcIndex]] = -1;
+    }
+}
+
+static gpointer _topology_runPrecomputeThread(TopologyPrecomputeThread* thread) {
+    TopologyPrecomputeJob* job = thread->job;
+    TopologyArcs* arcs = job->arcs;
+
+    thread->pathLatencies = g_new0(gdouble, arcs->numVertices);
+    thread->previousVertices = g_new0(guint, arcs->numVertices);
+    thread->previousArcs = g_new0(guint, arcs->numVertices);
+    thread->isSettled = g_new0(guint8, arcs->numVertices);
+    thread->directArcs = g_new(gint, arcs->numVertices);
+    for(guint vertexIndex = 0; vertexIndex < arcs->numVertices; vertexIndex++) {
+        thread->directArcs[vertexIndex] = -1;
+    }
+    /* each arc is pushed at most once, plus the source */
+    thread->heap = g_new0(TopologyHeapEntry, arcs->offsets[arcs->numVertices] + 1);
+
+    while(TRUE) {
+        gint srcOrdinal = g_atomic_int_add(&job->nextSourceOrdinal, 1);
+        if(srcOrdinal >= (gint)job->matrix->numAttachedVertices) {
+            break;
+        }
+        _topology_precomputeSourcePaths(thread, (guint)srcOrdinal);
+    }
+
+    g_free(thread->pathLatencies);
+    g_free(thread->previousVertices);
+    g_free(thread->previousArcs);
+    g_free(thread->isSettled);
+    g_free(thread->directArcs);
+    g_free(thread->heap);
+
+    return NULL;
+}
+
+gboolean topology_precomputePaths(Topology* top, guint nThreads, gdouble* minimumPathLatencyOut) {
+    MAGIC_ASSERT(top);
+    utility_assert(top->pathMatrix == NULL);
+
+    GTimer* precomputeTimer = g_timer_new();
+
+    TopologyArcs* arcs = _topology_newArcs(top);
+    if(!arcs) {
+        g_timer_destroy(precomputeTimer);
+        critical("unable to read the topology graph, paths will be computed on demand instead");
+        return FALSE;
+    }
+
+    TopologyPrecomputeJob job;
+    memset(&job, 0, sizeof(TopologyPrecomputeJob));
+    job.arcs = arcs;
+    job.matrix = _topology_newPathMatrix(top);
+    job.isDirected = top->isDirected ? TRUE : FALSE;
+    job.isComplete = top->isComplete ? TRUE : FALSE;
+    job.prefersDirectPaths = top->prefersDirectPaths;
+
+    nThreads = MAX(nThreads, 1);
+    nThreads = MIN(nThreads, MAX(job.matrix->numAttachedVertices, 1));
+
+    message("precomputing paths between all %u vertices with attached hosts using %u threads",
+            job.matrix->numAttachedVertices, nThreads);
+
+    /* these threads only read the graph copy and each write to their own rows */
+    TopologyPrecomputeThread* threads = g_new0(TopologyPrecomputeThread, nThreads);
+    for(guint i = 0; i < nThreads; i++) {
+        threads[i].job = &job;
+        threads[i].thread = g_thread_new("topology-precompute",
+                (GThreadFunc)_topology_runPrecomputeThread, &threads[i]);
+    }
+
+    gdouble minimumPathLatency = 0.0f;
+    guint dijkstraCount = 0, pathCount = 0, missingPathCount = 0, zeroLatencyPathCount = 0;
+
+    for(guint i = 0; i < nThreads; i++) {
+        g_thread_join(threads[i].thread);
+
+        if(threads[i].minimumPathLatency > 0 &&
+                (minimumPathLatency == 0 || threads[i].minimumPathLatency < minimumPathLatency)) {
+            minimumPathLatency = threads[i].minimumPathLatency;
+        }
+        dijkstraCount += threads[i].dijkstraCount;
+        pathCount += threads[i].pathCount;
+        missingPathCount += threads[i].missingPathCount;
+        zeroLatencyPathCount += threads[i].zeroLatencyPathCount;
+    }
+
+    g_free(threads);
+    _topology_freeArcs(arcs);
+
+    gdouble elapsedSeconds = g_timer_elapsed(precomputeTimer, NULL);
+    g_timer_destroy(precomputeTimer);
+
+    if(zeroLatencyPathCount > 0) {
+        warning("found %u shortest paths with a latency of 0 ms, using 1 ms instead", zeroLatencyPathCount);
+    }
+    if(missingPathCount > 0) {
+        warning("unable to precompute %u paths, they will be computed on demand instead", missingPathCount);
+    }
+
+    gsize matrixBytes = _topology_getPathMatrixSize(job.matrix);
+    message("precomputed %u paths with %u runs of dijkstra in %f seconds; the path matrix for %u "
+            "vertices with attached hosts uses %"G_GSIZE_FORMAT" bytes (%f MiB), and path lookups "
+            "no longer need to lock the graph",
+            pathCount, dijkstraCount, elapsedSeconds, job.matrix->numAttachedVertices,
+            matrixBytes, ((gdouble)matrixBytes) / (1024.0f * 1024.0f));
+
+    g_mutex_lock(&top->topologyLock);
+    top->shortestPathTotalTime += elapsedSeconds;
+    top->shortestPathCount += dijkstraCount;
+    g_mutex_unlock(&top->topologyLock);
+
+    g_rw_lock_writer_lock(&(top->pathCacheLock));
+    if(minimumPathLatency > 0 && (top->minimumPathLatency == 0 || minimumPathLatency < top->minimumPathLatency)) {
+        top->minimumPathLatency = minimumPathLatency;
+    }
+    g_rw_lock_writer_unlock(&(top->pathCacheLock));
+
+    /* the matrix is read-only from now on */
+    top->pathMatrix = job.matrix;
+
+    if(minimumPathLatencyOut) {
+        *minimumPathLatencyOut = minimumPathLatency;
+    }
+
+    return TRUE;
+}
+
+static Path* _topology_getPrecomputedPath(Topology* top, igraph_integer_t srcVertexIndex,
+        igraph_integer_t dstVertexIndex) {
+    MAGIC_ASSERT(top);
+
+    gdouble latency = 0.0f, reliability = 0.0f;
+    gboolean isDirect = FALSE;
+    if(!_topology_lookupPrecomputedPath(top, srcVertexIndex, dstVertexIndex, &latency, &reliability, &isDirect)) {
+        return NULL;
+    }
+
+    /* the path object is only needed to count packets, so we create it the first
+     * time it is requested instead of creating one for every entry in the matrix */
+    g_rw_lock_writer_lock(&(top->pathCacheLock));
+
+    /* someone may have created it while we were waiting for the lock */
+    Path* path = _topology_lookupPathInCache(top, srcVertexIndex, dstVertexIndex);
+    if(!path && !top->isDirected) {
+        path = _topology_lookupPathInCache(top, dstVertexIndex, srcVertexIndex);
+    }
+
+    if(!path) {
+        path = path_new(isDirect, (gint64)srcVertexIndex, (gint64)dstVertexIndex, latency, reliability);
+        _topology_insertPathInCache(top, path);
+    }
+
+    g_rw_lock_writer_unlock(&(top->pathCacheLock));
+
+    return path;
+}
+
+Path* topology_getPath(Topology* top, Address* srcAddress, Address* dstAddress) {
     MAGIC_ASSERT(top);
 
     /* get connected points */
@@ -1974,13 +2666,13 @@ static Path* _topology_getPathEntry(Topology* top, Address* srcAddress, Address*
     if(srcVertexIndex < 0) {
         critical("invalid vertex %i, source address %s is not connected to topology",
                 (gint)srcVertexIndex, address_toString(srcAddress));
-        return FALSE;
+        return NULL;
     }
     igraph_integer_t dstVertexIndex = _topology_getConnectedVertexIndex(top, dstAddress);
     if(dstVertexIndex < 0) {
         critical("invalid vertex %i, destination address %s is not connected to topology",
                 (gint)dstVertexIndex, address_toString(dstAddress));
-        return FALSE;
+        return NULL;
     }
 
     /* check for a cache hit */
@@ -1989,6 +2681,10 @@ static Path* _topology_getPathEntry(Topology* top, Address* srcAddress, Address*
         path = _topology_getPathFromCache(top, dstVertexIndex, srcVertexIndex);
     }
 
+    if(!path && top->pathMatrix) {
+        path = _topology_getPrecomputedPath(top, srcVertexIndex, dstVertexIndex);
+    }
+
     if(!path) {
         /* cache miss, lets find the path */
         gboolean success = FALSE;
@@ -2053,7 +2749,7 @@ static Path* _topology_getPathEntry(Topology* top, Address* srcAddress, Address*
 void topology_incrementPathPacketCounter(Topology* top, Address* srcAddress, Address* dstAddress) {
     MAGIC_ASSERT(top);
 
-    Path* path = _topology_getPathEntry(top, srcAddress, dstAddress);
+    Path* path = topology_getPath(top, srcAddress, dstAddress);
     if(path != NULL) {
         path_incrementPacketCount(path);
     } else {
@@ -2065,7 +2761,15 @@ void topology_incrementPathPacketCounter(Topology* top, Address* srcAddress, Add
 gdouble topology_getLatency(Topology* top, Address* srcAddress, Address* dstAddress) {
     MAGIC_ASSERT(top);
 
-    Path* path = _topology_getPathEntry(top, srcAddress, dstAddress);
+    if(top->pathMatrix) {
+        gdouble latency = 0.0f;
+        if(_topology_lookupPrecomputedPath(top, _topology_getConnectedVertexIndex(top, srcAddress),
+                _topology_getConnectedVertexIndex(top, dstAddress), &latency, NULL, NULL)) {
+            return latency;
+        }
+    }
+
+    Path* path = topology_getPath(top, srcAddress, dstAddress);
 
     if(path != NULL) {
         return path_getLatency(path);
@@ -2077,7 +2781,15 @@ gdouble topology_getLatency(Topology* top, Address* srcAddress, Address* dstAddr
 gdouble topology_getReliability(Topology* top, Address* srcAddress, Address* dstAddress) {
     MAGIC_ASSERT(top);
 
-    Path* path = _topology_getPathEntry(top, srcAddress, dstAddress);
+    if(top->pathMatrix) {
+        gdouble reliability = 0.0f;
+        if(_topology_lookupPrecomputedPath(top, _topology_getConnectedVertexIndex(top, srcAddress),
+                _topology_getConnectedVertexIndex(top, dstAddress), NULL, &reliability, NULL)) {
+            return reliability;
+        }
+    }
+
+    Path* path = topology_getPath(top, srcAddress, dstAddress);
 
     if(path != NULL) {
         return path_getReliability(path);
@@ -2086,6 +2798,34 @@ gdouble topology_getReliability(Topology* top, Address* srcAddress, Address* dst
     }
 }
 
+gdouble topology_getMinimumOutgoingLatency(Topology* top, Address* srcAddress) {
+    MAGIC_ASSERT(top);
+
+    TopologyPathMatrix* matrix = top->pathMatrix;
+    if(!matrix) {
+        return (gdouble) -1;
+    }
+
+    igraph_integer_t srcVertexIndex = _topology_getConnectedVertexIndex(top, srcAddress);
+    if(srcVertexIndex < 0 || srcVertexIndex >= matrix->numVertices ||
+            matrix->vertexOrdinals[(gsize)srcVertexIndex] < 0) {
+        return (gdouble) -1;
+    }
+
+    guint srcOrdinal = (guint) matrix->vertexOrdinals[(gsize)srcVertexIndex];
+    gdouble minLatency = -1.0;
+
+    /* pairs without a path are never used, so they don't limit the minimum */
+    for(guint dstOrdinal = 0; dstOrdinal < matrix->numAttachedVertices; dstOrdinal++) {
+        gdouble latency = matrix->latencies[_topology_getPathMatrixPosition(matrix, srcOrdinal, dstOrdinal)];
+        if(latency >= 0 && (minLatency < 0 || latency < minLatency)) {
+            minLatency = latency;
+        }
+    }
+
+    return minLatency;
+}
+
 gboolean topology_isRoutable(Topology* top, Address* srcAddress, Address* dstAddress) {
     MAGIC_ASSERT(top);
     return (topology_getLatency(top, srcAddress, dstAddress) > -1) ? TRUE : FALSE;
@@ -2461,6 +3201,12 @@ void topology_free(Topology* top) {
     _topology_clearCache(top);
     g_rw_lock_clear(&(top->pathCacheLock));
 
+    /* nobody else is using the topology by now */
+    if(top->pathMatrix) {
+        _topology_freePathMatrix(top->pathMatrix);
+        top->pathMatrix = NULL;
+    }
+
     /* clear the stored edge weights */
     g_rw_lock_writer_lock(&(top->edgeWeightsLock));
     if(top->edgeWeights) {
@@ -10,6 +10,7 @@
 #include <glib.h>
 
 #include "main/routing/address.h"
+#include "main/routing/path.h"
 #include "main/utility/random.h"
 
 typedef struct _Topology Topology;
@@ -22,6 +23,22 @@ void topology_attach(Topology* top, Address* address, Random* randomSourcePool,
         guint64* bwDownOut, guint64* bwUpOut);
 void topology_detach(Topology* top, Address* address);
 
+/* compute the paths between all vertices with attached hosts using nThreads threads,
+ * and store them in a matrix that can be read without locking. this must be called
+ * after all hosts are attached and before the simulation starts. paths to hosts
+ * attached later are still computed on demand. the minimum latency of all
+ * precomputed paths is returned in minimumPathLatencyOut. */
+gboolean topology_precomputePaths(Topology* top, guint nThreads, gdouble* minimumPathLatencyOut);
+
+/* returns the path between the addresses, computing it if it is not yet cached.
+ * the path is owned by the topology and remains valid until the topology is freed,
+ * so callers may hold on to it to avoid repeating the lookup. */
+Path* topology_getPath(Topology* top, Address* srcAddress, Address* dstAddress);
+
+/* returns the minimum latency of the precomputed paths from the address to any vertex
+ * with attached hosts, or -1 if the paths were not precomputed */
+gdouble topology_getMinimumOutgoingLatency(Topology* top, Address* srcAddress);
+
 gboolean topology_isRoutable(Topology* top, Address* srcAddress, Address* dstAddress);
 gdouble topology_getLatency(Topology* top, Address* srcAddress, Address* dstAddress);
 gdouble topology_getReliability(Topology* top, Address* srcAddress, Address* dstAddress);
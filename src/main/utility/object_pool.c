@@ -0,0 +1,198 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/utility/object_pool.h"
+
+#include <glib.h>
+#include <string.h>
+
+#include "main/utility/utility.h"
+
+/* every object is preceded by a header that links it to its pool. the header
+ * is padded to 16 bytes so that the object keeps malloc's alignment. */
+typedef union _ObjectPoolHeader ObjectPoolHeader;
+union _ObjectPoolHeader {
+    struct {
+        /* the pool the object was allocated from, or NULL */
+        ObjectPool* owner;
+        /* the next free object while this one is on a free list */
+        ObjectPoolHeader* next;
+    };
+    gchar padding[16];
+};
+
+struct _ObjectPool {
+    gsize objectSize;
+
+    /* only touched by the owner thread. numInUse counts the objects that were
+     * allocated and not released by the owner. */
+    ObjectPoolHeader* freeList;
+    guint64 numInUse;
+    ObjectPoolStats stats;
+
+    /* the number of objects that other threads released, updated atomically so
+     * that the owner can subtract them from numInUse before it drains them */
+    guint64 numRemoteReleases;
+
+    /* objects released by other threads, pushed with compare-and-swap.
+     * only the owner pops from this list, and it always takes all of it. */
+    ObjectPoolHeader* remoteList;
+
+    /* one reference held by the owner and one for each allocated object */
+    gint referenceCount;
+
+    MAGIC_DECLARE;
+};
+
+static inline ObjectPoolHeader* _objectpool_getHeader(gpointer object) {
+    return ((ObjectPoolHeader*)object) - 1;
+}
+
+static inline gpointer _objectpool_getObject(ObjectPoolHeader* header) {
+    return (gpointer)(header + 1);
+}
+
+static ObjectPoolHeader* _objectpool_takeRemoteList(ObjectPool* pool) {
+    ObjectPoolHeader* list = NULL;
+    do {
+        list = g_atomic_pointer_get(&pool->remoteList);
+    } while(list && !g_atomic_pointer_compare_and_exchange(&pool->remoteList, list, NULL));
+    return list;
+}
+
+static void _objectpool_freeList(ObjectPoolHeader* header) {
+    while(header) {
+        ObjectPoolHeader* next = header->next;
+        g_free(header);
+        header = next;
+    }
+}
+
+static void _objectpool_destroy(ObjectPool* pool) {
+    _objectpool_freeList(pool->freeList);
+    _objectpool_freeList(_objectpool_takeRemoteList(pool));
+    MAGIC_CLEAR(pool);
+    g_free(pool);
+}
+
+static void _objectpool_unref(ObjectPool* pool) {
+    if(g_atomic_int_dec_and_test(&pool->referenceCount)) {
+        _objectpool_destroy(pool);
+    }
+}
+
+ObjectPool* objectpool_new(gsize objectSize) {
+    utility_assert(objectSize > 0);
+
+    ObjectPool* pool = g_new0(ObjectPool, 1);
+    MAGIC_INIT(pool);
+
+    pool->objectSize = objectSize;
+    pool->referenceCount = 1;
+
+    return pool;
+}
+
+void objectpool_free(ObjectPool* pool) {
+    MAGIC_ASSERT(pool);
+
+    /* nobody will allocate from the free lists again */
+    _objectpool_freeList(pool->freeList);
+    pool->freeList = NULL;
+    _objectpool_freeList(_objectpool_takeRemoteList(pool));
+
+    _objectpool_unref(pool);
+}
+
+gpointer objectpool_alloc(ObjectPool* pool, gsize objectSize) {
+    ObjectPoolHeader* header = NULL;
+
+    if(pool) {
+        MAGIC_ASSERT(pool);
+        utility_assert(objectSize == pool->objectSize);
+
+        if(!pool->freeList) {
+            /* collect the objects that other threads returned to us */
+            ObjectPoolHeader* returned = _objectpool_takeRemoteList(pool);
+            while(returned) {
+                ObjectPoolHeader* next = returned->next;
+                returned->next = pool->freeList;
+                pool->freeList = returned;
+                returned = next;
+                pool->stats.numRemoteReturns++;
+            }
+        }
+
+        if(pool->freeList) {
+            header = pool->freeList;
+            pool->freeList = header->next;
+            pool->stats.numHits++;
+        } else {
+            header = g_malloc(sizeof(ObjectPoolHeader) + pool->objectSize);
+            pool->stats.numMisses++;
+        }
+
+        g_atomic_int_inc(&pool->referenceCount);
+        pool->numInUse++;
+        guint64 numRemoteReleases = __atomic_load_n(&pool->numRemoteReleases, __ATOMIC_RELAXED);
+        pool->stats.maxInUse = MAX(pool->stats.maxInUse, pool->numInUse - numRemoteReleases);
+    } else {
+        header = g_malloc(sizeof(ObjectPoolHeader) + objectSize);
+    }
+
+    header->owner = pool;
+    header->next = NULL;
+
+    gpointer object = _objectpool_getObject(header);
+    memset(object, 0, pool ? pool->objectSize : objectSize);
+    return object;
+}
+
+void objectpool_release(ObjectPool* localPool, gpointer object) {
+    if(!object) {
+        return;
+    }
+
+    ObjectPoolHeader* header = _objectpool_getHeader(object);
+    ObjectPool* owner = header->owner;
+
+    if(!owner) {
+        g_free(header);
+        return;
+    }
+
+    MAGIC_ASSERT(owner);
+
+    if(owner == localPool) {
+        /* we own the pool, so nobody else touches the free list */
+        header->next = owner->freeList;
+        owner->freeList = header;
+        owner->numInUse--;
+        /* can't drop to 0 while we still hold the owner reference */
+        g_atomic_int_add(&owner->referenceCount, -1);
+    } else {
+        /* the object no longer counts as in use, even before the owner drains it */
+        __atomic_add_fetch(&owner->numRemoteReleases, 1, __ATOMIC_RELAXED);
+
+        while(TRUE) {
+            ObjectPoolHeader* head = g_atomic_pointer_get(&owner->remoteList);
+            header->next = head;
+            if(g_atomic_pointer_compare_and_exchange(&owner->remoteList, head, header)) {
+                break;
+            }
+            /* another thread returned an object at the same time */
+            utility_cpuRelax();
+        }
+
+        /* the owner may have freed the pool already, in which case the
+         * last object to come back cleans it up */
+        _objectpool_unref(owner);
+    }
+}
+
+const ObjectPoolStats* objectpool_getStats(ObjectPool* pool) {
+    MAGIC_ASSERT(pool);
+    return &pool->stats;
+}
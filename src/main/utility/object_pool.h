@@ -0,0 +1,59 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_OBJECT_POOL_H_
+#define SHD_OBJECT_POOL_H_
+
+#include <glib.h>
+
+/**
+ * A pool of fixed-size objects owned by a single thread. Released objects are
+ * kept on a free list and handed out again by later allocations, which avoids
+ * the system allocator for objects that are created and destroyed at high
+ * rates (e.g., events, tasks, and packets).
+ *
+ * Every object remembers the pool it was allocated from. Objects released by
+ * the owner thread go directly onto the pool's free list; objects released by
+ * any other thread are pushed onto a lock-free return list that the owner
+ * drains the next time its free list runs empty. That way objects flow back
+ * to the thread that creates them even when another thread destroys them.
+ *
+ * objectpool_alloc and objectpool_free must only be called by the owner
+ * thread. objectpool_release may be called by any thread. The pool memory is
+ * kept until the owner has freed the pool and every object allocated from it
+ * has been released.
+ */
+
+typedef struct _ObjectPool ObjectPool;
+
+typedef struct _ObjectPoolStats ObjectPoolStats;
+struct _ObjectPoolStats {
+    /* allocations served from the free list */
+    guint64 numHits;
+    /* allocations that had to go to the system allocator */
+    guint64 numMisses;
+    /* objects released by other threads and returned to the owner */
+    guint64 numRemoteReturns;
+    /* the largest number of objects that were allocated and not yet released.
+     * objects released by other threads count as released right away, not when
+     * the owner drains them, though the owner may see such releases slightly late. */
+    guint64 maxInUse;
+};
+
+ObjectPool* objectpool_new(gsize objectSize);
+/* releases the owner's reference to the pool. objects that are still
+ * allocated stay valid and may still be released from any thread. */
+void objectpool_free(ObjectPool* pool);
+
+/* returns a cleared object from the pool. if pool is NULL, the object is
+ * allocated directly and objectSize is used as its size. */
+gpointer objectpool_alloc(ObjectPool* pool, gsize objectSize);
+/* returns the object to the pool it was allocated from. localPool is the
+ * calling thread's own pool for objects of this type, or NULL if it has none. */
+void objectpool_release(ObjectPool* localPool, gpointer object);
+
+const ObjectPoolStats* objectpool_getStats(ObjectPool* pool);
+
+#endif /* SHD_OBJECT_POOL_H_ */
@@ -0,0 +1,166 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/utility/round_barrier.h"
+
+#include <glib.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "main/utility/utility.h"
+
+/* bounds and starting point for the number of polls before a waiter sleeps */
+#define ROUNDBARRIER_MIN_SPINS (1 << 6)
+#define ROUNDBARRIER_MAX_SPINS (1 << 16)
+#define ROUNDBARRIER_INITIAL_SPINS (1 << 10)
+
+struct _RoundBarrier {
+    /* the parties that have not yet arrived in the current generation */
+    volatile gint numRemaining;
+    /* advanced by every release. parties wait for it to change, so its
+     * parity is the barrier sense. */
+    volatile gint generation;
+
+    /* the number of threads sleeping in the kernel on each of the above, so
+     * that releasing threads only make the wake syscall when needed */
+    volatile gint numRemainingSleepers;
+    volatile gint numGenerationSleepers;
+
+    /* grows when waits finish while spinning and shrinks when they don't */
+    volatile gint spinLimit;
+
+    guint numParties;
+    gboolean hasCoordinator;
+
+    MAGIC_DECLARE;
+};
+
+static void _roundbarrier_futexWait(volatile gint* address, gint value) {
+    /* returns immediately if *address no longer holds value; spurious wakeups
+     * are handled by our callers, which re-check the value in a loop */
+    syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+}
+
+static void _roundbarrier_futexWakeAll(volatile gint* address) {
+    syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, G_MAXINT, NULL, NULL, 0);
+}
+
+/* block until *address no longer holds value */
+static void _roundbarrier_waitWhileEqual(RoundBarrier* barrier, volatile gint* address,
+        gint value, volatile gint* numSleepers) {
+    gint spinLimit = g_atomic_int_get(&barrier->spinLimit);
+
+    for(gint i = 0; i < spinLimit; i++) {
+        if(g_atomic_int_get(address) != value) {
+            if(spinLimit < ROUNDBARRIER_MAX_SPINS) {
+                g_atomic_int_set(&barrier->spinLimit, spinLimit * 2);
+            }
+            return;
+        }
+        utility_cpuRelax();
+    }
+
+    /* we spun without success; spin less next time. the limit is shared by all
+     * of the waiters, so concurrent updates may be lost, which is harmless. */
+    if(spinLimit > ROUNDBARRIER_MIN_SPINS) {
+        g_atomic_int_set(&barrier->spinLimit, spinLimit / 2);
+    }
+
+    /* the waker changes the value before checking the sleeper count, and we
+     * increment the count before checking the value, so a wakeup can't be lost */
+    g_atomic_int_inc(numSleepers);
+    while(g_atomic_int_get(address) == value) {
+        _roundbarrier_futexWait(address, value);
+    }
+    g_atomic_int_add(numSleepers, -1);
+}
+
+static void _roundbarrier_wakeAll(volatile gint* address, volatile gint* numSleepers) {
+    if(g_atomic_int_get(numSleepers) > 0) {
+        _roundbarrier_futexWakeAll(address);
+    }
+}
+
+static void _roundbarrier_advanceGeneration(RoundBarrier* barrier) {
+    /* the next generation's arrivals happen only after they see the new
+     * generation, so the count must be restored first */
+    g_atomic_int_set(&barrier->numRemaining, (gint)barrier->numParties);
+    g_atomic_int_inc(&barrier->generation);
+    _roundbarrier_wakeAll(&barrier->generation, &barrier->numGenerationSleepers);
+}
+
+RoundBarrier* roundbarrier_new(guint numParties, gboolean hasCoordinator) {
+    utility_assert(numParties > 0);
+
+    RoundBarrier* barrier = g_new0(RoundBarrier, 1);
+    MAGIC_INIT(barrier);
+
+    barrier->numParties = numParties;
+    barrier->hasCoordinator = hasCoordinator;
+    barrier->numRemaining = (gint)numParties;
+    barrier->spinLimit = ROUNDBARRIER_INITIAL_SPINS;
+
+    return barrier;
+}
+
+void roundbarrier_free(RoundBarrier* barrier) {
+    MAGIC_ASSERT(barrier);
+    MAGIC_CLEAR(barrier);
+    g_free(barrier);
+}
+
+gboolean roundbarrier_await(RoundBarrier* barrier) {
+    MAGIC_ASSERT(barrier);
+
+    /* this must be read before we arrive, since the generation may advance as
+     * soon as the count reaches zero */
+    gint generation = g_atomic_int_get(&barrier->generation);
+
+    if(g_atomic_int_dec_and_test(&barrier->numRemaining)) {
+        if(!barrier->hasCoordinator) {
+            _roundbarrier_advanceGeneration(barrier);
+            return TRUE;
+        }
+
+        /* let the coordinator know everyone is here, then wait like the others */
+        _roundbarrier_wakeAll(&barrier->numRemaining, &barrier->numRemainingSleepers);
+    }
+
+    _roundbarrier_waitWhileEqual(barrier, &barrier->generation, generation,
+            &barrier->numGenerationSleepers);
+    return FALSE;
+}
+
+void roundbarrier_awaitArrivals(RoundBarrier* barrier) {
+    MAGIC_ASSERT(barrier);
+    utility_assert(barrier->hasCoordinator);
+
+    /* the count changes with every arrival, so we don't let these waits
+     * influence the spin limit of the parties */
+    gint spinLimit = g_atomic_int_get(&barrier->spinLimit);
+    for(gint i = 0; i < spinLimit; i++) {
+        if(g_atomic_int_get(&barrier->numRemaining) == 0) {
+            return;
+        }
+        utility_cpuRelax();
+    }
+
+    /* only the last party to arrive wakes us */
+    g_atomic_int_inc(&barrier->numRemainingSleepers);
+    gint numRemaining = 0;
+    while((numRemaining = g_atomic_int_get(&barrier->numRemaining)) != 0) {
+        _roundbarrier_futexWait(&barrier->numRemaining, numRemaining);
+    }
+    g_atomic_int_add(&barrier->numRemainingSleepers, -1);
+}
+
+void roundbarrier_release(RoundBarrier* barrier) {
+    MAGIC_ASSERT(barrier);
+    utility_assert(barrier->hasCoordinator);
+
+    roundbarrier_awaitArrivals(barrier);
+    _roundbarrier_advanceGeneration(barrier);
+}
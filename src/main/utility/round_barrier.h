@@ -0,0 +1,44 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_ROUND_BARRIER_H_
+#define SHD_ROUND_BARRIER_H_
+
+#include <glib.h>
+
+/**
+ * A reusable thread barrier for synchronizing the scheduler rounds. Waiting
+ * threads first spin on the barrier generation for an adaptive number of
+ * iterations and then sleep on it with a futex, so short rounds avoid the
+ * mutex and condition variable wake-ups of a CountDownLatch. Each release
+ * advances the generation (i.e., reverses the barrier sense), so unlike a
+ * CountDownLatch the barrier never needs to be reset between uses.
+ *
+ * A barrier created with a coordinator has one extra party that does not
+ * arrive with the others. The coordinator waits for the other parties with
+ * roundbarrier_awaitArrivals, may then do work while they are held at the
+ * barrier, and lets them through with roundbarrier_release.
+ */
+
+typedef struct _RoundBarrier RoundBarrier;
+
+/* numParties is the number of threads that call roundbarrier_await, which
+ * does not include the coordinator if hasCoordinator is TRUE */
+RoundBarrier* roundbarrier_new(guint numParties, gboolean hasCoordinator);
+void roundbarrier_free(RoundBarrier* barrier);
+
+/* block until all parties have arrived and, if the barrier has a coordinator,
+ * until the coordinator has released them. returns TRUE in exactly one of the
+ * parties of a barrier without a coordinator (the last one to arrive). */
+gboolean roundbarrier_await(RoundBarrier* barrier);
+
+/* coordinator only: block until all parties have arrived. this may be called
+ * more than once before the parties are released. */
+void roundbarrier_awaitArrivals(RoundBarrier* barrier);
+/* coordinator only: waits for all parties to arrive if needed, and then
+ * releases them */
+void roundbarrier_release(RoundBarrier* barrier);
+
+#endif /* SHD_ROUND_BARRIER_H_ */
@@ -0,0 +1,125 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/utility/slab_cache.h"
+
+#include <glib.h>
+
+#include "main/utility/utility.h"
+
+/* blocks in the smallest size class hold this many bytes */
+#define SLAB_MIN_BLOCK_SHIFT 6
+/* blocks larger than 1 << SLAB_MAX_BLOCK_SHIFT bytes are never cached */
+#define SLAB_MAX_BLOCK_SHIFT 14
+#define SLAB_NUM_CLASSES (SLAB_MAX_BLOCK_SHIFT - SLAB_MIN_BLOCK_SHIFT + 1)
+
+/* a free block stores the link to the next free block in its own memory */
+typedef struct _SlabFreeBlock SlabFreeBlock;
+struct _SlabFreeBlock {
+    SlabFreeBlock* next;
+};
+
+typedef struct _SlabClass SlabClass;
+struct _SlabClass {
+    SlabFreeBlock* freeList;
+    guint numFree;
+    guint maxFree;
+};
+
+struct _SlabCache {
+    SlabClass classes[SLAB_NUM_CLASSES];
+    MAGIC_DECLARE;
+};
+
+static inline gint _slabcache_getClassIndex(gsize size) {
+    if(size > (((gsize)1) << SLAB_MAX_BLOCK_SHIFT)) {
+        return -1;
+    }
+
+    /* the index of the smallest power of two that is >= size */
+    gint shift = SLAB_MIN_BLOCK_SHIFT;
+    if(size > (((gsize)1) << SLAB_MIN_BLOCK_SHIFT)) {
+        shift = (gint)(sizeof(unsigned long) * 8) - __builtin_clzl((unsigned long)(size - 1));
+    }
+
+    return shift - SLAB_MIN_BLOCK_SHIFT;
+}
+
+static inline gsize _slabcache_getClassBlockSize(gint classIndex) {
+    return ((gsize)1) << (classIndex + SLAB_MIN_BLOCK_SHIFT);
+}
+
+SlabCache* slabcache_new(gsize maxCachedBytesPerClass) {
+    SlabCache* cache = g_new0(SlabCache, 1);
+    MAGIC_INIT(cache);
+
+    for(gint i = 0; i < SLAB_NUM_CLASSES; i++) {
+        cache->classes[i].maxFree =
+                (guint)(maxCachedBytesPerClass / _slabcache_getClassBlockSize(i));
+    }
+
+    return cache;
+}
+
+void slabcache_free(SlabCache* cache) {
+    MAGIC_ASSERT(cache);
+
+    for(gint i = 0; i < SLAB_NUM_CLASSES; i++) {
+        SlabFreeBlock* block = cache->classes[i].freeList;
+        while(block) {
+            SlabFreeBlock* next = block->next;
+            g_free(block);
+            block = next;
+        }
+    }
+
+    MAGIC_CLEAR(cache);
+    g_free(cache);
+}
+
+gpointer slabcache_alloc(SlabCache* cache, gsize size) {
+    gint classIndex = _slabcache_getClassIndex(size);
+
+    if(classIndex < 0) {
+        /* too large to be cached */
+        return g_malloc(size);
+    }
+
+    if(cache) {
+        MAGIC_ASSERT(cache);
+        SlabClass* slabClass = &cache->classes[classIndex];
+        if(slabClass->freeList) {
+            SlabFreeBlock* block = slabClass->freeList;
+            slabClass->freeList = block->next;
+            slabClass->numFree--;
+            return block;
+        }
+    }
+
+    /* always allocate the full class size so the block can be reused */
+    return g_malloc(_slabcache_getClassBlockSize(classIndex));
+}
+
+void slabcache_release(SlabCache* cache, gpointer block, gsize size) {
+    if(!block) {
+        return;
+    }
+
+    gint classIndex = _slabcache_getClassIndex(size);
+
+    if(cache && classIndex >= 0) {
+        MAGIC_ASSERT(cache);
+        SlabClass* slabClass = &cache->classes[classIndex];
+        if(slabClass->numFree < slabClass->maxFree) {
+            SlabFreeBlock* freeBlock = block;
+            freeBlock->next = slabClass->freeList;
+            slabClass->freeList = freeBlock;
+            slabClass->numFree++;
+            return;
+        }
+    }
+
+    g_free(block);
+}
@@ -0,0 +1,36 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_SLAB_CACHE_H_
+#define SHD_SLAB_CACHE_H_
+
+#include <glib.h>
+
+/**
+ * A per-thread cache of free memory blocks, grouped into power-of-two size
+ * classes. Blocks released to the cache are kept on a free list for their
+ * size class and handed out again by later allocations of that class, which
+ * avoids the system allocator for short-lived objects that are created and
+ * destroyed at high rates (e.g., packet payloads).
+ *
+ * A SlabCache is not thread-safe and must only be used by the thread that
+ * owns it. Every block is obtained from g_malloc, so a block allocated through
+ * one cache may be released to any other cache (or to a NULL cache, which
+ * frees it) as long as the same size is given on release.
+ */
+
+typedef struct _SlabCache SlabCache;
+
+SlabCache* slabcache_new(gsize maxCachedBytesPerClass);
+void slabcache_free(SlabCache* cache);
+
+/* returns a block of at least size bytes. the contents are not cleared.
+ * if cache is NULL, the block is allocated directly. */
+gpointer slabcache_alloc(SlabCache* cache, gsize size);
+/* returns the block to the cache. size must be the size given on allocation.
+ * if cache is NULL, or the size class is full, the block is freed. */
+void slabcache_release(SlabCache* cache, gpointer block, gsize size);
+
+#endif /* SHD_SLAB_CACHE_H_ */
@@ -90,4 +90,14 @@ gboolean utility_copyFile(const gchar* fromPath, const gchar* toPath);
 
 void utility_handleError(const gchar* file, gint line, const gchar* funtcion, const gchar* message);
 
+/* hints to the CPU that we are spinning while waiting for another thread */
+static inline void utility_cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#else
+    /* at least make the compiler reload what we are waiting on */
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
 #endif /* SHD_UTILITY_H_ */
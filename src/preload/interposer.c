@@ -30,7 +30,6 @@
 #include <sys/uio.h>
 
 #include "main/core/support/definitions.h"
-#include "main/core/worker.h"
 #include "main/host/process.h"
 #include "preload/preload_functions.h"
 
@@ -69,10 +68,14 @@ static FuncDirector director;
 static int directorIsInitialized;
 
 /* track if we are in a recursive loop to avoid infinite recursion.
- * threads MUST access this via &isRecursive to ensure each has its own copy
- * http://gcc.gnu.org/onlinedocs/gcc-4.3.6/gcc/Thread_002dLocal.html */
+ * each thread has its own copy, so it needs no atomic operations. */
 static __thread unsigned long isRecursive = 0;
 
+/* the process whose plug-in code is running on this thread, or NULL while
+ * shadow itself is running. shadow keeps it up to date on every process
+ * context change, so that intercepted calls don't have to ask shadow. */
+static __thread Process* emulatedProcess = NULL;
+
 /* provide a way to disable and enable interposition */
 static __thread unsigned long disableCount = 0;
 
@@ -121,6 +124,10 @@ int interposer_setShadowIsLoaded(int isLoaded) {
     return 0;
 }
 
+void interposer_setEmulatedProcess(Process* proc) {
+    emulatedProcess = proc;
+}
+
 static void _interposer_globalInitializeHelper() {
     if(directorIsInitialized) {
         return;
@@ -153,10 +160,10 @@ static void _interposer_globalInitializeHelper() {
 
 static void _interposer_globalInitialize() {
     /* ensure we recursively intercept during initialization */
-    if(!__sync_fetch_and_add(&isRecursive, 1)){
+    if(!isRecursive++){
         _interposer_globalInitializeHelper();
     }
-    __sync_fetch_and_sub(&isRecursive, 1);
+    isRecursive--;
 }
 
 /* this function is called when the library is loaded,
@@ -179,21 +186,13 @@ static inline Process* _doEmulate() {
     if(!directorIsInitialized) {
         _interposer_globalInitialize();
     }
-    Process* proc = NULL;
-    /* recursive calls always go to libc */
-    if(!__sync_fetch_and_add(&isRecursive, 1)) {
-        proc = director.shadowIsLoaded && (*(&disableCount)) <= 0 && worker_isAlive() ? worker_getActiveProcess() : NULL;
-        /* check if the shadow intercept library is loaded yet, but dont fail if its not */
-        if(proc) {
-            /* ask shadow if this call is a plug-in that should be intercepted */
-            proc = process_shouldEmulate(proc) ? proc : NULL;
-        } else {
-            /* intercept library is not yet loaded, don't redirect */
-            proc = NULL;
-        }
+    /* recursive calls always go to libc. emulatedProcess is only ever set by
+     * shadow, and only while a plug-in is running, so it is NULL whenever the
+     * intercept library is not loaded yet or shadow itself is running. */
+    if(isRecursive || disableCount > 0 || !director.shadowIsLoaded) {
+        return NULL;
     }
-    __sync_fetch_and_sub(&isRecursive, 1);
-    return proc;
+    return emulatedProcess;
 }
 
 /****************************************************************************
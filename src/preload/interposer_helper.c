@@ -4,3 +4,9 @@
 int interposer_setShadowIsLoaded(int isLoaded) {
     return -1;
 }
+
+/* shadow calls this whenever it changes process context; the real version in
+ * interposer.c caches the process, and without the preload lib there is nothing to do */
+void interposer_setEmulatedProcess(void* proc) {
+    return;
+}
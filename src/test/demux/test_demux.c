@@ -0,0 +1,173 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+/*
+ * Micro-benchmark for network interface socket demultiplexing. Checks that the
+ * packed-key AssociationTable returns the same socket for every packet as the
+ * old string-keyed GHashTable lookups, before and after removing half the
+ * sockets, and reports the lookup throughput of both. The throughput is only
+ * reported, not checked.
+ */
+
+#include <glib.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "main/host/association_table.h"
+#include "main/host/protocol.h"
+#include "test/test_main_common.h"
+
+typedef struct _DemuxKey DemuxKey;
+struct _DemuxKey {
+    ProtocolType type;
+    in_port_t port;
+    in_addr_t peerIP;
+    in_port_t peerPort;
+};
+
+/* the old implementation as it existed in network_interface.c */
+static gchar* _test_getAssociationKey(in_addr_t interfaceIP, ProtocolType type,
+        in_port_t port, in_addr_t peerAddr, in_port_t peerPort) {
+    GString* strBuffer = g_string_new(NULL);
+    g_string_printf(strBuffer,
+            "%s|%"G_GUINT32_FORMAT":%"G_GUINT16_FORMAT"|%"G_GUINT32_FORMAT":%"G_GUINT16_FORMAT,
+            type == PTCP ? "TCP" : "UDP", (guint)interfaceIP, port, peerAddr, peerPort);
+    return g_string_free(strBuffer, FALSE);
+}
+
+static gpointer _test_stringDemux(GHashTable* table, in_addr_t interfaceIP, DemuxKey* key) {
+    gchar* general = _test_getAssociationKey(interfaceIP, key->type, key->port, 0, 0);
+    gpointer value = g_hash_table_lookup(table, general);
+    g_free(general);
+
+    if(!value) {
+        gchar* specific = _test_getAssociationKey(interfaceIP, key->type, key->port,
+                key->peerIP, key->peerPort);
+        value = g_hash_table_lookup(table, specific);
+        g_free(specific);
+    }
+
+    return value;
+}
+
+static gint64 _test_replayStringDemux(GHashTable* table, in_addr_t interfaceIP,
+        DemuxKey* packets, guint numPackets, gpointer* found) {
+    gint64 start = g_get_monotonic_time();
+    for(guint i = 0; i < numPackets; i++) {
+        found[i] = _test_stringDemux(table, interfaceIP, &packets[i]);
+    }
+    return MAX(g_get_monotonic_time() - start, 1);
+}
+
+static gint64 _test_replayPackedDemux(AssociationTable* table, DemuxKey* packets, guint numPackets,
+        gpointer* found) {
+    gint64 start = g_get_monotonic_time();
+    for(guint i = 0; i < numPackets; i++) {
+        DemuxKey* p = &packets[i];
+        found[i] = associationtable_demux(table, p->type, p->port, p->peerIP, p->peerPort);
+    }
+    return MAX(g_get_monotonic_time() - start, 1);
+}
+
+gint main(gint argc, gchar* argv[]) {
+    /* number of associated sockets and number of packets to demux */
+    guint numSockets = argc > 1 ? (guint)atoi(argv[1]) : 20000;
+    guint numPackets = argc > 2 ? (guint)atoi(argv[2]) : 200000;
+    in_addr_t interfaceIP = htonl(0x0b000001);
+
+    DemuxKey* keys = g_new0(DemuxKey, numSockets);
+    GHashTable* stringTable = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    AssociationTable* packedTable = associationtable_new(NULL);
+
+    for(guint i = 0; i < numSockets; i++) {
+        DemuxKey* key = &keys[i];
+        key->type = (i % 4 == 0) ? PUDP : PTCP;
+
+        if(i % 100 == 0) {
+            /* a listening server on a well-known port */
+            key->port = (in_port_t)(i / 100 + 1);
+        } else {
+            /* a connected client on an ephemeral port */
+            key->port = (in_port_t)(10000 + (i % 50000));
+            key->peerIP = (in_addr_t)test_nextRandom();
+            key->peerPort = (in_port_t)(test_nextRandom() | 1);
+        }
+
+        if(associationtable_lookup(packedTable, key->type, key->port, key->peerIP, key->peerPort)) {
+            /* skip duplicate tuples */
+            key->type = PNONE;
+            continue;
+        }
+
+        /* use the key address as the fake socket pointer */
+        g_hash_table_replace(stringTable, _test_getAssociationKey(interfaceIP, key->type,
+                key->port, key->peerIP, key->peerPort), key);
+        associationtable_insert(packedTable, key->type, key->port, key->peerIP, key->peerPort, key);
+    }
+
+    /* packets for listeners come from random peers, and some packets are for closed sockets */
+    DemuxKey* packets = g_new0(DemuxKey, numPackets);
+    for(guint i = 0; i < numPackets; i++) {
+        packets[i] = keys[test_nextRandom() % numSockets];
+        if(packets[i].peerIP == 0) {
+            packets[i].peerIP = (in_addr_t)test_nextRandom();
+            packets[i].peerPort = (in_port_t)test_nextRandom();
+        }
+        if(i % 16 == 0) {
+            packets[i].peerPort++;
+        }
+    }
+
+    gpointer* expected = g_new0(gpointer, numPackets);
+    gpointer* actual = g_new0(gpointer, numPackets);
+    gint result = EXIT_SUCCESS;
+
+    /* both implementations must agree on every packet, including after removals */
+    for(guint round = 0; round < 2; round++) {
+        gint64 stringMicros = _test_replayStringDemux(stringTable, interfaceIP, packets, numPackets, expected);
+        gint64 packedMicros = _test_replayPackedDemux(packedTable, packets, numPackets, actual);
+
+        g_print("round %u, %u sockets: string keys %.2f Mlookups/s, packed keys %.2f Mlookups/s, "
+                "speedup %.2fx\n", round, g_hash_table_size(stringTable),
+                (gdouble)numPackets / (gdouble)stringMicros,
+                (gdouble)numPackets / (gdouble)packedMicros,
+                (gdouble)stringMicros / (gdouble)packedMicros);
+
+        if(!test_checkResults("association table", expected, actual, numPackets, sizeof(gpointer))) {
+            g_printerr("in round %u\n", round);
+            result = EXIT_FAILURE;
+        }
+
+        for(guint i = 0; round == 0 && i < numSockets; i += 2) {
+            DemuxKey* key = &keys[i];
+            if(key->type == PNONE) {
+                continue;
+            }
+            gchar* stringKey = _test_getAssociationKey(interfaceIP, key->type,
+                    key->port, key->peerIP, key->peerPort);
+            g_hash_table_remove(stringTable, stringKey);
+            g_free(stringKey);
+            if(!associationtable_remove(packedTable, key->type, key->port, key->peerIP, key->peerPort)) {
+                g_printerr("failed to remove socket %u\n", i);
+                result = EXIT_FAILURE;
+            }
+        }
+    }
+
+    if(associationtable_getSize(packedTable) != g_hash_table_size(stringTable)) {
+        g_printerr("table sizes differ\n");
+        result = EXIT_FAILURE;
+    }
+
+    associationtable_free(packedTable);
+    g_hash_table_destroy(stringTable);
+    g_free(expected);
+    g_free(actual);
+    g_free(packets);
+    g_free(keys);
+
+    return result;
+}
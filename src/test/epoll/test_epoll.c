@@ -214,6 +214,71 @@ fail:
     return EXIT_FAILURE;
 }
 
+static int _test_pipe_edgetrigger_refill() {
+    /* Create a set of pipefds
+       pfd[0] == read, pfd[1] == write */
+    int pfds[2];
+    if(pipe(pfds) < 0) {
+        fprintf(stdout, "error: pipe could not be created!\n");
+        return EXIT_FAILURE;
+    }
+
+    struct epoll_event pevent;
+    pevent.events = EPOLLIN|EPOLLET;
+    pevent.data.fd = pfds[0];
+
+    int efd = epoll_create(1);
+    if(epoll_ctl(efd, EPOLL_CTL_ADD, pfds[0], &pevent) < 0) {
+        fprintf(stdout, "error: epoll_ctl failed\n");
+        return EXIT_FAILURE;
+    }
+
+    /* Collect the readable event */
+    if(_test_fd_write(pfds[1]) < 0) {
+        fprintf(stdout, "error: could not write to pipe\n");
+        goto fail;
+    }
+    int ready = epoll_wait(efd, &pevent, 1, 100);
+    if(ready != 1) {
+        fprintf(stdout, "error: epoll_wait returned %i instead of 1 event for the first write\n", ready);
+        goto fail;
+    }
+
+    /* the event was collected and the pipe did not change, so nothing is reported */
+    ready = epoll_wait(efd, &pevent, 1, 100);
+    if(ready != 0) {
+        fprintf(stdout, "error: epoll_wait returned %i instead of 0 events without changes to the pipe\n", ready);
+        goto fail;
+    }
+
+    /* now drain the pipe and fill it again without waiting in between. the pipe
+     * became unreadable and readable again, which is a new edge even though it
+     * was readable both times we looked. */
+    if(_test_fd_readCmp(pfds[0]) != 0) {
+        fprintf(stdout, "error: did not read 'test' from pipe.\n");
+        goto fail;
+    }
+    if(_test_fd_write(pfds[1]) < 0) {
+        fprintf(stdout, "error: could not write to pipe\n");
+        goto fail;
+    }
+
+    ready = epoll_wait(efd, &pevent, 1, 100);
+    if(ready != 1) {
+        fprintf(stdout, "error: epoll_wait returned %i instead of 1 event after draining and refilling the pipe\n", ready);
+        goto fail;
+    }
+
+    /* success! */
+    close(pfds[0]);
+    close(pfds[1]);
+    return EXIT_SUCCESS;
+fail:
+    close(pfds[0]);
+    close(pfds[1]);
+    return EXIT_FAILURE;
+}
+
 static int _test_creat() {
     int fd = creat("testepoll.txt", 0);
     if(fd < 0) {
@@ -264,6 +329,12 @@ int main(int argc, char* argv[]) {
         return EXIT_FAILURE;
     }
 
+    fprintf(stdout, "########## _test_pipe_edgetrigger_refill() started\n");
+    if(_test_pipe_edgetrigger_refill() != EXIT_SUCCESS) {
+        fprintf(stdout, "########## _test_pipe_edgetrigger_refill() failed\n");
+        return EXIT_FAILURE;
+    }
+
     fprintf(stdout, "########## _test_creat() started\n");
     if(_test_creat() != EXIT_SUCCESS) {
         fprintf(stdout, "########## _test_creat() failed\n");
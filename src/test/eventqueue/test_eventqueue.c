@@ -0,0 +1,422 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+/*
+ * Micro-benchmark for the scheduler's event queues. Replays a trace of event
+ * pushes and pops against the generic PriorityQueue (as the scheduler policies
+ * used it, with event_compare), the EventQueue, and the CalendarQueue, checks
+ * that all of them pop the events in the same order, and reports the replay
+ * times, which are not checked. It also checks eventqueue_countBefore and
+ * eventqueue_moveHostEvents against the events left in the queue at the end
+ * of the trace.
+ *
+ * The trace is either read from a file with one operation per line:
+ *   push <time> <dst host id> <src host id>
+ *   pop
+ * where events from each src host are numbered in push order, or recorded
+ * from a synthetic hold model where every popped event causes new events to
+ * be pushed a short random latency into the future.
+ */
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "main/core/support/definitions.h"
+#include "main/core/work/calendar_queue.h"
+#include "main/core/work/event.h"
+#include "main/core/work/event_queue.h"
+#include "main/utility/priority_queue.h"
+#include "test/test_main_common.h"
+
+/* the benchmark runs outside of shadow, so it provides its own minimal events.
+ * the queues only need event_getKey, event_getHost, and event_unref. */
+struct _Event {
+    SimulationTime time;
+    GQuark dstHostID;
+    GQuark srcHostID;
+    guint64 srcHostEventID;
+};
+
+typedef struct _TraceOp TraceOp;
+struct _TraceOp {
+    /* the event to push, or NULL to pop */
+    Event* event;
+};
+
+typedef struct _Trace Trace;
+struct _Trace {
+    GArray* ops;
+    GPtrArray* events;
+    guint numPops;
+};
+
+void event_getKey(Event* event, EventKey* key) {
+    key->time = event->time;
+    key->hostIDs = (((guint64)event->dstHostID) << 32) | ((guint64)event->srcHostID);
+    key->srcHostEventID = event->srcHostEventID;
+}
+
+gpointer event_getHost(Event* event) {
+    /* the test has no hosts, so the dst host id stands in for the host */
+    return GUINT_TO_POINTER(event->dstHostID);
+}
+
+void event_unref(Event* event) {
+    /* the trace owns the events */
+}
+
+/* the same order as event_compare, including the indirection through the host ids */
+static gint _test_compareEvents(const Event* a, const Event* b, gpointer userData) {
+    if(a->time != b->time) {
+        return a->time > b->time ? 1 : -1;
+    } else if(a->dstHostID != b->dstHostID) {
+        return a->dstHostID > b->dstHostID ? 1 : -1;
+    } else if(a->srcHostID != b->srcHostID) {
+        return a->srcHostID > b->srcHostID ? 1 : -1;
+    } else if(a->srcHostEventID != b->srcHostEventID) {
+        return a->srcHostEventID > b->srcHostEventID ? 1 : -1;
+    } else {
+        return 0;
+    }
+}
+
+static Event* _test_newEvent(Trace* trace, guint64* nextEventIDs, SimulationTime time,
+        GQuark dstHostID, GQuark srcHostID) {
+    Event* event = g_new0(Event, 1);
+    event->time = time;
+    event->dstHostID = dstHostID;
+    event->srcHostID = srcHostID;
+    event->srcHostEventID = nextEventIDs[srcHostID]++;
+    g_ptr_array_add(trace->events, event);
+    return event;
+}
+
+static void _test_appendOp(Trace* trace, Event* event) {
+    TraceOp op = {event};
+    g_array_append_val(trace->ops, op);
+    if(event == NULL) {
+        trace->numPops++;
+    }
+}
+
+static Trace* _test_newTrace() {
+    Trace* trace = g_new0(Trace, 1);
+    trace->ops = g_array_new(FALSE, FALSE, sizeof(TraceOp));
+    trace->events = g_ptr_array_new_with_free_func(g_free);
+    return trace;
+}
+
+static void _test_freeTrace(Trace* trace) {
+    g_array_free(trace->ops, TRUE);
+    g_ptr_array_free(trace->events, TRUE);
+    g_free(trace);
+}
+
+static Trace* _test_recordHoldTrace(guint numHosts, guint numEventsPerHost, guint numPops) {
+    Trace* trace = _test_newTrace();
+    guint64* nextEventIDs = g_new0(guint64, numHosts + 1);
+    PriorityQueue* queue = priorityqueue_new((GCompareDataFunc)_test_compareEvents, NULL, NULL);
+
+    /* host ids start at 1, like GQuarks */
+    for(guint host = 1; host <= numHosts; host++) {
+        for(guint i = 0; i < numEventsPerHost; i++) {
+            SimulationTime time = (SimulationTime)(test_nextRandom() % 1000) * SIMTIME_ONE_MICROSECOND;
+            Event* event = _test_newEvent(trace, nextEventIDs, time, host, host);
+            priorityqueue_push(queue, event);
+            _test_appendOp(trace, event);
+        }
+    }
+
+    /* the queue size stays near numHosts*numEventsPerHost, since each pop pushes one
+     * event on average: half of the time a packet to a random host, and otherwise
+     * either a local timer or nothing */
+    for(guint i = 0; i < numPops && !priorityqueue_isEmpty(queue); i++) {
+        Event* popped = priorityqueue_pop(queue);
+        _test_appendOp(trace, NULL);
+
+        GQuark srcHostID = popped->dstHostID;
+        guint32 choice = test_nextRandom() % 4;
+        if(choice <= 1) {
+            GQuark dstHostID = 1 + (test_nextRandom() % numHosts);
+            SimulationTime latency = (1 + (test_nextRandom() % 50)) * SIMTIME_ONE_MILLISECOND;
+            Event* event = _test_newEvent(trace, nextEventIDs, popped->time + latency, dstHostID, srcHostID);
+            priorityqueue_push(queue, event);
+            _test_appendOp(trace, event);
+        }
+        if(choice == 1 || choice == 2) {
+            SimulationTime delay = (test_nextRandom() % 1000) * SIMTIME_ONE_MICROSECOND;
+            Event* event = _test_newEvent(trace, nextEventIDs, popped->time + delay, srcHostID, srcHostID);
+            priorityqueue_push(queue, event);
+            _test_appendOp(trace, event);
+        }
+    }
+
+    priorityqueue_free(queue);
+    g_free(nextEventIDs);
+    return trace;
+}
+
+static Trace* _test_loadTrace(const gchar* path) {
+    FILE* file = fopen(path, "r");
+    if(!file) {
+        g_printerr("unable to open trace file '%s'\n", path);
+        return NULL;
+    }
+
+    Trace* trace = _test_newTrace();
+    GHashTable* nextEventIDs = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+
+    gchar line[256];
+    guint lineNum = 0;
+    while(fgets(line, sizeof(line), file)) {
+        lineNum++;
+        guint64 time = 0;
+        guint dstHostID = 0, srcHostID = 0;
+
+        if(g_str_has_prefix(line, "pop")) {
+            _test_appendOp(trace, NULL);
+        } else if(sscanf(line, "push %"G_GUINT64_FORMAT" %u %u", &time, &dstHostID, &srcHostID) == 3) {
+            guint64* nextEventID = g_hash_table_lookup(nextEventIDs, GUINT_TO_POINTER(srcHostID));
+            if(!nextEventID) {
+                nextEventID = g_new0(guint64, 1);
+                g_hash_table_insert(nextEventIDs, GUINT_TO_POINTER(srcHostID), nextEventID);
+            }
+
+            Event* event = g_new0(Event, 1);
+            event->time = (SimulationTime)time;
+            event->dstHostID = (GQuark)dstHostID;
+            event->srcHostID = (GQuark)srcHostID;
+            event->srcHostEventID = (*nextEventID)++;
+            g_ptr_array_add(trace->events, event);
+            _test_appendOp(trace, event);
+        } else if(line[0] != '\n' && line[0] != '#') {
+            g_printerr("skipping malformed line %u in trace file '%s'\n", lineNum, path);
+        }
+    }
+
+    fclose(file);
+    g_hash_table_destroy(nextEventIDs);
+    return trace;
+}
+
+static gint64 _test_replayPriorityQueue(Trace* trace, Event** popped) {
+    PriorityQueue* queue = priorityqueue_new((GCompareDataFunc)_test_compareEvents, NULL, NULL);
+    guint numPopped = 0;
+
+    gint64 start = g_get_monotonic_time();
+    for(guint i = 0; i < trace->ops->len; i++) {
+        TraceOp* op = &g_array_index(trace->ops, TraceOp, i);
+        if(op->event) {
+            priorityqueue_push(queue, op->event);
+        } else {
+            popped[numPopped++] = priorityqueue_pop(queue);
+        }
+    }
+    gint64 elapsed = MAX(g_get_monotonic_time() - start, 1);
+
+    priorityqueue_free(queue);
+    return elapsed;
+}
+
+static gint64 _test_replayEventQueue(Trace* trace, Event** popped) {
+    EventQueue* queue = eventqueue_new();
+    guint numPopped = 0;
+
+    gint64 start = g_get_monotonic_time();
+    for(guint i = 0; i < trace->ops->len; i++) {
+        TraceOp* op = &g_array_index(trace->ops, TraceOp, i);
+        if(op->event) {
+            eventqueue_push(queue, op->event);
+        } else {
+            popped[numPopped++] = eventqueue_pop(queue);
+        }
+    }
+    gint64 elapsed = MAX(g_get_monotonic_time() - start, 1);
+
+    eventqueue_free(queue);
+    return elapsed;
+}
+
+static gint64 _test_replayCalendarQueue(Trace* trace, Event** popped) {
+    CalendarQueue* queue = calendarqueue_new();
+    guint numPopped = 0;
+
+    gint64 start = g_get_monotonic_time();
+    for(guint i = 0; i < trace->ops->len; i++) {
+        TraceOp* op = &g_array_index(trace->ops, TraceOp, i);
+        if(op->event) {
+            calendarqueue_push(queue, op->event);
+        } else {
+            popped[numPopped++] = calendarqueue_pop(queue);
+        }
+    }
+    gint64 elapsed = MAX(g_get_monotonic_time() - start, 1);
+
+    calendarqueue_free(queue);
+    return elapsed;
+}
+
+static EventQueue* _test_replayIntoEventQueue(Trace* trace) {
+    EventQueue* queue = eventqueue_new();
+    for(guint i = 0; i < trace->ops->len; i++) {
+        TraceOp* op = &g_array_index(trace->ops, TraceOp, i);
+        if(op->event) {
+            eventqueue_push(queue, op->event);
+        } else {
+            eventqueue_pop(queue);
+        }
+    }
+    return queue;
+}
+
+#define TEST_NUM_COUNT_THRESHOLDS 5
+
+static gboolean _test_checkEventQueueCount(Trace* trace) {
+    EventQueue* queue = _test_replayIntoEventQueue(trace);
+
+    if(eventqueue_isEmpty(queue)) {
+        eventqueue_free(queue);
+        return TRUE;
+    }
+
+    /* spread the thresholds between the first event and a bit past the last one */
+    SimulationTime first = eventqueue_peekTime(queue);
+    SimulationTime thresholds[TEST_NUM_COUNT_THRESHOLDS];
+    gsize counted[TEST_NUM_COUNT_THRESHOLDS];
+    gsize actual[TEST_NUM_COUNT_THRESHOLDS] = {0};
+    for(guint j = 0; j < TEST_NUM_COUNT_THRESHOLDS; j++) {
+        thresholds[j] = first + (j * j * SIMTIME_ONE_MILLISECOND);
+        counted[j] = eventqueue_countBefore(queue, thresholds[j]);
+    }
+
+    Event* event = NULL;
+    while((event = eventqueue_pop(queue)) != NULL) {
+        for(guint j = 0; j < TEST_NUM_COUNT_THRESHOLDS; j++) {
+            if(event->time < thresholds[j]) {
+                actual[j]++;
+            }
+        }
+    }
+    eventqueue_free(queue);
+
+    gboolean isCorrect = TRUE;
+    for(guint j = 0; j < TEST_NUM_COUNT_THRESHOLDS; j++) {
+        if(counted[j] != actual[j]) {
+            g_printerr("event queue counted %zu events before %"G_GUINT64_FORMAT", but there were %zu\n",
+                    counted[j], thresholds[j], actual[j]);
+            isCorrect = FALSE;
+        }
+    }
+    return isCorrect;
+}
+
+/* pops everything from the queue, checking the order and the destination hosts */
+static gboolean _test_drainMovedQueue(EventQueue* queue, GQuark hostID, gboolean isMoved, gsize* numPopped) {
+    Event* previous = NULL;
+    Event* event = NULL;
+    while((event = eventqueue_pop(queue)) != NULL) {
+        if(previous && _test_compareEvents(previous, event, NULL) > 0) {
+            g_printerr("event queue popped events out of order after moving host %u\n", hostID);
+            return FALSE;
+        }
+        if((event->dstHostID == hostID) != isMoved) {
+            g_printerr("event for host %u was %s after moving host %u\n", event->dstHostID,
+                    isMoved ? "moved" : "left behind", hostID);
+            return FALSE;
+        }
+        previous = event;
+        (*numPopped)++;
+    }
+    return TRUE;
+}
+
+static gboolean _test_checkEventQueueMove(Trace* trace) {
+    EventQueue* queue = _test_replayIntoEventQueue(trace);
+    EventQueue* destination = eventqueue_new();
+
+    gsize numEvents = eventqueue_getLength(queue);
+    Event* next = eventqueue_peek(queue);
+    if(!next) {
+        eventqueue_free(queue);
+        eventqueue_free(destination);
+        return TRUE;
+    }
+
+    /* move the host of the next event, so that the root of the heap changes */
+    GQuark hostID = next->dstHostID;
+    gsize numMoved = eventqueue_moveHostEvents(queue, destination, event_getHost(next));
+
+    gsize numKept = 0, numReceived = 0;
+    gboolean isCorrect = _test_drainMovedQueue(queue, hostID, FALSE, &numKept) &&
+            _test_drainMovedQueue(destination, hostID, TRUE, &numReceived);
+
+    if(isCorrect && (numReceived != numMoved || numKept + numReceived != numEvents)) {
+        g_printerr("event queue moved %zu of %zu events for host %u, but %zu arrived and %zu stayed\n",
+                numMoved, numEvents, hostID, numReceived, numKept);
+        isCorrect = FALSE;
+    }
+
+    eventqueue_free(queue);
+    eventqueue_free(destination);
+    return isCorrect;
+}
+
+gint main(gint argc, gchar* argv[]) {
+    Trace* trace = NULL;
+
+    if(argc == 2) {
+        trace = _test_loadTrace(argv[1]);
+        if(!trace) {
+            return EXIT_FAILURE;
+        }
+    } else {
+        /* number of hosts, pending events per host, and number of pops */
+        guint numHosts = argc > 1 ? (guint)atoi(argv[1]) : 1000;
+        guint numEventsPerHost = argc > 2 ? (guint)atoi(argv[2]) : 10;
+        guint numPops = argc > 3 ? (guint)atoi(argv[3]) : 1000000;
+        trace = _test_recordHoldTrace(numHosts, numEventsPerHost, numPops);
+    }
+
+    Event** expected = g_new0(Event*, trace->numPops);
+    Event** actual = g_new0(Event*, trace->numPops);
+    Event** actualCalendar = g_new0(Event*, trace->numPops);
+
+    gint64 pqMicros = _test_replayPriorityQueue(trace, expected);
+    gint64 eqMicros = _test_replayEventQueue(trace, actual);
+    gint64 cqMicros = _test_replayCalendarQueue(trace, actualCalendar);
+
+    g_print("replayed %u operations, %u of them pops\n", trace->ops->len, trace->numPops);
+    g_print("priority queue: %"G_GINT64_FORMAT" us, %.2f Mops/s\n", pqMicros,
+            (gdouble)trace->ops->len / (gdouble)pqMicros);
+    g_print("event queue: %"G_GINT64_FORMAT" us, %.2f Mops/s, speedup %.2fx\n", eqMicros,
+            (gdouble)trace->ops->len / (gdouble)eqMicros, (gdouble)pqMicros / (gdouble)eqMicros);
+    g_print("calendar queue: %"G_GINT64_FORMAT" us, %.2f Mops/s, speedup %.2fx\n", cqMicros,
+            (gdouble)trace->ops->len / (gdouble)cqMicros, (gdouble)pqMicros / (gdouble)cqMicros);
+
+    gint result = EXIT_SUCCESS;
+
+    /* the execution order of events must not depend on the queue */
+    if(!test_checkResults("event queue", expected, actual, trace->numPops, sizeof(Event*))) {
+        result = EXIT_FAILURE;
+    }
+    if(!test_checkResults("calendar queue", expected, actualCalendar, trace->numPops, sizeof(Event*))) {
+        result = EXIT_FAILURE;
+    }
+
+    if(!_test_checkEventQueueCount(trace)) {
+        result = EXIT_FAILURE;
+    }
+    if(!_test_checkEventQueueMove(trace)) {
+        result = EXIT_FAILURE;
+    }
+
+    g_free(expected);
+    g_free(actual);
+    g_free(actualCalendar);
+    _test_freeTrace(trace);
+
+    return result;
+}
@@ -0,0 +1,302 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+/*
+ * Test for the LazyTimer. The timer runs against a minimal scheduler that
+ * executes the tasks it is given in time order, and the test checks when the
+ * timer expires and how many events it scheduled for a sequence of arms and
+ * disarms, including events that become stale when the timer is armed for an
+ * earlier time and events that the scheduler refuses.
+ */
+
+#include <glib.h>
+#include <stdlib.h>
+
+#include "main/core/support/definitions.h"
+#include "main/core/work/lazy_timer.h"
+#include "main/core/work/task.h"
+#include "main/core/worker.h"
+
+/* the test runs outside of shadow, so it provides its own minimal tasks.
+ * the timer only needs task_new and task_unref. */
+struct _Task {
+    TaskCallbackFunc execute;
+    gpointer callbackObject;
+    gpointer callbackArgument;
+    TaskObjectFreeFunc objectFree;
+    gint referenceCount;
+    SimulationTime time;
+};
+
+typedef struct _TestScheduler TestScheduler;
+struct _TestScheduler {
+    SimulationTime now;
+    /* events at or after this time are refused, like at the end of a simulation */
+    SimulationTime endTime;
+    /* the tasks that were scheduled but did not run yet, in time order */
+    GQueue* tasks;
+    guint numScheduled;
+};
+
+static TestScheduler scheduler;
+
+typedef struct _TestOwner TestOwner;
+struct _TestOwner {
+    gint referenceCount;
+    guint numExpired;
+    SimulationTime lastExpired;
+};
+
+Task* task_new(TaskCallbackFunc callback, gpointer callbackObject, gpointer callbackArgument,
+        TaskObjectFreeFunc objectFree, TaskArgumentFreeFunc argumentFree) {
+    Task* task = g_new0(Task, 1);
+    task->execute = callback;
+    task->callbackObject = callbackObject;
+    task->callbackArgument = callbackArgument;
+    task->objectFree = objectFree;
+    task->referenceCount = 1;
+    return task;
+}
+
+void task_unref(Task* task) {
+    if(--task->referenceCount <= 0) {
+        if(task->objectFree) {
+            task->objectFree(task->callbackObject);
+        }
+        g_free(task);
+    }
+}
+
+SimulationTime worker_getCurrentTime() {
+    return scheduler.now;
+}
+
+static gint _test_compareTasks(const Task* a, const Task* b, gpointer userData) {
+    /* a task goes after the queued tasks with the same time, so that they run
+     * in the order they were scheduled */
+    return a->time <= b->time ? -1 : 1;
+}
+
+gboolean worker_scheduleTask(Task* task, SimulationTime nanoDelay) {
+    SimulationTime time = scheduler.now + nanoDelay;
+    if(time >= scheduler.endTime) {
+        return FALSE;
+    }
+
+    task->referenceCount++;
+    task->time = time;
+    g_queue_insert_sorted(scheduler.tasks, task, (GCompareDataFunc)_test_compareTasks, NULL);
+    scheduler.numScheduled++;
+    return TRUE;
+}
+
+/* runs the tasks that are due up to and including the given time */
+static void _test_runUntil(SimulationTime time) {
+    while(!g_queue_is_empty(scheduler.tasks)) {
+        Task* task = g_queue_peek_head(scheduler.tasks);
+        if(task->time > time) {
+            break;
+        }
+        g_queue_pop_head(scheduler.tasks);
+        scheduler.now = task->time;
+        task->execute(task->callbackObject, task->callbackArgument);
+        task_unref(task);
+    }
+    scheduler.now = time;
+}
+
+static void _test_ownerRef(TestOwner* owner) {
+    owner->referenceCount++;
+}
+
+static void _test_ownerUnref(TestOwner* owner) {
+    owner->referenceCount--;
+}
+
+static void _test_onExpired(TestOwner* owner) {
+    owner->numExpired++;
+    owner->lastExpired = scheduler.now;
+}
+
+static LazyTimer* _test_setUp(TestOwner* owner) {
+    scheduler.now = 1000;
+    scheduler.endTime = SIMTIME_MAX;
+    scheduler.tasks = g_queue_new();
+    scheduler.numScheduled = 0;
+    *owner = (TestOwner){0};
+    return lazytimer_new((LazyTimerExpiredFunc)_test_onExpired, owner,
+            (LazyTimerOwnerRefFunc)_test_ownerRef, (LazyTimerOwnerUnrefFunc)_test_ownerUnref);
+}
+
+/* runs the remaining tasks and checks that the timer released the owner */
+static gboolean _test_tearDown(const gchar* name, LazyTimer* timer, TestOwner* owner) {
+    _test_runUntil(SIMTIME_MAX - 1);
+    g_queue_free(scheduler.tasks);
+    lazytimer_free(timer);
+
+    if(owner->referenceCount != 0) {
+        g_printerr("%s: the timer holds %i owner references after all events ran\n",
+                name, owner->referenceCount);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static gboolean _test_check(const gchar* name, const gchar* what, guint64 actual, guint64 expected) {
+    if(actual != expected) {
+        g_printerr("%s: %s was %"G_GUINT64_FORMAT" instead of %"G_GUINT64_FORMAT"\n",
+                name, what, actual, expected);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static gboolean _test_expires() {
+    const gchar* name = "expire";
+    TestOwner owner;
+    LazyTimer* timer = _test_setUp(&owner);
+    gboolean success = TRUE;
+
+    lazytimer_arm(timer, 1100);
+    success = _test_check(name, "armed", lazytimer_isArmed(timer), TRUE) && success;
+    success = _test_check(name, "expire time", lazytimer_getExpireTime(timer), 1100) && success;
+    success = _test_check(name, "owner references", owner.referenceCount, 1) && success;
+
+    _test_runUntil(1099);
+    success = _test_check(name, "expirations before the expire time", owner.numExpired, 0) && success;
+    _test_runUntil(1100);
+    success = _test_check(name, "expirations", owner.numExpired, 1) && success;
+    success = _test_check(name, "armed after expiring", lazytimer_isArmed(timer), FALSE) && success;
+
+    return _test_tearDown(name, timer, &owner) && success;
+}
+
+static gboolean _test_rearmLater() {
+    const gchar* name = "rearm later";
+    TestOwner owner;
+    LazyTimer* timer = _test_setUp(&owner);
+    gboolean success = TRUE;
+
+    /* pushing the timer back while its event is pending schedules nothing */
+    for(guint i = 0; i < 10; i++) {
+        lazytimer_arm(timer, scheduler.now + 200);
+        _test_runUntil(scheduler.now + 10);
+    }
+    success = _test_check(name, "scheduled events", scheduler.numScheduled, 1) && success;
+    success = _test_check(name, "expirations", owner.numExpired, 0) && success;
+
+    /* the event fired early and scheduled one event for the rest of the time */
+    SimulationTime expireTime = lazytimer_getExpireTime(timer);
+    _test_runUntil(SIMTIME_MAX - 1);
+    success = _test_check(name, "expirations", owner.numExpired, 1) && success;
+    success = _test_check(name, "expiration time", owner.lastExpired, expireTime) && success;
+    success = _test_check(name, "scheduled events", scheduler.numScheduled, 2) && success;
+
+    return _test_tearDown(name, timer, &owner) && success;
+}
+
+static gboolean _test_armEarlier() {
+    const gchar* name = "arm earlier";
+    TestOwner owner;
+    LazyTimer* timer = _test_setUp(&owner);
+    gboolean success = TRUE;
+
+    /* the second arm replaces the pending event, which becomes stale */
+    lazytimer_arm(timer, 1500);
+    lazytimer_arm(timer, 1200);
+    success = _test_check(name, "scheduled events", scheduler.numScheduled, 2) && success;
+    success = _test_check(name, "owner references", owner.referenceCount, 2) && success;
+
+    _test_runUntil(1200);
+    success = _test_check(name, "expirations", owner.numExpired, 1) && success;
+    success = _test_check(name, "expiration time", owner.lastExpired, 1200) && success;
+
+    /* the stale event must not expire the timer again */
+    _test_runUntil(1500);
+    success = _test_check(name, "expirations after the stale event", owner.numExpired, 1) && success;
+
+    /* a stale event at the same time as the live one expires the timer once */
+    lazytimer_arm(timer, 2000);
+    lazytimer_arm(timer, 1800);
+    _test_runUntil(1800);
+    lazytimer_arm(timer, 2000);
+    _test_runUntil(2000);
+    success = _test_check(name, "expirations at the stale event time", owner.numExpired, 3) && success;
+    success = _test_check(name, "expiration time", owner.lastExpired, 2000) && success;
+
+    return _test_tearDown(name, timer, &owner) && success;
+}
+
+static gboolean _test_disarm() {
+    const gchar* name = "disarm";
+    TestOwner owner;
+    LazyTimer* timer = _test_setUp(&owner);
+    gboolean success = TRUE;
+
+    lazytimer_arm(timer, 1100);
+    lazytimer_disarm(timer);
+    success = _test_check(name, "armed", lazytimer_isArmed(timer), FALSE) && success;
+    _test_runUntil(1100);
+    success = _test_check(name, "expirations", owner.numExpired, 0) && success;
+    success = _test_check(name, "owner references", owner.referenceCount, 0) && success;
+
+    /* rearming for a later time reuses the pending event */
+    lazytimer_arm(timer, 1200);
+    lazytimer_disarm(timer);
+    lazytimer_arm(timer, 1300);
+    success = _test_check(name, "scheduled events", scheduler.numScheduled, 2) && success;
+    _test_runUntil(1300);
+    success = _test_check(name, "expirations after rearming later", owner.numExpired, 1) && success;
+    success = _test_check(name, "expiration time", owner.lastExpired, 1300) && success;
+
+    /* rearming for an earlier time schedules a new event */
+    lazytimer_arm(timer, 1500);
+    lazytimer_disarm(timer);
+    lazytimer_arm(timer, 1400);
+    success = _test_check(name, "scheduled events", scheduler.numScheduled, 5) && success;
+    _test_runUntil(1500);
+    success = _test_check(name, "expirations after rearming earlier", owner.numExpired, 2) && success;
+    success = _test_check(name, "expiration time", owner.lastExpired, 1400) && success;
+
+    return _test_tearDown(name, timer, &owner) && success;
+}
+
+static gboolean _test_refused() {
+    const gchar* name = "refused";
+    TestOwner owner;
+    LazyTimer* timer = _test_setUp(&owner);
+    gboolean success = TRUE;
+
+    scheduler.endTime = 2000;
+
+    /* the timer can't expire, so it must not look armed */
+    lazytimer_arm(timer, 2500);
+    success = _test_check(name, "armed past the end", lazytimer_isArmed(timer), FALSE) && success;
+    success = _test_check(name, "owner references", owner.referenceCount, 0) && success;
+
+    /* the same when the remaining time is past the end after the event fired */
+    lazytimer_arm(timer, 1500);
+    lazytimer_arm(timer, 2500);
+    success = _test_check(name, "armed before the event", lazytimer_isArmed(timer), TRUE) && success;
+    _test_runUntil(1500);
+    success = _test_check(name, "armed after the event", lazytimer_isArmed(timer), FALSE) && success;
+    success = _test_check(name, "expirations", owner.numExpired, 0) && success;
+
+    /* and it can be armed again */
+    lazytimer_arm(timer, 1600);
+    _test_runUntil(1600);
+    success = _test_check(name, "expirations after arming again", owner.numExpired, 1) && success;
+
+    return _test_tearDown(name, timer, &owner) && success;
+}
+
+gint main(gint argc, gchar* argv[]) {
+    gboolean success = _test_expires();
+    success = _test_rearmLater() && success;
+    success = _test_armEarlier() && success;
+    success = _test_disarm() && success;
+    success = _test_refused() && success;
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,158 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+/*
+ * Test for the binary log records that worker threads hand to the logger
+ * helper thread. It checks that:
+ *   - encoding a message and formatting the record gives the same message as
+ *     formatting it directly with printf, for all supported conversions and
+ *     for formats that fall back to formatting on the logging thread
+ *   - entries written to a LogRing by one thread are read back in order and
+ *     intact by another, including across wrap-arounds and when the ring fills
+ */
+
+#include <glib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "main/core/logger/log_record.h"
+#include "main/core/logger/log_ring.h"
+
+static guint32 nextCallsiteID = 0;
+
+/* encodes a message like a worker thread, formats the record like the helper
+ * thread, and compares the message part of the log line with printf */
+static gboolean _test_checkFormat(const gchar* format, ...) {
+    va_list vargs, vargsCopy;
+    va_start(vargs, format);
+    va_copy(vargsCopy, vargs);
+
+    LogCallsite* callsite = logcallsite_new(nextCallsiteID++, "/path/to/file.c", "function", 42, format);
+    GByteArray* buffer = g_byte_array_new();
+
+    /* the helper only gets the call site through its encoded definition */
+    logrecord_encodeCallsite(buffer, callsite);
+    LogCallsite* decoded = logcallsite_decode(buffer->data, buffer->len);
+
+    logrecord_encode(buffer, callsite, LOGLEVEL_INFO, 3723.5, 1000000001, 7, "host", "11.0.0.1", vargs);
+    GString* line = g_string_new(NULL);
+    logrecord_format(buffer->data, decoded, line);
+
+    gchar* expectedMessage = g_strdup_vprintf(format, vargsCopy);
+    gchar* expectedLine = g_strdup_printf("01:02:03.500000 [thread-7] 00:00:01.000000001 [info] "
+            "[host~11.0.0.1] [file.c:42] [function] %s\n", expectedMessage);
+
+    gboolean success = g_strcmp0(line->str, expectedLine) == 0;
+    if(!success) {
+        g_printerr("format '%s' gave log line\n\t%sinstead of\n\t%s", format, line->str, expectedLine);
+    }
+
+    g_free(expectedLine);
+    g_free(expectedMessage);
+    g_string_free(line, TRUE);
+    g_byte_array_free(buffer, TRUE);
+    logcallsite_free(decoded);
+    logcallsite_free(callsite);
+    va_end(vargsCopy);
+    va_end(vargs);
+    return success;
+}
+
+static gboolean _test_formats() {
+    gboolean success = TRUE;
+    success = _test_checkFormat("no arguments") && success;
+    success = _test_checkFormat("%d %i %u %x %X %o %c %%", -5, 6, 7u, 255, 255, 8, 'Q') && success;
+    success = _test_checkFormat("%hhd %hd %ld %lld %zu %jd %td", 300, 70000, -3L, -12345678901LL,
+            (size_t)99, (intmax_t)-1, (ptrdiff_t)5) && success;
+    success = _test_checkFormat("%f %5.2f %e %g %G %a %Lf", 3.14159, 2.5, 1e10, 0.0001, 2.5, 1.0,
+            (long double)1.25L) && success;
+    success = _test_checkFormat("%*d|%-*.*f|%08.3f|%+i|%#o|% d", 6, 3, 8, 2, 1.5, 2.25, 3, 8, 4) && success;
+    success = _test_checkFormat("%s and %s, %10s|%-10s|", "one", "two", "right", "left") && success;
+    success = _test_checkFormat("%s %p", (const gchar*)NULL, (void*)0x1234) && success;
+    /* these are formatted on the logging thread */
+    success = _test_checkFormat("%.*s!", 3, "abcdef") && success;
+    success = _test_checkFormat("%.2s!", "abcdef") && success;
+    success = _test_checkFormat("%2$s %1$s", "world", "hello") && success;
+    return success;
+}
+
+typedef struct _TestRingData TestRingData;
+struct _TestRingData {
+    LogRing* ring;
+    guint numEntries;
+};
+
+static gsize _test_getEntryLength(LogRing* ring, guint i) {
+    /* varies the lengths so that entries end at all offsets in the buffer */
+    return 1 + ((gsize)i * 7919) % logring_getMaxEntryLength(ring);
+}
+
+static gpointer _test_runRingProducer(TestRingData* data) {
+    guchar* entry = g_malloc(logring_getMaxEntryLength(data->ring));
+
+    for(guint i = 0; i < data->numEntries; i++) {
+        gsize length = _test_getEntryLength(data->ring, i);
+        memset(entry, (guchar)i, length);
+        while(!logring_write(data->ring, entry, length)) {
+            logring_publish(data->ring);
+            g_thread_yield();
+        }
+        if(i % 8 == 0) {
+            logring_publish(data->ring);
+        }
+    }
+    logring_publish(data->ring);
+
+    g_free(entry);
+    return NULL;
+}
+
+static gboolean _test_ring(guint numEntries) {
+    TestRingData data = {.ring = logring_new(16*1024), .numEntries = numEntries};
+    GThread* producer = g_thread_new("producer", (GThreadFunc)_test_runRingProducer, &data);
+
+    gboolean success = TRUE;
+    for(guint i = 0; i < numEntries;) {
+        gsize length = 0;
+        const guchar* entry = logring_peek(data.ring, &length);
+        if(!entry) {
+            g_thread_yield();
+            continue;
+        }
+
+        /* the producer is blocked on a full ring if we stop, so we keep consuming */
+        if(success && (length != _test_getEntryLength(data.ring, i) ||
+                entry[0] != (guchar)i || entry[length-1] != (guchar)i)) {
+            g_printerr("ring entry %u is corrupt\n", i);
+            success = FALSE;
+        }
+        if(((guintptr)entry) % 8 != 0) {
+            g_printerr("ring entry %u is not aligned\n", i);
+            success = FALSE;
+        }
+
+        logring_consume(data.ring);
+        i++;
+    }
+
+    g_thread_join(producer);
+    if(logring_peek(data.ring, NULL) != NULL) {
+        g_printerr("the ring has more entries than were written\n");
+        success = FALSE;
+    }
+    logring_free(data.ring);
+    return success;
+}
+
+gint main(gint argc, gchar* argv[]) {
+    guint numEntries = argc > 1 ? (guint)atoi(argv[1]) : 200000;
+
+    gboolean success = _test_formats();
+    success = _test_ring(numEntries) && success;
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
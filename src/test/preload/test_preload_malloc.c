@@ -0,0 +1,78 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+/*
+ * Benchmark for the cost of an intercepted call. Times a loop of malloc and
+ * free calls, which go through the preload library's interposition check and
+ * into shadow when run as a plug-in, and straight to libc when run outside of
+ * shadow. Compare the cost per call of the two runs, or of the plug-in run
+ * before and after a change to the preload library.
+ *
+ * Under shadow, clock_gettime returns the simulated time, which does not move
+ * while the plug-in runs, so the loop is timed with the CPU's time stamp
+ * counter instead and the cost is reported in cycles.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <x86intrin.h>
+
+#define NUM_ROUNDS 5
+#define NUM_LIVE 64
+
+static int _test_mallocFree(long numPairs, uint64_t* cycles) {
+    /* keep a few allocations live so that the allocator does not just hand
+     * back the same chunk, and touch each one so the calls can't be elided */
+    void* live[NUM_LIVE] = {0};
+
+    uint64_t start = __rdtsc();
+    for(long i = 0; i < numPairs; i++) {
+        int slot = (int)(i % NUM_LIVE);
+        free(live[slot]);
+        size_t size = (size_t)(16 + ((i * 37) % 1024));
+        live[slot] = malloc(size);
+        if(!live[slot]) {
+            return EXIT_FAILURE;
+        }
+        memset(live[slot], (int)i, 1);
+    }
+    *cycles = __rdtsc() - start;
+
+    for(int slot = 0; slot < NUM_LIVE; slot++) {
+        free(live[slot]);
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[]) {
+    fprintf(stdout, "########## preload malloc benchmark starting ##########\n");
+
+    long numPairs = argc > 1 ? atol(argv[1]) : 1000000;
+    if(numPairs <= 0) {
+        fprintf(stdout, "########## the number of malloc/free pairs must be positive\n");
+        return EXIT_FAILURE;
+    }
+
+    /* report the fastest round, which is the least disturbed by the rest of the system */
+    uint64_t best = UINT64_MAX;
+    for(int round = 0; round < NUM_ROUNDS; round++) {
+        uint64_t cycles = 0;
+        if(_test_mallocFree(numPairs, &cycles) != EXIT_SUCCESS) {
+            fprintf(stdout, "########## malloc failed in round %i\n", round);
+            return EXIT_FAILURE;
+        }
+        if(cycles < best) {
+            best = cycles;
+        }
+    }
+
+    fprintf(stdout, "%ld malloc/free pairs: %.1f cycles per call\n",
+            numPairs, (double)best / (double)(2 * numPairs));
+
+    fprintf(stdout, "########## preload malloc benchmark passed! ##########\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,232 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+/*
+ * Test for the TCP retransmit queue. Besides some basic checks, it records the
+ * sequence of queue operations that a bulk sender with a fixed congestion
+ * window performs (sending packets, taking lost packets out for a
+ * retransmission and putting them back, and clearing the packets covered by
+ * each cumulative ACK), and replays it against the RetransmitQueue and against
+ * a hash table that is scanned on every ACK, like the old _tcp_clearRetransmit
+ * did. For each congestion window from the minimum to the maximum, doubling,
+ * it checks that both remove the same packets and reports the replay cost per
+ * ACK of each of them. The costs are only reported, not checked.
+ */
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "main/host/descriptor/tcp_retransmit_queue.h"
+#include "test/test_main_common.h"
+
+typedef enum _TraceOpType TraceOpType;
+enum _TraceOpType {
+    TRACE_OP_SEND, TRACE_OP_RETRANSMIT, TRACE_OP_ACK,
+};
+
+typedef struct _TraceOp TraceOp;
+struct _TraceOp {
+    TraceOpType type;
+    /* the packet that is sent or retransmitted, or the cumulative ACK */
+    guint sequence;
+};
+
+typedef struct _Trace Trace;
+struct _Trace {
+    GArray* ops;
+    guint numAcks;
+};
+
+static void _test_addOp(Trace* trace, TraceOpType type, guint sequence) {
+    TraceOp op = {.type = type, .sequence = sequence};
+    g_array_append_val(trace->ops, op);
+    if(type == TRACE_OP_ACK) {
+        trace->numAcks++;
+    }
+}
+
+/* every ACK acknowledges two packets (as with delayed ACKs), after which two
+ * new packets are sent. now and then a packet in the window is lost; it is
+ * taken out of the queue and put back when it is sent again one ACK later. */
+static Trace* _test_recordTrace(guint cwnd, guint numAcks) {
+    Trace* trace = g_new0(Trace, 1);
+    trace->ops = g_array_new(FALSE, FALSE, sizeof(TraceOp));
+
+    /* sequence number 0 is never queued for data packets */
+    guint unacked = 1;
+    guint next = 1;
+    guint lost = 0;
+
+    while(next < unacked + cwnd) {
+        _test_addOp(trace, TRACE_OP_SEND, next++);
+    }
+
+    for(guint i = 0; i < numAcks; i++) {
+        if(lost != 0) {
+            _test_addOp(trace, TRACE_OP_SEND, lost);
+            lost = 0;
+        }
+        if(test_nextRandom() % 32 == 0) {
+            lost = unacked + 2 + (test_nextRandom() % (cwnd - 2));
+            _test_addOp(trace, TRACE_OP_RETRANSMIT, lost);
+        }
+
+        /* the receiver can't ack past a packet it didn't get */
+        guint ack = unacked + 2;
+        if(lost != 0 && ack > lost) {
+            ack = lost;
+        }
+        _test_addOp(trace, TRACE_OP_ACK, ack);
+        unacked = ack;
+
+        while(next < unacked + cwnd) {
+            _test_addOp(trace, TRACE_OP_SEND, next++);
+        }
+    }
+
+    return trace;
+}
+
+static void _test_freeTrace(Trace* trace) {
+    g_array_free(trace->ops, TRUE);
+    g_free(trace);
+}
+
+static inline gpointer _test_getPacket(guint sequence) {
+    /* the queues only need a non-NULL value for each sequence number */
+    return GUINT_TO_POINTER(sequence);
+}
+
+static gint64 _test_replayHashTableScan(Trace* trace, guint* removed) {
+    GHashTable* table = g_hash_table_new(g_direct_hash, g_direct_equal);
+    guint numResults = 0;
+
+    gint64 start = g_get_monotonic_time();
+    for(guint i = 0; i < trace->ops->len; i++) {
+        TraceOp* op = &g_array_index(trace->ops, TraceOp, i);
+        gpointer key = GUINT_TO_POINTER(op->sequence);
+
+        if(op->type == TRACE_OP_SEND) {
+            if(g_hash_table_lookup(table, key) == NULL) {
+                g_hash_table_insert(table, key, _test_getPacket(op->sequence));
+            }
+        } else if(op->type == TRACE_OP_RETRANSMIT) {
+            removed[numResults++] = g_hash_table_steal(table, key) ? 1 : 0;
+        } else {
+            GHashTableIter iter;
+            gpointer sequence, value;
+            guint numRemoved = 0;
+
+            g_hash_table_iter_init(&iter, table);
+            while(g_hash_table_iter_next(&iter, &sequence, &value)) {
+                if(GPOINTER_TO_UINT(sequence) < op->sequence) {
+                    g_hash_table_iter_remove(&iter);
+                    numRemoved++;
+                }
+            }
+            removed[numResults++] = numRemoved;
+        }
+    }
+    gint64 elapsed = MAX(g_get_monotonic_time() - start, 1);
+
+    g_hash_table_destroy(table);
+    return elapsed;
+}
+
+static gint64 _test_replayRetransmitQueue(Trace* trace, guint* removed) {
+    RetransmitQueue* queue = retransmitqueue_new(NULL);
+    guint numResults = 0;
+    guint lastAck = 0;
+
+    gint64 start = g_get_monotonic_time();
+    for(guint i = 0; i < trace->ops->len; i++) {
+        TraceOp* op = &g_array_index(trace->ops, TraceOp, i);
+
+        if(op->type == TRACE_OP_SEND) {
+            retransmitqueue_insert(queue, op->sequence, _test_getPacket(op->sequence));
+        } else if(op->type == TRACE_OP_RETRANSMIT) {
+            removed[numResults++] = retransmitqueue_steal(queue, op->sequence) ? 1 : 0;
+        } else {
+            removed[numResults++] =
+                    retransmitqueue_removeRange(queue, lastAck, op->sequence, NULL, NULL);
+            lastAck = op->sequence;
+        }
+    }
+    gint64 elapsed = MAX(g_get_monotonic_time() - start, 1);
+
+    retransmitqueue_free(queue);
+    return elapsed;
+}
+
+static gboolean _test_checkRetransmitQueue() {
+    RetransmitQueue* queue = retransmitqueue_new(NULL);
+    gboolean success = TRUE;
+
+    /* fill, take out the first packet, ack past it, and put it back in front */
+    for(guint sequence = 10; sequence < 200; sequence++) {
+        retransmitqueue_insert(queue, sequence, _test_getPacket(sequence));
+    }
+    success = success && retransmitqueue_insert(queue, 10, _test_getPacket(10)) == FALSE;
+    success = success && retransmitqueue_steal(queue, 10) == _test_getPacket(10);
+    success = success && retransmitqueue_removeRange(queue, 0, 100, NULL, NULL) == 89;
+    success = success && retransmitqueue_lookup(queue, 99) == NULL;
+    success = success && retransmitqueue_insert(queue, 10, _test_getPacket(10));
+    success = success && retransmitqueue_lookup(queue, 10) == _test_getPacket(10);
+    success = success && retransmitqueue_lookup(queue, 150) == _test_getPacket(150);
+    success = success && retransmitqueue_getLength(queue) == 101;
+
+    /* a range that only partially overlaps the queue */
+    success = success && retransmitqueue_removeRange(queue, 190, (guint)-1, NULL, NULL) == 10;
+    success = success && retransmitqueue_removeRange(queue, 0, 11, NULL, NULL) == 1;
+    success = success && retransmitqueue_getLength(queue) == 90;
+    success = success && retransmitqueue_removeRange(queue, 0, (guint)-1, NULL, NULL) == 90;
+    success = success && retransmitqueue_isEmpty(queue);
+
+    if(!success) {
+        g_printerr("retransmit queue failed the basic checks\n");
+    }
+
+    retransmitqueue_free(queue);
+    return success;
+}
+
+gint main(gint argc, gchar* argv[]) {
+    /* smallest and largest congestion window in packets, and number of ACKs */
+    guint minCwnd = argc > 1 ? (guint)atoi(argv[1]) : 16;
+    guint maxCwnd = argc > 2 ? (guint)atoi(argv[2]) : 4096;
+    guint numAcks = argc > 3 ? (guint)atoi(argv[3]) : 20000;
+
+    gint result = _test_checkRetransmitQueue() ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    for(guint cwnd = MAX(minCwnd, 4); cwnd <= maxCwnd; cwnd *= 2) {
+        Trace* trace = _test_recordTrace(cwnd, numAcks);
+        guint numResults = trace->ops->len;
+
+        guint* expected = g_new0(guint, numResults);
+        guint* actual = g_new0(guint, numResults);
+
+        gint64 scanMicros = _test_replayHashTableScan(trace, expected);
+        gint64 queueMicros = _test_replayRetransmitQueue(trace, actual);
+
+        g_print("cwnd %u packets: hash table scan %.1f ns/ack, retransmit queue %.1f ns/ack\n",
+                cwnd, 1000.0 * scanMicros / trace->numAcks, 1000.0 * queueMicros / trace->numAcks);
+
+        if(!test_checkResults("retransmit queue", expected, actual, numResults, sizeof(guint))) {
+            g_printerr("with a congestion window of %u packets\n", cwnd);
+            result = EXIT_FAILURE;
+        }
+
+        g_free(expected);
+        g_free(actual);
+        _test_freeTrace(trace);
+
+        if(result != EXIT_SUCCESS) {
+            break;
+        }
+    }
+
+    return result;
+}
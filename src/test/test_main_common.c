@@ -0,0 +1,47 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+/*
+ * Common code for the tests that build parts of shadow's main sources
+ * directly into the test executable instead of running in shadow.
+ */
+
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "main/utility/utility.h"
+#include "test/test_main_common.h"
+
+static guint64 rngState = 0x5eed5eed5eed5eedULL;
+
+/* the main sources assert with utility_assert, which fails the test here */
+void utility_handleError(const gchar* file, gint line, const gchar* function, const gchar* message) {
+    g_printerr("**ERROR encountered**\n\tAt file: %s\n\tAt line: %d\n\tAt function: %s\n\tMessage: %s\n",
+            file, line, function, message);
+    abort();
+}
+
+guint32 test_nextRandom() {
+    /* xorshift64, deterministic across runs */
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return (guint32)(rngState >> 32);
+}
+
+gboolean test_checkResults(const gchar* name, gconstpointer expected, gconstpointer actual,
+        guint numResults, gsize resultSize) {
+    const guint8* expectedBytes = expected;
+    const guint8* actualBytes = actual;
+
+    for(guint i = 0; i < numResults; i++) {
+        if(memcmp(&expectedBytes[i * resultSize], &actualBytes[i * resultSize], resultSize) != 0) {
+            g_printerr("%s disagrees at result %u of %u\n", name, i, numResults);
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
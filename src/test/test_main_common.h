@@ -0,0 +1,20 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SRC_TEST_SHD_TEST_MAIN_COMMON_H_
+#define SRC_TEST_SHD_TEST_MAIN_COMMON_H_
+
+#include <glib.h>
+
+/* returns the next number of a pseudo-random sequence that is the same in every run */
+guint32 test_nextRandom();
+
+/* checks that replaying a trace against the old and the new implementation
+ * gave the same results, reporting the first result where they disagree.
+ * both arrays hold numResults results of resultSize bytes each. */
+gboolean test_checkResults(const gchar* name, gconstpointer expected, gconstpointer actual,
+        guint numResults, gsize resultSize);
+
+#endif /* SRC_TEST_SHD_TEST_MAIN_COMMON_H_ */
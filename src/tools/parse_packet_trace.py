@@ -0,0 +1,65 @@
+#!/usr/bin/python
+
+'''
+Convert the binary packet trace files that shadow writes with --packet-trace
+into tab-separated text, one packet delivery status per line. Records from
+several trace files (one per worker thread) are merged and sorted by time.
+The record layout must match PacketTraceRecord in src/main/routing/packet_trace.h.
+'''
+
+from __future__ import print_function
+import socket
+import struct
+import sys
+
+MAGIC = b"SHDPKTTR"
+HEADER = struct.Struct("=8sII")
+RECORD = struct.Struct("=QQIIIIHHHHIIII")
+
+PROTOCOLS = {1: "LOCAL", 2: "TCP", 3: "UDP"}
+
+# indexed by the bit position of each PacketDeliveryStatusFlags value
+STATUSES = ["UNUSED", "SND_CREATED", "SND_TCP_ENQUEUE_THROTTLED",
+    "SND_TCP_ENQUEUE_RETRANSMIT", "SND_TCP_DEQUEUE_RETRANSMIT", "SND_TCP_RETRANSMITTED",
+    "SND_SOCKET_BUFFERED", "SND_INTERFACE_SENT", "INET_SENT", "INET_DROPPED",
+    "ROUTER_ENQUEUED", "ROUTER_DEQUEUED", "ROUTER_DROPPED", "RCV_INTERFACE_RECEIVED",
+    "RCV_INTERFACE_DROPPED", "RCV_SOCKET_PROCESSED", "RCV_SOCKET_DROPPED",
+    "RCV_TCP_ENQUEUE_UNORDERED", "RCV_SOCKET_BUFFERED", "RCV_SOCKET_DELIVERED", "DESTROYED"]
+
+def status_to_string(status):
+    bit = status.bit_length() - 1
+    return STATUSES[bit] if 0 < bit < len(STATUSES) else "NONE" if status == 0 else "UNKNOWN"
+
+def read_records(filename):
+    with open(filename, 'rb') as f:
+        magic, version, record_size = HEADER.unpack(f.read(HEADER.size))
+        if magic != MAGIC or record_size != RECORD.size:
+            print("{0} is not a packet trace file of a supported version".format(filename), file=sys.stderr)
+            return
+        while True:
+            data = f.read(record_size)
+            if len(data) < record_size:
+                break
+            yield RECORD.unpack(data)
+
+def main():
+    if len(sys.argv) < 2:
+        print("USAGE: {0} packet-trace.0.bin [packet-trace.1.bin ...]".format(sys.argv[0]), file=sys.stderr)
+        exit(1)
+
+    records = []
+    for filename in sys.argv[1:]:
+        records.extend(read_records(filename))
+    records.sort(key=lambda r: r[0])
+
+    print("time_ns\tpacket\tstatus\tprotocol\tsource\tdestination\tflags\tseq\tack\tbytes")
+    for (time, packet_id, host_id, status, src_ip, dst_ip, src_port, dst_port,
+            protocol, tcp_flags, seq, ack, length, _) in records:
+        # addresses and ports are in network byte order
+        src = "{0}:{1}".format(socket.inet_ntoa(struct.pack("=I", src_ip)), socket.ntohs(src_port))
+        dst = "{0}:{1}".format(socket.inet_ntoa(struct.pack("=I", dst_ip)), socket.ntohs(dst_port))
+        print("{0}\t{1}:{2}\t{3}\t{4}\t{5}\t{6}\t{7}\t{8}\t{9}\t{10}".format(time, host_id, packet_id,
+            status_to_string(status), PROTOCOLS.get(protocol, "UNKNOWN"), src, dst, tcp_flags, seq, ack, length))
+
+if __name__ == '__main__':
+    main()